@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <chrono>
+#include <vector>
+
+#include "../common/collision.hpp"
+
+using soupcans::aabb2d;
+using soupcans::collisionBody;
+using soupcans::CollisionWorld;
+using soupcans::JobSystem;
+
+const aabb2d PLAYFIELD = { -1.0f, -1.0f, 1.0f, 1.0f };
+const float DT = 1.0f / 60.0f;
+
+// small deterministic generator so every run sees the same bodies
+static uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static float randomUnit(uint32_t& state) {
+    return (nextRandom(state) & 0xffffff) / (float)0x1000000;
+}
+
+static void integrate(std::vector<collisionBody>& bodies) {
+    for (collisionBody& body : bodies) {
+        body.x += body.vx * DT;
+        body.y += body.vy * DT;
+        if (body.x - body.radius < PLAYFIELD.min_x || body.x + body.radius > PLAYFIELD.max_x) {
+            body.vx = -body.vx;
+        }
+        if (body.y - body.radius < PLAYFIELD.min_y || body.y + body.radius > PLAYFIELD.max_y) {
+            body.vy = -body.vy;
+        }
+    }
+}
+
+// order-dependent hash of the final state, equal hashes mean identical runs
+static uint64_t stateHash(const std::vector<collisionBody>& bodies) {
+    uint64_t hash = 1469598103934665603ull;
+    for (const collisionBody& body : bodies) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&body);
+        for (size_t i = 0; i < sizeof(body); i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+static void runBenchmark(uint32_t n_bodies, int n_steps, int n_threads, uint32_t max_contacts) {
+    // radius shrinks with the count so density stays about the same
+    float radius = 0.6f / sqrtf((float)n_bodies);
+    JobSystem jobs(n_threads);
+    CollisionWorld world(PLAYFIELD, radius, &jobs);
+    world.setMaxContacts(max_contacts);
+    std::vector<collisionBody>& bodies = world.bodies();
+    uint32_t seed = 0x50c4c4u;
+    for (uint32_t i = 0; i < n_bodies; i++) {
+        collisionBody body;
+        body.x = -0.95f + 1.9f * randomUnit(seed);
+        body.y = -0.95f + 1.9f * randomUnit(seed);
+        body.vx = randomUnit(seed) - 0.5f;
+        body.vy = randomUnit(seed) - 0.5f;
+        body.radius = radius;
+        body.inv_mass = 1.0f;
+        bodies.push_back(body);
+    }
+
+    uint64_t n_candidates = 0, n_contacts = 0, n_dropped = 0;
+    double broadphase_seconds = 0.0, resolve_seconds = 0.0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int step = 0; step < n_steps; step++) {
+        integrate(bodies);
+        world.step();
+        n_candidates += world.stats().n_candidate_pairs;
+        n_contacts += world.stats().n_contacts;
+        n_dropped += world.stats().n_dropped;
+        broadphase_seconds += world.stats().broadphase_seconds;
+        resolve_seconds += world.stats().resolve_seconds;
+    }
+    double total = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+
+    printf("%7u bodies  %2d threads  %8.3f ms/step  "
+           "(broadphase %.3f, resolve %.3f)  "
+           "%7.2f M pairs/s  %7.2f M contacts/s  hash %016llx\n",
+           n_bodies, n_threads, 1000.0 * total / n_steps,
+           1000.0 * broadphase_seconds / n_steps, 1000.0 * resolve_seconds / n_steps,
+           n_candidates / total / 1e6, n_contacts / total / 1e6,
+           (unsigned long long)stateHash(bodies));
+    if (n_dropped > 0) {
+        printf("%7u bodies  %2d threads  %.1f contacts/step over the cap dropped\n",
+               n_bodies, n_threads, (double)n_dropped / n_steps);
+    }
+}
+
+int main(int argc, char** argv) {
+    int n_threads = JobSystem::defaultThreadCount();
+    int n_steps = 100;
+    uint32_t max_contacts = UINT32_MAX;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            n_threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--steps") && i + 1 < argc) {
+            n_steps = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--max-contacts") && i + 1 < argc) {
+            max_contacts = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--threads N] [--steps N] [--max-contacts N]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (n_threads < 1) {
+        n_threads = 1;
+    }
+
+    const uint32_t BODY_COUNTS[] = { 1000, 10000, 100000 };
+    for (uint32_t n_bodies : BODY_COUNTS) {
+        runBenchmark(n_bodies, n_steps, 1, max_contacts);
+        if (n_threads > 1) {
+            runBenchmark(n_bodies, n_steps, n_threads, max_contacts);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../common/frameShare.hpp"
+
+using namespace soupcans;
+
+/* The shared-memory half of --serve on its own, without a GPU: one
+   process publishes frames the way FrameServer does (a memcpy into the
+   slot, standing in for the copy out of the PBO) and forked consumers
+   read each frame they're woken for in place. Run uncapped for
+   throughput and paced for latency, at 1080p and 4K.
+*/
+struct consumerReport {
+    uint64_t n_frames;
+    uint64_t n_skipped;
+    double read_seconds;
+    // publish() until the frame was acquired and until it was read through, in ms
+    double wake_p50, wake_p95, wake_p99, wake_max;
+    double done_p50, done_p99;
+};
+
+// keeps the reads from being optimized away
+static volatile uint64_t g_sink;
+
+static double percentile(std::vector<double>& samples, double p) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[(size_t)(p * (samples.size() - 1) + 0.5)];
+}
+
+// runs in the child until the server hangs up, then reports down `pipe_fd`
+static void consumeFrames(const char* socket_path, int pipe_fd) {
+    consumerReport report = {};
+    std::vector<double> wake, done;
+    FrameShareClient client;
+    if (client.connect(socket_path)) {
+        uint64_t last_frame = 0;
+        while (client.connected()) {
+            sharedFrame frame;
+            if (client.waitFrames(1000) == 0 || !client.acquire(&frame)) {
+                continue;
+            }
+            if (report.n_frames > 0 && frame.frame == last_frame) {
+                // woken for the frame the last wake already found
+                client.release();
+                continue;
+            }
+            uint64_t acquired = frameShareClockNs();
+            // every byte, eight at a time, where it lies
+            const uint64_t* words = reinterpret_cast<const uint64_t*>(frame.pixels);
+            size_t n_words = frame.stride * frame.height / 8;
+            uint64_t sum = 0;
+            for (size_t i = 0; i < n_words; i++) {
+                sum += words[i];
+            }
+            uint64_t read = frameShareClockNs();
+            g_sink += sum;
+            if (report.n_frames > 0 && frame.frame > last_frame + 1) {
+                report.n_skipped += frame.frame - last_frame - 1;
+            }
+            last_frame = frame.frame;
+            client.release();
+            report.n_frames++;
+            report.read_seconds += (read - acquired) / 1e9;
+            wake.push_back((acquired - frame.publish_ns) / 1e6);
+            done.push_back((read - frame.publish_ns) / 1e6);
+        }
+    }
+    report.wake_max = wake.empty() ? 0.0 : *std::max_element(wake.begin(), wake.end());
+    report.wake_p50 = percentile(wake, 0.5);
+    report.wake_p95 = percentile(wake, 0.95);
+    report.wake_p99 = percentile(wake, 0.99);
+    report.done_p50 = percentile(done, 0.5);
+    report.done_p99 = percentile(done, 0.99);
+    ssize_t written = write(pipe_fd, &report, sizeof(report));
+    (void)written;
+}
+
+// one server, fresh consumers, `fps` 0 for as fast as it goes
+static bool runPhase(const char* socket_path, int width, int height, int n_frames,
+                     double fps, int n_consumers) {
+    FrameShareServer server;
+    if (!server.open(socket_path, width, height)) {
+        return false;
+    }
+    size_t frame_size = server.frameSize();
+    std::vector<unsigned char> source(frame_size);
+    for (size_t i = 0; i < frame_size; i++) {
+        source[i] = (unsigned char)(i * 7);
+    }
+
+    int pipes[2];
+    if (pipe(pipes) != 0) {
+        return false;
+    }
+    std::vector<pid_t> children;
+    for (int i = 0; i < n_consumers; i++) {
+        pid_t child = fork();
+        if (child == 0) {
+            close(pipes[0]);
+            consumeFrames(socket_path, pipes[1]);
+            _exit(0);
+        }
+        children.push_back(child);
+    }
+    close(pipes[1]);
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (server.consumerCount() < n_consumers && std::chrono::steady_clock::now() < deadline) {
+        server.serviceConnections();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    bool connected = server.consumerCount() == n_consumers;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int frame = 0; connected && frame < n_frames; frame++) {
+        if (fps > 0.0) {
+            std::this_thread::sleep_until(start + std::chrono::duration<double>(frame / fps));
+        }
+        uint64_t captured = frameShareClockNs();
+        unsigned char* pixels = server.beginFrame();
+        if (pixels) {
+            memcpy(pixels, source.data(), frame_size);
+            server.publish((uint64_t)frame, captured);
+        }
+    }
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    // the consumers read what they have, then see the socket close
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const frameShareStats stats = server.stats();
+    server.close();
+
+    std::vector<consumerReport> reports;
+    consumerReport report;
+    while (read(pipes[0], &report, sizeof(report)) == (ssize_t)sizeof(report)) {
+        reports.push_back(report);
+    }
+    close(pipes[0]);
+    for (pid_t child : children) {
+        if (!connected) {
+            kill(child, SIGTERM);
+        }
+        waitpid(child, nullptr, 0);
+    }
+    if (!connected) {
+        fprintf(stderr, "only %d of %d consumers connected\n", server.consumerCount(),
+                n_consumers);
+        return false;
+    }
+
+    double gigabytes = (double)frame_size * stats.n_published / 1e9;
+    if (fps > 0.0) {
+        printf("%dx%d at %.0f fps: %llu frames published, %llu dropped\n", width, height, fps,
+               (unsigned long long)stats.n_published, (unsigned long long)stats.n_dropped);
+    } else {
+        printf("%dx%d uncapped: %llu frames in %.3f s, %.1f frames/s, %.2f GB/s into the "
+               "slots, %llu dropped\n", width, height, (unsigned long long)stats.n_published,
+               seconds, stats.n_published / seconds, gigabytes / seconds,
+               (unsigned long long)stats.n_dropped);
+    }
+    for (size_t i = 0; i < reports.size(); i++) {
+        const consumerReport& r = reports[i];
+        double read_ms = r.n_frames ? r.read_seconds * 1000.0 / r.n_frames : 0.0;
+        printf("  consumer %zu: %llu frames read, %llu skipped, %.3f ms (%.2f GB/s) to read one\n",
+               i, (unsigned long long)r.n_frames, (unsigned long long)r.n_skipped, read_ms,
+               read_ms > 0.0 ? frame_size / (read_ms * 1e6) : 0.0);
+        printf("    publish to acquire p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms; "
+               "to read through p50 %.3f ms, p99 %.3f ms\n", r.wake_p50, r.wake_p95,
+               r.wake_p99, r.wake_max, r.done_p50, r.done_p99);
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int n_frames = 240;
+    double fps = 60.0;
+    int n_consumers = 1;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            n_frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--fps") && i + 1 < argc) {
+            fps = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--consumers") && i + 1 < argc) {
+            n_consumers = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [--fps N] [--consumers N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (n_consumers < 1 || n_consumers > FRAME_SHARE_MAX_CONSUMERS) {
+        fprintf(stderr, "between 1 and %d consumers\n", FRAME_SHARE_MAX_CONSUMERS);
+        return 1;
+    }
+
+    char socket_path[64];
+    snprintf(socket_path, sizeof(socket_path), "/tmp/frame_share_bench.%d", (int)getpid());
+    static const int SIZES[2][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    for (const int* size : SIZES) {
+        if (!runPhase(socket_path, size[0], size[1], n_frames, 0.0, n_consumers) ||
+            !runPhase(socket_path, size[0], size[1], n_frames, fps, n_consumers)) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <chrono>
+#include <vector>
+
+#include "../common/jobSystem.hpp"
+
+using soupcans::JobSystem;
+
+/* Frame-shaped workload: integrate a large set of entities, then build a
+   4x4 matrix for each of them, as two dependent parallel_for passes. Run
+   with 1..N workers to see how frame time scales with the core count.
+*/
+struct entity {
+    float x, y, vx, vy, angle;
+};
+
+static void simulateFrame(JobSystem& jobs, std::vector<entity>& entities,
+                          std::vector<float>& matrices, float dt) {
+    uint32_t n = static_cast<uint32_t>(entities.size());
+    uint32_t grain = jobs.grainFor(n, 1024);
+    jobs.parallelFor(0, n, grain, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            entity& e = entities[i];
+            e.x += e.vx * dt;
+            e.y += e.vy * dt;
+            if (fabsf(e.x) > 1.0f) e.vx = -e.vx;
+            if (fabsf(e.y) > 1.0f) e.vy = -e.vy;
+            e.angle += dt;
+        }
+    });
+    jobs.parallelFor(0, n, grain, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const entity& e = entities[i];
+            float c = cosf(e.angle), s = sinf(e.angle);
+            float* m = &matrices[16 * i];
+            m[0] = c;    m[1] = s;    m[2] = 0.0f;  m[3] = 0.0f;
+            m[4] = -s;   m[5] = c;    m[6] = 0.0f;  m[7] = 0.0f;
+            m[8] = 0.0f; m[9] = 0.0f; m[10] = 1.0f; m[11] = 0.0f;
+            m[12] = e.x; m[13] = e.y; m[14] = 0.0f; m[15] = 1.0f;
+        }
+    });
+}
+
+int main(int argc, char** argv) {
+    int max_threads = JobSystem::defaultThreadCount();
+    uint32_t n_entities = 1000000;
+    int n_frames = 60;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            max_threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--entities") && i + 1 < argc) {
+            n_entities = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            n_frames = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--threads N] [--entities N] [--frames N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<entity> entities(n_entities);
+    std::vector<float> matrices(16 * (size_t)n_entities);
+    double single_thread_ms = 0.0;
+    for (int n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+        for (uint32_t i = 0; i < n_entities; i++) {
+            entities[i] = entity{ 0.0f, 0.0f, 0.001f * (i % 97), 0.001f * (i % 89), 0.0f };
+        }
+        JobSystem jobs(n_threads);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < n_frames; frame++) {
+            simulateFrame(jobs, entities, matrices, 1.0f / 60.0f);
+        }
+        double frame_ms = 1000.0 * std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start
+        ).count() / n_frames;
+        if (n_threads == 1) {
+            single_thread_ms = frame_ms;
+        }
+
+        printf("%3d threads: %8.3f ms/frame, %5.2fx speedup\n",
+               n_threads, frame_ms, single_thread_ms / frame_ms);
+        jobs.printStats(stdout);
+        if (n_threads < max_threads && n_threads * 2 > max_threads) {
+            n_threads = max_threads / 2;  // always finish on max_threads
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,453 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "../runtime/runtime.hpp"
+#include "../runtime/sceneList.hpp"
+
+using namespace soupcans;
+
+#ifndef SOUPCANS_SOURCE_DIR
+#define SOUPCANS_SOURCE_DIR ".."
+#endif
+
+struct benchScene {
+    const char* name;
+    sceneFactory create;
+    // scenes that take an object count as their first option
+    bool takes_count;
+};
+
+const benchScene SCENES[] = {
+    { "bouncing_candy", createBouncingCandyScene, true },
+    { "dvd_triangle", createDvdTriangleScene, true },
+    { "image_cube", createImageCubeScene, true },
+    { "rotating_colors", createRotatingColorsScene, false },
+    { "shader_triangle", createShaderTriangleScene, false },
+};
+
+struct benchSize {
+    int width;
+    int height;
+};
+
+// per-frame samples of one run, the warmup frames are left out
+struct frameSamples {
+    uint64_t warmup;
+    std::vector<double> frame_ms;
+    std::vector<double> update_ms;
+    std::vector<double> render_ms;
+    std::vector<double> present_ms;
+    char renderer[128];
+};
+
+struct distribution {
+    double mean, stddev, min, p50, p90, p99, max;
+};
+
+struct runResult {
+    std::string scene;
+    int width, height, n_objects;
+    antiAliasMode anti_alias;
+    distribution frame_ms;
+};
+
+static void collectFrame(const Scene& scene, uint64_t frame,
+                         const frameTimings& timings, void* user_data) {
+    (void)scene;
+    frameSamples* samples = static_cast<frameSamples*>(user_data);
+    if (frame == 0) {
+        const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        snprintf(samples->renderer, sizeof(samples->renderer), "%s",
+                 renderer ? renderer : "unknown");
+    }
+    if (frame < samples->warmup) {
+        return;
+    }
+    // capacity was reserved up front, nothing here allocates
+    samples->frame_ms.push_back(timings.frame_seconds * 1000.0);
+    samples->update_ms.push_back(timings.update_seconds * 1000.0);
+    samples->render_ms.push_back(timings.render_seconds * 1000.0);
+    samples->present_ms.push_back(timings.present_seconds * 1000.0);
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+static distribution distributionOf(std::vector<double> values) {
+    distribution d = distribution{};
+    if (values.empty()) {
+        return d;
+    }
+    std::sort(values.begin(), values.end());
+    double sum = 0.0, sum_sq = 0.0;
+    for (double v : values) {
+        sum += v;
+        sum_sq += v * v;
+    }
+    d.mean = sum / values.size();
+    d.stddev = sqrt(std::max(0.0, sum_sq / values.size() - d.mean * d.mean));
+    d.min = values.front();
+    d.max = values.back();
+    d.p50 = percentile(values, 0.50);
+    d.p90 = percentile(values, 0.90);
+    d.p99 = percentile(values, 0.99);
+    return d;
+}
+
+static void writeDistribution(FILE* out, const char* key, const distribution& d) {
+    fprintf(out, "\"%s\": {\"mean\": %.4f, \"stddev\": %.4f, \"min\": %.4f, "
+                 "\"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+            key, d.mean, d.stddev, d.min, d.p50, d.p90, d.p99, d.max);
+}
+
+static uint64_t residentBytes() {
+    long pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm) {
+        return 0;
+    }
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+    return (uint64_t)resident * sysconf(_SC_PAGESIZE);
+}
+
+static uint64_t peakResidentBytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is in kilobytes on linux
+    return (uint64_t)usage.ru_maxrss * 1024;
+}
+
+/* Every run is written as a single line, so --compare can read an earlier
+   report back without a JSON parser.
+*/
+static bool runOne(Runtime& runtime, const benchScene& bench_scene, benchSize size,
+                   int n_objects, uint64_t n_frames, uint64_t warmup,
+                   FILE* out, bool first, runResult* result) {
+    char count_arg[32];
+    snprintf(count_arg, sizeof(count_arg), "%d", n_objects);
+    char* scene_argv[] = { const_cast<char*>("scene_bench"), count_arg, nullptr };
+    std::unique_ptr<Scene> scene = bench_scene.create(2, scene_argv);
+
+    frameSamples samples;
+    samples.warmup = warmup;
+    samples.frame_ms.reserve(n_frames);
+    samples.update_ms.reserve(n_frames);
+    samples.render_ms.reserve(n_frames);
+    samples.present_ms.reserve(n_frames);
+    snprintf(samples.renderer, sizeof(samples.renderer), "unknown");
+    runtime.setProfileHook(collectFrame, &samples);
+    int status = runtime.run(*scene);
+    runtime.setProfileHook(nullptr, nullptr);
+    if (status != 0) {
+        fprintf(stderr, "scene_bench: %s failed to run\n", bench_scene.name);
+        return false;
+    }
+
+    const runStats& stats = runtime.lastRunStats();
+    double n = (stats.n_frames > 0) ? (double)stats.n_frames : 1.0;
+    double n_gpu = (stats.n_gpu_frames > 0) ? (double)stats.n_gpu_frames : 1.0;
+    distribution frame_ms = distributionOf(samples.frame_ms);
+    fprintf(out, "%s    {\"scene\": \"%s\", \"width\": %d, \"height\": %d, \"objects\": %d, "
+                 "\"anti_alias\": \"%s\", \"frames\": %zu, \"renderer\": \"%s\", ",
+            first ? "" : ",\n", bench_scene.name, size.width, size.height, n_objects,
+            antiAliasModeName(stats.anti_alias), samples.frame_ms.size(), samples.renderer);
+    writeDistribution(out, "frame_ms", frame_ms);
+    fprintf(out, ", ");
+    writeDistribution(out, "update_ms", distributionOf(samples.update_ms));
+    fprintf(out, ", ");
+    writeDistribution(out, "render_ms", distributionOf(samples.render_ms));
+    fprintf(out, ", ");
+    writeDistribution(out, "present_ms", distributionOf(samples.present_ms));
+    // means over every frame the GPU timed, warmup included
+    fprintf(out, ", \"gpu_ms_per_frame\": {\"render\": %.4f, \"anti_alias\": %.4f}",
+            stats.gpu_render_seconds * 1000.0 / n_gpu,
+            stats.gpu_anti_alias_seconds * 1000.0 / n_gpu);
+    fprintf(out, ", \"gl_calls_per_frame\": {\"draw_calls\": %.2f, \"binds\": %.2f, "
+                 "\"uniform_updates\": %.2f, \"uploads\": %.2f, \"upload_bytes\": %.1f, "
+                 "\"clears\": %.2f}",
+            stats.gl_calls.draw_calls / n, stats.gl_calls.binds / n,
+            stats.gl_calls.uniform_updates / n, stats.gl_calls.uploads / n,
+            stats.gl_calls.upload_bytes / n, stats.gl_calls.clears / n);
+    double wall = (stats.wall_seconds > 0.0) ? stats.wall_seconds : 1.0;
+    fprintf(out, ", \"cpu\": {\"cpu_per_wall\": %.4f, \"worker_cpu_per_wall\": %.4f, "
+                 "\"idle_seconds\": %.4f}",
+            stats.cpu_seconds / wall, stats.worker_cpu_seconds / wall, stats.idle_seconds);
+    double n_swaps = (stats.n_swap_latency_samples > 0) ?
+        (double)stats.n_swap_latency_samples : 1.0;
+    const latencySummary& to_present = stats.input_to_present;
+    fprintf(out, ", \"latency_ms\": {\"swap_mean\": %.4f, \"swap_max\": %.4f, "
+                 "\"input_samples\": %llu, \"input_to_present_p50\": %.4f, "
+                 "\"input_to_present_p95\": %.4f, \"input_to_present_p99\": %.4f, "
+                 "\"input_to_present_max\": %.4f}",
+            stats.swap_latency_seconds * 1000.0 / n_swaps,
+            stats.max_swap_latency_seconds * 1000.0,
+            (unsigned long long)to_present.n_samples, to_present.p50, to_present.p95,
+            to_present.p99, to_present.max);
+    fprintf(out, ", \"memory\": {\"heap_allocations\": %llu, \"allocating_frames\": %llu, "
+                 "\"frame_arena_peak_bytes\": %zu, \"rss_bytes\": %llu, "
+                 "\"peak_rss_bytes\": %llu}}",
+            (unsigned long long)stats.n_heap_allocations,
+            (unsigned long long)stats.n_allocating_frames,
+            runtime.frameArena().highWaterMark(),
+            (unsigned long long)residentBytes(), (unsigned long long)peakResidentBytes());
+    fflush(out);
+
+    result->scene = bench_scene.name;
+    result->width = size.width;
+    result->height = size.height;
+    result->n_objects = n_objects;
+    result->anti_alias = stats.anti_alias;
+    result->frame_ms = frame_ms;
+    return true;
+}
+
+static bool readNumber(const char* line, const char* key, double* value) {
+    const char* found = strstr(line, key);
+    if (!found) {
+        return false;
+    }
+    *value = atof(found + strlen(key));
+    return true;
+}
+
+/* Reads the runs back out of an earlier report and compares median frame
+   times, returns how many configurations got slower than the tolerance.
+*/
+static int compareWithBaseline(const char* path, const std::vector<runResult>& results,
+                               double tolerance) {
+    FILE* baseline = fopen(path, "r");
+    if (!baseline) {
+        fprintf(stderr, "scene_bench: could not open baseline %s\n", path);
+        return -1;
+    }
+    int n_slower = 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), baseline)) {
+        const char* scene_key = strstr(line, "\"scene\": \"");
+        const char* frame_key = strstr(line, "\"frame_ms\": {");
+        if (!scene_key || !frame_key) {
+            continue;
+        }
+        char scene[64];
+        if (sscanf(scene_key, "\"scene\": \"%63[^\"]\"", scene) != 1) {
+            continue;
+        }
+        // reports from before anti-aliasing modes match whatever mode ran
+        char anti_alias[16] = "";
+        const char* anti_alias_key = strstr(line, "\"anti_alias\": \"");
+        if (anti_alias_key) {
+            sscanf(anti_alias_key, "\"anti_alias\": \"%15[^\"]\"", anti_alias);
+        }
+        double width, height, n_objects, old_p50;
+        if (!readNumber(line, "\"width\": ", &width) ||
+            !readNumber(line, "\"height\": ", &height) ||
+            !readNumber(line, "\"objects\": ", &n_objects) ||
+            !readNumber(frame_key, "\"p50\": ", &old_p50)) {
+            continue;
+        }
+        for (const runResult& result : results) {
+            if (result.scene != scene || result.width != (int)width ||
+                result.height != (int)height || result.n_objects != (int)n_objects ||
+                (anti_alias[0] && strcmp(anti_alias, antiAliasModeName(result.anti_alias)))) {
+                continue;
+            }
+            double change = (old_p50 > 0.0) ?
+                100.0 * (result.frame_ms.p50 - old_p50) / old_p50 : 0.0;
+            bool slower = change > tolerance;
+            fprintf(stderr, "%-16s %5dx%-5d %6d objects %-5s  p50 %8.3f -> %8.3f ms  "
+                            "%+6.1f%%%s\n",
+                    scene, result.width, result.height, result.n_objects,
+                    antiAliasModeName(result.anti_alias),
+                    old_p50, result.frame_ms.p50, change, slower ? "  SLOWER" : "");
+            n_slower += slower ? 1 : 0;
+        }
+    }
+    fclose(baseline);
+    return n_slower;
+}
+
+static std::vector<benchSize> parseSizes(const char* text) {
+    std::vector<benchSize> sizes;
+    const char* cursor = text;
+    while (*cursor) {
+        benchSize size;
+        int consumed = 0;
+        if (sscanf(cursor, "%dx%d%n", &size.width, &size.height, &consumed) != 2) {
+            break;
+        }
+        sizes.push_back(size);
+        cursor += consumed;
+        if (*cursor == ',') {
+            cursor++;
+        }
+    }
+    return sizes;
+}
+
+static std::vector<int> parseCounts(const char* text) {
+    std::vector<int> counts;
+    const char* cursor = text;
+    while (*cursor) {
+        char* end;
+        long count = strtol(cursor, &end, 10);
+        if (end == cursor) {
+            break;
+        }
+        counts.push_back(count > 0 ? (int)count : 1);
+        cursor = (*end == ',') ? end + 1 : end;
+    }
+    return counts;
+}
+
+static std::vector<antiAliasMode> parseAntiAliasModes(const char* text) {
+    std::vector<antiAliasMode> modes;
+    char name[16];
+    const char* cursor = text;
+    while (*cursor) {
+        size_t length = strcspn(cursor, ",");
+        antiAliasMode mode;
+        snprintf(name, sizeof(name), "%.*s", (int)length, cursor);
+        if (length >= sizeof(name) || !parseAntiAliasMode(name, &mode)) {
+            return std::vector<antiAliasMode>();
+        }
+        modes.push_back(mode);
+        cursor += length;
+        if (*cursor == ',') {
+            cursor++;
+        }
+    }
+    return modes;
+}
+
+static void printUsage(const char* program_name) {
+    fprintf(stderr,
+            "usage: %s [--frames N] [--warmup N] [--sizes WxH,...] [--counts N,...]\n"
+            "          [--scenes name,...] [--anti-alias off|msaa2|msaa4|msaa8|fxaa,...]\n"
+            "          [--threads N] [--resources DIR]\n"
+            "          [--out FILE] [--compare BASELINE.json] [--tolerance PERCENT]\n",
+            program_name);
+}
+
+int main(int argc, char** argv) {
+    uint64_t n_frames = 300;
+    uint64_t warmup = 30;
+    std::vector<benchSize> sizes = parseSizes("640x360,1280x720,1920x1080");
+    std::vector<int> counts = parseCounts("1,100,1000");
+    const char* scene_filter = nullptr;
+    std::vector<antiAliasMode> anti_alias_modes(1, defaultAntiAliasMode());
+    const char* out_path = nullptr;
+    const char* baseline_path = nullptr;
+    double tolerance = 5.0;
+
+    runtimeSettings settings;
+    settings.backend = BACKEND_HEADLESS;
+    settings.uncapped = true;
+    settings.count_gl_calls = true;
+    settings.resource_root = SOUPCANS_SOURCE_DIR;
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--frames") && has_value) {
+            n_frames = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--warmup") && has_value) {
+            warmup = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--sizes") && has_value) {
+            sizes = parseSizes(argv[++i]);
+        } else if (!strcmp(argv[i], "--counts") && has_value) {
+            counts = parseCounts(argv[++i]);
+        } else if (!strcmp(argv[i], "--scenes") && has_value) {
+            scene_filter = argv[++i];
+        } else if (!strcmp(argv[i], "--anti-alias") && has_value) {
+            anti_alias_modes = parseAntiAliasModes(argv[++i]);
+        } else if (!strcmp(argv[i], "--threads") && has_value) {
+            settings.n_threads = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--resources") && has_value) {
+            settings.resource_root = argv[++i];
+        } else if (!strcmp(argv[i], "--out") && has_value) {
+            out_path = argv[++i];
+        } else if (!strcmp(argv[i], "--compare") && has_value) {
+            baseline_path = argv[++i];
+        } else if (!strcmp(argv[i], "--tolerance") && has_value) {
+            tolerance = atof(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (sizes.empty() || counts.empty() || anti_alias_modes.empty() || n_frames == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "scene_bench: could not open %s\n", out_path);
+        return 1;
+    }
+    // keep stderr for failures, the per-run summaries would drown the comparison
+    setLogLevel(LOG_WARNING);
+    settings.max_frames = warmup + n_frames;
+    Runtime runtime(settings);
+
+    fprintf(out, "{\n  \"benchmark\": \"scene_bench\",\n  \"frames\": %llu,\n"
+                 "  \"warmup\": %llu,\n  \"threads\": %d,\n  \"runs\": [\n",
+            (unsigned long long)n_frames, (unsigned long long)warmup,
+            runtime.jobs().threadCount());
+    std::vector<runResult> results;
+    bool failed = false;
+    for (const benchScene& bench_scene : SCENES) {
+        if (scene_filter && !strstr(scene_filter, bench_scene.name)) {
+            continue;
+        }
+        for (benchSize size : sizes) {
+            for (size_t c = 0; c < counts.size(); c++) {
+                // fixed scenes only need one run per size
+                if (!bench_scene.takes_count && c > 0) {
+                    break;
+                }
+                int n_objects = bench_scene.takes_count ? counts[c] : 1;
+                for (antiAliasMode anti_alias : anti_alias_modes) {
+                    runtime.setAntiAliasMode(anti_alias);
+                    runResult result;
+                    if (!runOne(runtime, bench_scene, size, n_objects, n_frames, warmup,
+                                out, results.empty(), &result)) {
+                        failed = true;
+                        continue;
+                    }
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    if (baseline_path) {
+        int n_slower = compareWithBaseline(baseline_path, results, tolerance);
+        if (n_slower != 0) {
+            if (n_slower > 0) {
+                fprintf(stderr, "scene_bench: %d configuration(s) more than %.1f%% slower\n",
+                        n_slower, tolerance);
+            }
+            return 2;
+        }
+    }
+    return failed ? 1 : 0;
+}
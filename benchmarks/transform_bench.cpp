@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <chrono>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../include/glHelpers.hpp"
+#include "../common/transform.hpp"
+
+using soupcans::mat4f;
+
+// keeps the optimizer from throwing the results away
+static float g_sink = 0.0f;
+
+static void consume(const float* m) {
+    g_sink += m[0] + m[5] + m[10] + m[15];
+}
+
+template <class F>
+static double nsPerCall(uint64_t n_calls, F&& fn) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < n_calls; i++) {
+        fn(i);
+    }
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+    return seconds * 1e9 / n_calls;
+}
+
+// the per-frame x then y rotation of bouncing_candy and image_cube, three ways
+static void benchRotation(uint64_t n_calls) {
+    const glm::vec3 X_AXIS(1.0f, 0.0f, 0.0f), Y_AXIS(0.0f, 1.0f, 0.0f);
+    double helper = nsPerCall(n_calls, [](uint64_t i) {
+        int theta = (int)(i % 360);
+        glm::mat4 m = glhelpers::rot3d_matrix(theta, 'x') * glhelpers::rot3d_matrix(theta, 'y');
+        consume(glm::value_ptr(m));
+    });
+    double glm_rotate = nsPerCall(n_calls, [&](uint64_t i) {
+        float radians = glm::radians((float)(i % 360));
+        glm::mat4 m = glm::rotate(glm::mat4(1.0f), radians, X_AXIS) *
+                      glm::rotate(glm::mat4(1.0f), radians, Y_AXIS);
+        consume(glm::value_ptr(m));
+    });
+    double matrices = nsPerCall(n_calls, [](uint64_t i) {
+        int theta = (int)(i % 360);
+        mat4f m = soupcans::rotationDegrees(soupcans::AXIS_X, theta) *
+                  soupcans::rotationDegrees(soupcans::AXIS_Y, theta);
+        consume(m.m);
+    });
+    double quaternions = nsPerCall(n_calls, [](uint64_t i) {
+        int theta = (int)(i % 360);
+        mat4f m = soupcans::quatToMat4(soupcans::quatMultiply(
+            soupcans::quatDegrees(soupcans::AXIS_X, theta),
+            soupcans::quatDegrees(soupcans::AXIS_Y, theta)
+        ));
+        consume(m.m);
+    });
+    printf("x * y rotation       rot3d_matrix %7.2f ns  glm::rotate %7.2f ns  "
+           "table matrices %7.2f ns  quaternions %7.2f ns\n",
+           helper, glm_rotate, matrices, quaternions);
+}
+
+// model * squish * rotation for every candy, as bouncing_candy does each frame
+static void benchCompose(uint32_t n_objects, int n_iterations) {
+    std::vector<glm::mat4> models(n_objects), squishes(n_objects), glm_out(n_objects);
+    std::vector<mat4f> batch_out(n_objects);
+    for (uint32_t i = 0; i < n_objects; i++) {
+        models[i] = glm::translate(glm::mat4(1.0f), glm::vec3(0.001f * i, -0.5f, 0.0f));
+        squishes[i] = glm::scale(glm::mat4(1.0f), glm::vec3(1.1f, 0.9f, 1.1f));
+    }
+    mat4f rotation = soupcans::quatToMat4(soupcans::quatDegrees(soupcans::AXIS_Y, 30));
+    glm::mat4 glm_rotation;
+    memcpy(glm::value_ptr(glm_rotation), rotation.m, sizeof(rotation.m));
+
+    double glm_ns = nsPerCall(n_iterations, [&](uint64_t) {
+        for (uint32_t i = 0; i < n_objects; i++) {
+            glm_out[i] = models[i] * squishes[i] * glm_rotation;
+        }
+        consume(glm::value_ptr(glm_out[n_objects - 1]));
+    });
+    double batch_ns = nsPerCall(n_iterations, [&](uint64_t) {
+        soupcans::composeMat4Batch(glm::value_ptr(models[0]), 1, glm::value_ptr(squishes[0]), 1,
+                                   rotation.m, 0, batch_out[0].m, n_objects);
+        consume(batch_out[n_objects - 1].m);
+    });
+
+    float max_error = 0.0f;
+    for (uint32_t i = 0; i < n_objects; i++) {
+        const float* expected = glm::value_ptr(glm_out[i]);
+        for (int k = 0; k < 16; k++) {
+            max_error = fmaxf(max_error, fabsf(expected[k] - batch_out[i].m[k]));
+        }
+    }
+    printf("%7u composes         glm loop %9.1f ns/matrix  %s batch %9.1f ns/matrix  "
+           "max error %g\n",
+           n_objects, glm_ns / n_objects, soupcans::transformKernelName(),
+           batch_ns / n_objects, max_error);
+}
+
+int main(int argc, char** argv) {
+    uint64_t n_calls = 10000000;
+    int n_iterations = 200;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--calls") && i + 1 < argc) {
+            n_calls = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            n_iterations = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--calls N] [--iterations N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (n_calls < 1 || n_iterations < 1) {
+        fprintf(stderr, "counts must be positive\n");
+        return 1;
+    }
+
+    benchRotation(n_calls);
+    const uint32_t OBJECT_COUNTS[] = { 100, 10000, 100000 };
+    for (uint32_t n_objects : OBJECT_COUNTS) {
+        benchCompose(n_objects, n_iterations);
+    }
+    printf("(sink %g)\n", g_sink);
+    return 0;
+}
@@ -1,12 +1,10 @@
-#include <array>
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <sstream>
+#include <algorithm>
+#include <vector>
 #include <memory>
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include <GL/gl3w.h>
@@ -16,20 +14,21 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
-#include "../include/glDebug.hpp"
-#include "../include/glHelpers.hpp"
-
-void nanoDelay(unsigned int nanoseconds) {
-	timespec frame_delay = { 0,          /* seconds */
-							 nanoseconds /* nanoseconds */ };
-	timespec remaining = { 0, 0 };
-
-	nanosleep(&frame_delay, &remaining);
-}
-
-// structs defined in glhelpers.hpp for convient grouping of things
-using glhelpers::displayObjects;
-using glhelpers::shaderSrc;
+#include "../common/spatialGrid.hpp"
+#include "../common/collision.hpp"
+#include "../common/transform.hpp"
+#include "../runtime/runtime.hpp"
+#include "../runtime/sceneList.hpp"
+
+using soupcans::aabb2d;
+using soupcans::SpatialGrid;
+using soupcans::collisionBody;
+using soupcans::CollisionWorld;
+using soupcans::JobSystem;
+using soupcans::mat4f;
+using soupcans::Runtime;
+using soupcans::Scene;
+using soupcans::sceneSettings;
 
 class MovingObject {
     private:
@@ -66,6 +65,11 @@ class MovingObject {
             );
         }
 
+        void setPosition(float pos_x, float pos_y) {
+            this->updateModel(pos_x, pos_y);
+            this->recordPosition();
+        }
+
         void setVelocity(float vel_x, float vel_y) {
             this->velocity_x = vel_x;
             this->velocity_y = vel_y;
@@ -84,311 +88,348 @@ class MovingObject {
         }
 
         float getPositionY() {
-            return *(this->model_pos_x);
+            return *(this->model_pos_y);
         }
 };
 
-void squish_matrix(glm::mat4& matrix, float obj_y_pos, float obj_radius, float ground_y) {
+void squish_matrix(glm::mat4& matrix, float obj_y_pos, float obj_radius, float ground_y,
+                   float impact = 0.0f) {
     float compress_factor = 0.75f;
     float expand_factor = 0.75f;
-    float ground_proximity;
+    // squish from touching the ground, plus whatever other candies bumped into us
+    float squish_amount = impact;
     if (obj_y_pos <= ground_y + obj_radius) {
-        ground_proximity = fabs(obj_y_pos - obj_radius - ground_y);
-        matrix[0][0] = 1.0f + (expand_factor * ground_proximity );
-        matrix[1][1] = 1.0f - (compress_factor * ground_proximity);
-        matrix[2][2] = 1.0f + (expand_factor * ground_proximity);
-    } else {
-        matrix[0][0] = 1.0f;
-        matrix[1][1] = 1.0f;
-        matrix[2][2] = 1.0f;
+        squish_amount += fabs(obj_y_pos - obj_radius - ground_y);
     }
+    matrix[0][0] = 1.0f + (expand_factor * squish_amount);
+    matrix[1][1] = 1.0f - (compress_factor * squish_amount);
+    matrix[2][2] = 1.0f + (expand_factor * squish_amount);
 }
 
-int main() {
-    if (!glfwInit()) {
-        GL_LOG_ERROR() << "ERROR: could not start GLFW3";
-        return 1;
-    }
+/* Matrices and 3d object initialization */
+const float CANDY_SCALE = 0.3f;
+const float WIDESCREEN_CORRECTION = 0.5625f;
+// protrusion factor for pyramid face
+const float PROTRUSION = 0.25f;
+// the tessellated spikes stand out this much further at the hardest impact
+const float SPIKE_FLARE = 0.6f;
+const float CANDY_RADIUS = 0.15f;
+const float CANDY_EXTENT = CANDY_SCALE * (0.5f + PROTRUSION * (1.0f + SPIKE_FLARE));
+
+/* Control cage for the tessellated candy, the same points and colors as
+   res/meshes/bucephalus.obj: the cube's corners, then the direction of
+   each face's spike. Every face is one patch, its corners counter-clockwise
+   from outside and then its spike; candy.tese builds the pyramid on top.
+*/
+const float CAGE_POINTS[14][3] = {
+    { -0.5f,  0.5f,  0.5f }, { -0.5f, -0.5f,  0.5f }, {  0.5f,  0.5f,  0.5f },
+    {  0.5f, -0.5f,  0.5f }, { -0.5f,  0.5f, -0.5f }, { -0.5f, -0.5f, -0.5f },
+    {  0.5f,  0.5f, -0.5f }, {  0.5f, -0.5f, -0.5f },
+    {  1.0f,  0.0f,  0.0f }, { -1.0f,  0.0f,  0.0f }, {  0.0f,  1.0f,  0.0f },
+    {  0.0f, -1.0f,  0.0f }, {  0.0f,  0.0f,  1.0f }, {  0.0f,  0.0f, -1.0f },
+};
+const float CAGE_COLORS[14][3] = {
+    { 0.22f, 0.00f, 0.23f }, { 0.00f, 0.44f, 0.00f }, { 0.01f, 0.00f, 0.58f },
+    { 1.00f, 0.11f, 0.00f }, { 0.26f, 1.00f, 0.59f }, { 0.00f, 0.00f, 1.00f },
+    { 0.55f, 0.00f, 0.56f }, { 0.00f, 0.64f, 0.00f },
+    { 0.98f, 0.00f, 0.58f }, { 1.00f, 0.66f, 0.00f }, { 0.74f, 1.00f, 0.69f },
+    { 0.00f, 0.37f, 1.00f }, { 0.84f, 0.00f, 0.10f }, { 0.00f, 0.73f, 0.00f },
+};
+const int N_CAGE_PATCHES = 6;
+const int CAGE_PATCH_SIZE = 5;
+const int CAGE_PATCHES[N_CAGE_PATCHES][CAGE_PATCH_SIZE] = {
+    { 1, 3, 2, 0, 12 },     // front
+    { 7, 5, 4, 6, 13 },     // rear
+    { 3, 7, 6, 2, 8 },      // right
+    { 5, 1, 0, 4, 9 },      // left
+    { 0, 2, 6, 4, 10 },     // top
+    { 5, 7, 3, 1, 11 },     // bottom
+};
+// screen pixels per generated edge, distant candies get fewer triangles
+const float PIXELS_PER_SEGMENT = 6.0f;
+const int MAX_TESSELLATION_LEVEL = 32;
 
-    /* Window hints */
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4);
-
-    /* Video mode, window, display */
-    std::unique_ptr<displayObjects> display_objects = glhelpers::getDisplayObjects();
-    GLFWwindow* window = glfwCreateWindow(
-        display_objects->vidmode->width/2, display_objects->vidmode->height/2,
-        "OpenGL program that hasn't rendered anything yet",
-        NULL, NULL
-    );
-    if (!window) {
-        GL_LOG_ERROR() << "ERROR: could not open window with GLFW3";
-        glfwTerminate();
-        return 1;
-    }
-    glfwMakeContextCurrent(window);
-	// disable vsync to test our 60fps cap
-	glfwSwapInterval(1);
+class BouncingCandyScene : public Scene {
+    public:
+        BouncingCandyScene(int n_candies, bool tessellated, float roundness)
+            : n_candies(n_candies),
+              // Spatial index over the playfield, used to cull candies outside the view
+              grid(SpatialGrid::fitted(
+                  aabb2d{ -1.0f, -1.0f, 1.0f, 1.0f }, 2.0f * CANDY_EXTENT
+              )),
+              tessellated(tessellated),
+              roundness(roundness) {}
+
+        const char* name() const override {
+            return "bouncing_candy";
+        }
 
-    /* Initialize extension wrangler library */
-    if (gl3wInit()) {
-       GL_LOG_ERROR()  << "OH NO INDEPENDENCE DAY (gl3wInit failed)";
-    }
+        sceneSettings settings() const override {
+            sceneSettings settings;
+            settings.window.title = "bouncing_candy";
+            // tessellation shaders came with 4.0
+            settings.window.gl_major = this->tessellated ? 4 : 3;
+            settings.window.gl_minor = 3;
+            // cap to 60fps, the runtime sleeps off what is left of each frame
+            settings.max_fps = 60.0;
+            return settings;
+        }
 
-    /* Debugging */
-    glEnable(GL_DEBUG_OUTPUT);
-    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-    glDebugMessageCallback(gldebug::glDebugCallback, nullptr);
-    glfwSetErrorCallback(gldebug::glfwErrorCallback);
-    //gldebug::logGLParams(); // uncomment to log graphics hardware limits
-
-    /* Initialize a new log and populate with version info */
-    GL_LOG_RESET();
-    GL_LOG_INFO() << "Renderer: " << glGetString(GL_RENDERER);
-    GL_LOG_INFO() << "OpenGL version supported: " << glGetString(GL_VERSION);
-
-    /* Callbacks for non-debugging functions */
-    glfwSetWindowSizeCallback(window, glhelpers::glfw_primary_window_size_callback);
-    glfwSetFramebufferSizeCallback(window, glhelpers::glfw_default_framebuffer_size_callback);
-
-    /* Misc. setup calls to OpenGL's API */
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-
-    /* Matrices and 3d object initialization */
-    float scale = 0.3f;
-    float wcorr = 0.5625f; // correction factor for widescreen
-    glm::mat4 model{
-         scale,         0.0f,   0.0f, 0.0f,
-          0.0f,  scale/wcorr,   0.0f, 0.0f,
-          0.0f,         0.0f,  scale, 0.0f,
-          0.0f,         0.0f,   0.0f, 1.0f
-    };
-    glm::mat4 squish{
-          1.0f,  0.0f,  0.0f, 0.0f,
-          0.0f,  1.0f,  0.0f, 0.0f,
-          0.0f,  0.0f,  1.0f, 0.0f,
-          0.0f,  0.0f,  0.0f, 1.0f
-    };
-    //float* obj_x = &model[3][0];
-    float* obj_y = &model[3][1];
-
-    float color_vectors[] = {
-        0.22f, 0.00f, 0.23f,
-        0.00f, 0.44f, 0.00f,
-        0.01f, 0.00f, 0.58f,
-        1.00f, 0.11f, 0.00f,
-        0.26f, 1.00f, 0.59f,
-        0.00f, 0.00f, 1.00f,
-        0.55f, 0.00f, 0.56f,
-        0.00f, 0.64f, 0.00f,
-        0.98f, 0.00f, 0.58f,
-        1.00f, 0.66f, 0.00f,
-        0.74f, 1.00f, 0.69f,
-        0.00f, 0.37f, 1.00f,
-        0.84f, 0.00f, 0.10f,
-        0.00f, 0.73f, 0.00f,
-        0.23f, 0.00f, 0.83f,
-    };
-    /* float color_vectors[] = { */
-    /*      1.0f,  0.0f,  0.0f, */
-    /*      0.0f,  1.0f,  0.0f, */
-    /*      0.0f,  0.0f,  1.0f, */
-    /*      1.0f,  0.0f,  0.0f, */
-    /*      0.0f,  1.0f,  0.0f, */
-    /*      0.0f,  0.0f,  1.0f, */
-    /*      1.0f,  0.0f,  0.0f, */
-    /*      0.0f,  1.0f,  0.0f, */
-    /*      0.0f,  0.0f,  1.0f, */
-    /*      1.0f,  0.0f,  0.0f, */
-    /*      0.0f,  1.0f,  0.0f, */
-    /*      0.0f,  0.0f,  1.0f, */
-    /*      1.0f,  0.0f,  0.0f, */
-    /*      0.0f,  1.0f,  0.0f, */
-    /*      0.0f,  0.0f,  1.0f, */
-    /* }; */
-
-    /* srand(time(NULL)); */
-    /* for (int i = 0; i < sizeof(color_vectors) / sizeof(GLfloat); i+=2) { */
-    /*     color_vectors[i] = (GLfloat)(rand() % 100) / 100; */
-    /*     std::cout << i << " " << color_vectors[i] << std::endl; */
-    /* } */
-
-    float p = 0.25; // protrusion factor for pyramid face
-    float bucephalus_vectors[] = {
-        // front face of inner cube
-        -0.5f,  0.5f,  0.5f,          // 0
-        -0.5f, -0.5f,  0.5f,          // 1
-         0.5f,  0.5f,  0.5f,          // 2
-         0.5f, -0.5f,  0.5f,          // 3
-         // rear face of inner cube
-        -0.5f,  0.5f, -0.5f,          // 4
-        -0.5f, -0.5f, -0.5f,          // 5
-         0.5f,  0.5f, -0.5f,          // 6
-         0.5f, -0.5f, -0.5f,          // 7
-         // "pyramid face" vectors
-         0.5f+p,  0.0f,    0.0f,      // 8
-        -0.5f-p,  0.0f,    0.0f,      // 9
-         0.0f,    0.5f+p,  0.0f,      // 10
-         0.0f,   -0.5f-p,  0.0f,      // 11
-         0.0f,    0.0f,    0.5f+p,    // 12
-         0.0f,    0.0f,   -0.5f-p,    // 13
-    };
-    GLuint bucephalus_indices[] = {
-        // front face
-        0, 1, 12,
-        0, 2, 12,
-        3, 1, 12,
-        3, 2, 12,
-        // rear face
-        4, 5, 13,
-        4, 6, 13,
-        7, 5, 13,
-        7, 6, 13,
-        // right face
-        2, 3, 8, 
-        2, 6, 8,
-        7, 3, 8,
-        7, 6, 8,
-        // left face
-        0, 1, 9, 
-        0, 4, 9,
-        5, 1, 9,
-        5, 4, 9,
-        // top face
-        0, 4, 10, 
-        0, 2, 10,
-        6, 4, 10,
-        6, 2, 10,
-        // bottom face
-        1, 5, 11, 
-        1, 3, 11,
-        7, 5, 11,
-        7, 3, 11,
-    };
-
-    /* Binding for our 3d objects */
-    GLuint vertex_arr;
-    glGenVertexArrays(1, &vertex_arr);
-    glBindVertexArray(vertex_arr);
-
-    GLuint color_buffer;
-    glGenBuffers(1, &color_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, color_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(color_vectors)*3, 
-        color_vectors, GL_STATIC_DRAW
-    );
-
-    GLuint vposition_buffer;
-    glGenBuffers(1, &vposition_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vposition_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(bucephalus_vectors)*3,
-        bucephalus_vectors, GL_STATIC_DRAW
-    );
-
-    GLuint element_buffer;
-    glGenBuffers(1, &element_buffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(bucephalus_indices),
-        bucephalus_indices, GL_STATIC_DRAW
-    );
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glBindBuffer(GL_ARRAY_BUFFER, color_buffer);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-
-    /* Shader program initialization logic */
-    std::unique_ptr<shaderSrc> vertex_src, fragment_src;
-    vertex_src = glhelpers::load_shader_file(
-        GL_VERTEX_SHADER, "res/shaders/vert.vert"
-    );
-    fragment_src = glhelpers::load_shader_file(
-        GL_FRAGMENT_SHADER, "res/shaders/frag.frag"
-    );
-    GLuint vs = glhelpers::compile_shaderSrc(vertex_src.get());
-    GLuint fs = glhelpers::compile_shaderSrc(fragment_src.get());
-
-    /* Link the shader program and use it*/
-    GLuint shader_prog = glCreateProgram();
-    glAttachShader(shader_prog, vs);
-    glAttachShader(shader_prog, fs);
-    glhelpers::gl_link_program(shader_prog);
-
-    /* Misc. setup for render loop */
-    size_t n_elements = sizeof(bucephalus_indices)/sizeof(GLuint);
-
-    int theta = 1;
-    int rotational_velocity = 1;
-    MovingObject bucephalus(0.0, -1.0, &model[3][0], &model[3][1]);
-
-    glm::mat4 rotation_matrix = (
-        glhelpers::rot3d_matrix(theta, 'x') * glhelpers::rot3d_matrix(theta, 'y')
-    );
-    glUseProgram(shader_prog);
-    int model_location = glGetUniformLocation(shader_prog, "model");
-    int rot_location = glGetUniformLocation(shader_prog, "rotation");
-    int squish_location = glGetUniformLocation(shader_prog, "squish");
-    glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(rot_location, 1, GL_FALSE, glm::value_ptr(rotation_matrix));
-    glUniformMatrix4fv(squish_location, 1, GL_FALSE, glm::value_ptr(squish));
-    glBindBuffer(GL_ARRAY_BUFFER, vposition_buffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
-
-    glhelpers::SimpleTimer timer = glhelpers::SimpleTimer();
-
-	const unsigned int FRAME_DELAY_60FPS_CAP = 16500000;
-
-    /* Render loop */
-    while (!glfwWindowShouldClose(window)) {
-        glhelpers::update_fps_counter(window);
-        timer.update();
-        
-        squish_matrix(squish, model[3][1], 0.15f, -0.6f);
-        glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(model));
-        rotation_matrix = (
-            glhelpers::rot3d_matrix(theta, 'x') * glhelpers::rot3d_matrix(theta, 'y')
-        );
-        glUniformMatrix4fv(rot_location, 1, GL_FALSE, 
-            glm::value_ptr(rotation_matrix)
-        );
-        glUniformMatrix4fv(squish_location, 1, GL_FALSE, 
-            glm::value_ptr(squish)
-        );
-
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		int width, height;
-		glfwGetFramebufferSize(window, &width, &height);
-        glViewport(0, 0, width, height);
-
-        /* Draw objects here */
-        glDrawElements(GL_TRIANGLES, n_elements, GL_UNSIGNED_INT, nullptr);
-
-        glfwPollEvents();
-        glfwSwapBuffers(window);
-
-        if (GLFW_PRESS == glfwGetKey(window, GLFW_KEY_ESCAPE)) {
-            glfwSetWindowShouldClose(window, 1);
+        bool init(Runtime& runtime) override {
+            float scale = CANDY_SCALE;
+            float wcorr = WIDESCREEN_CORRECTION;
+            glm::mat4 model{
+                 scale,         0.0f,   0.0f, 0.0f,
+                  0.0f,  scale/wcorr,   0.0f, 0.0f,
+                  0.0f,         0.0f,  scale, 0.0f,
+                  0.0f,         0.0f,   0.0f, 1.0f
+            };
+            glm::mat4 squish{
+                  1.0f,  0.0f,  0.0f, 0.0f,
+                  0.0f,  1.0f,  0.0f, 0.0f,
+                  0.0f,  0.0f,  1.0f, 0.0f,
+                  0.0f,  0.0f,  0.0f, 1.0f
+            };
+
+            // one model and squish matrix per candy
+            this->models.assign(this->n_candies, model);
+            this->squishes.assign(this->n_candies, squish);
+            for (int i = 0; i < this->n_candies; i++) {
+                // spread candies across the floor and stagger their drop heights
+                this->models[i][3][0] = (this->n_candies > 1) ?
+                    -0.75f + 1.5f * i / (this->n_candies - 1) : 0.0f;
+                this->models[i][3][1] = -0.05f - 0.55f * (float)(i % 7) / 7.0f;
+            }
+
+            if (this->tessellated) {
+                // 30 vertices of control cage, the GPU makes the rest of the candy
+                std::vector<float> cage;
+                for (const int* patch : CAGE_PATCHES) {
+                    for (int i = 0; i < CAGE_PATCH_SIZE; i++) {
+                        cage.insert(cage.end(), CAGE_POINTS[patch[i]], CAGE_POINTS[patch[i]] + 3);
+                        cage.insert(cage.end(), CAGE_COLORS[patch[i]], CAGE_COLORS[patch[i]] + 3);
+                    }
+                }
+                glGenVertexArrays(1, &this->cage_array);
+                glBindVertexArray(this->cage_array);
+                glGenBuffers(1, &this->cage_buffer);
+                glBindBuffer(GL_ARRAY_BUFFER, this->cage_buffer);
+                glBufferData(GL_ARRAY_BUFFER, cage.size() * sizeof(float), cage.data(),
+                             GL_STATIC_DRAW);
+                glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), nullptr);
+                glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+                                      (void*)(3 * sizeof(float)));
+                glEnableVertexAttribArray(0);
+                glEnableVertexAttribArray(1);
+                this->shader_prog = runtime.loadTessellatedProgram(
+                    "shaders/cage.vert", "shaders/candy.tesc", "shaders/candy.tese",
+                    "shaders/frag.frag"
+                );
+            } else {
+                /* The candy's shape and vertex colors, packed by tools/meshpack from
+                   res/meshes/bucephalus.obj; its points stick out by PROTRUSION */
+                if (!runtime.loadMesh("meshes/bucephalus.smsh", &this->candy)) {
+                    return false;
+                }
+                this->shader_prog = runtime.loadShaderProgram(
+                    "shaders/vert.vert", "shaders/frag.frag"
+                );
+            }
+            if (!this->shader_prog) {
+                return false;
+            }
+
+            this->theta = 1;
+            this->rotational_velocity = 1;
+            // MovingObjects keep pointers into models, which never gets resized after this
+            this->candies.clear();
+            this->candies.reserve(this->n_candies);
+            for (int i = 0; i < this->n_candies; i++) {
+                this->candies.emplace_back(0.0, -1.0, &this->models[i][3][0], &this->models[i][3][1]);
+            }
+
+            this->draw_list.clear();
+            this->draw_list.reserve(this->n_candies);
+
+            // Candies bump into each other as circles, impacts fade out over a few frames
+            this->collisions.reset(new CollisionWorld(
+                aabb2d{ -1.0f, -1.0f, 1.0f, 1.0f }, CANDY_RADIUS, &runtime.jobs()
+            ));
+            this->collisions->bodies().resize(this->n_candies);
+            this->impacts.assign(this->n_candies, 0.0f);
+            this->transforms.assign(this->n_candies, soupcans::identityMat4());
+
+            glUseProgram(this->shader_prog);
+            this->transform_location = glGetUniformLocation(this->shader_prog, "transform");
+            this->protrusion_location = glGetUniformLocation(this->shader_prog, "protrusion");
+            this->viewport_location = glGetUniformLocation(this->shader_prog, "viewport_size");
+            if (this->tessellated) {
+                GLint max_level = MAX_TESSELLATION_LEVEL;
+                glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &max_level);
+                glUniform1f(glGetUniformLocation(this->shader_prog, "max_level"),
+                            static_cast<float>(std::min<GLint>(max_level, MAX_TESSELLATION_LEVEL)));
+                glUniform1f(glGetUniformLocation(this->shader_prog, "pixels_per_segment"),
+                            PIXELS_PER_SEGMENT);
+                glUniform1f(glGetUniformLocation(this->shader_prog, "roundness"), this->roundness);
+            }
+            return true;
         }
 
-        if (*obj_y > 0.0f || *obj_y < -0.65f) {
-            bucephalus.setVelocity(0.0f, -bucephalus.getVelocityY());
+        void update(Runtime& runtime, double elapsed_seconds) override {
+            JobSystem& jobs = runtime.jobs();
+            CollisionWorld& collisions = *this->collisions;
+            std::vector<MovingObject>& candies = this->candies;
+            uint32_t grain = jobs.grainFor(this->n_candies);
+
+            jobs.parallelFor(0, this->n_candies, grain, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; i++) {
+                    MovingObject& candy = candies[i];
+                    float vel_x = candy.getVelocityX(), vel_y = candy.getVelocityY();
+                    // only turn around when heading further out, collisions can push us past a wall
+                    if ((candy.getPositionY() > 0.0f && vel_y > 0.0f) ||
+                        (candy.getPositionY() < -0.65f && vel_y < 0.0f)) {
+                        vel_y = -vel_y;
+                    }
+                    if (fabs(candy.getPositionX()) > 0.8f && candy.getPositionX() * vel_x > 0.0f) {
+                        vel_x = -vel_x;
+                    }
+                    candy.setVelocity(vel_x, vel_y);
+                    candy.applyVelocity(elapsed_seconds);
+                    candy.recordPosition();
+
+                    collisionBody& body = collisions.bodies()[i];
+                    body.x = candy.getPositionX();
+                    body.y = candy.getPositionY();
+                    body.vx = candy.getVelocityX();
+                    body.vy = candy.getVelocityY();
+                    body.radius = CANDY_RADIUS;
+                    body.inv_mass = 1.0f;
+                }
+            });
+            collisions.step();
+            for (int i = 0; i < this->n_candies; i++) {
+                const collisionBody& body = collisions.bodies()[i];
+                candies[i].setPosition(body.x, body.y);
+                candies[i].setVelocity(body.vx, body.vy);
+                this->impacts[i] = std::max(collisions.impact(i), this->impacts[i] * 0.85f);
+            }
+            this->theta = (this->theta < 360) ? this->theta + this->rotational_velocity :
+                                                this->theta + this->rotational_velocity - 360;
+            // every candy spins the same way, one quaternion product covers them all
+            mat4f rotation = soupcans::quatToMat4(soupcans::quatMultiply(
+                soupcans::quatDegrees(soupcans::AXIS_X, this->theta),
+                soupcans::quatDegrees(soupcans::AXIS_Y, this->theta)
+            ));
+
+            // bounds only live for this frame
+            aabb2d* candy_bounds = runtime.frameArena().allocateArray<aabb2d>(this->n_candies);
+            jobs.parallelFor(0, this->n_candies, grain, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; i++) {
+                    squish_matrix(this->squishes[i], this->models[i][3][1], CANDY_RADIUS,
+                                  -0.6f, this->impacts[i]);
+                    candy_bounds[i] = soupcans::aabbAround(
+                        this->models[i][3][0], this->models[i][3][1],
+                        CANDY_EXTENT, CANDY_EXTENT / WIDESCREEN_CORRECTION
+                    );
+                }
+                // model * squish * rotation, so the shader gets one matrix per candy
+                soupcans::composeMat4Batch(
+                    glm::value_ptr(this->models[begin]), 1,
+                    glm::value_ptr(this->squishes[begin]), 1,
+                    rotation.m, 0, this->transforms[begin].m, end - begin
+                );
+            });
+            this->grid.rebuild(candy_bounds, this->n_candies);
+            this->grid.cullVisible(soupcans::NDC_VIEW, this->draw_list, jobs);
         }
-        bucephalus.applyVelocity(timer.getElapsedSeconds());
-        bucephalus.recordPosition();
-        theta = (theta < 360) ? theta + rotational_velocity : 
-                                theta + rotational_velocity - 360;
 
-		// cap our program to 60fps with a delay before next frame
-		nanoDelay(FRAME_DELAY_60FPS_CAP);
-    }
+        void render(Runtime& runtime) override {
+            runtime.beginRenderPass(soupcans::depthTestedPass());
+            glUseProgram(this->shader_prog);
+
+            if (this->tessellated) {
+                // the level of detail follows each candy's size on screen
+                int width, height;
+                runtime.framebufferSize(&width, &height);
+                glUniform2f(this->viewport_location, static_cast<float>(width),
+                            static_cast<float>(height));
+                glPatchParameteri(GL_PATCH_VERTICES, CAGE_PATCH_SIZE);
+                glBindVertexArray(this->cage_array);
+            } else {
+                glBindVertexArray(this->candy.vertex_array);
+            }
+
+            /* Draw objects here, only the ones that survived culling */
+            for (uint32_t id : this->draw_list) {
+                glUniformMatrix4fv(this->transform_location, 1, GL_FALSE,
+                    this->transforms[id].m
+                );
+                if (this->tessellated) {
+                    // spikes flare out on impact and settle back as it fades
+                    float flare = std::min(this->impacts[id] / CANDY_RADIUS, 1.0f);
+                    glUniform1f(this->protrusion_location,
+                                PROTRUSION * (1.0f + SPIKE_FLARE * flare));
+                    glDrawArrays(GL_PATCHES, 0, N_CAGE_PATCHES * CAGE_PATCH_SIZE);
+                } else {
+                    glDrawElements(GL_TRIANGLES, this->candy.n_indices, this->candy.index_type,
+                                   nullptr);
+                }
+            }
+            runtime.endRenderPass();
+        }
+
+        void shutdown(Runtime& runtime) override {
+            (void)runtime;
+            this->collisions.reset();
+            glDeleteProgram(this->shader_prog);
+            if (this->tessellated) {
+                glDeleteVertexArrays(1, &this->cage_array);
+                glDeleteBuffers(1, &this->cage_buffer);
+            } else {
+                soupcans::deleteMesh(&this->candy);
+            }
+        }
 
-    glfwTerminate();
+    private:
+        int n_candies;
+        std::vector<glm::mat4> models;
+        std::vector<glm::mat4> squishes;
+        std::vector<mat4f> transforms;
+        std::vector<MovingObject> candies;
+        std::vector<float> impacts;
+        SpatialGrid grid;
+        std::vector<uint32_t> draw_list;
+        std::unique_ptr<CollisionWorld> collisions;
+        int theta;
+        int rotational_velocity;
+
+        bool tessellated;
+        float roundness;
+        soupcans::gpuMesh candy;
+        GLuint cage_array, cage_buffer;
+        GLuint shader_prog;
+        int transform_location;
+        int protrusion_location;
+        int viewport_location;
+};
 
-    return 0;
+// candy count, then --mesh to skip tessellation or --roundness 0..1 to smooth the spikes
+std::unique_ptr<Scene> soupcans::createBouncingCandyScene(int argc, char** argv) {
+    int n_candies = 1;
+    bool tessellated = true;
+    float roundness = 0.0f;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mesh") == 0) {
+            // the packed 14 vertex mesh, vert.vert and frag.frag only need GL 3.3
+            tessellated = false;
+        } else if (strcmp(argv[i], "--roundness") == 0 && i + 1 < argc) {
+            roundness = std::min(std::max(static_cast<float>(atof(argv[++i])), 0.0f), 1.0f);
+        } else {
+            n_candies = atoi(argv[i]);
+        }
+    }
+    if (n_candies < 1) {
+        n_candies = 1;
+    }
+    return std::unique_ptr<Scene>(new BouncingCandyScene(n_candies, tessellated, roundness));
 }
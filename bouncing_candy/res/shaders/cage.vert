@@ -0,0 +1,13 @@
+#version 430
+
+layout(location = 0) in vec3 vertex_position;
+layout(location = 1) in vec3 vertex_color;
+
+// the control cage goes through untouched, candy.tese places the vertices
+out vec3 cage_position;
+out vec3 cage_color;
+
+void main() {
+    cage_position = vertex_position;
+    cage_color = vertex_color;
+}
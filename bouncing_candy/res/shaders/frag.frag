@@ -1,4 +1,4 @@
-#version 430
+#version 330 core
 
 in vec3 color;
 out vec4 frag_color;
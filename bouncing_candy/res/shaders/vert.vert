@@ -1,16 +1,15 @@
-#version 430
+#version 330 core
 
 layout(location = 0) in vec3 vertex_position;
 layout(location = 1) in vec3 vertex_color;
 
-uniform mat4 model;
-uniform mat4 squish;
-uniform mat4 rotation;
+// model * squish * rotation, composed on the CPU
+uniform mat4 transform;
 
 out vec3 color;
 
 void main() {
     color = vertex_color;
     //color = vec3(1.0, 0.0, 0.0);
-    gl_Position = model * squish * rotation * vec4(vertex_position, 1.0); 
+    gl_Position = transform * vec4(vertex_position, 1.0);
 }
@@ -0,0 +1,243 @@
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "cloudNoise.hpp"
+#include "jobSystem.hpp"
+
+namespace soupcans {
+
+static const float TWO_PI = 6.28318530718f;
+// tileableNoise() peaks near sqrt(1/2), this stretches the sum to about [-1, 1]
+static const float NOISE_NORMALIZE = 1.41421356f;
+
+// integer finalizer, the GLSL side does the same arithmetic on uints
+static uint32_t hash32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+static void latticeGradient(int ix, int iy, uint32_t seed, float* gx, float* gy) {
+    uint32_t h = hash32((uint32_t)ix ^ hash32((uint32_t)iy ^ hash32(seed)));
+    float angle = (float)(h >> 8) * (TWO_PI / 16777216.0f);
+    *gx = cosf(angle);
+    *gy = sinf(angle);
+}
+
+static inline float fade(float t) {
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+float tileableNoise(float x, float y, int period, uint32_t seed) {
+    float fx = floorf(x), fy = floorf(y);
+    float tx = x - fx, ty = y - fy;
+    int ix0 = ((int)fx % period + period) % period;
+    int iy0 = ((int)fy % period + period) % period;
+    int ix1 = (ix0 + 1 == period) ? 0 : ix0 + 1;
+    int iy1 = (iy0 + 1 == period) ? 0 : iy0 + 1;
+
+    float g00x, g00y, g10x, g10y, g01x, g01y, g11x, g11y;
+    latticeGradient(ix0, iy0, seed, &g00x, &g00y);
+    latticeGradient(ix1, iy0, seed, &g10x, &g10y);
+    latticeGradient(ix0, iy1, seed, &g01x, &g01y);
+    latticeGradient(ix1, iy1, seed, &g11x, &g11y);
+
+    float n00 = g00x * tx + g00y * ty;
+    float n10 = g10x * (tx - 1.0f) + g10y * ty;
+    float n01 = g01x * tx + g01y * (ty - 1.0f);
+    float n11 = g11x * (tx - 1.0f) + g11y * (ty - 1.0f);
+    float u = fade(tx), v = fade(ty);
+    float nx0 = n00 + u * (n10 - n00);
+    float nx1 = n01 + u * (n11 - n01);
+    return nx0 + v * (nx1 - nx0);
+}
+
+float cloudDensity(float u, float v, const cloudSettings& settings) {
+    float sum = 0.0f, total = 0.0f, amplitude = 1.0f;
+    for (int octave = 0; octave < settings.n_octaves; octave++) {
+        int period = settings.period << octave;
+        sum += amplitude * tileableNoise(u * period, v * period, period,
+                                         settings.seed + (uint32_t)octave);
+        total += amplitude;
+        amplitude *= settings.persistence;
+    }
+    return (total > 0.0f) ? sum / total * NOISE_NORMALIZE : 0.0f;
+}
+
+// one octave's gradients, precomputed so the row loop only does arithmetic
+struct octaveLattice {
+    int period;
+    float amplitude;
+    std::vector<float> gx;
+    std::vector<float> gy;
+};
+
+static void accumulateScalar(const octaveLattice& lattice, const float* gx0, const float* gy0,
+                             const float* gx1, const float* gy1, float ty, float v,
+                             float x_scale, int x, float* row) {
+    float sx = ((float)x + 0.5f) * x_scale;
+    int ix0 = (int)sx;
+    float tx = sx - (float)ix0;
+    ix0 = (ix0 >= lattice.period) ? ix0 - lattice.period : ix0;
+    int ix1 = (ix0 + 1 == lattice.period) ? 0 : ix0 + 1;
+
+    float n00 = gx0[ix0] * tx + gy0[ix0] * ty;
+    float n10 = gx0[ix1] * (tx - 1.0f) + gy0[ix1] * ty;
+    float n01 = gx1[ix0] * tx + gy1[ix0] * (ty - 1.0f);
+    float n11 = gx1[ix1] * (tx - 1.0f) + gy1[ix1] * (ty - 1.0f);
+    float u = fade(tx);
+    float nx0 = n00 + u * (n10 - n00);
+    float nx1 = n01 + u * (n11 - n01);
+    row[x] += lattice.amplitude * (nx0 + v * (nx1 - nx0));
+}
+
+#ifdef __SSE2__
+static inline __m128 gather(const float* table, const int* index) {
+    return _mm_set_ps(table[index[3]], table[index[2]], table[index[1]], table[index[0]]);
+}
+
+static inline __m128 fade4(__m128 t) {
+    __m128 inner = _mm_add_ps(
+        _mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))),
+        _mm_set1_ps(10.0f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+#endif
+
+// adds one octave of noise to row y of a width wide tile
+static void accumulateOctaveRow(const octaveLattice& lattice, int y, int width, int height,
+                                float* row) {
+    int period = lattice.period;
+    float sy = ((float)y + 0.5f) * ((float)period / (float)height);
+    int iy0 = (int)sy;
+    float ty = sy - (float)iy0;
+    iy0 = (iy0 >= period) ? iy0 - period : iy0;
+    int iy1 = (iy0 + 1 == period) ? 0 : iy0 + 1;
+    float v = fade(ty);
+    const float* gx0 = lattice.gx.data() + iy0 * period;
+    const float* gy0 = lattice.gy.data() + iy0 * period;
+    const float* gx1 = lattice.gx.data() + iy1 * period;
+    const float* gy1 = lattice.gy.data() + iy1 * period;
+    float x_scale = (float)period / (float)width;
+
+    int x = 0;
+#ifdef __SSE2__
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 ty4 = _mm_set1_ps(ty);
+    const __m128 ty4_minus_one = _mm_set1_ps(ty - 1.0f);
+    const __m128 v4 = _mm_set1_ps(v);
+    const __m128 amplitude4 = _mm_set1_ps(lattice.amplitude);
+    const __m128i period4 = _mm_set1_epi32(period);
+    const __m128i last4 = _mm_set1_epi32(period - 1);
+    alignas(16) int i0[4], i1[4];
+    for (; x + 4 <= width; x += 4) {
+        __m128 sx = _mm_mul_ps(
+            _mm_add_ps(_mm_set_ps((float)(x + 3), (float)(x + 2), (float)(x + 1), (float)x),
+                       _mm_set1_ps(0.5f)),
+            _mm_set1_ps(x_scale));
+        // sx is never negative, so truncating is flooring
+        __m128i ix0 = _mm_cvttps_epi32(sx);
+        __m128 tx = _mm_sub_ps(sx, _mm_cvtepi32_ps(ix0));
+        // wrap rounding at the right edge, then the right hand lattice column
+        ix0 = _mm_sub_epi32(ix0, _mm_andnot_si128(_mm_cmpgt_epi32(period4, ix0), period4));
+        __m128i ix1 = _mm_andnot_si128(_mm_cmpeq_epi32(ix0, last4),
+                                       _mm_add_epi32(ix0, _mm_set1_epi32(1)));
+        _mm_store_si128(reinterpret_cast<__m128i*>(i0), ix0);
+        _mm_store_si128(reinterpret_cast<__m128i*>(i1), ix1);
+
+        __m128 tx_minus_one = _mm_sub_ps(tx, one);
+        __m128 n00 = _mm_add_ps(_mm_mul_ps(gather(gx0, i0), tx),
+                                _mm_mul_ps(gather(gy0, i0), ty4));
+        __m128 n10 = _mm_add_ps(_mm_mul_ps(gather(gx0, i1), tx_minus_one),
+                                _mm_mul_ps(gather(gy0, i1), ty4));
+        __m128 n01 = _mm_add_ps(_mm_mul_ps(gather(gx1, i0), tx),
+                                _mm_mul_ps(gather(gy1, i0), ty4_minus_one));
+        __m128 n11 = _mm_add_ps(_mm_mul_ps(gather(gx1, i1), tx_minus_one),
+                                _mm_mul_ps(gather(gy1, i1), ty4_minus_one));
+        __m128 u = fade4(tx);
+        __m128 nx0 = _mm_add_ps(n00, _mm_mul_ps(u, _mm_sub_ps(n10, n00)));
+        __m128 nx1 = _mm_add_ps(n01, _mm_mul_ps(u, _mm_sub_ps(n11, n01)));
+        __m128 n = _mm_add_ps(nx0, _mm_mul_ps(v4, _mm_sub_ps(nx1, nx0)));
+        _mm_storeu_ps(row + x, _mm_add_ps(_mm_loadu_ps(row + x), _mm_mul_ps(amplitude4, n)));
+    }
+#endif
+    for (; x < width; x++) {
+        accumulateScalar(lattice, gx0, gy0, gx1, gy1, ty, v, x_scale, x, row);
+    }
+}
+
+static inline unsigned char toByte(float value) {
+    return (unsigned char)(value * 255.0f + 0.5f);
+}
+
+// density in about [-1, 1] to sky blue through grey to white
+static void shadeCloud(float density, float coverage, unsigned char* rgba) {
+    float c = (0.5f + 0.5f * density - coverage) / (1.0f - coverage);
+    c = (c < 0.0f) ? 0.0f : (c > 1.0f ? 1.0f : c);
+    c = c * (2.0f - c);
+    static const float SKY[3] = { 0.40f, 0.62f, 0.90f };
+    static const float SHADOW[3] = { 0.80f, 0.82f, 0.88f };
+    for (int i = 0; i < 3; i++) {
+        float cloud = SHADOW[i] + c * (1.0f - SHADOW[i]);
+        rgba[i] = toByte(SKY[i] + c * (cloud - SKY[i]));
+    }
+    rgba[3] = 255;
+}
+
+void generateCloudTexture(const cloudSettings& settings, int width, int height,
+                          unsigned char* pixels, JobSystem* jobs) {
+    if (width <= 0 || height <= 0 || settings.period <= 0) {
+        return;
+    }
+    std::vector<octaveLattice> lattices(settings.n_octaves);
+    float total = 0.0f, amplitude = 1.0f;
+    for (int octave = 0; octave < settings.n_octaves; octave++) {
+        octaveLattice& lattice = lattices[octave];
+        lattice.period = settings.period << octave;
+        lattice.amplitude = amplitude;
+        lattice.gx.resize(lattice.period * lattice.period);
+        lattice.gy.resize(lattice.period * lattice.period);
+        for (int iy = 0; iy < lattice.period; iy++) {
+            for (int ix = 0; ix < lattice.period; ix++) {
+                int i = iy * lattice.period + ix;
+                latticeGradient(ix, iy, settings.seed + (uint32_t)octave,
+                                &lattice.gx[i], &lattice.gy[i]);
+            }
+        }
+        total += amplitude;
+        amplitude *= settings.persistence;
+    }
+    float normalize = (total > 0.0f) ? NOISE_NORMALIZE / total : 0.0f;
+    float coverage = (settings.coverage < 0.0f) ? 0.0f :
+        (settings.coverage > 0.99f ? 0.99f : settings.coverage);
+
+    auto generate_rows = [&](uint32_t begin, uint32_t end) {
+        std::vector<float> row(width);
+        for (uint32_t y = begin; y < end; y++) {
+            std::fill(row.begin(), row.end(), 0.0f);
+            for (const octaveLattice& lattice : lattices) {
+                accumulateOctaveRow(lattice, (int)y, width, height, row.data());
+            }
+            unsigned char* out = pixels + (size_t)y * width * 4;
+            for (int x = 0; x < width; x++) {
+                shadeCloud(row[x] * normalize, coverage, out + x * 4);
+            }
+        }
+    };
+    if (jobs) {
+        jobs->parallelFor(0, height, jobs->grainFor(height, 8), generate_rows);
+    } else {
+        generate_rows(0, height);
+    }
+}
+
+}
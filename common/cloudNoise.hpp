@@ -0,0 +1,43 @@
+#ifndef SOUPCANS_CLOUD_NOISE_HPP
+#define SOUPCANS_CLOUD_NOISE_HPP
+
+#include <stdint.h>
+
+namespace soupcans {
+
+class JobSystem;
+
+struct cloudSettings {
+    // lattice cells across the tile in the coarsest octave
+    int period;
+    int n_octaves;
+    // amplitude kept from one octave to the next
+    float persistence;
+    // 0 covers the whole sky, 1 leaves it clear
+    float coverage;
+    uint32_t seed;
+};
+
+const cloudSettings DEFAULT_CLOUDS = { 4, 6, 0.5f, 0.45f, 1u };
+
+/* Periodic gradient noise: the lattice wraps every `period` cells, so
+   noise(x + period, y) == noise(x, y + period) == noise(x, y). Roughly
+   in [-0.7, 0.7]. res/shaders/clouds_fragment.glsl in shader_triangle
+   computes the same function on the GPU, keep the two in step.
+*/
+float tileableNoise(float x, float y, int period, uint32_t seed);
+
+// fractal sum of tileableNoise() octaves at (u, v) in [0, 1), scaled to about [-1, 1]
+float cloudDensity(float u, float v, const cloudSettings& settings);
+
+/* Fills `pixels` with a width x height RGBA8 sky that repeats seamlessly
+   in both directions at any size, so it can scroll with plain GL_REPEAT
+   sampling. Rows are spread across `jobs` when given; each row is
+   evaluated four pixels at a time with SSE2 where the compiler allows.
+*/
+void generateCloudTexture(const cloudSettings& settings, int width, int height,
+                          unsigned char* pixels, JobSystem* jobs = nullptr);
+
+}
+
+#endif
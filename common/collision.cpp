@@ -0,0 +1,190 @@
+#include <math.h>
+
+#include <chrono>
+
+#include "collision.hpp"
+
+namespace soupcans {
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+}
+
+CollisionWorld::CollisionWorld(aabb2d playfield, float max_radius, JobSystem* jobs)
+    : grid(SpatialGrid::fitted(playfield, 2.0f * max_radius)) {
+    this->jobs = jobs;
+    this->max_contacts = UINT32_MAX;
+    this->restitution = 1.0f;
+    this->last_stats = collisionStats{};
+}
+
+void CollisionWorld::detectChunk(int chunk) {
+    int n_cells = this->grid.cellCount();
+    int cell_begin = static_cast<int>((int64_t)n_cells * chunk / N_CHUNKS);
+    int cell_end = static_cast<int>((int64_t)n_cells * (chunk + 1) / N_CHUNKS);
+
+    std::vector<collisionContact>& out = this->chunk_contacts[chunk];
+    uint32_t& n_candidates = this->chunk_candidates[chunk];
+    out.clear();
+    n_candidates = 0;
+
+    const collisionBody* bodies = this->body_list.data();
+    this->grid.forEachOverlappingPairInCells(cell_begin, cell_end,
+        [&](uint32_t a, uint32_t b) {
+            n_candidates++;
+            float dx = bodies[b].x - bodies[a].x;
+            float dy = bodies[b].y - bodies[a].y;
+            float min_dist = bodies[a].radius + bodies[b].radius;
+            float dist_sq = dx * dx + dy * dy;
+            if (dist_sq >= min_dist * min_dist) {
+                return;
+            }
+            float dist = sqrtf(dist_sq);
+            collisionContact contact;
+            contact.a = a;
+            contact.b = b;
+            if (dist > 1e-6f) {
+                contact.nx = dx / dist;
+                contact.ny = dy / dist;
+            } else {
+                // perfectly stacked, push apart along y
+                contact.nx = 0.0f;
+                contact.ny = 1.0f;
+            }
+            contact.depth = min_dist - dist;
+            out.push_back(contact);
+        }
+    );
+}
+
+void CollisionWorld::resolve(const collisionContact& contact) {
+    collisionBody& a = this->body_list[contact.a];
+    collisionBody& b = this->body_list[contact.b];
+    float inv_mass_sum = a.inv_mass + b.inv_mass;
+    if (inv_mass_sum <= 0.0f) {
+        return;
+    }
+
+    // push the bodies apart so they no longer overlap
+    float correction = contact.depth / inv_mass_sum;
+    a.x -= contact.nx * correction * a.inv_mass;
+    a.y -= contact.ny * correction * a.inv_mass;
+    b.x += contact.nx * correction * b.inv_mass;
+    b.y += contact.ny * correction * b.inv_mass;
+
+    // bounce only if they are still moving towards each other
+    float closing = (b.vx - a.vx) * contact.nx + (b.vy - a.vy) * contact.ny;
+    if (closing < 0.0f) {
+        float j = -(1.0f + this->restitution) * closing / inv_mass_sum;
+        a.vx -= j * contact.nx * a.inv_mass;
+        a.vy -= j * contact.ny * a.inv_mass;
+        b.vx += j * contact.nx * b.inv_mass;
+        b.vy += j * contact.ny * b.inv_mass;
+    }
+
+    if (contact.depth > this->body_impact[contact.a]) {
+        this->body_impact[contact.a] = contact.depth;
+    }
+    if (contact.depth > this->body_impact[contact.b]) {
+        this->body_impact[contact.b] = contact.depth;
+    }
+}
+
+/* How many of its contacts each chunk keeps under max_contacts. A chunk
+   is a band of the playfield, so cutting the concatenated list would
+   leave the last bands unresolved whenever the cap is hit. Instead every
+   chunk gets an equal share, and what chunks with fewer contacts don't
+   use goes to the others.
+*/
+void CollisionWorld::shareContactCap(uint32_t* quota) const {
+    uint64_t remaining = this->max_contacts;
+    int n_open = 0;
+    bool open[N_CHUNKS];
+    for (int chunk = 0; chunk < N_CHUNKS; chunk++) {
+        quota[chunk] = 0;
+        open[chunk] = !this->chunk_contacts[chunk].empty();
+        n_open += open[chunk] ? 1 : 0;
+    }
+    bool settled = false;
+    while (n_open > 0 && !settled) {
+        uint64_t share = remaining / n_open;
+        settled = true;
+        for (int chunk = 0; chunk < N_CHUNKS; chunk++) {
+            uint64_t found = this->chunk_contacts[chunk].size();
+            if (open[chunk] && found <= share) {
+                quota[chunk] = static_cast<uint32_t>(found);
+                remaining -= found;
+                open[chunk] = false;
+                n_open--;
+                settled = false;
+            }
+        }
+    }
+    if (n_open == 0) {
+        return;
+    }
+    // every chunk still open found more than its share
+    uint64_t share = remaining / n_open;
+    uint64_t extra = remaining % n_open;
+    for (int chunk = 0; chunk < N_CHUNKS; chunk++) {
+        if (open[chunk]) {
+            quota[chunk] = static_cast<uint32_t>(share + ((extra > 0) ? 1 : 0));
+            extra -= (extra > 0) ? 1 : 0;
+        }
+    }
+}
+
+void CollisionWorld::step() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint32_t n_bodies = static_cast<uint32_t>(this->body_list.size());
+
+    this->body_bounds.resize(n_bodies);
+    for (uint32_t i = 0; i < n_bodies; i++) {
+        const collisionBody& body = this->body_list[i];
+        this->body_bounds[i] = aabbAround(body.x, body.y, body.radius, body.radius);
+    }
+    this->grid.rebuild(this->body_bounds.data(), n_bodies);
+
+    // every job only ever writes the output of its own chunks
+    if (!this->jobs || n_bodies < 1024) {
+        for (int chunk = 0; chunk < N_CHUNKS; chunk++) {
+            this->detectChunk(chunk);
+        }
+    } else {
+        this->jobs->parallelFor(0, N_CHUNKS, 1, [this](uint32_t begin, uint32_t end) {
+            for (uint32_t chunk = begin; chunk < end; chunk++) {
+                this->detectChunk(chunk);
+            }
+        });
+    }
+
+    collisionStats stats = collisionStats{};
+    for (int chunk = 0; chunk < N_CHUNKS; chunk++) {
+        stats.n_candidate_pairs += this->chunk_candidates[chunk];
+        stats.n_contacts += static_cast<uint32_t>(this->chunk_contacts[chunk].size());
+    }
+    uint32_t quota[N_CHUNKS];
+    this->shareContactCap(quota);
+    this->contact_list.clear();
+    for (int chunk = 0; chunk < N_CHUNKS; chunk++) {
+        const std::vector<collisionContact>& found = this->chunk_contacts[chunk];
+        this->contact_list.insert(this->contact_list.end(),
+            found.begin(), found.begin() + quota[chunk]
+        );
+    }
+    stats.n_dropped = stats.n_contacts - static_cast<uint32_t>(this->contact_list.size());
+    stats.broadphase_seconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    this->body_impact.assign(n_bodies, 0.0f);
+    for (const collisionContact& contact : this->contact_list) {
+        this->resolve(contact);
+    }
+    stats.resolve_seconds = secondsSince(start);
+
+    this->last_stats = stats;
+}
+
+}
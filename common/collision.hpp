@@ -0,0 +1,106 @@
+#ifndef SOUPCANS_COLLISION_HPP
+#define SOUPCANS_COLLISION_HPP
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "spatialGrid.hpp"
+#include "jobSystem.hpp"
+
+namespace soupcans {
+
+// circle collider in the 2d playfield, inv_mass of 0 makes a body immovable
+struct collisionBody {
+    float x;
+    float y;
+    float vx;
+    float vy;
+    float radius;
+    float inv_mass;
+};
+
+// normal points from a towards b
+struct collisionContact {
+    uint32_t a;
+    uint32_t b;
+    float nx;
+    float ny;
+    float depth;
+};
+
+struct collisionStats {
+    uint32_t n_candidate_pairs;  // broadphase aabb overlaps
+    uint32_t n_contacts;         // narrowphase circle overlaps
+    uint32_t n_dropped;          // contacts past max_contacts, taken evenly from every chunk
+    double broadphase_seconds;
+    double resolve_seconds;
+};
+
+/* Broadphase on a SpatialGrid, circle narrowphase and impulse response.
+   Detection runs over fixed cell ranges ("chunks") that are spread across
+   the job system's workers; chunk results are concatenated in chunk order
+   and resolved serially, so the outcome does not depend on the thread count.
+
+   The caller owns integration and wall bounces, and calls step() once
+   per frame after moving the bodies.
+*/
+class CollisionWorld {
+    public:
+        // detection stays on the calling thread when jobs is null
+        CollisionWorld(aabb2d playfield, float max_radius, JobSystem* jobs = nullptr);
+
+        std::vector<collisionBody>& bodies() {
+            return this->body_list;
+        }
+
+        void step();
+
+        const std::vector<collisionContact>& contacts() const {
+            return this->contact_list;
+        }
+
+        // deepest penetration of each body this step, for deformation effects
+        float impact(uint32_t id) const {
+            return this->body_impact[id];
+        }
+
+        const collisionStats& stats() const {
+            return this->last_stats;
+        }
+
+        /* Hard cap on contacts resolved per step to bound the frame cost,
+           split evenly across the playfield; see collisionStats::n_dropped.
+        */
+        void setMaxContacts(uint32_t max_contacts) {
+            this->max_contacts = max_contacts;
+        }
+
+        void setRestitution(float restitution) {
+            this->restitution = restitution;
+        }
+
+    private:
+        static const int N_CHUNKS = 64;
+
+        SpatialGrid grid;
+        JobSystem* jobs;
+        uint32_t max_contacts;
+        float restitution;
+
+        std::vector<collisionBody> body_list;
+        std::vector<aabb2d> body_bounds;
+        std::vector<collisionContact> contact_list;
+        std::vector<float> body_impact;
+        std::vector<collisionContact> chunk_contacts[N_CHUNKS];
+        uint32_t chunk_candidates[N_CHUNKS];
+        collisionStats last_stats;
+
+        void detectChunk(int chunk);
+        void shareContactCap(uint32_t* quota) const;
+        void resolve(const collisionContact& contact);
+};
+
+}
+
+#endif
@@ -0,0 +1,323 @@
+#include <malloc.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <mutex>
+#include <new>
+
+#include "frameArena.hpp"
+
+static std::atomic<uint64_t> g_heap_allocations{0};
+static std::atomic<int64_t> g_heap_bytes{0};
+static std::atomic<int64_t> g_heap_peak_bytes{0};
+
+// what malloc really handed out, so the frees subtract the same amount
+static void countBytes(void* ptr) {
+    int64_t size = (int64_t)malloc_usable_size(ptr);
+    int64_t in_use = g_heap_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+    int64_t peak = g_heap_peak_bytes.load(std::memory_order_relaxed);
+    while (in_use > peak &&
+           !g_heap_peak_bytes.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {
+    }
+}
+
+static void release(void* ptr) {
+    if (ptr) {
+        g_heap_bytes.fetch_sub((int64_t)malloc_usable_size(ptr), std::memory_order_relaxed);
+        free(ptr);
+    }
+}
+
+/* Global allocation hooks. They only count and forward to malloc, and they
+   live in this file so any program using the arenas gets them linked in.
+*/
+void* operator new(size_t size) {
+    g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    countBytes(ptr);
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    g_heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    void* ptr = aligned_alloc(align, (size + align - 1) / align * align);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    countBytes(ptr);
+    return ptr;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    release(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    release(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    release(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    release(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+    release(ptr);
+}
+
+namespace soupcans {
+
+uint64_t heapAllocationCount() {
+    return g_heap_allocations.load(std::memory_order_relaxed);
+}
+
+uint64_t heapBytesInUse() {
+    int64_t bytes = g_heap_bytes.load(std::memory_order_relaxed);
+    return bytes > 0 ? (uint64_t)bytes : 0;
+}
+
+uint64_t heapPeakBytes() {
+    return (uint64_t)g_heap_peak_bytes.load(std::memory_order_relaxed);
+}
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+LinearArena::LinearArena(size_t capacity) {
+    this->size = alignUp(capacity > 0 ? capacity : 4096, 64);
+    this->base = static_cast<unsigned char*>(aligned_alloc(64, this->size));
+    if (!this->base) {
+        throw std::bad_alloc();
+    }
+    this->used = 0;
+    this->high_water = 0;
+    this->overflow_bytes = 0;
+    this->overflow = nullptr;
+}
+
+LinearArena::~LinearArena() {
+    this->reset();
+    free(this->base);
+}
+
+void* LinearArena::allocate(size_t size, size_t alignment) {
+    size_t offset = alignUp(this->used, alignment);
+    if (offset + size <= this->size) {
+        this->used = offset + size;
+        if (this->used > this->high_water) {
+            this->high_water = this->used;
+        }
+        return this->base + offset;
+    }
+
+    // out of room, borrow from the heap until the next reset grows the arena
+    size_t header = alignUp(sizeof(overflowBlock), alignment);
+    // aligned_alloc() wants the size in whole multiples of the alignment
+    size_t block_alignment = (alignment < 16) ? 16 : alignment;
+    unsigned char* block = static_cast<unsigned char*>(
+        aligned_alloc(block_alignment, alignUp(header + size, block_alignment))
+    );
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    overflowBlock* node = reinterpret_cast<overflowBlock*>(block);
+    node->next = this->overflow;
+    this->overflow = node;
+    this->overflow_bytes += size;
+    if (this->used + this->overflow_bytes > this->high_water) {
+        this->high_water = this->used + this->overflow_bytes;
+    }
+    return block + header;
+}
+
+void LinearArena::rewind(size_t mark) {
+    if (mark == 0) {
+        // back at the start, also drop any heap overflow
+        this->reset();
+    } else if (mark < this->used) {
+        this->used = mark;
+    }
+}
+
+void LinearArena::reset() {
+    while (this->overflow) {
+        overflowBlock* next = this->overflow->next;
+        free(this->overflow);
+        this->overflow = next;
+    }
+    if (this->overflow_bytes > 0) {
+        // grow with some headroom so the next frame fits
+        size_t grown_size = alignUp(this->high_water + this->high_water / 2, 64);
+        unsigned char* grown = static_cast<unsigned char*>(aligned_alloc(64, grown_size));
+        // without the memory the old arena stays, and frames keep overflowing onto the heap
+        if (grown) {
+            free(this->base);
+            this->base = grown;
+            this->size = grown_size;
+        }
+        this->overflow_bytes = 0;
+    }
+    this->used = 0;
+}
+
+LinearArena& scratchArena() {
+    static thread_local LinearArena arena(1 << 20);
+    return arena;
+}
+
+char* readFileInto(LinearArena& arena, const char* path, size_t* length) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return nullptr;
+    }
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (file_size < 0) {
+        fclose(file);
+        return nullptr;
+    }
+
+    char* text = static_cast<char*>(arena.allocate(file_size + 1, 1));
+    size_t n_read = fread(text, 1, file_size, file);
+    fclose(file);
+    text[n_read] = '\0';
+    if (length) {
+        *length = n_read;
+    }
+    return text;
+}
+
+/* Pool blocks carry a 16 byte header with their size class; class k holds
+   blocks of 2^k bytes. Anything above the largest class goes straight to
+   malloc and is marked with LARGE_CLASS.
+*/
+static const int MIN_CLASS = 6;
+static const int MAX_CLASS = 28;
+static const uint32_t LARGE_CLASS = 0xff;
+static const size_t POOL_HEADER = 16;
+
+struct poolHeader {
+    uint32_t size_class;
+    uint32_t magic;
+    size_t large_size;
+};
+
+struct poolFreeNode {
+    poolFreeNode* next;
+};
+
+static std::mutex g_pool_mutex;
+static poolFreeNode* g_pool_free_lists[MAX_CLASS + 1];
+
+static int sizeClassFor(size_t size) {
+    int k = MIN_CLASS;
+    while (k <= MAX_CLASS && ((size_t)1 << k) < size) {
+        k++;
+    }
+    return k;
+}
+
+static size_t usableSize(const poolHeader* header) {
+    return (header->size_class == LARGE_CLASS) ?
+        header->large_size : ((size_t)1 << header->size_class);
+}
+
+void* poolMalloc(size_t size) {
+    int k = sizeClassFor(size);
+    poolHeader* header = nullptr;
+    if (k > MAX_CLASS) {
+        header = static_cast<poolHeader*>(malloc(POOL_HEADER + size));
+        if (!header) {
+            return nullptr;
+        }
+        header->size_class = LARGE_CLASS;
+        header->large_size = size;
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(g_pool_mutex);
+            poolFreeNode* node = g_pool_free_lists[k];
+            if (node) {
+                g_pool_free_lists[k] = node->next;
+                header = reinterpret_cast<poolHeader*>(node);
+            }
+        }
+        if (!header) {
+            header = static_cast<poolHeader*>(malloc(POOL_HEADER + ((size_t)1 << k)));
+            if (!header) {
+                return nullptr;
+            }
+        }
+        header->size_class = k;
+        header->large_size = 0;
+    }
+    header->magic = 0x50c4;
+    return reinterpret_cast<unsigned char*>(header) + POOL_HEADER;
+}
+
+void* poolRealloc(void* ptr, size_t new_size) {
+    if (!ptr) {
+        return poolMalloc(new_size);
+    }
+    poolHeader* header = reinterpret_cast<poolHeader*>(
+        static_cast<unsigned char*>(ptr) - POOL_HEADER
+    );
+    size_t old_size = usableSize(header);
+    if (new_size <= old_size) {
+        return ptr;
+    }
+    void* grown = poolMalloc(new_size);
+    if (grown) {
+        memcpy(grown, ptr, old_size);
+        poolFree(ptr);
+    }
+    return grown;
+}
+
+void poolFree(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    poolHeader* header = reinterpret_cast<poolHeader*>(
+        static_cast<unsigned char*>(ptr) - POOL_HEADER
+    );
+    if (header->size_class == LARGE_CLASS) {
+        free(header);
+        return;
+    }
+    int k = header->size_class;
+    poolFreeNode* node = reinterpret_cast<poolFreeNode*>(header);
+    std::lock_guard<std::mutex> lock(g_pool_mutex);
+    node->next = g_pool_free_lists[k];
+    g_pool_free_lists[k] = node;
+}
+
+}
@@ -0,0 +1,151 @@
+#ifndef SOUPCANS_FRAME_ARENA_HPP
+#define SOUPCANS_FRAME_ARENA_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace soupcans {
+
+/* Bump allocator for data that only lives until the next reset(). When a
+   frame asks for more than the arena holds, the extra comes from the heap
+   and the arena grows to the high-water mark on the next reset, so after
+   a few frames a steady-state frame never touches the heap.
+*/
+class LinearArena {
+    public:
+        explicit LinearArena(size_t capacity);
+        ~LinearArena();
+
+        LinearArena(const LinearArena&) = delete;
+        LinearArena& operator=(const LinearArena&) = delete;
+
+        // alignment is a power of two; throws std::bad_alloc like new when the heap is out
+        void* allocate(size_t size, size_t alignment = 16);
+
+        template <class T>
+        T* allocateArray(size_t count) {
+            return static_cast<T*>(this->allocate(count * sizeof(T), alignof(T)));
+        }
+
+        // releases everything allocated since the matching mark(), rewinding
+        // to the very start is the same as reset()
+        size_t mark() const {
+            return this->used;
+        }
+        void rewind(size_t mark);
+
+        void reset();
+
+        size_t capacity() const {
+            return this->size;
+        }
+        size_t highWaterMark() const {
+            return this->high_water;
+        }
+
+    private:
+        struct overflowBlock {
+            overflowBlock* next;
+        };
+
+        unsigned char* base;
+        size_t size;
+        size_t used;
+        size_t high_water;
+        size_t overflow_bytes;
+        overflowBlock* overflow;
+};
+
+// rewinds an arena to where it was when the scope was entered
+class ArenaScope {
+    public:
+        explicit ArenaScope(LinearArena& arena) : arena(arena), saved(arena.mark()) {}
+        ~ArenaScope() {
+            this->arena.rewind(this->saved);
+        }
+
+    private:
+        LinearArena& arena;
+        size_t saved;
+};
+
+// per-thread arena for temporaries inside jobs, use it through an ArenaScope
+LinearArena& scratchArena();
+
+// copies a flat array of glm vectors (or plain floats) into arena memory
+template <class T>
+float* flattenInto(LinearArena& arena, const T* vector_arr, size_t size_arr) {
+    float* out = static_cast<float*>(arena.allocate(size_arr, alignof(float)));
+    memcpy(out, vector_arr, size_arr);
+    return out;
+}
+
+// reads a whole file into arena memory with a trailing NUL, or returns nullptr
+char* readFileInto(LinearArena& arena, const char* path, size_t* length = nullptr);
+
+/* Size-class pool that keeps freed blocks for reuse, so repeated image
+   decodes at the same sizes stop hitting the heap. Thread-safe.
+*/
+void* poolMalloc(size_t size);
+void* poolRealloc(void* ptr, size_t new_size);
+void poolFree(void* ptr);
+
+// counts every global operator new made by the process
+uint64_t heapAllocationCount();
+/* Bytes held through global operator new right now and at most so far,
+   as malloc rounded them. malloc() calls made directly (the pools, stb)
+   aren't in either.
+*/
+uint64_t heapBytesInUse();
+uint64_t heapPeakBytes();
+
+/* Watches the heap allocation count across frames. Frames after the
+   warmup should never allocate; report() says how many did.
+*/
+class FrameAllocationTracker {
+    public:
+        explicit FrameAllocationTracker(uint32_t warmup_frames = 120)
+            : warmup_frames(warmup_frames) {}
+
+        void beginFrame() {
+            this->frame_start_count = heapAllocationCount();
+        }
+
+        void endFrame() {
+            uint64_t allocations = heapAllocationCount() - this->frame_start_count;
+            if (++this->n_frames <= this->warmup_frames) {
+                return;
+            }
+            this->n_steady_frames++;
+            if (allocations > 0) {
+                this->n_allocating_frames++;
+                this->n_steady_allocations += allocations;
+            }
+        }
+
+        void report(FILE* out) const {
+            fprintf(out, "heap: %llu of %llu steady-state frames allocated "
+                         "(%llu allocations in total)\n",
+                    (unsigned long long)this->n_allocating_frames,
+                    (unsigned long long)this->n_steady_frames,
+                    (unsigned long long)this->n_steady_allocations);
+        }
+
+        uint64_t allocatingFrames() const {
+            return this->n_allocating_frames;
+        }
+
+    private:
+        uint32_t warmup_frames;
+        uint64_t frame_start_count = 0;
+        uint64_t n_frames = 0;
+        uint64_t n_steady_frames = 0;
+        uint64_t n_allocating_frames = 0;
+        uint64_t n_steady_allocations = 0;
+};
+
+}
+
+#endif
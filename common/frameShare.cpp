@@ -0,0 +1,559 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <new>
+
+#include "frameShare.hpp"
+#include "log.hpp"
+
+// linux 5.1, older headers don't have it
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+
+namespace soupcans {
+
+// what the server sends a new consumer, along with the memfd, its eventfd and its held page
+struct frameShareHello {
+    uint32_t magic;
+    uint32_t version;
+};
+
+static const int N_HELLO_FDS = 3;
+
+uint64_t frameShareClockNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+static size_t roundUp(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+static size_t pageSize() {
+    return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// a consumer's held page in a memfd of its own, nullptr (and *fd -1) if it can't be made
+static frameShareHeld* makeHeldPage(int* fd) {
+    *fd = memfd_create("soupcans-held", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (*fd < 0 || ftruncate(*fd, (off_t)pageSize()) != 0) {
+        if (*fd >= 0) {
+            ::close(*fd);
+        }
+        *fd = -1;
+        return nullptr;
+    }
+    // the server keeps reading it, a consumer can't take the page away under it
+    fcntl(*fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+    void* page = mmap(nullptr, pageSize(), PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if (page == MAP_FAILED) {
+        ::close(*fd);
+        *fd = -1;
+        return nullptr;
+    }
+    frameShareHeld* held = new (page) frameShareHeld;
+    held->slot.store(-1);
+    return held;
+}
+
+static bool socketAddress(const char* path, sockaddr_un* address) {
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address->sun_path)) {
+        SOUP_LOG_ERROR("frame share socket path %s is too long", path);
+        return false;
+    }
+    strcpy(address->sun_path, path);
+    return true;
+}
+
+FrameShareServer::FrameShareServer() {
+    this->socket_path = nullptr;
+    this->listen_socket = -1;
+    this->memfd = -1;
+    this->map_size = 0;
+    this->map = nullptr;
+    this->header = nullptr;
+    this->stride = 0;
+    this->height = 0;
+    this->slot_offset = 0;
+    this->slot_size = 0;
+    this->n_slots = 0;
+    for (int i = 0; i < FRAME_SHARE_MAX_SLOTS; i++) {
+        this->sequences[i] = 0;
+    }
+    for (int i = 0; i < FRAME_SHARE_MAX_CONSUMERS; i++) {
+        this->consumers[i] = consumer{ -1, -1, nullptr };
+    }
+    this->n_consumers = 0;
+    this->writing = -1;
+    this->last_written = -1;
+    this->share_stats = frameShareStats{};
+}
+
+FrameShareServer::~FrameShareServer() {
+    this->close();
+}
+
+bool FrameShareServer::open(const char* socket_path, int width, int height, int n_slots) {
+    if (width <= 0 || height <= 0 || n_slots < 2 || n_slots > FRAME_SHARE_MAX_SLOTS) {
+        return false;
+    }
+    sockaddr_un address;
+    if (!socketAddress(socket_path, &address)) {
+        return false;
+    }
+
+    // a socket file left by a server that died goes, a live server's stays
+    int probe = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (probe >= 0 && ::connect(probe, (sockaddr*)&address, sizeof(address)) == 0) {
+        SOUP_LOG_ERROR("another frame server is already on %s", socket_path);
+        ::close(probe);
+        return false;
+    }
+    if (probe >= 0) {
+        ::close(probe);
+    }
+    unlink(socket_path);
+
+    size_t page = pageSize();
+    size_t stride = (size_t)width * 4;
+    size_t header_size = roundUp(sizeof(frameShareHeader), page);
+    size_t slot_size = roundUp(stride * height, page);
+    this->map_size = header_size + slot_size * n_slots;
+
+    this->memfd = memfd_create("soupcans-frames", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (this->memfd < 0 || ftruncate(this->memfd, (off_t)this->map_size) != 0) {
+        SOUP_LOG_ERROR("could not make %zu bytes of shared frames: %s", this->map_size,
+                       strerror(errno));
+        this->close();
+        return false;
+    }
+    // a consumer that could shrink it would crash the server on its next write
+    fcntl(this->memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW);
+    void* map = mmap(nullptr, this->map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     this->memfd, 0);
+    if (map == MAP_FAILED) {
+        SOUP_LOG_ERROR("could not map shared frames: %s", strerror(errno));
+        this->close();
+        return false;
+    }
+    // this mapping stays writable, every later one (any consumer's) can only read
+    if (fcntl(this->memfd, F_ADD_SEALS, F_SEAL_FUTURE_WRITE | F_SEAL_SEAL) != 0) {
+        SOUP_LOG_WARNING("this kernel can't seal the shared frames read-only (%s), "
+                         "consumers could write into them", strerror(errno));
+        fcntl(this->memfd, F_ADD_SEALS, F_SEAL_SEAL);
+    }
+    this->map = static_cast<unsigned char*>(map);
+    this->header = new (map) frameShareHeader;
+    this->header->magic = FRAME_SHARE_MAGIC;
+    this->header->version = FRAME_SHARE_VERSION;
+    this->header->width = (uint32_t)width;
+    this->header->height = (uint32_t)height;
+    this->header->stride = stride;
+    this->header->slot_offset = header_size;
+    this->header->slot_size = slot_size;
+    this->header->n_slots = (uint32_t)n_slots;
+    this->header->latest.store(-1);
+    this->header->n_published.store(0);
+    this->stride = stride;
+    this->height = height;
+    this->slot_offset = header_size;
+    this->slot_size = slot_size;
+    this->n_slots = n_slots;
+    for (int i = 0; i < FRAME_SHARE_MAX_SLOTS; i++) {
+        this->sequences[i] = 0;
+        frameShareSlot& slot = this->header->slots[i];
+        slot.sequence.store(0);
+        slot.frame = 0;
+        slot.capture_ns = 0;
+        slot.publish_ns = 0;
+    }
+
+    this->listen_socket = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (this->listen_socket < 0 ||
+        bind(this->listen_socket, (sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(this->listen_socket, FRAME_SHARE_MAX_CONSUMERS) != 0) {
+        SOUP_LOG_ERROR("could not listen on %s: %s", socket_path, strerror(errno));
+        this->close();
+        return false;
+    }
+    this->socket_path = socket_path;
+    this->writing = -1;
+    this->last_written = -1;
+    this->share_stats = frameShareStats{};
+    SOUP_LOG_INFO("serving %dx%d frames on %s, %d slots of %zu bytes", width, height,
+                  socket_path, n_slots, slot_size);
+    return true;
+}
+
+void FrameShareServer::close() {
+    for (int i = 0; i < FRAME_SHARE_MAX_CONSUMERS; i++) {
+        this->dropConsumer(i);
+    }
+    if (this->listen_socket >= 0) {
+        ::close(this->listen_socket);
+        unlink(this->socket_path);
+        this->listen_socket = -1;
+    }
+    if (this->map) {
+        munmap(this->map, this->map_size);
+        this->map = nullptr;
+    }
+    if (this->memfd >= 0) {
+        ::close(this->memfd);
+        this->memfd = -1;
+    }
+    this->header = nullptr;
+    this->socket_path = nullptr;
+}
+
+void FrameShareServer::dropConsumer(int index) {
+    consumer& c = this->consumers[index];
+    if (c.socket < 0) {
+        return;
+    }
+    ::close(c.socket);
+    ::close(c.event);
+    // whatever it was reading is free again
+    munmap(c.held, pageSize());
+    c = consumer{ -1, -1, nullptr };
+    this->n_consumers--;
+}
+
+void FrameShareServer::serviceConnections() {
+    if (!this->isOpen()) {
+        return;
+    }
+    int connection;
+    while ((connection = accept4(this->listen_socket, nullptr, nullptr,
+                                 SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        int index = 0;
+        while (index < FRAME_SHARE_MAX_CONSUMERS && this->consumers[index].socket >= 0) {
+            index++;
+        }
+        if (index == FRAME_SHARE_MAX_CONSUMERS) {
+            SOUP_LOG_WARNING("turning away a frame consumer, %d already connected",
+                             this->n_consumers);
+            ::close(connection);
+            continue;
+        }
+        int event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        int held_fd = -1;
+        frameShareHeld* held = (event >= 0) ? makeHeldPage(&held_fd) : nullptr;
+        if (!held) {
+            SOUP_LOG_WARNING("turning away a frame consumer: %s", strerror(errno));
+            if (event >= 0) {
+                ::close(event);
+            }
+            ::close(connection);
+            continue;
+        }
+
+        frameShareHello hello = { FRAME_SHARE_MAGIC, FRAME_SHARE_VERSION };
+        iovec payload = { &hello, sizeof(hello) };
+        int fds[N_HELLO_FDS] = { this->memfd, event, held_fd };
+        char control[CMSG_SPACE(sizeof(fds))];
+        memset(control, 0, sizeof(control));
+        msghdr message = {};
+        message.msg_iov = &payload;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        cmsghdr* rights = CMSG_FIRSTHDR(&message);
+        rights->cmsg_level = SOL_SOCKET;
+        rights->cmsg_type = SCM_RIGHTS;
+        rights->cmsg_len = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(rights), fds, sizeof(fds));
+        bool sent = sendmsg(connection, &message, MSG_NOSIGNAL) == (ssize_t)sizeof(hello);
+        // the mapping keeps the page, the consumer has its own descriptor now
+        ::close(held_fd);
+        if (!sent) {
+            munmap(held, pageSize());
+            ::close(connection);
+            ::close(event);
+            continue;
+        }
+        this->consumers[index] = consumer{ connection, event, held };
+        this->n_consumers++;
+        this->share_stats.n_connections++;
+    }
+
+    // consumers never send anything, a readable socket means one hung up
+    for (int i = 0; i < FRAME_SHARE_MAX_CONSUMERS; i++) {
+        if (this->consumers[i].socket < 0) {
+            continue;
+        }
+        char byte;
+        ssize_t n = recv(this->consumers[i].socket, &byte, 1, MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            this->dropConsumer(i);
+        }
+    }
+}
+
+size_t FrameShareServer::frameSize() const {
+    return this->header ? this->stride * (size_t)this->height : 0;
+}
+
+bool FrameShareServer::slotHeld(int slot) const {
+    for (int i = 0; i < FRAME_SHARE_MAX_CONSUMERS; i++) {
+        if (!this->consumers[i].held) {
+            continue;
+        }
+        // a consumer writes what it likes here, anything but a slot holds nothing
+        int32_t held = this->consumers[i].held->slot.load();
+        if (held >= 0 && held < this->n_slots && held == slot) {
+            return true;
+        }
+    }
+    return false;
+}
+
+unsigned char* FrameShareServer::beginFrame() {
+    if (!this->isOpen() || this->writing >= 0) {
+        return nullptr;
+    }
+    int n_slots = this->n_slots;
+    // only the server writes latest, so it is the slot written last
+    int latest = this->last_written;
+    for (int k = 1; k <= n_slots; k++) {
+        int slot = (this->last_written + k + n_slots) % n_slots;
+        if (slot == latest) {
+            continue;
+        }
+        /* Mark it before looking for readers. A consumer marks what it
+           holds before looking at the sequence, so with both sequentially
+           consistent one of the two always sees the other: either it's
+           held here, or the consumer sees it odd and picks again.
+        */
+        frameShareSlot& candidate = this->header->slots[slot];
+        uint64_t sequence = this->sequences[slot];
+        candidate.sequence.store(sequence + 1);
+        if (this->slotHeld(slot)) {
+            candidate.sequence.store(sequence);
+            continue;
+        }
+        this->writing = slot;
+        return this->map + this->slot_offset + (size_t)slot * this->slot_size;
+    }
+    this->share_stats.n_dropped++;
+    return nullptr;
+}
+
+void FrameShareServer::publish(uint64_t frame, uint64_t capture_ns) {
+    if (this->writing < 0) {
+        return;
+    }
+    frameShareSlot& slot = this->header->slots[this->writing];
+    slot.frame = frame;
+    slot.capture_ns = capture_ns;
+    slot.publish_ns = frameShareClockNs();
+    this->sequences[this->writing] += 2;
+    slot.sequence.store(this->sequences[this->writing]);
+    this->header->latest.store(this->writing);
+    this->header->n_published.fetch_add(1);
+    this->last_written = this->writing;
+    this->writing = -1;
+    this->share_stats.n_published++;
+
+    uint64_t one = 1;
+    for (int i = 0; i < FRAME_SHARE_MAX_CONSUMERS; i++) {
+        if (this->consumers[i].event >= 0) {
+            ssize_t written = write(this->consumers[i].event, &one, sizeof(one));
+            (void)written;
+        }
+    }
+}
+
+FrameShareClient::FrameShareClient() {
+    this->socket = -1;
+    this->event = -1;
+    this->header_size = 0;
+    this->pixels_size = 0;
+    this->header = nullptr;
+    this->held = nullptr;
+    this->pixels = nullptr;
+    this->holding = false;
+}
+
+FrameShareClient::~FrameShareClient() {
+    this->close();
+}
+
+bool FrameShareClient::connect(const char* socket_path) {
+    sockaddr_un address;
+    if (!socketAddress(socket_path, &address)) {
+        return false;
+    }
+    this->socket = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (this->socket < 0 || ::connect(this->socket, (sockaddr*)&address, sizeof(address)) != 0) {
+        SOUP_LOG_ERROR("could not connect to a frame server on %s: %s", socket_path,
+                       strerror(errno));
+        this->close();
+        return false;
+    }
+
+    frameShareHello hello = {};
+    iovec payload = { &hello, sizeof(hello) };
+    int fds[N_HELLO_FDS] = { -1, -1, -1 };
+    char control[CMSG_SPACE(sizeof(fds))];
+    msghdr message = {};
+    message.msg_iov = &payload;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    // the server only answers from its frame loop, this waits up to a frame for it
+    ssize_t received = recvmsg(this->socket, &message, MSG_CMSG_CLOEXEC);
+    cmsghdr* rights = (received == (ssize_t)sizeof(hello)) ? CMSG_FIRSTHDR(&message) : nullptr;
+    if (rights && rights->cmsg_type == SCM_RIGHTS && rights->cmsg_len == CMSG_LEN(sizeof(fds))) {
+        memcpy(fds, CMSG_DATA(rights), sizeof(fds));
+    }
+    int memfd = fds[0];
+    this->event = fds[1];
+    int held_fd = fds[2];
+    struct stat info, held_info;
+    if (memfd < 0 || this->event < 0 || held_fd < 0 || hello.magic != FRAME_SHARE_MAGIC ||
+        hello.version != FRAME_SHARE_VERSION || fstat(memfd, &info) != 0 ||
+        fstat(held_fd, &held_info) != 0 || (size_t)held_info.st_size < sizeof(frameShareHeld)) {
+        SOUP_LOG_ERROR("%s did not answer like a frame server", socket_path);
+        if (memfd >= 0) {
+            ::close(memfd);
+        }
+        if (held_fd >= 0) {
+            ::close(held_fd);
+        }
+        this->close();
+        return false;
+    }
+
+    // the held page is the only thing written, the header and frames are only ever read
+    void* held = mmap(nullptr, pageSize(), PROT_READ | PROT_WRITE, MAP_SHARED, held_fd, 0);
+    ::close(held_fd);
+    if (held != MAP_FAILED) {
+        this->held = static_cast<frameShareHeld*>(held);
+    }
+    this->header_size = roundUp(sizeof(frameShareHeader), pageSize());
+    void* header = mmap(nullptr, this->header_size, PROT_READ, MAP_SHARED, memfd, 0);
+    if (header != MAP_FAILED) {
+        this->header = static_cast<const frameShareHeader*>(header);
+    }
+    bool usable = this->held && this->header && this->header->version == FRAME_SHARE_VERSION &&
+                  this->header->slot_offset == this->header_size &&
+                  this->header->n_slots > 0 && this->header->n_slots <= FRAME_SHARE_MAX_SLOTS &&
+                  this->header->slot_offset + this->header->slot_size * this->header->n_slots <=
+                      (uint64_t)info.st_size;
+    if (usable) {
+        this->pixels_size = (size_t)(this->header->slot_size * this->header->n_slots);
+        void* pixels = mmap(nullptr, this->pixels_size, PROT_READ, MAP_SHARED, memfd,
+                            (off_t)this->header->slot_offset);
+        this->pixels = (pixels != MAP_FAILED) ? static_cast<const unsigned char*>(pixels) :
+            nullptr;
+    }
+    ::close(memfd);
+    if (!this->pixels) {
+        SOUP_LOG_ERROR("could not map the frames from %s", socket_path);
+        this->close();
+        return false;
+    }
+    return true;
+}
+
+void FrameShareClient::close() {
+    this->release();
+    if (this->pixels) {
+        munmap(const_cast<unsigned char*>(this->pixels), this->pixels_size);
+        this->pixels = nullptr;
+    }
+    if (this->header) {
+        munmap(const_cast<frameShareHeader*>(this->header), this->header_size);
+        this->header = nullptr;
+    }
+    if (this->held) {
+        munmap(this->held, pageSize());
+        this->held = nullptr;
+    }
+    if (this->event >= 0) {
+        ::close(this->event);
+        this->event = -1;
+    }
+    if (this->socket >= 0) {
+        ::close(this->socket);
+        this->socket = -1;
+    }
+}
+
+uint64_t FrameShareClient::waitFrames(int timeout_ms) {
+    if (!this->connected()) {
+        return 0;
+    }
+    pollfd fds[2] = { { this->event, POLLIN, 0 }, { this->socket, POLLIN, 0 } };
+    if (poll(fds, 2, timeout_ms) <= 0) {
+        return 0;
+    }
+    if (fds[1].revents) {
+        // the server never sends after the hello, so this is it hanging up
+        char byte;
+        ssize_t n = recv(this->socket, &byte, 1, MSG_DONTWAIT);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            ::close(this->socket);
+            this->socket = -1;
+        }
+    }
+    uint64_t count = 0;
+    if ((fds[0].revents & POLLIN) && read(this->event, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+    }
+    return count;
+}
+
+bool FrameShareClient::acquire(sharedFrame* frame) {
+    if (!this->header) {
+        return false;
+    }
+    this->release();
+    std::atomic<int32_t>& held = this->held->slot;
+    // each retry means the server published a newer frame meanwhile, so this ends
+    while (true) {
+        int slot = this->header->latest.load();
+        if (slot < 0 || slot >= (int)this->header->n_slots) {
+            return false;
+        }
+        held.store(slot);
+        const frameShareSlot& shared = this->header->slots[slot];
+        if (shared.sequence.load() & 1) {
+            // the server got to it first, it isn't the newest any more
+            held.store(-1);
+            continue;
+        }
+        frame->pixels = this->pixels + (size_t)slot * this->header->slot_size;
+        frame->width = (int)this->header->width;
+        frame->height = (int)this->header->height;
+        frame->stride = (size_t)this->header->stride;
+        frame->frame = shared.frame;
+        frame->capture_ns = shared.capture_ns;
+        frame->publish_ns = shared.publish_ns;
+        this->holding = true;
+        return true;
+    }
+}
+
+void FrameShareClient::release() {
+    if (this->holding) {
+        this->held->slot.store(-1);
+        this->holding = false;
+    }
+}
+
+}
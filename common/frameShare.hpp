@@ -0,0 +1,206 @@
+#ifndef SOUPCANS_FRAME_SHARE_HPP
+#define SOUPCANS_FRAME_SHARE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace soupcans {
+
+/* Finished frames handed to other processes on this machine without a
+   copy on their side. The frames live in a memfd the server maps
+   read-write and every consumer maps read-only; a consumer reads the
+   newest one in place, for as long as it likes, and the server writes
+   around it. Consumers connect over a Unix socket, which hands them the
+   memfd, an eventfd of their own that counts published frames and a
+   page of their own (frameShareHeld) to say which frame they are reading.
+   The socket staying open is how the server knows a consumer is alive.
+
+   Nothing a consumer can write decides where the server writes: the
+   frames' memfd is sealed against new writable mappings once the server
+   has mapped it, the layout the server uses is its own copy, and a held
+   slot out of range counts as holding nothing.
+
+   Pixels are RGBA8, rows bottom to top as glReadPixels returns them.
+*/
+static const uint32_t FRAME_SHARE_MAGIC = 0x53524653;  // "SFRS"
+static const uint32_t FRAME_SHARE_VERSION = 2;
+static const int FRAME_SHARE_MAX_SLOTS = 8;
+static const int FRAME_SHARE_MAX_CONSUMERS = 8;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+              std::atomic<int32_t>::is_always_lock_free,
+              "the atomics in the shared header have to work across processes");
+
+struct frameShareSlot {
+    // even once a frame is in, odd while the server writes one
+    std::atomic<uint64_t> sequence;
+    uint64_t frame;
+    // frameShareClockNs() when the frame was read back and when it came out
+    uint64_t capture_ns;
+    uint64_t publish_ns;
+};
+
+// at the start of the frames' memfd, the slots' pixels follow at slot_offset
+struct frameShareHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    // bytes per row and between the starts of two slots
+    uint64_t stride;
+    uint64_t slot_offset;
+    uint64_t slot_size;
+    uint32_t n_slots;
+    // the slot holding the newest frame, -1 before the first
+    std::atomic<int32_t> latest;
+    std::atomic<uint64_t> n_published;
+    frameShareSlot slots[FRAME_SHARE_MAX_SLOTS];
+};
+
+// a consumer's own page, the only shared memory it writes
+struct frameShareHeld {
+    // the slot it is reading, -1 for none; the server never writes into those
+    std::atomic<int32_t> slot;
+};
+
+// CLOCK_MONOTONIC in nanoseconds, the same clock in every process
+uint64_t frameShareClockNs();
+
+struct frameShareStats {
+    uint64_t n_published;
+    // frames that found every slot newest or being read, never written
+    uint64_t n_dropped;
+    uint64_t n_connections;
+};
+
+/* The server half. One frame at a time: beginFrame() hands out a slot
+   nobody is reading, publish() makes it the newest and wakes everyone.
+   Nothing here blocks, a frame with no slot free is dropped instead.
+*/
+class FrameShareServer {
+    public:
+        FrameShareServer();
+        ~FrameShareServer();
+
+        FrameShareServer(const FrameShareServer&) = delete;
+        FrameShareServer& operator=(const FrameShareServer&) = delete;
+
+        /* Listens on `socket_path` for frames of this size. Two slots are
+           the least that works, each consumer reading an old frame ties up
+           one more.
+        */
+        bool open(const char* socket_path, int width, int height, int n_slots = 4);
+        // consumers see the socket close and the last frame stays readable for them
+        void close();
+
+        bool isOpen() const {
+            return this->header != nullptr;
+        }
+        // takes in new consumers and lets go of the ones that left
+        void serviceConnections();
+        int consumerCount() const {
+            return this->n_consumers;
+        }
+
+        // where the next frame's pixels go, nullptr drops the frame
+        unsigned char* beginFrame();
+        // the frame from beginFrame(), read back at capture_ns
+        void publish(uint64_t frame, uint64_t capture_ns);
+
+        size_t frameSize() const;
+        const frameShareStats& stats() const {
+            return this->share_stats;
+        }
+
+    private:
+        struct consumer {
+            int socket;
+            int event;
+            frameShareHeld* held;
+        };
+
+        const char* socket_path;
+        int listen_socket;
+        int memfd;
+        size_t map_size;
+        unsigned char* map;
+        frameShareHeader* header;
+        // the layout as the server made it, never read back from the shared header
+        size_t stride;
+        int height;
+        size_t slot_offset;
+        size_t slot_size;
+        int n_slots;
+        uint64_t sequences[FRAME_SHARE_MAX_SLOTS];
+        consumer consumers[FRAME_SHARE_MAX_CONSUMERS];
+        int n_consumers;
+        int writing;
+        int last_written;
+        frameShareStats share_stats;
+
+        void dropConsumer(int index);
+        bool slotHeld(int slot) const;
+};
+
+// a frame a consumer has acquired, valid until it releases it
+struct sharedFrame {
+    const unsigned char* pixels;
+    int width;
+    int height;
+    size_t stride;
+    uint64_t frame;
+    uint64_t capture_ns;
+    uint64_t publish_ns;
+};
+
+class FrameShareClient {
+    public:
+        FrameShareClient();
+        ~FrameShareClient();
+
+        FrameShareClient(const FrameShareClient&) = delete;
+        FrameShareClient& operator=(const FrameShareClient&) = delete;
+
+        bool connect(const char* socket_path);
+        void close();
+
+        // until the server closes its end
+        bool connected() const {
+            return this->socket >= 0;
+        }
+        /* Waits up to timeout_ms (-1 forever) for frames to be published,
+           the number published since the last wait; 0 on a timeout or once
+           the server is gone. For a loop of its own, poll notifyFd() and
+           connectionFd() for input instead.
+        */
+        uint64_t waitFrames(int timeout_ms);
+        int notifyFd() const {
+            return this->event;
+        }
+        int connectionFd() const {
+            return this->socket;
+        }
+
+        /* The newest frame, read in place until release(), which a client
+           holding one does before acquiring again. False if nothing has
+           been published yet.
+        */
+        bool acquire(sharedFrame* frame);
+        void release();
+
+    private:
+        int socket;
+        int event;
+        size_t header_size;
+        size_t pixels_size;
+        const frameShareHeader* header;
+        frameShareHeld* held;
+        const unsigned char* pixels;
+        bool holding;
+};
+
+}
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef SOUPCANS_IMAGE_DECODE_HPP
+#define SOUPCANS_IMAGE_DECODE_HPP
+
+namespace soupcans {
+
+/* stbi_load() that reads the compressed file into the calling thread's
+   scratch arena first, meant to be run inside a decode job. The flip
+   only applies to this thread, so scenes decoding side by side can't
+   change each other's orientation. The pixels come from the stb pool;
+   release them with stbi_image_free().
+*/
+unsigned char* decodeImageFile(const char* path, int* width, int* height,
+                               int* n_channels, int desired_channels = 0,
+                               bool flip_vertically = false);
+
+}
+
+#endif
@@ -0,0 +1,157 @@
+#include <stddef.h>
+#include <string.h>
+
+#include "inputTrace.hpp"
+#include "log.hpp"
+
+namespace soupcans {
+
+static const uint16_t LATE_POLL_BIT = 1u << 15;
+
+static uint16_t traceKey(int key, int poll) {
+    return (uint16_t)(key & ~LATE_POLL_BIT) | (poll ? LATE_POLL_BIT : 0);
+}
+
+bool traceFrame::pressed(int key, int poll) const {
+    uint16_t wanted = traceKey(key, poll);
+    for (int i = 0; i < this->n_keys; i++) {
+        if (this->keys[i] == wanted) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool traceFrame::press(int key, int poll) {
+    if (this->pressed(key, poll)) {
+        return true;
+    }
+    if (this->n_keys == MAX_TRACE_KEYS) {
+        return false;
+    }
+    this->keys[this->n_keys++] = traceKey(key, poll);
+    return true;
+}
+
+// the record without the unused end of keys[]
+static const size_t FRAME_FIXED_BYTES = 2 * sizeof(double) + 2;
+
+InputTraceWriter::InputTraceWriter() {
+    this->file = nullptr;
+    this->n_frames = 0;
+}
+
+InputTraceWriter::~InputTraceWriter() {
+    this->close();
+}
+
+bool InputTraceWriter::open(const char* path, const traceFileHeader& header) {
+    this->close();
+    this->file = fopen(path, "wb");
+    if (!this->file) {
+        SOUP_LOG_ERROR("could not open %s to record a trace", path);
+        return false;
+    }
+    traceFileHeader written = header;
+    memcpy(written.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    written.version = TRACE_VERSION;
+    written.n_frames = 0;
+    fwrite(&written, sizeof(written), 1, this->file);
+    this->n_frames = 0;
+    return true;
+}
+
+void InputTraceWriter::write(const traceFrame& frame) {
+    if (!this->file) {
+        return;
+    }
+    unsigned char record[FRAME_FIXED_BYTES + sizeof(frame.keys)];
+    memcpy(record, &frame.dt, sizeof(double));
+    memcpy(record + sizeof(double), &frame.time, sizeof(double));
+    record[2 * sizeof(double)] = frame.flags;
+    record[2 * sizeof(double) + 1] = frame.n_keys;
+    memcpy(record + FRAME_FIXED_BYTES, frame.keys, frame.n_keys * sizeof(uint16_t));
+    fwrite(record, FRAME_FIXED_BYTES + frame.n_keys * sizeof(uint16_t), 1, this->file);
+    this->n_frames++;
+}
+
+void InputTraceWriter::close() {
+    if (!this->file) {
+        return;
+    }
+    // patched in place, a trace cut off before this still replays
+    long n_frames_offset = (long)offsetof(traceFileHeader, n_frames);
+    if (fseek(this->file, n_frames_offset, SEEK_SET) == 0) {
+        fwrite(&this->n_frames, sizeof(this->n_frames), 1, this->file);
+    }
+    if (ferror(this->file)) {
+        SOUP_LOG_ERROR("the trace could not be written completely");
+    }
+    fclose(this->file);
+    this->file = nullptr;
+    // part of the run report, which release builds print too
+    fprintf(stderr, "%llu frames recorded\n", (unsigned long long)this->n_frames);
+}
+
+InputTraceReader::InputTraceReader() {
+    this->file = nullptr;
+    this->file_header = traceFileHeader{};
+}
+
+InputTraceReader::~InputTraceReader() {
+    this->close();
+}
+
+bool InputTraceReader::open(const char* path) {
+    this->close();
+    this->file = fopen(path, "rb");
+    if (!this->file) {
+        SOUP_LOG_ERROR("could not open trace %s", path);
+        return false;
+    }
+    const char* problem = nullptr;
+    if (fread(&this->file_header, sizeof(this->file_header), 1, this->file) != 1 ||
+        memcmp(this->file_header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        problem = "is not an input trace";
+    } else if (this->file_header.version != TRACE_VERSION) {
+        problem = "was recorded by another version";
+    } else if (this->file_header.width <= 0 || this->file_header.height <= 0) {
+        problem = "has no framebuffer size";
+    }
+    if (problem) {
+        SOUP_LOG_ERROR("%s %s", path, problem);
+        this->close();
+        return false;
+    }
+    this->file_header.scene[sizeof(this->file_header.scene) - 1] = '\0';
+    return true;
+}
+
+bool InputTraceReader::read(traceFrame* frame) {
+    if (!this->file) {
+        return false;
+    }
+    unsigned char record[FRAME_FIXED_BYTES];
+    if (fread(record, sizeof(record), 1, this->file) != 1) {
+        return false;
+    }
+    memcpy(&frame->dt, record, sizeof(double));
+    memcpy(&frame->time, record + sizeof(double), sizeof(double));
+    frame->flags = record[2 * sizeof(double)];
+    frame->n_keys = record[2 * sizeof(double) + 1];
+    if (frame->n_keys > MAX_TRACE_KEYS ||
+        fread(frame->keys, sizeof(uint16_t), frame->n_keys, this->file) != frame->n_keys) {
+        SOUP_LOG_WARNING("the trace is cut off or damaged, the replay ends here");
+        return false;
+    }
+    return true;
+}
+
+void InputTraceReader::close() {
+    if (this->file) {
+        fclose(this->file);
+        this->file = nullptr;
+    }
+}
+
+}
@@ -0,0 +1,117 @@
+#ifndef SOUPCANS_INPUT_TRACE_HPP
+#define SOUPCANS_INPUT_TRACE_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+
+namespace soupcans {
+
+/* Input traces (.strc), everything outside the code that decided what a
+   run's frames did: the random seed the scene was handed, and per frame
+   the dt and clock it saw, the keys it found pressed and whether it was
+   late latched. Replaying one runs the same frames again, so a stutter
+   seen once can be profiled and bisected offline.
+
+   The file is this header and then one record per frame: dt and time as
+   doubles, a flags byte, a key count byte and that many 16 bit keys.
+   Only keys a scene asked about and found pressed are there, a frame
+   nobody touches a key in is 18 bytes. Everything is little endian.
+*/
+static const char TRACE_MAGIC[4] = { 'S', 'T', 'R', 'C' };
+static const uint32_t TRACE_VERSION = 1;
+// per frame, more pressed keys than this at once are dropped
+static const int MAX_TRACE_KEYS = 32;
+
+struct traceFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t random_seed;
+    // written when the recording closes, 0 if it was cut off
+    uint64_t n_frames;
+    // of the framebuffer, a replay opens one the same size
+    int32_t width;
+    int32_t height;
+    // the scene's name(), a trace only replays into the scene it came from
+    char scene[32];
+};
+
+static_assert(sizeof(traceFileHeader) == 64, "traceFileHeader is part of the file format");
+
+enum traceFrameFlags : uint8_t {
+    // the runtime polled again before render() and called Scene::lateLatch()
+    TRACE_LATE_LATCHED = 1u << 0
+};
+
+struct traceFrame {
+    double dt;
+    // Runtime::time() during the frame
+    double time;
+    uint8_t flags;
+    uint8_t n_keys;
+    // bit 15 set for keys seen in the late latch poll
+    uint16_t keys[MAX_TRACE_KEYS];
+
+    // poll 0 is the frame's first, 1 the late latch
+    bool pressed(int key, int poll) const;
+    // false if the frame has no room left
+    bool press(int key, int poll);
+};
+
+/* Writes a trace one frame at a time through stdio's buffer, so a frame
+   costs a memcpy and every few hundred of them one write().
+*/
+class InputTraceWriter {
+    public:
+        InputTraceWriter();
+        ~InputTraceWriter();
+
+        InputTraceWriter(const InputTraceWriter&) = delete;
+        InputTraceWriter& operator=(const InputTraceWriter&) = delete;
+
+        // magic, version and n_frames are filled in
+        bool open(const char* path, const traceFileHeader& header);
+        void write(const traceFrame& frame);
+        // writes the frame count into the header
+        void close();
+
+        bool isOpen() const {
+            return this->file != nullptr;
+        }
+        uint64_t frameCount() const {
+            return this->n_frames;
+        }
+
+    private:
+        FILE* file;
+        uint64_t n_frames;
+};
+
+class InputTraceReader {
+    public:
+        InputTraceReader();
+        ~InputTraceReader();
+
+        InputTraceReader(const InputTraceReader&) = delete;
+        InputTraceReader& operator=(const InputTraceReader&) = delete;
+
+        // false (and logged) if it isn't a trace this build can replay
+        bool open(const char* path);
+        // false at the end of the trace
+        bool read(traceFrame* frame);
+        void close();
+
+        bool isOpen() const {
+            return this->file != nullptr;
+        }
+        const traceFileHeader& header() const {
+            return this->file_header;
+        }
+
+    private:
+        FILE* file;
+        traceFileHeader file_header;
+};
+
+}
+
+#endif
@@ -0,0 +1,278 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <chrono>
+
+#include "jobSystem.hpp"
+
+namespace soupcans {
+
+static thread_local const JobSystem* tls_job_system = nullptr;
+static thread_local int tls_worker_index = -1;
+
+static double steadySeconds() {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+bool jobDeque::push(job* j) {
+    int64_t b = this->bottom.load(std::memory_order_relaxed);
+    int64_t t = this->top.load(std::memory_order_acquire);
+    if (b - t >= CAPACITY) {
+        return false;
+    }
+    this->slots[b & (CAPACITY - 1)].store(j, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_release);
+    this->bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+job* jobDeque::pop() {
+    int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+    this->bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = this->top.load(std::memory_order_relaxed);
+    if (t > b) {
+        // empty, undo the reservation
+        this->bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    job* j = this->slots[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+        // last job, race the thieves for it
+        if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                std::memory_order_relaxed)) {
+            j = nullptr;
+        }
+        this->bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return j;
+}
+
+job* jobDeque::steal() {
+    int64_t t = this->top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = this->bottom.load(std::memory_order_acquire);
+    if (t >= b) {
+        return nullptr;
+    }
+    job* j = this->slots[t & (CAPACITY - 1)].load(std::memory_order_acquire);
+    if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                            std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    return j;
+}
+
+JobSystem::JobSystem(int n_threads) {
+    if (n_threads <= 0) {
+        n_threads = defaultThreadCount();
+    }
+    this->running = true;
+    this->queued_jobs = 0;
+    this->sleeping_workers = 0;
+    for (int i = 0; i < n_threads; i++) {
+        worker* w = new worker;
+        w->job_pool.reset(new job[jobDeque::CAPACITY]);
+        w->next_job = 0;
+        this->workers.push_back(w);
+    }
+
+    // the creating thread is worker 0
+    tls_job_system = this;
+    tls_worker_index = 0;
+    for (int i = 1; i < n_threads; i++) {
+        this->workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+    }
+    this->resetStats();
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(this->sleep_mutex);
+        this->running = false;
+    }
+    this->wake_up.notify_all();
+    for (size_t i = 1; i < this->workers.size(); i++) {
+        this->workers[i]->thread.join();
+    }
+    for (worker* w : this->workers) {
+        delete w;
+    }
+    if (tls_job_system == this) {
+        tls_job_system = nullptr;
+        tls_worker_index = -1;
+    }
+}
+
+int JobSystem::defaultThreadCount() {
+    const char* env = getenv("SOUP_THREADS");
+    int n_threads = env ? atoi(env) : 0;
+    if (n_threads <= 0) {
+        n_threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    return (n_threads > 0) ? n_threads : 1;
+}
+
+int JobSystem::currentWorker() const {
+    return (tls_job_system == this) ? tls_worker_index : -1;
+}
+
+job* JobSystem::allocateJob() {
+    int index = this->currentWorker();
+    if (index < 0) {
+        fprintf(stderr, "FATAL: jobs can only be spawned from a worker thread!\n");
+        abort();
+    }
+    // ring allocator, slots get reused once the deque has wrapped around
+    // and the job that had the slot has finished
+    worker* w = this->workers[index];
+    job* j = &w->job_pool[w->next_job & (jobDeque::CAPACITY - 1)];
+    if (j->live.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    j->live.store(true, std::memory_order_relaxed);
+    w->next_job++;
+    return j;
+}
+
+void JobSystem::submit(job* j) {
+    int index = this->currentWorker();
+    j->counter->pending.fetch_add(1, std::memory_order_relaxed);
+    if (!this->workers[index]->deque.push(j)) {
+        // deque is full, just do the work right here
+        this->execute(index, j);
+        return;
+    }
+    // pairs with the sleeping worker's increment: either it sees the job
+    // before it waits, or this sees it asleep and notifies under the lock
+    this->queued_jobs.fetch_add(1, std::memory_order_seq_cst);
+    if (this->sleeping_workers.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(this->sleep_mutex);
+        this->wake_up.notify_one();
+    }
+}
+
+job* JobSystem::findJob(int index) {
+    job* j = this->workers[index]->deque.pop();
+    if (!j) {
+        int n_workers = this->threadCount();
+        for (int offset = 1; offset < n_workers && !j; offset++) {
+            j = this->workers[(index + offset) % n_workers]->deque.steal();
+            if (j) {
+                this->workers[index]->jobs_stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+    if (j) {
+        this->queued_jobs.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return j;
+}
+
+void JobSystem::execute(int index, job* j) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    jobCounter* counter = j->counter;
+    j->entry(j);
+    j->live.store(false, std::memory_order_release);
+    uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+
+    worker* w = this->workers[index];
+    w->busy_ns.fetch_add(elapsed, std::memory_order_relaxed);
+    w->jobs_executed.fetch_add(1, std::memory_order_relaxed);
+    counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+void JobSystem::wait(jobCounter* counter) {
+    int index = this->currentWorker();
+    while (counter->pending.load(std::memory_order_acquire) > 0) {
+        job* j = this->findJob(index);
+        if (j) {
+            this->execute(index, j);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(int index) {
+    tls_job_system = this;
+    tls_worker_index = index;
+
+    int idle_spins = 0;
+    while (this->running.load(std::memory_order_acquire)) {
+        job* j = this->findJob(index);
+        if (j) {
+            this->execute(index, j);
+            idle_spins = 0;
+            continue;
+        }
+        if (++idle_spins < 64) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // nothing to steal for a while, sleep until submit() or the destructor
+        // wakes us; an idle job system costs no CPU at all
+        std::unique_lock<std::mutex> lock(this->sleep_mutex);
+        this->sleeping_workers.fetch_add(1, std::memory_order_seq_cst);
+        this->wake_up.wait(lock, [this]() {
+            return !this->running.load(std::memory_order_acquire) ||
+                   this->queued_jobs.load(std::memory_order_seq_cst) > 0;
+        });
+        this->sleeping_workers.fetch_sub(1, std::memory_order_acq_rel);
+        idle_spins = 0;
+    }
+}
+
+std::vector<workerStats> JobSystem::stats() const {
+    std::vector<workerStats> out;
+    for (const worker* w : this->workers) {
+        workerStats s;
+        s.jobs_executed = w->jobs_executed.load(std::memory_order_relaxed);
+        s.jobs_stolen = w->jobs_stolen.load(std::memory_order_relaxed);
+        s.busy_seconds = w->busy_ns.load(std::memory_order_relaxed) * 1e-9;
+        out.push_back(s);
+    }
+    return out;
+}
+
+void JobSystem::resetStats() {
+    for (worker* w : this->workers) {
+        w->jobs_executed = 0;
+        w->jobs_stolen = 0;
+        w->busy_ns = 0;
+    }
+    this->stats_reset_time = steadySeconds();
+}
+
+double JobSystem::workerCpuSeconds() const {
+    double total = 0.0;
+    for (size_t i = 1; i < this->workers.size(); i++) {
+        std::thread& thread = this->workers[i]->thread;
+        clockid_t clock;
+        struct timespec spent;
+        if (pthread_getcpuclockid(thread.native_handle(), &clock) == 0 &&
+            clock_gettime(clock, &spent) == 0) {
+            total += spent.tv_sec + spent.tv_nsec * 1e-9;
+        }
+    }
+    return total;
+}
+
+void JobSystem::printStats(FILE* out) const {
+    double wall = steadySeconds() - this->stats_reset_time;
+    std::vector<workerStats> all = this->stats();
+    for (size_t i = 0; i < all.size(); i++) {
+        fprintf(out, "worker %2zu: %5.1f%% busy, %8llu jobs, %8llu stolen\n", i,
+                (wall > 0.0) ? 100.0 * all[i].busy_seconds / wall : 0.0,
+                (unsigned long long)all[i].jobs_executed,
+                (unsigned long long)all[i].jobs_stolen);
+    }
+}
+
+}
@@ -0,0 +1,163 @@
+#ifndef SOUPCANS_JOB_SYSTEM_HPP
+#define SOUPCANS_JOB_SYSTEM_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace soupcans {
+
+// counts unfinished jobs, a parent waits on the counter its children share
+struct jobCounter {
+    std::atomic<int> pending{0};
+};
+
+struct job {
+    void (*entry)(job*);
+    jobCounter* counter;
+    // from allocation until it has run, a live slot can't be handed out again
+    std::atomic<bool> live{false};
+    alignas(16) unsigned char payload[48];
+};
+
+/* Chase-Lev work-stealing deque. Only the owning worker may push() and
+   pop() (LIFO end), any thread may steal() (FIFO end).
+*/
+class jobDeque {
+    public:
+        static const int64_t CAPACITY = 4096;
+
+        bool push(job* j);
+        job* pop();
+        job* steal();
+
+    private:
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+        std::atomic<job*> slots[CAPACITY];
+};
+
+struct workerStats {
+    uint64_t jobs_executed;
+    uint64_t jobs_stolen;
+    double busy_seconds;
+};
+
+/* Fiber-free job system. The thread that creates it becomes worker 0 and
+   runs jobs while it waits on a counter; the remaining workers are
+   background threads that steal when their own deque runs dry and sleep
+   when there is nothing to do. Jobs must be spawned from worker threads.
+*/
+class JobSystem {
+    public:
+        explicit JobSystem(int n_threads = 0);
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        int threadCount() const {
+            return static_cast<int>(this->workers.size());
+        }
+
+        // queues fn() as a child of counter; the callable is stored inline
+        template <class F>
+        void run(F&& fn, jobCounter* counter) {
+            typedef typename std::decay<F>::type callable;
+            static_assert(sizeof(callable) <= sizeof(job::payload),
+                          "job callable too large, capture by reference instead");
+            job* j = this->allocateJob();
+            if (!j) {
+                // every slot of this worker's pool is still queued or running
+                fn();
+                return;
+            }
+            j->counter = counter;
+            new (j->payload) callable(std::forward<F>(fn));
+            j->entry = [](job* self) {
+                callable* c = reinterpret_cast<callable*>(self->payload);
+                (*c)();
+                c->~callable();
+            };
+            this->submit(j);
+        }
+
+        // runs other jobs until every child of counter has finished
+        void wait(jobCounter* counter);
+
+        // calls fn(begin, end) over [begin, end) in pieces of at most grain items
+        template <class F>
+        void parallelFor(uint32_t begin, uint32_t end, uint32_t grain, const F& fn) {
+            if (grain == 0) {
+                grain = 1;
+            }
+            if (end - begin <= grain) {
+                if (begin < end) {
+                    fn(begin, end);
+                }
+                return;
+            }
+            jobCounter counter;
+            for (uint32_t b = begin; b < end; b += grain) {
+                uint32_t e = (end - b > grain) ? b + grain : end;
+                this->run([&fn, b, e]() { fn(b, e); }, &counter);
+            }
+            this->wait(&counter);
+        }
+
+        // grain that gives each worker a few pieces to balance the load
+        uint32_t grainFor(uint32_t n_items, uint32_t min_grain = 64) const {
+            uint32_t grain = n_items / (4 * this->threadCount());
+            return (grain > min_grain) ? grain : min_grain;
+        }
+
+        std::vector<workerStats> stats() const;
+        void resetStats();
+
+        // per-worker utilization since the last resetStats()
+        void printStats(FILE* out) const;
+        // CPU time the background workers' threads have used, spinning and sleeping included
+        double workerCpuSeconds() const;
+
+        // SOUP_THREADS from the environment, else the hardware thread count
+        static int defaultThreadCount();
+
+    private:
+        struct worker {
+            jobDeque deque;
+            std::unique_ptr<job[]> job_pool;
+            uint32_t next_job;
+            std::thread thread;
+            std::atomic<uint64_t> jobs_executed{0};
+            std::atomic<uint64_t> jobs_stolen{0};
+            std::atomic<uint64_t> busy_ns{0};
+        };
+
+        std::vector<worker*> workers;
+        std::atomic<bool> running;
+        std::atomic<int> queued_jobs;
+        std::atomic<int> sleeping_workers;
+        std::mutex sleep_mutex;
+        std::condition_variable wake_up;
+        double stats_reset_time;
+
+        int currentWorker() const;
+        // nullptr when the next slot's job hasn't run yet
+        job* allocateJob();
+        void submit(job* j);
+        job* findJob(int index);
+        void execute(int index, job* j);
+        void workerLoop(int index);
+};
+
+}
+
+#endif
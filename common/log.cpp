@@ -0,0 +1,167 @@
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "log.hpp"
+
+namespace soupcans {
+
+static std::atomic<int> g_log_threshold{LOG_INFO};
+
+static const char* LEVEL_NAMES[] = { "ERROR", "WARNING", "INFO", "DEBUG" };
+
+/* Fixed ring of preformatted lines between the callers and the writer
+   thread, so logging from a GL callback never allocates or blocks on I/O.
+*/
+static const int N_LOG_SLOTS = 256;
+static const int LOG_LINE_SIZE = 1024;
+
+struct logQueue {
+    std::mutex mutex;
+    std::condition_variable wake_up;
+    std::thread writer;
+    bool running = false;
+    uint32_t head = 0;
+    uint32_t tail = 0;
+    uint64_t n_dropped = 0;
+    char lines[N_LOG_SLOTS][LOG_LINE_SIZE];
+};
+
+static logQueue g_log_queue;
+static std::atomic<bool> g_log_async{false};
+
+void setLogLevel(logLevel level) {
+    g_log_threshold.store(level, std::memory_order_relaxed);
+}
+
+logLevel logThreshold() {
+    return static_cast<logLevel>(g_log_threshold.load(std::memory_order_relaxed));
+}
+
+static void writerLoop() {
+    logQueue& queue = g_log_queue;
+    char line[LOG_LINE_SIZE];
+    std::unique_lock<std::mutex> lock(queue.mutex);
+    while (true) {
+        queue.wake_up.wait(lock, [&queue]() {
+            return !queue.running || queue.head != queue.tail;
+        });
+        while (queue.head != queue.tail) {
+            memcpy(line, queue.lines[queue.tail % N_LOG_SLOTS], LOG_LINE_SIZE);
+            queue.tail++;
+            // the actual write happens without holding up the callers
+            lock.unlock();
+            fputs(line, stderr);
+            lock.lock();
+        }
+        if (!queue.running) {
+            break;
+        }
+    }
+}
+
+static void enqueueLine(const char* line) {
+    logQueue& queue = g_log_queue;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.running) {
+            // raced with stopLogThread(), the writer is already gone
+            fputs(line, stderr);
+            return;
+        }
+        if (queue.head - queue.tail >= (uint32_t)N_LOG_SLOTS) {
+            queue.n_dropped++;
+            return;
+        }
+        memcpy(queue.lines[queue.head % N_LOG_SLOTS], line, LOG_LINE_SIZE);
+        queue.head++;
+    }
+    queue.wake_up.notify_one();
+}
+
+void logMessage(logLevel level, const char* format, ...) {
+    if (level > logThreshold()) {
+        return;
+    }
+    // formatted as a whole line so lines from different threads don't interleave
+    char line[LOG_LINE_SIZE];
+    int prefix = snprintf(line, sizeof(line), "[%s] ", LEVEL_NAMES[level]);
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line + prefix, sizeof(line) - prefix - 1, format, args);
+    va_end(args);
+    length = (length < 0) ? 0 : prefix + length;
+    if (length > LOG_LINE_SIZE - 2) {
+        length = LOG_LINE_SIZE - 2;
+    }
+    line[length] = '\n';
+    line[length + 1] = '\0';
+
+    if (g_log_async.load(std::memory_order_acquire)) {
+        enqueueLine(line);
+    } else {
+        fputs(line, stderr);
+    }
+}
+
+void startLogThread() {
+    logQueue& queue = g_log_queue;
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.running) {
+        return;
+    }
+    queue.running = true;
+    queue.n_dropped = 0;
+    queue.writer = std::thread(writerLoop);
+    g_log_async.store(true, std::memory_order_release);
+}
+
+void stopLogThread() {
+    logQueue& queue = g_log_queue;
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.running) {
+            return;
+        }
+        g_log_async.store(false, std::memory_order_release);
+        queue.running = false;
+    }
+    queue.wake_up.notify_one();
+    queue.writer.join();
+    if (queue.n_dropped > 0) {
+        fprintf(stderr, "[WARNING] log queue overflowed, %llu messages dropped\n",
+                (unsigned long long)queue.n_dropped);
+    }
+}
+
+bool parseDebugLevel(const char* text, debugLevel* level) {
+    if (!strcmp(text, "release") || !strcmp(text, "0")) {
+        *level = DEBUG_RELEASE;
+    } else if (!strcmp(text, "async") || !strcmp(text, "debug") || !strcmp(text, "1")) {
+        *level = DEBUG_ASYNC;
+    } else if (!strcmp(text, "sync") || !strcmp(text, "2")) {
+        *level = DEBUG_SYNC;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+debugLevel defaultDebugLevel() {
+    const char* env = getenv("SOUP_DEBUG_LEVEL");
+    debugLevel level = DEBUG_RELEASE;
+    if (env && !parseDebugLevel(env, &level)) {
+        fprintf(stderr, "[WARNING] unknown SOUP_DEBUG_LEVEL %s, using release\n", env);
+        level = DEBUG_RELEASE;
+    }
+    return clampDebugLevel(level);
+}
+
+}
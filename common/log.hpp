@@ -0,0 +1,91 @@
+#ifndef SOUPCANS_LOG_HPP
+#define SOUPCANS_LOG_HPP
+
+/* How much diagnostics a build can do, set with -DSOUP_DEBUG_LEVEL=N:
+   0  release, no GL debug context and SOUP_LOG_INFO/DEBUG compile out
+   1  GL debug output delivered asynchronously, logging through a
+      background thread so the driver keeps its own threading
+   2  like 1, plus synchronous GL callbacks for breaking on the bad call
+   The runtime level (debugLevel below) picks within this ceiling.
+*/
+#define SOUP_DEBUG_RELEASE 0
+#define SOUP_DEBUG_ASYNC 1
+#define SOUP_DEBUG_SYNC 2
+
+#ifndef SOUP_DEBUG_LEVEL
+#ifdef NDEBUG
+#define SOUP_DEBUG_LEVEL SOUP_DEBUG_RELEASE
+#else
+#define SOUP_DEBUG_LEVEL SOUP_DEBUG_SYNC
+#endif
+#endif
+
+namespace soupcans {
+
+enum logLevel {
+    LOG_ERROR = 0,
+    LOG_WARNING,
+    LOG_INFO,
+    LOG_DEBUG
+};
+
+enum debugLevel {
+    DEBUG_RELEASE = SOUP_DEBUG_RELEASE,
+    DEBUG_ASYNC = SOUP_DEBUG_ASYNC,
+    DEBUG_SYNC = SOUP_DEBUG_SYNC
+};
+
+// messages above the threshold are dropped, LOG_INFO unless changed
+void setLogLevel(logLevel level);
+logLevel logThreshold();
+
+void logMessage(logLevel level, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/* Hands output to a background thread, callers only format into a queue
+   slot. Messages are dropped (and counted) if the queue ever fills up.
+   stopLogThread() writes out whatever is still queued.
+*/
+void startLogThread();
+void stopLogThread();
+
+// "release", "async" or "sync" (or 0-2), false if it is none of those
+bool parseDebugLevel(const char* text, debugLevel* level);
+
+// SOUP_DEBUG_LEVEL from the environment, else release, capped by the build
+debugLevel defaultDebugLevel();
+
+// the highest level this build supports
+inline debugLevel clampDebugLevel(debugLevel level) {
+    return (level > SOUP_DEBUG_LEVEL) ? static_cast<debugLevel>(SOUP_DEBUG_LEVEL) : level;
+}
+
+}
+
+// the threshold is checked before any formatting happens
+#define SOUP_LOG_AT(level, ...) \
+    do { \
+        if ((level) <= soupcans::logThreshold()) { \
+            soupcans::logMessage((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+// kept behind if (0) so the arguments are still type checked
+#define SOUP_LOG_NEVER(level, ...) \
+    do { \
+        if (0) { \
+            soupcans::logMessage((level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define SOUP_LOG_ERROR(...) SOUP_LOG_AT(soupcans::LOG_ERROR, __VA_ARGS__)
+#define SOUP_LOG_WARNING(...) SOUP_LOG_AT(soupcans::LOG_WARNING, __VA_ARGS__)
+#if SOUP_DEBUG_LEVEL > SOUP_DEBUG_RELEASE
+#define SOUP_LOG_INFO(...) SOUP_LOG_AT(soupcans::LOG_INFO, __VA_ARGS__)
+#define SOUP_LOG_DEBUG(...) SOUP_LOG_AT(soupcans::LOG_DEBUG, __VA_ARGS__)
+#else
+#define SOUP_LOG_INFO(...) SOUP_LOG_NEVER(soupcans::LOG_INFO, __VA_ARGS__)
+#define SOUP_LOG_DEBUG(...) SOUP_LOG_NEVER(soupcans::LOG_DEBUG, __VA_ARGS__)
+#endif
+
+#endif
@@ -0,0 +1,257 @@
+#include <math.h>
+#include <string.h>
+
+#include "log.hpp"
+#include "meshFormat.hpp"
+
+namespace soupcans {
+
+size_t meshComponentSize(meshComponentType type) {
+    switch (type) {
+        case MESH_FLOAT32:
+            return 4;
+        case MESH_FLOAT16:
+        case MESH_UNORM16:
+        case MESH_SNORM16:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+static uint64_t alignTo16(uint64_t offset) {
+    return (offset + 15) & ~static_cast<uint64_t>(15);
+}
+
+const char* validateMesh(const void* data, size_t size) {
+    if (size < sizeof(meshFileHeader)) {
+        return "too short for a mesh header";
+    }
+    meshFileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC)) != 0) {
+        return "not a packed mesh";
+    }
+    if (header.version != MESH_VERSION) {
+        return "packed with another version of meshpack";
+    }
+    if (header.index_size != 2 && header.index_size != 4) {
+        return "indices are neither 16 nor 32 bit";
+    }
+    if (header.n_attributes == 0 || header.n_attributes > MAX_MESH_ATTRIBUTES ||
+        header.vertex_stride == 0) {
+        return "bad vertex layout";
+    }
+    for (uint32_t i = 0; i < header.n_attributes; i++) {
+        const meshAttribute& attribute = header.attributes[i];
+        if (attribute.semantic >= N_MESH_SEMANTICS || attribute.type > MESH_SNORM16 ||
+            attribute.components < 1 || attribute.components > 4 ||
+            attribute.offset + attribute.components * meshComponentSize(attribute.type) >
+                header.vertex_stride) {
+            return "bad vertex attribute";
+        }
+    }
+    // 64 bit, so a hostile count can't wrap around
+    uint64_t vertex_end = header.vertex_offset +
+        static_cast<uint64_t>(header.n_vertices) * header.vertex_stride;
+    uint64_t index_end = header.index_offset +
+        static_cast<uint64_t>(header.n_indices) * header.index_size;
+    if (header.vertex_offset < sizeof(meshFileHeader) || header.vertex_offset % 16 != 0 ||
+        header.index_offset < vertex_end || header.index_offset % 16 != 0 || index_end > size) {
+        return "blocks don't fit in the file";
+    }
+    if (header.n_indices % 3 != 0) {
+        return "index count isn't whole triangles";
+    }
+    return nullptr;
+}
+
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+    if (exponent == 0xff) {
+        // infinity stays infinity, NaN stays NaN
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    }
+    int half_exponent = static_cast<int>(exponent) - 127 + 15;
+    if (half_exponent >= 31) {
+        return sign | 0x7c00;
+    }
+    if (half_exponent <= 0) {
+        if (half_exponent < -10) {
+            return sign;
+        }
+        // subnormal, the implicit leading 1 becomes explicit
+        mantissa |= 0x800000;
+        int shift = 14 - half_exponent;
+        uint32_t half_mantissa = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half_mantissa & 1))) {
+            half_mantissa++;
+        }
+        return sign | static_cast<uint16_t>(half_mantissa);
+    }
+    uint32_t half = (static_cast<uint32_t>(half_exponent) << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    // round to nearest even, a carry into the exponent is still right
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return sign | static_cast<uint16_t>(half);
+}
+
+static void writeComponents(uint8_t* out, meshComponentType type,
+                            const float* values, int n) {
+    for (int i = 0; i < n; i++) {
+        float v = values[i];
+        switch (type) {
+            case MESH_FLOAT32:
+                memcpy(out + 4 * i, &v, 4);
+                break;
+            case MESH_FLOAT16: {
+                uint16_t half = floatToHalf(v);
+                memcpy(out + 2 * i, &half, 2);
+                break;
+            }
+            case MESH_UNORM8:
+                out[i] = static_cast<uint8_t>(lroundf(fminf(fmaxf(v, 0.0f), 1.0f) * 255.0f));
+                break;
+            case MESH_SNORM8:
+                out[i] = static_cast<uint8_t>(static_cast<int8_t>(
+                    lroundf(fminf(fmaxf(v, -1.0f), 1.0f) * 127.0f)));
+                break;
+            case MESH_UNORM16: {
+                uint16_t q = static_cast<uint16_t>(
+                    lroundf(fminf(fmaxf(v, 0.0f), 1.0f) * 65535.0f));
+                memcpy(out + 2 * i, &q, 2);
+                break;
+            }
+            case MESH_SNORM16: {
+                int16_t q = static_cast<int16_t>(
+                    lroundf(fminf(fmaxf(v, -1.0f), 1.0f) * 32767.0f));
+                memcpy(out + 2 * i, &q, 2);
+                break;
+            }
+        }
+    }
+}
+
+bool packMesh(const meshSource& source, const meshPackOptions& options,
+              std::vector<uint8_t>* file) {
+    size_t n_vertices = source.positions.size() / 3;
+    if (n_vertices == 0 || source.positions.size() % 3 != 0) {
+        SOUP_LOG_ERROR("a mesh needs 3 floats of position per vertex");
+        return false;
+    }
+    if ((!source.normals.empty() && source.normals.size() != n_vertices * 3) ||
+        (!source.texcoords.empty() && source.texcoords.size() != n_vertices * 2) ||
+        (!source.colors.empty() && source.colors.size() != n_vertices * 4)) {
+        SOUP_LOG_ERROR("attribute counts don't match the %zu vertices", n_vertices);
+        return false;
+    }
+    if (source.indices.empty() || source.indices.size() % 3 != 0) {
+        SOUP_LOG_ERROR("a mesh needs whole triangles");
+        return false;
+    }
+    for (uint32_t index : source.indices) {
+        if (index >= n_vertices) {
+            SOUP_LOG_ERROR("index %u is past the last vertex", index);
+            return false;
+        }
+    }
+
+    meshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_MAGIC, sizeof(MESH_MAGIC));
+    header.version = MESH_VERSION;
+    header.n_vertices = static_cast<uint32_t>(n_vertices);
+    header.n_indices = static_cast<uint32_t>(source.indices.size());
+    header.index_size = (n_vertices <= 0x10000) ? 2 : 4;
+
+    // every attribute starts 4 byte aligned, what the GL wants
+    struct packedAttribute {
+        const std::vector<float>* values;
+        int source_components;
+    };
+    packedAttribute packed[MAX_MESH_ATTRIBUTES];
+    uint32_t stride = 0;
+    auto addAttribute = [&](meshSemantic semantic, meshComponentType type, int components,
+                            const std::vector<float>* values, int source_components) {
+        meshAttribute& attribute = header.attributes[header.n_attributes];
+        attribute.semantic = semantic;
+        attribute.type = type;
+        attribute.components = static_cast<uint8_t>(components);
+        attribute.offset = stride;
+        packed[header.n_attributes++] = packedAttribute{ values, source_components };
+        stride += (components * meshComponentSize(type) + 3) & ~static_cast<size_t>(3);
+    };
+    addAttribute(MESH_POSITION, options.full_positions ? MESH_FLOAT32 : MESH_FLOAT16, 3,
+                 &source.positions, 3);
+    if (!source.normals.empty()) {
+        addAttribute(MESH_NORMAL, MESH_SNORM8, 3, &source.normals, 3);
+    }
+    if (!source.texcoords.empty()) {
+        bool unit = true;
+        for (float t : source.texcoords) {
+            unit = unit && t >= 0.0f && t <= 1.0f;
+        }
+        // tiling coordinates need the range of a half
+        addAttribute(MESH_TEXCOORD, unit ? MESH_UNORM16 : MESH_FLOAT16, 2,
+                     &source.texcoords, 2);
+    }
+    if (!source.colors.empty()) {
+        addAttribute(MESH_COLOR, MESH_UNORM8, 4, &source.colors, 4);
+    }
+    header.vertex_stride = stride;
+
+    for (int axis = 0; axis < 3; axis++) {
+        header.bounds_min[axis] = source.positions[axis];
+        header.bounds_max[axis] = source.positions[axis];
+    }
+    for (size_t v = 0; v < n_vertices; v++) {
+        for (int axis = 0; axis < 3; axis++) {
+            float p = source.positions[v * 3 + axis];
+            header.bounds_min[axis] = fminf(header.bounds_min[axis], p);
+            header.bounds_max[axis] = fmaxf(header.bounds_max[axis], p);
+        }
+    }
+
+    uint64_t vertex_offset = alignTo16(sizeof(meshFileHeader));
+    uint64_t index_offset = alignTo16(vertex_offset + n_vertices * stride);
+    uint64_t file_size = index_offset + source.indices.size() * header.index_size;
+    if (file_size > 0xffffffffu) {
+        SOUP_LOG_ERROR("mesh is over 4 GiB packed");
+        return false;
+    }
+    header.vertex_offset = static_cast<uint32_t>(vertex_offset);
+    header.index_offset = static_cast<uint32_t>(index_offset);
+
+    file->assign(file_size, 0);
+    uint8_t* out = file->data();
+    memcpy(out, &header, sizeof(header));
+    for (size_t v = 0; v < n_vertices; v++) {
+        uint8_t* vertex = out + vertex_offset + v * stride;
+        for (uint32_t a = 0; a < header.n_attributes; a++) {
+            const meshAttribute& attribute = header.attributes[a];
+            const packedAttribute& p = packed[a];
+            writeComponents(vertex + attribute.offset, attribute.type,
+                            p.values->data() + v * p.source_components, attribute.components);
+        }
+    }
+    for (size_t i = 0; i < source.indices.size(); i++) {
+        uint8_t* index = out + index_offset + i * header.index_size;
+        if (header.index_size == 2) {
+            uint16_t short_index = static_cast<uint16_t>(source.indices[i]);
+            memcpy(index, &short_index, 2);
+        } else {
+            memcpy(index, &source.indices[i], 4);
+        }
+    }
+    return true;
+}
+
+}
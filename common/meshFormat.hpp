@@ -0,0 +1,105 @@
+#ifndef SOUPCANS_MESH_FORMAT_HPP
+#define SOUPCANS_MESH_FORMAT_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+namespace soupcans {
+
+/* Packed meshes (.smsh), what tools/meshpack writes and the runtime maps
+   straight into buffers. The file is this header, then the interleaved
+   vertices, then the indices, each block 16 byte aligned so it can be
+   handed to the GL without copying. Everything is little endian.
+
+   Attributes are quantized as far as they go without looking different:
+   positions as halves, normals as snorm8, texture coordinates as unorm16
+   when they stay inside [0, 1] and colors as unorm8. The GL turns the
+   normalized types back into floats, shaders don't change.
+*/
+enum meshSemantic : uint8_t {
+    MESH_POSITION,
+    MESH_NORMAL,
+    MESH_TEXCOORD,
+    MESH_COLOR,
+    N_MESH_SEMANTICS
+};
+
+enum meshComponentType : uint8_t {
+    MESH_FLOAT32,
+    MESH_FLOAT16,
+    MESH_UNORM8,
+    MESH_SNORM8,
+    MESH_UNORM16,
+    MESH_SNORM16
+};
+
+struct meshAttribute {
+    meshSemantic semantic;
+    meshComponentType type;
+    uint8_t components;
+    uint8_t reserved;
+    // from the start of a vertex
+    uint32_t offset;
+};
+
+static const char MESH_MAGIC[4] = { 'S', 'M', 'S', 'H' };
+static const uint32_t MESH_VERSION = 1;
+static const int MAX_MESH_ATTRIBUTES = N_MESH_SEMANTICS;
+
+struct meshFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t n_vertices;
+    uint32_t n_indices;
+    uint32_t vertex_stride;
+    // 2 while there are few enough vertices, otherwise 4
+    uint32_t index_size;
+    // from the start of the file
+    uint32_t vertex_offset;
+    uint32_t index_offset;
+    float bounds_min[3];
+    float bounds_max[3];
+    uint32_t n_attributes;
+    meshAttribute attributes[MAX_MESH_ATTRIBUTES];
+};
+
+static_assert(sizeof(meshAttribute) == 8, "meshAttribute is part of the file format");
+static_assert(sizeof(meshFileHeader) == 92, "meshFileHeader is part of the file format");
+
+// bytes of one component
+size_t meshComponentSize(meshComponentType type);
+
+/* Checks that a whole file of `size` bytes holds the mesh its header
+   describes. Returns nullptr if it does, otherwise what is wrong.
+*/
+const char* validateMesh(const void* data, size_t size);
+
+/* Triangles with unpacked attributes, what importers produce. An empty
+   attribute vector means the mesh doesn't have it; otherwise there is
+   one entry per vertex (3 floats for positions and normals, 2 for
+   texture coordinates, 4 for colors).
+*/
+struct meshSource {
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> texcoords;
+    std::vector<float> colors;
+    std::vector<uint32_t> indices;
+};
+
+struct meshPackOptions {
+    // keep 32 bit float positions, for meshes too big or too fine for halves
+    bool full_positions = false;
+};
+
+// the whole .smsh file, false (and logged) if the source is broken
+bool packMesh(const meshSource& source, const meshPackOptions& options,
+              std::vector<uint8_t>* file);
+
+uint16_t floatToHalf(float value);
+
+}
+
+#endif
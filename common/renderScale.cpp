@@ -0,0 +1,92 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "renderScale.hpp"
+
+namespace soupcans {
+
+// shrink a bit below the budget so we don't sit right on the edge
+static const float TARGET_FRACTION = 0.9f;
+// only grow when the frame would still fit at the next step up
+static const float GROW_FRACTION = 0.7f;
+static const float GROW_STEP = 0.05f;
+static const int SETTLE_FRAMES = 8;
+static const double SMOOTHING = 0.1;
+
+RenderScaleController::RenderScaleController(float budget_ms, float min_scale,
+                                             float max_scale) {
+    this->budget_ms = budget_ms;
+    this->min_scale = min_scale;
+    this->max_scale = max_scale;
+    this->current_scale = max_scale;
+    this->smoothed_ms = -1.0;
+    this->cooldown_frames = 0;
+    this->n_frames = 0;
+    this->n_over_budget = 0;
+    this->scale_sum = 0.0;
+}
+
+float RenderScaleController::defaultBudgetMs() {
+    const char* env = getenv("SOUP_GPU_BUDGET_MS");
+    float budget_ms = env ? static_cast<float>(atof(env)) : 0.0f;
+    return (budget_ms > 0.0f) ? budget_ms : 1000.0f / 60.0f;
+}
+
+void RenderScaleController::setScale(float new_scale) {
+    if (new_scale < this->min_scale) {
+        new_scale = this->min_scale;
+    } else if (new_scale > this->max_scale) {
+        new_scale = this->max_scale;
+    }
+    if (new_scale == this->current_scale) {
+        return;
+    }
+    // guess what the new resolution will cost until real samples show up
+    double pixel_ratio = (double)new_scale * new_scale /
+                         ((double)this->current_scale * this->current_scale);
+    this->smoothed_ms *= pixel_ratio;
+    this->current_scale = new_scale;
+    this->cooldown_frames = SETTLE_FRAMES;
+}
+
+float RenderScaleController::update(double gpu_ms) {
+    this->n_frames++;
+    this->scale_sum += this->current_scale;
+    if (gpu_ms > this->budget_ms) {
+        this->n_over_budget++;
+    }
+
+    if (this->smoothed_ms < 0.0) {
+        this->smoothed_ms = gpu_ms;
+    } else {
+        this->smoothed_ms += SMOOTHING * (gpu_ms - this->smoothed_ms);
+    }
+    if (this->cooldown_frames > 0) {
+        this->cooldown_frames--;
+        return this->current_scale;
+    }
+
+    if (this->smoothed_ms > this->budget_ms) {
+        float fit = sqrtf(TARGET_FRACTION * this->budget_ms /
+                          static_cast<float>(this->smoothed_ms));
+        this->setScale(this->current_scale * fit);
+    } else if (this->current_scale < this->max_scale) {
+        float next_scale = this->current_scale + GROW_STEP;
+        double next_ms = this->smoothed_ms * (next_scale * next_scale) /
+                         (this->current_scale * this->current_scale);
+        if (next_ms < GROW_FRACTION * this->budget_ms) {
+            this->setScale(next_scale);
+        }
+    }
+    return this->current_scale;
+}
+
+void RenderScaleController::report(FILE* out) const {
+    fprintf(out, "render scale: %.2f average, %llu of %llu frames over the "
+                 "%.2f ms GPU budget\n",
+            (this->n_frames > 0) ? this->scale_sum / this->n_frames : this->current_scale,
+            (unsigned long long)this->n_over_budget,
+            (unsigned long long)this->n_frames, this->budget_ms);
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef SOUPCANS_RENDER_SCALE_HPP
+#define SOUPCANS_RENDER_SCALE_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+
+namespace soupcans {
+
+/* Picks the internal render resolution from measured GPU frame times.
+   Fragment cost goes with pixel count, so when the smoothed time is over
+   budget the scale drops by sqrt(budget / time) in one go; when there is
+   plenty of headroom it creeps back up a step at a time. After every change
+   it waits a few frames, timer results arrive a couple of frames late.
+*/
+class RenderScaleController {
+    public:
+        explicit RenderScaleController(float budget_ms, float min_scale = 0.5f,
+                                       float max_scale = 1.0f);
+
+        // feeds one GPU frame time, returns the scale for the next frame
+        float update(double gpu_ms);
+
+        float scale() const {
+            return this->current_scale;
+        }
+        double smoothedMs() const {
+            return this->smoothed_ms;
+        }
+        float budgetMs() const {
+            return this->budget_ms;
+        }
+
+        // average scale and how often the budget was missed
+        void report(FILE* out) const;
+
+        // SOUP_GPU_BUDGET_MS from the environment, else a 60 fps frame
+        static float defaultBudgetMs();
+
+    private:
+        float budget_ms;
+        float min_scale;
+        float max_scale;
+        float current_scale;
+        double smoothed_ms;
+        int cooldown_frames;
+
+        uint64_t n_frames;
+        uint64_t n_over_budget;
+        double scale_sum;
+
+        void setScale(float new_scale);
+};
+
+}
+
+#endif
@@ -0,0 +1,114 @@
+#include <math.h>
+
+#include <algorithm>
+
+#include "spatialGrid.hpp"
+#include "jobSystem.hpp"
+
+namespace soupcans {
+
+SpatialGrid::SpatialGrid(aabb2d world, int n_cells_x, int n_cells_y) {
+    this->world = world;
+    this->n_cells_x = (n_cells_x > 0) ? n_cells_x : 1;
+    this->n_cells_y = (n_cells_y > 0) ? n_cells_y : 1;
+    this->inv_cell_w = this->n_cells_x / (world.max_x - world.min_x);
+    this->inv_cell_h = this->n_cells_y / (world.max_y - world.min_y);
+    this->cell_start.assign(this->cellCount() + 1, 0);
+}
+
+SpatialGrid SpatialGrid::fitted(aabb2d world, float object_size,
+                                int max_cells_per_axis) {
+    int nx = static_cast<int>(ceilf((world.max_x - world.min_x) / object_size));
+    int ny = static_cast<int>(ceilf((world.max_y - world.min_y) / object_size));
+    nx = std::min(std::max(nx, 1), max_cells_per_axis);
+    ny = std::min(std::max(ny, 1), max_cells_per_axis);
+    return SpatialGrid(world, nx, ny);
+}
+
+void SpatialGrid::rebuild(const aabb2d* bounds, uint32_t n_objects) {
+    this->bounds.assign(bounds, bounds + n_objects);
+
+    // counting pass: how many entries land in each cell
+    std::fill(this->cell_start.begin(), this->cell_start.end(), 0);
+    for (uint32_t id = 0; id < n_objects; id++) {
+        const aabb2d& box = bounds[id];
+        int x0 = this->cellX(box.min_x), x1 = this->cellX(box.max_x);
+        int y0 = this->cellY(box.min_y), y1 = this->cellY(box.max_y);
+        for (int cy = y0; cy <= y1; cy++) {
+            for (int cx = x0; cx <= x1; cx++) {
+                this->cell_start[cy * this->n_cells_x + cx + 1]++;
+            }
+        }
+    }
+    for (int cell = 0; cell < this->cellCount(); cell++) {
+        this->cell_start[cell + 1] += this->cell_start[cell];
+    }
+
+    // scatter pass, walking ids in order keeps every cell sorted
+    this->cell_items.resize(this->cell_start[this->cellCount()]);
+    std::vector<uint32_t>& cursor = this->scatter_cursor;
+    cursor.assign(this->cell_start.begin(), this->cell_start.end() - 1);
+    for (uint32_t id = 0; id < n_objects; id++) {
+        const aabb2d& box = bounds[id];
+        int x0 = this->cellX(box.min_x), x1 = this->cellX(box.max_x);
+        int y0 = this->cellY(box.min_y), y1 = this->cellY(box.max_y);
+        for (int cy = y0; cy <= y1; cy++) {
+            for (int cx = x0; cx <= x1; cx++) {
+                this->cell_items[cursor[cy * this->n_cells_x + cx]++] = id;
+            }
+        }
+    }
+}
+
+void SpatialGrid::queryRegion(const aabb2d& region, std::vector<uint32_t>& out) const {
+    out.clear();
+    this->queryRows(region, this->cellY(region.min_y), this->cellY(region.max_y) + 1, out);
+    std::sort(out.begin(), out.end());
+}
+
+void SpatialGrid::cullVisible(const aabb2d& view, std::vector<uint32_t>& draw_list,
+                              JobSystem& jobs) const {
+    int y0 = this->cellY(view.min_y), y1 = this->cellY(view.max_y);
+    int n_rows = y1 - y0 + 1;
+    this->row_results.resize(n_rows);
+    jobs.parallelFor(0, n_rows, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t row = begin; row < end; row++) {
+            this->row_results[row].clear();
+            this->queryRows(view, y0 + row, y0 + row + 1, this->row_results[row]);
+        }
+    });
+
+    draw_list.clear();
+    for (int row = 0; row < n_rows; row++) {
+        draw_list.insert(draw_list.end(),
+            this->row_results[row].begin(), this->row_results[row].end());
+    }
+    std::sort(draw_list.begin(), draw_list.end());
+}
+
+// appends without sorting, rows [row_begin, row_end) must lie inside region
+void SpatialGrid::queryRows(const aabb2d& region, int row_begin, int row_end,
+                            std::vector<uint32_t>& out) const {
+    int x0 = this->cellX(region.min_x), x1 = this->cellX(region.max_x);
+    int y0 = this->cellY(region.min_y);
+    for (int cy = row_begin; cy < row_end; cy++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            int cell = cy * this->n_cells_x + cx;
+            for (uint32_t i = this->cell_start[cell]; i < this->cell_start[cell + 1]; i++) {
+                uint32_t id = this->cell_items[i];
+                const aabb2d& box = this->bounds[id];
+                if (!aabbOverlap(box, region)) {
+                    continue;
+                }
+                // only the first cell shared by the box and the region reports it
+                int first_x = std::max(this->cellX(box.min_x), x0);
+                int first_y = std::max(this->cellY(box.min_y), y0);
+                if (cx == first_x && cy == first_y) {
+                    out.push_back(id);
+                }
+            }
+        }
+    }
+}
+
+}
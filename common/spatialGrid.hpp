@@ -0,0 +1,142 @@
+#ifndef SOUPCANS_SPATIAL_GRID_HPP
+#define SOUPCANS_SPATIAL_GRID_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <vector>
+
+namespace soupcans {
+
+class JobSystem;
+
+// axis-aligned bounding box in the 2d playfield (normalized device coords)
+struct aabb2d {
+    float min_x;
+    float min_y;
+    float max_x;
+    float max_y;
+};
+
+inline bool aabbOverlap(const aabb2d& a, const aabb2d& b) {
+    return a.min_x <= b.max_x && b.min_x <= a.max_x &&
+           a.min_y <= b.max_y && b.min_y <= a.max_y;
+}
+
+inline aabb2d aabbAround(float center_x, float center_y,
+                         float half_width, float half_height) {
+    return aabb2d{ center_x - half_width, center_y - half_height,
+                   center_x + half_width, center_y + half_height };
+}
+
+// the whole visible area of a 2d scene drawn without a camera
+const aabb2d NDC_VIEW = { -1.0f, -1.0f, 1.0f, 1.0f };
+
+/* Uniform grid over a bounded 2d playfield, rebuilt from scratch every
+   frame with a counting sort. Objects covering several cells are stored
+   in each of them, and every query reports an object (or pair) from exactly
+   one cell, so results never contain duplicates. Object ids inside a cell
+   stay in ascending order, which keeps query results deterministic.
+*/
+class SpatialGrid {
+    public:
+        SpatialGrid(aabb2d world, int n_cells_x, int n_cells_y);
+
+        // picks a cell count so that a cell is about the size of one object
+        static SpatialGrid fitted(aabb2d world, float object_size,
+                                  int max_cells_per_axis = 256);
+
+        void rebuild(const aabb2d* bounds, uint32_t n_objects);
+
+        // indices of every object overlapping `region`, in ascending order
+        void queryRegion(const aabb2d& region, std::vector<uint32_t>& out) const;
+
+        // replaces `draw_list` with the objects that can be seen in `view`
+        void cullVisible(const aabb2d& view, std::vector<uint32_t>& draw_list) const {
+            this->queryRegion(view, draw_list);
+        }
+
+        // same result, with rows of cells spread across the job system; not
+        // safe to call concurrently on one grid
+        void cullVisible(const aabb2d& view, std::vector<uint32_t>& draw_list,
+                         JobSystem& jobs) const;
+
+        // calls fn(a, b) with a < b once for every pair of overlapping boxes
+        template <class F>
+        void forEachOverlappingPair(F&& fn) const {
+            this->forEachOverlappingPairInCells(0, this->cellCount(), fn);
+        }
+
+        // same as above, restricted to the cells [cell_begin, cell_end) so
+        // the work can be split into independent chunks
+        template <class F>
+        void forEachOverlappingPairInCells(int cell_begin, int cell_end, F&& fn) const {
+            for (int cell = cell_begin; cell < cell_end; cell++) {
+                const uint32_t* items = &this->cell_items[this->cell_start[cell]];
+                uint32_t n_items = this->cell_start[cell + 1] - this->cell_start[cell];
+                for (uint32_t i = 0; i < n_items; i++) {
+                    const aabb2d& a = this->bounds[items[i]];
+                    for (uint32_t j = i + 1; j < n_items; j++) {
+                        const aabb2d& b = this->bounds[items[j]];
+                        if (aabbOverlap(a, b) && this->ownsPair(cell, a, b)) {
+                            fn(items[i], items[j]);
+                        }
+                    }
+                }
+            }
+        }
+
+        int cellCount() const {
+            return this->n_cells_x * this->n_cells_y;
+        }
+
+        uint32_t objectCount() const {
+            return static_cast<uint32_t>(this->bounds.size());
+        }
+
+        const aabb2d& objectBounds(uint32_t id) const {
+            return this->bounds[id];
+        }
+
+        const aabb2d& worldBounds() const {
+            return this->world;
+        }
+
+    private:
+        aabb2d world;
+        int n_cells_x;
+        int n_cells_y;
+        float inv_cell_w;
+        float inv_cell_h;
+
+        std::vector<aabb2d> bounds;
+        std::vector<uint32_t> cell_start;  // prefix sums, cellCount()+1 entries
+        std::vector<uint32_t> cell_items;  // object ids grouped by cell
+        std::vector<uint32_t> scatter_cursor;
+        mutable std::vector<std::vector<uint32_t>> row_results;
+
+        void queryRows(const aabb2d& region, int row_begin, int row_end,
+                       std::vector<uint32_t>& out) const;
+
+        int cellX(float x) const {
+            int cx = static_cast<int>((x - this->world.min_x) * this->inv_cell_w);
+            return (cx < 0) ? 0 : (cx >= this->n_cells_x) ? this->n_cells_x - 1 : cx;
+        }
+
+        int cellY(float y) const {
+            int cy = static_cast<int>((y - this->world.min_y) * this->inv_cell_h);
+            return (cy < 0) ? 0 : (cy >= this->n_cells_y) ? this->n_cells_y - 1 : cy;
+        }
+
+        // a pair is reported only by the cell holding the min corner of the
+        // intersection of the two boxes
+        bool ownsPair(int cell, const aabb2d& a, const aabb2d& b) const {
+            float ix = (a.min_x > b.min_x) ? a.min_x : b.min_x;
+            float iy = (a.min_y > b.min_y) ? a.min_y : b.min_y;
+            return cell == this->cellY(iy) * this->n_cells_x + this->cellX(ix);
+        }
+};
+
+}
+
+#endif
@@ -0,0 +1,32 @@
+/* The one stb_image implementation in a SOUPCANS build, with its
+   allocations routed through the frame arena pool so that decode buffers
+   get recycled instead of going back to the heap every load.
+*/
+#include "frameArena.hpp"
+
+#define STBI_MALLOC(size) soupcans::poolMalloc(size)
+#define STBI_REALLOC(ptr, new_size) soupcans::poolRealloc(ptr, new_size)
+#define STBI_FREE(ptr) soupcans::poolFree(ptr)
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include "imageDecode.hpp"
+
+namespace soupcans {
+
+unsigned char* decodeImageFile(const char* path, int* width, int* height,
+                               int* n_channels, int desired_channels,
+                               bool flip_vertically) {
+    stbi_set_flip_vertically_on_load_thread(flip_vertically ? 1 : 0);
+    ArenaScope scratch(scratchArena());
+    size_t file_size = 0;
+    char* file_data = readFileInto(scratchArena(), path, &file_size);
+    if (!file_data) {
+        return nullptr;
+    }
+    return stbi_load_from_memory(reinterpret_cast<stbi_uc*>(file_data),
+                                 static_cast<int>(file_size),
+                                 width, height, n_channels, desired_channels);
+}
+
+}
@@ -0,0 +1,235 @@
+#include <math.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SOUP_TRANSFORM_AVX 1
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define SOUP_TRANSFORM_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SOUP_TRANSFORM_NEON 1
+#endif
+
+#include "transform.hpp"
+
+namespace soupcans {
+
+static const float PI = 3.14159265358979f;
+static const float DEGREES_TO_RADIANS = PI / 180.0f;
+
+// Taylor series, x in [0, pi / 2] where a dozen terms are exact to float precision
+static constexpr double constexprSin(double x) {
+    double term = x, sum = x;
+    for (int n = 1; n < 12; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+static constexpr degreeTable makeDegreeTable() {
+    degreeTable table = {};
+    const double half_degree = 3.14159265358979323846 / 360.0;
+    for (int h = 0; h < 720; h++) {
+        // fold every quadrant back onto the first
+        int folded = h % 360;
+        folded = (folded > 180) ? 360 - folded : folded;
+        double s = constexprSin(folded * half_degree);
+        table.sine[h] = static_cast<float>((h < 360) ? s : -s);
+    }
+    return table;
+}
+
+constexpr degreeTable DEGREE_TABLE = makeDegreeTable();
+static_assert(DEGREE_TABLE.sine[180] == 1.0f && DEGREE_TABLE.sine[540] == -1.0f,
+              "degree table is off");
+
+mat4f identityMat4() {
+    mat4f out = {};
+    out.m[0] = out.m[5] = out.m[10] = out.m[15] = 1.0f;
+    return out;
+}
+
+// half angle sine and cosine go straight into the quaternion
+static quatf axisQuat(transformAxis axis, float half_sin, float half_cos) {
+    quatf q = { 0.0f, 0.0f, 0.0f, half_cos };
+    if (axis == AXIS_X) {
+        q.x = half_sin;
+    } else if (axis == AXIS_Y) {
+        q.y = half_sin;
+    } else {
+        q.z = half_sin;
+    }
+    return q;
+}
+
+quatf quatDegrees(transformAxis axis, int degrees) {
+    // half of a whole degree angle is a whole number of half degrees
+    return axisQuat(axis, sinHalfDegrees(degrees), cosHalfDegrees(degrees));
+}
+
+quatf quatDegrees(transformAxis axis, float degrees) {
+    return quatRadians(axis, degrees * DEGREES_TO_RADIANS);
+}
+
+quatf quatRadians(transformAxis axis, float radians) {
+    return axisQuat(axis, sinf(0.5f * radians), cosf(0.5f * radians));
+}
+
+quatf quatRadians(float axis_x, float axis_y, float axis_z, float radians) {
+    float s = sinf(0.5f * radians);
+    return quatf{ axis_x * s, axis_y * s, axis_z * s, cosf(0.5f * radians) };
+}
+
+quatf quatMultiply(const quatf& a, const quatf& b) {
+    return quatf{
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z
+    };
+}
+
+mat4f quatToMat4(const quatf& q) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    mat4f out = {};
+    out.m[0] = 1.0f - 2.0f * (yy + zz);
+    out.m[1] = 2.0f * (xy + wz);
+    out.m[2] = 2.0f * (xz - wy);
+    out.m[4] = 2.0f * (xy - wz);
+    out.m[5] = 1.0f - 2.0f * (xx + zz);
+    out.m[6] = 2.0f * (yz + wx);
+    out.m[8] = 2.0f * (xz + wy);
+    out.m[9] = 2.0f * (yz - wx);
+    out.m[10] = 1.0f - 2.0f * (xx + yy);
+    out.m[15] = 1.0f;
+    return out;
+}
+
+// rows and columns of the plane the axis leaves alone
+static mat4f axisRotation(transformAxis axis, float s, float c) {
+    mat4f out = identityMat4();
+    int i = (axis == AXIS_X) ? 1 : (axis == AXIS_Y ? 2 : 0);
+    int j = (axis == AXIS_X) ? 2 : (axis == AXIS_Y ? 0 : 1);
+    out.m[i * 4 + i] = c;
+    out.m[i * 4 + j] = s;
+    out.m[j * 4 + i] = -s;
+    out.m[j * 4 + j] = c;
+    return out;
+}
+
+mat4f rotationDegrees(transformAxis axis, int degrees) {
+    return axisRotation(axis, sinDegrees(degrees), cosDegrees(degrees));
+}
+
+mat4f rotationDegrees(transformAxis axis, float degrees) {
+    return rotationRadians(axis, degrees * DEGREES_TO_RADIANS);
+}
+
+mat4f rotationRadians(transformAxis axis, float radians) {
+    return axisRotation(axis, sinf(radians), cosf(radians));
+}
+
+/* out = a * b for one matrix; column j of the product is a times column
+   j of b. a is held in registers, so out may be b but not a.
+*/
+static inline void multiplyKernel(const float* a, const float* b, float* out) {
+#if defined(SOUP_TRANSFORM_AVX)
+    __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a));
+    __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 4));
+    __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 8));
+    __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a + 12));
+    // two columns of b at a time, each lane pair broadcasting its own column
+    for (int j = 0; j < 16; j += 8) {
+        __m256 columns = _mm256_loadu_ps(b + j);
+        __m256 r = _mm256_mul_ps(a0, _mm256_shuffle_ps(columns, columns, 0x00));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a1, _mm256_shuffle_ps(columns, columns, 0x55)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a2, _mm256_shuffle_ps(columns, columns, 0xaa)));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a3, _mm256_shuffle_ps(columns, columns, 0xff)));
+        _mm256_storeu_ps(out + j, r);
+    }
+#elif defined(SOUP_TRANSFORM_SSE)
+    __m128 a0 = _mm_loadu_ps(a), a1 = _mm_loadu_ps(a + 4);
+    __m128 a2 = _mm_loadu_ps(a + 8), a3 = _mm_loadu_ps(a + 12);
+    for (int j = 0; j < 16; j += 4) {
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b[j]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b[j + 1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b[j + 2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b[j + 3])));
+        _mm_storeu_ps(out + j, r);
+    }
+#elif defined(SOUP_TRANSFORM_NEON)
+    float32x4_t a0 = vld1q_f32(a), a1 = vld1q_f32(a + 4);
+    float32x4_t a2 = vld1q_f32(a + 8), a3 = vld1q_f32(a + 12);
+    for (int j = 0; j < 16; j += 4) {
+        float32x4_t r = vmulq_n_f32(a0, b[j]);
+        r = vmlaq_n_f32(r, a1, b[j + 1]);
+        r = vmlaq_n_f32(r, a2, b[j + 2]);
+        r = vmlaq_n_f32(r, a3, b[j + 3]);
+        vst1q_f32(out + j, r);
+    }
+#else
+    float a_copy[16];
+    for (int i = 0; i < 16; i++) {
+        a_copy[i] = a[i];
+    }
+    for (int j = 0; j < 16; j += 4) {
+        float b0 = b[j], b1 = b[j + 1], b2 = b[j + 2], b3 = b[j + 3];
+        for (int row = 0; row < 4; row++) {
+            out[j + row] = a_copy[row] * b0 + a_copy[4 + row] * b1 +
+                           a_copy[8 + row] * b2 + a_copy[12 + row] * b3;
+        }
+    }
+#endif
+}
+
+void multiplyMat4(const float* a, const float* b, float* out) {
+    if (out == a) {
+        float product[16];
+        multiplyKernel(a, b, product);
+        for (int i = 0; i < 16; i++) {
+            out[i] = product[i];
+        }
+        return;
+    }
+    multiplyKernel(a, b, out);
+}
+
+void multiplyMat4Batch(const float* a, size_t a_stride, const float* b, size_t b_stride,
+                       float* out, size_t n) {
+    a_stride *= 16;
+    b_stride *= 16;
+    for (size_t i = 0; i < n; i++) {
+        multiplyKernel(a + i * a_stride, b + i * b_stride, out + i * 16);
+    }
+}
+
+void composeMat4Batch(const float* a, size_t a_stride, const float* b, size_t b_stride,
+                      const float* c, size_t c_stride, float* out, size_t n) {
+    a_stride *= 16;
+    b_stride *= 16;
+    c_stride *= 16;
+    for (size_t i = 0; i < n; i++) {
+        // b * c lands in out, then a goes on in place, out never leaves the cache
+        float* product = out + i * 16;
+        multiplyKernel(b + i * b_stride, c + i * c_stride, product);
+        multiplyKernel(a + i * a_stride, product, product);
+    }
+}
+
+const char* transformKernelName() {
+#if defined(SOUP_TRANSFORM_AVX)
+    return "avx";
+#elif defined(SOUP_TRANSFORM_SSE)
+    return "sse";
+#elif defined(SOUP_TRANSFORM_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+}
@@ -0,0 +1,101 @@
+#ifndef SOUPCANS_TRANSFORM_HPP
+#define SOUPCANS_TRANSFORM_HPP
+
+#include <stddef.h>
+
+namespace soupcans {
+
+/* Column-major 4x4 matrices, laid out like GL and glm::mat4: anything
+   that takes a `const float*` matrix also takes glm::value_ptr(m), and an
+   array of glm::mat4 is an array of 16 float matrices.
+*/
+struct alignas(16) mat4f {
+    float m[16];
+};
+
+struct quatf {
+    float x;
+    float y;
+    float z;
+    float w;
+};
+
+enum transformAxis {
+    AXIS_X,
+    AXIS_Y,
+    AXIS_Z
+};
+
+// sin in half degree steps, built at compile time; the halves are for quaternions
+struct degreeTable {
+    float sine[720];
+};
+
+extern const degreeTable DEGREE_TABLE;
+
+// any integer number of half degrees, without calling into libm
+inline float sinHalfDegrees(int half_degrees) {
+    int i = half_degrees % 720;
+    return DEGREE_TABLE.sine[(i < 0) ? i + 720 : i];
+}
+
+inline float cosHalfDegrees(int half_degrees) {
+    int i = half_degrees % 720 + 180;
+    return DEGREE_TABLE.sine[(i < 0) ? i + 720 : (i >= 720 ? i - 720 : i)];
+}
+
+inline float sinDegrees(int degrees) {
+    return sinHalfDegrees((degrees % 360) * 2);
+}
+
+inline float cosDegrees(int degrees) {
+    return cosHalfDegrees((degrees % 360) * 2);
+}
+
+mat4f identityMat4();
+
+/* Rotations. Integer degrees come from the table, the float overloads
+   take degrees or radians as their name says.
+*/
+quatf quatDegrees(transformAxis axis, int degrees);
+quatf quatDegrees(transformAxis axis, float degrees);
+quatf quatRadians(transformAxis axis, float radians);
+// around any unit length axis
+quatf quatRadians(float axis_x, float axis_y, float axis_z, float radians);
+
+// the rotation `b` followed by `a`, like multiplying their matrices a * b
+quatf quatMultiply(const quatf& a, const quatf& b);
+mat4f quatToMat4(const quatf& q);
+
+mat4f rotationDegrees(transformAxis axis, int degrees);
+mat4f rotationDegrees(transformAxis axis, float degrees);
+mat4f rotationRadians(transformAxis axis, float radians);
+
+// out = a * b, out may alias either one
+void multiplyMat4(const float* a, const float* b, float* out);
+
+inline mat4f operator*(const mat4f& a, const mat4f& b) {
+    mat4f out;
+    multiplyMat4(a.m, b.m, out.m);
+    return out;
+}
+
+/* Kernels over arrays of n matrices, 16 floats apart. A stride of 0
+   uses the same matrix for every element, so one call can put a shared
+   view or rotation on every model. Pointers need not be 16 byte aligned,
+   and out must not overlap the inputs. Built with AVX when the compiler
+   targets it, else SSE or NEON, else plain C++.
+*/
+// out[i] = a[i] * b[i]
+void multiplyMat4Batch(const float* a, size_t a_stride, const float* b, size_t b_stride,
+                       float* out, size_t n);
+// out[i] = a[i] * b[i] * c[i], in one pass over the arrays
+void composeMat4Batch(const float* a, size_t a_stride, const float* b, size_t b_stride,
+                      const float* c, size_t c_stride, float* out, size_t n);
+
+// which of the kernels above this build uses, for benchmark output
+const char* transformKernelName();
+
+}
+
+#endif
@@ -1,13 +1,9 @@
-#include <array>
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <sstream>
+#include <algorithm>
+#include <vector>
 #include <memory>
 
 #include <math.h>
 #include <stdlib.h>
-#include <time.h>
 
 #include <GL/gl3w.h>
 #include <GLFW/glfw3.h>
@@ -16,200 +12,270 @@
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include "../include/glDebug.hpp"
-#include "../include/glHelpers.hpp"
-
-using glhelpers::displayObjects;
-using glhelpers::shaderSrc;
-
-int main() {
-    if (!glfwInit()) {
-        fprintf(stderr, "ERROR: could not start GLFW3\n");
-        return 1;
-    }
+#include "../common/spatialGrid.hpp"
+#include "../common/collision.hpp"
+#include "../runtime/runtime.hpp"
+#include "../runtime/sceneList.hpp"
+
+using soupcans::aabb2d;
+using soupcans::SpatialGrid;
+using soupcans::collisionBody;
+using soupcans::CollisionWorld;
+using soupcans::JobSystem;
+using soupcans::ArenaScope;
+using soupcans::Runtime;
+using soupcans::Scene;
+using soupcans::sceneSettings;
+
+const GLfloat TRIANGLE_SCALE = 0.5f;
+const GLfloat TRIANGLE_HALF_EXTENT = 0.5f * TRIANGLE_SCALE;
+const GLfloat WALL_POSITION = 0.75f;
+
+struct bouncingTriangle {
+    glm::mat4 matrix;
+    GLfloat cmatrix[12];
+    GLfloat speed_x;
+    GLfloat speed_y;
+    GLfloat last_position_x;
+    GLfloat last_position_y;
+    bool hit_something;  // colors get randomized after the parallel update
+};
+
+void initTriangle(bouncingTriangle& triangle) {
+    // random starting position, identity color transform
+    float x_pos = (float)(rand() % 100) / 200;
+    float y_pos = (float)(rand() % 100) / 200;
+    triangle.matrix = glm::mat4{
+        TRIANGLE_SCALE,           0.0f,           0.0f, 0.0f,
+                  0.0f, TRIANGLE_SCALE,           0.0f, 0.0f,
+                  0.0f,           0.0f, TRIANGLE_SCALE, 0.0f,
+                 x_pos,          y_pos,           0.0f, 1.0f,
+    };
+    GLfloat identity[] = {
+         1.0f,  0.0f, 0.0f,
+         0.0f,  1.0f, 0.0f,
+         0.0f,  0.0f, 1.0f,
+         0.0f,  0.0f, 0.0f,
+    };
+    std::copy(identity, identity + 12, triangle.cmatrix);
+    triangle.speed_x = 0.75f;
+    triangle.speed_y = 0.75f;
+    triangle.last_position_x = x_pos;
+    triangle.last_position_y = y_pos;
+    triangle.hit_something = false;
+}
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4);
-
-    std::unique_ptr<displayObjects> display_objects = glhelpers::getDisplayObjects();
-    GLFWwindow* window = glhelpers::glfwCreatePrimaryWindow(
-        display_objects->vidmode->width/2, display_objects->vidmode->width/3,
-        "OpenGL program that hasn't rendered anything yet",
-        NULL, NULL
-    );
-    if (!window) {
-        GL_LOG_ERROR() << "ERROR: could not open window with GLFW3";
-        glfwTerminate();
-        return 1;
+void randomizeColors(bouncingTriangle& triangle) {
+    for (size_t i = 0; i < sizeof(triangle.cmatrix) / sizeof(GLfloat); i++) {
+        triangle.cmatrix[i] = (GLfloat)(rand() % 100) / 100;
     }
-    glfwMakeContextCurrent(window);
+}
 
-    if (gl3wInit()) {
-       GL_LOG_ERROR()  << "OH NO INDEPENDENCE DAY (gl3wInit failed)";
+// safe to run on any thread, rand() is left to randomizeColors()
+void moveTriangle(bouncingTriangle& triangle, double elapsed_seconds) {
+    const GLfloat SPEED_LIMIT = 1.25;
+
+    // reverse direction when going too far left, right, up or down
+    if (fabs(triangle.last_position_x) > WALL_POSITION ||
+        fabs(triangle.last_position_y) > WALL_POSITION) {
+        // Randomize matrix and transform colors with it
+        triangle.hit_something = true;
+
+        if (fabs(triangle.last_position_x) > WALL_POSITION) {
+            // x direction gets to speed up a little bit to prevent "loops"
+            if (triangle.speed_x >= SPEED_LIMIT) {
+                triangle.speed_x = (triangle.speed_x < -1) ? 0.75f : -0.75f;
+            } else {
+                triangle.speed_x = -(triangle.speed_x + 0.2f);
+            }
+            triangle.last_position_x += (elapsed_seconds * triangle.speed_x);
+        }
+        if (fabs(triangle.last_position_y) > WALL_POSITION) {
+            triangle.speed_y = -triangle.speed_y;
+            triangle.last_position_y += (elapsed_seconds * triangle.speed_y);
+        }
     }
 
-    glEnable(GL_DEBUG_OUTPUT);
-    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-    glDebugMessageCallback(gldebug::glDebugCallback, nullptr);
-    glfwSetErrorCallback(gldebug::glfwErrorCallback);
-    glfwSetWindowSizeCallback(window, 
-            glhelpers::glfw_primary_window_size_callback);
-    glfwSetFramebufferSizeCallback(window, 
-            glhelpers::glfw_default_framebuffer_size_callback);
-    GL_LOG_RESET();
-    /* gldebug::logGLParams(); */
-
-    const GLubyte* renderer = glGetString(GL_RENDERER);
-    const GLubyte* version = glGetString(GL_VERSION);
-    GL_LOG_INFO() << "Renderer: " << renderer;
-    GL_LOG_INFO() << "OpenGL version supported: " << version;
-
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-
-    // Seed random values and generate for x and y positions
-    srand(time(NULL));
-    float X_POS = (float)(rand() % 100) / 200;
-    float Y_POS = (float)(rand() % 100) / 200;
-
-    glm::vec3 vectors[] = {
-        glm::vec3( 0.0f,  0.5f,  0.0f),
-        glm::vec3( 0.5f, -0.5f,  0.0f),
-        glm::vec3(-0.5f, -0.5f,  0.0f)
-    };
+    // update matrix
+    triangle.matrix[3][0] = (elapsed_seconds * triangle.speed_x) + triangle.last_position_x;
+    triangle.last_position_x = triangle.matrix[3][0];
+    triangle.matrix[3][1] = (elapsed_seconds * triangle.speed_y) + triangle.last_position_y;
+    triangle.last_position_y = triangle.matrix[3][1];
+}
 
-    GLfloat colors[] = {
-         1.0f,  0.0f,  0.0f,
-         0.0f,  1.0f,  0.0f,
-         0.0f,  0.0f,  1.0f,
-    };
+class DvdTriangleScene : public Scene {
+    public:
+        explicit DvdTriangleScene(int n_triangles)
+            : n_triangles(n_triangles),
+              // Spatial index over the playfield, used to cull triangles outside the view
+              grid(SpatialGrid::fitted(
+                  aabb2d{ -1.0f, -1.0f, 1.0f, 1.0f }, 2.0f * TRIANGLE_HALF_EXTENT
+              )) {}
+
+        const char* name() const override {
+            return "dvd_triangle";
+        }
 
-    GLfloat cmatrix[] = {
-         1.0f,  0.0f, 0.0f,
-         0.0f,  1.0f, 0.0f,
-         0.0f,  0.0f, 1.0f,
-         0.0f,  0.0f, 0.0f,
-    };
+        sceneSettings settings() const override {
+            sceneSettings settings;
+            settings.window.title = "dvd_triangle";
+            // flat triangles, the one drawn last is on top
+            settings.window.depth_buffer = false;
+            return settings;
+        }
 
-    glm::mat4 matrix{
-         0.5f,  0.0f, 0.0f, 0.0f,
-         0.0f,  0.5f, 0.0f, 0.0f,
-         0.0f,  0.0f, 0.5f, 0.0f,
-        X_POS, Y_POS, 0.0f, 1.0f,
-    };
+        bool init(Runtime& runtime) override {
+            // Seed random values, every run starts from fresh triangles unless it is a replay
+            srand((unsigned)runtime.randomSeed());
+            this->triangles.assign(this->n_triangles, bouncingTriangle());
+            for (bouncingTriangle& triangle : this->triangles) {
+                initTriangle(triangle);
+            }
 
-    // VBOs
-    GLuint points_vbo, colors_vbo;
-    glhelpers::ufloat_ptr points = glhelpers::flatten(vectors, sizeof(vectors));
-
-    glGenBuffers(1, &points_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vectors), points.get(), GL_STATIC_DRAW);
-    glGenBuffers(1, &colors_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(colors), colors, GL_STATIC_DRAW);
-
-    // VAO
-    GLuint vao;
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-    glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-
-    /* Shader program initialization logic */
-    std::unique_ptr<shaderSrc> vertex_src, fragment_src;
-    vertex_src = glhelpers::load_shader_file(
-        GL_VERTEX_SHADER, "res/shaders/vertex.glsl"
-    );
-    fragment_src = glhelpers::load_shader_file(
-        GL_FRAGMENT_SHADER, "res/shaders/fragment.glsl"
-    );
-    GLuint vs = glhelpers::compile_shaderSrc(vertex_src.get());
-    GLuint fs = glhelpers::compile_shaderSrc(fragment_src.get());
-
-    // Combine compiled shaders into GPU shader program and link it
-    GLuint shader_prog = glCreateProgram();
-    glAttachShader(shader_prog, vs);
-    glAttachShader(shader_prog, fs);
-    glhelpers::gl_link_program(shader_prog);
-
-    // Send matrix to shader
-    int matrix_location = glGetUniformLocation(shader_prog, "matrix");
-    int cmatrix_location = glGetUniformLocation(shader_prog, "cmatrix");
-    glUseProgram(shader_prog);
-    glUniformMatrix4fv(matrix_location, 1, GL_FALSE, glm::value_ptr(matrix));
-    glUniformMatrix3fv(cmatrix_location, 1, GL_FALSE, cmatrix);
-
-    // Render loop
-    static double previous_seconds = glfwGetTime();
-    double current_seconds = glfwGetTime();
-    double elapsed_seconds = current_seconds - previous_seconds;
-
-    GLfloat speed_x = 0.75f;
-    GLfloat speed_y = 0.75f;
-    GLfloat SPEED_LIMIT = 1.25;
-    GLfloat last_position_x = X_POS;
-    GLfloat last_position_y = Y_POS;
-    glhelpers::SimpleTimer timer = glhelpers::SimpleTimer();
-    while (!glfwWindowShouldClose(window)) {
-        glhelpers::update_fps_counter(window);
-
-        // timer for doing animation
-        timer.update();
-
-        // reverse direction when going too far left, right, up or down
-        if (fabs(last_position_x) > 0.75f || fabs(last_position_y) > 0.75f) {
-            // Randomize matrix and transform colors with it
-            for (int i = 0; i < sizeof(cmatrix) / sizeof(GLfloat); i++) {
-                cmatrix[i] = (GLfloat)(rand() % 100) / 100;
+            glm::vec3 vectors[] = {
+                glm::vec3( 0.0f,  0.5f,  0.0f),
+                glm::vec3( 0.5f, -0.5f,  0.0f),
+                glm::vec3(-0.5f, -0.5f,  0.0f),
+            };
+            GLfloat colors[] = {
+                 1.0f,  0.0f,  0.0f,
+                 0.0f,  1.0f,  0.0f,
+                 0.0f,  0.0f,  1.0f,
+            };
+
+            // VBOs
+            ArenaScope scratch(soupcans::scratchArena());
+            float* points = soupcans::flattenInto(soupcans::scratchArena(), vectors, sizeof(vectors));
+            glGenBuffers(1, &this->points_vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, this->points_vbo);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(vectors), points, GL_STATIC_DRAW);
+            glGenBuffers(1, &this->colors_vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, this->colors_vbo);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(colors), colors, GL_STATIC_DRAW);
+
+            // VAO
+            glGenVertexArrays(1, &this->vao);
+            glBindVertexArray(this->vao);
+            glBindBuffer(GL_ARRAY_BUFFER, this->points_vbo);
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+            glBindBuffer(GL_ARRAY_BUFFER, this->colors_vbo);
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+            glEnableVertexAttribArray(0);
+            glEnableVertexAttribArray(1);
+
+            this->shader_prog = runtime.loadShaderProgram(
+                "shaders/vertex.glsl", "shaders/fragment.glsl"
+            );
+            if (!this->shader_prog) {
+                return false;
             }
 
-            if (fabs(last_position_x) > 0.75f) {
-                // x direction gets to speed up a little bit to prevent "loops"
-                if (speed_x >= SPEED_LIMIT) {
-                    speed_x = (speed_x < -1) ? 0.75f : -0.75f;
-                } else {
-                    speed_x = -(speed_x + 0.2f);
+            // Look up uniforms, they get set per triangle in render()
+            this->matrix_location = glGetUniformLocation(this->shader_prog, "matrix");
+            this->cmatrix_location = glGetUniformLocation(this->shader_prog, "cmatrix");
+
+            this->draw_list.clear();
+            this->draw_list.reserve(this->n_triangles);
+
+            // Triangles bounce off each other as circles around their centers
+            this->collisions.reset(new CollisionWorld(
+                aabb2d{ -1.0f, -1.0f, 1.0f, 1.0f }, TRIANGLE_HALF_EXTENT, &runtime.jobs()
+            ));
+            this->collisions->bodies().resize(this->n_triangles);
+            return true;
+        }
+
+        void update(Runtime& runtime, double elapsed_seconds) override {
+            JobSystem& jobs = runtime.jobs();
+            CollisionWorld& collisions = *this->collisions;
+            std::vector<bouncingTriangle>& triangles = this->triangles;
+            uint32_t n_triangles = this->n_triangles;
+
+            // bounds only live for this frame
+            aabb2d* triangle_bounds = runtime.frameArena().allocateArray<aabb2d>(n_triangles);
+
+            uint32_t grain = jobs.grainFor(n_triangles);
+            jobs.parallelFor(0, n_triangles, grain, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; i++) {
+                    moveTriangle(triangles[i], elapsed_seconds);
+                    collisionBody& body = collisions.bodies()[i];
+                    body.x = triangles[i].last_position_x;
+                    body.y = triangles[i].last_position_y;
+                    body.vx = triangles[i].speed_x;
+                    body.vy = triangles[i].speed_y;
+                    body.radius = TRIANGLE_HALF_EXTENT;
+                    body.inv_mass = 1.0f;
+                }
+            });
+            collisions.step();
+
+            jobs.parallelFor(0, n_triangles, grain, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; i++) {
+                    const collisionBody& body = collisions.bodies()[i];
+                    triangles[i].matrix[3][0] = triangles[i].last_position_x = body.x;
+                    triangles[i].matrix[3][1] = triangles[i].last_position_y = body.y;
+                    triangles[i].speed_x = body.vx;
+                    triangles[i].speed_y = body.vy;
+                    if (collisions.impact(i) > 0.0f) {
+                        triangles[i].hit_something = true;
+                    }
+                    triangle_bounds[i] = soupcans::aabbAround(
+                        triangles[i].last_position_x, triangles[i].last_position_y,
+                        TRIANGLE_HALF_EXTENT, TRIANGLE_HALF_EXTENT
+                    );
+                }
+            });
+            // rand() stays on this thread so a seed always gives the same colors
+            for (bouncingTriangle& triangle : triangles) {
+                if (triangle.hit_something) {
+                    randomizeColors(triangle);
+                    triangle.hit_something = false;
                 }
-                last_position_x += (timer.getElapsedSeconds() * speed_x);
-            }
-            if (fabs(last_position_y) > 0.75f) {
-                speed_y = -speed_y;
-                last_position_y += (timer.getElapsedSeconds() * speed_y);
             }
+            this->grid.rebuild(triangle_bounds, n_triangles);
+            this->grid.cullVisible(soupcans::NDC_VIEW, this->draw_list, jobs);
         }
 
-        // update matrix
-        matrix[3][0] = (timer.getElapsedSeconds() * speed_x) + last_position_x;
-        last_position_x = matrix[3][0];
-        matrix[3][1] = (timer.getElapsedSeconds() * speed_y) + last_position_y;
-        last_position_y = matrix[3][1];
-        glUseProgram(shader_prog);
-        glUniformMatrix4fv(matrix_location, 1, GL_FALSE, glm::value_ptr(matrix));
-        glUniformMatrix3fv(cmatrix_location, 1, GL_FALSE, cmatrix);
-
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glViewport(0, 0, 
-                glhelpers::get_glfw_primary_window_width(), 
-                glhelpers::get_glfw_primary_window_height());
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
-        glfwPollEvents();
-        glfwSwapBuffers(window);
-
-        if (GLFW_PRESS == glfwGetKey(window, GLFW_KEY_ESCAPE)) {
-            glfwSetWindowShouldClose(window, 1);
+        void render(Runtime& runtime) override {
+            runtime.beginRenderPass(soupcans::flatPass());
+            glUseProgram(this->shader_prog);
+            glBindVertexArray(this->vao);
+            for (uint32_t id : this->draw_list) {
+                glUniformMatrix4fv(this->matrix_location, 1, GL_FALSE,
+                    glm::value_ptr(this->triangles[id].matrix));
+                glUniformMatrix3fv(this->cmatrix_location, 1, GL_FALSE,
+                    this->triangles[id].cmatrix);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+            runtime.endRenderPass();
         }
-    }
 
-    glfwTerminate();
+        void shutdown(Runtime& runtime) override {
+            (void)runtime;
+            this->collisions.reset();
+            glDeleteProgram(this->shader_prog);
+            glDeleteVertexArrays(1, &this->vao);
+            glDeleteBuffers(1, &this->points_vbo);
+            glDeleteBuffers(1, &this->colors_vbo);
+        }
 
-    return 0;
+    private:
+        uint32_t n_triangles;
+        std::vector<bouncingTriangle> triangles;
+        SpatialGrid grid;
+        std::vector<uint32_t> draw_list;
+        std::unique_ptr<CollisionWorld> collisions;
+
+        GLuint points_vbo, colors_vbo, vao;
+        GLuint shader_prog;
+        int matrix_location, cmatrix_location;
+};
+
+// triangle count can be given on the command line
+std::unique_ptr<Scene> soupcans::createDvdTriangleScene(int argc, char** argv) {
+    int n_triangles = (argc > 1) ? atoi(argv[1]) : 1;
+    if (n_triangles < 1) {
+        n_triangles = 1;
+    }
+    return std::unique_ptr<Scene>(new DvdTriangleScene(n_triangles));
 }
@@ -1,236 +1,319 @@
-#include <array>
-#include <iostream>
-#include <fstream>
-#include <string>
-#include <sstream>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
 
 #include <GL/gl3w.h>
 #include <GLFW/glfw3.h>
 #include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/ext/matrix_transform.hpp>
+#include <stb/stb_image.h>
 
-#include "../include/glDebug.hpp"
 #include "../include/glHelpers.hpp"
-#include "../include/cube.hpp"
-#include "../include/stb_image.hpp"
+#include "../common/imageDecode.hpp"
+#include "../common/transform.hpp"
+#include "../runtime/runtime.hpp"
+#include "../runtime/sceneList.hpp"
+#include "../runtime/shaderPermutations.hpp"
+
+using soupcans::jobCounter;
+using soupcans::Runtime;
+using soupcans::Scene;
+using soupcans::sceneSettings;
+using soupcans::SAMPLER_ANISOTROPIC;
+using soupcans::ShaderPermutations;
+using soupcans::textureArrayInfo;
+using soupcans::textureArrayLayer;
+using soupcans::TextureRegistry;
+
+// #defines in fifth.frag, one program per combination the M key cycles through
+enum cubeShaderFeature : uint32_t {
+    TEXTURED = 1u << 0,
+    VERTEX_COLOR = 1u << 1,
+    // no color at all, for the depth prepass
+    DEPTH_ONLY = 1u << 2
+};
+static const char* const CUBE_SHADER_FEATURES[] = { "TEXTURED", "VERTEX_COLOR", "DEPTH_ONLY" };
+static const uint32_t CUBE_SHADER_MODES[] = { TEXTURED, VERTEX_COLOR, TEXTURED | VERTEX_COLOR };
+static const int N_CUBE_SHADER_MODES = 3;
+
+class ImageCubeScene : public Scene {
+    public:
+        ImageCubeScene(int n_cubes, const std::vector<std::string>& extra_images,
+                       bool depth_prepass)
+            : n_cubes(n_cubes), extra_images(extra_images), depth_prepass(depth_prepass),
+              owns_array(false), shaders("shaders/fifth.vert", "shaders/fifth.frag", CUBE_SHADER_FEATURES, 3) {}
+
+        const char* name() const override {
+            return "image_cube";
+        }
 
-// structs defined in glhelpers.hpp for convient grouping of things
-using glhelpers::displayObjects;
-using glhelpers::shaderSrc;
+        sceneSettings settings() const override {
+            sceneSettings settings;
+            settings.window.title = "image_cube";
+            return settings;
+        }
 
-int main() {
-    if (!glfwInit()) {
-        GL_LOG_ERROR() << "ERROR: could not start GLFW3";
-        return 1;
-    }
+        bool init(Runtime& runtime) override {
+            // Decode every image on the workers while the buffers and shaders get set up
+            this->image_paths.assign(1, runtime.resourcePath("img/container.jpg"));
+            this->image_paths.insert(this->image_paths.end(), this->extra_images.begin(),
+                                     this->extra_images.end());
+            int n_images = static_cast<int>(this->image_paths.size());
+            std::vector<textureArrayLayer> layers(n_images, textureArrayLayer{});
+            // named after its images, so video wall panels showing the same ones share it
+            this->array_name = "image_cube";
+            for (const std::string& path : this->extra_images) {
+                this->array_name += "|" + path;
+            }
+            const textureArrayInfo* shared_array =
+                runtime.textures().findArray(this->array_name.c_str());
+            this->owns_array = !shared_array;
+            jobCounter images_decoded;
+            for (int i = 0; i < n_images && !shared_array; i++) {
+                textureArrayLayer* layer = &layers[i];
+                const char* path = this->image_paths[i].c_str();
+                runtime.jobs().run([layer, path]() {
+                    layer->pixels = soupcans::decodeImageFile(
+                        path, &layer->width, &layer->height, &layer->n_channels
+                    );
+                }, &images_decoded);
+            }
+
+            /* Matrices and 3d object initialization */
+            float scale = 0.3f;
+            float wcorr = glhelpers::WIDESCREEN_SCALING_DIVISOR; // correction factor for widescreen
+            this->model = glm::mat4{
+                 scale,         0.0f,   0.0f, 0.0f,
+                  0.0f,  scale/wcorr,   0.0f, 0.0f,
+                  0.0f,         0.0f,  scale, 0.0f,
+                  0.0f,         0.0f,   0.0f, 1.0f
+            };
+
+            /* The cube with its corner colors and texture coordinates, packed by
+               tools/meshpack from res/meshes/cube.obj */
+            if (!runtime.loadMesh("meshes/cube.smsh", &this->cube)) {
+                // the decoders still write into layers
+                runtime.jobs().wait(&images_decoded);
+                for (const textureArrayLayer& layer : layers) {
+                    stbi_image_free(const_cast<unsigned char*>(layer.pixels));
+                }
+                return false;
+            }
+
+            // Per cube: grid offset in xy, scale and which image it shows
+            int columns = static_cast<int>(ceil(sqrt(static_cast<double>(this->n_cubes))));
+            int rows = (this->n_cubes + columns - 1) / columns;
+            float cube_scale = 1.0f / ((columns > rows) ? columns : rows);
+            std::vector<glm::vec4> instances(this->n_cubes);
+            for (int i = 0; i < this->n_cubes; i++) {
+                int column = i % columns, row = i / columns;
+                instances[i] = glm::vec4(
+                    (column - 0.5f * (columns - 1)) * (2.0f / columns),
+                    (0.5f * (rows - 1) - row) * (2.0f / rows),
+                    cube_scale, static_cast<float>(i % n_images)
+                );
+            }
+            glGenBuffers(1, &this->instance_buffer);
+            glBindBuffer(GL_ARRAY_BUFFER, this->instance_buffer);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec4) * instances.size(),
+                instances.data(), GL_STATIC_DRAW
+            );
+            // onto the cube's vertex array, loadMesh() left it bound
+            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+            glVertexAttribDivisor(3, 1);
+            glEnableVertexAttribArray(3);
+
+            // every mode is built now, so switching is only a glUseProgram
+            bool shaders_built = this->shaders.warm(runtime, CUBE_SHADER_MODES,
+                                                    N_CUBE_SHADER_MODES);
+            if (this->depth_prepass) {
+                GLuint depth_program = this->shaders.get(runtime, DEPTH_ONLY);
+                shaders_built = shaders_built && depth_program;
+                this->depth_transform_location = glGetUniformLocation(depth_program, "transform");
+            }
+
+            /* Every image goes into a layer of one texture array the size of the
+               container image, so all the cubes draw with a single bind */
+            runtime.jobs().wait(&images_decoded);
+            for (int i = 0; i < n_images && !shared_array; i++) {
+                if (!layers[i].pixels) {
+                    SOUP_LOG_ERROR("Failed to load image %s", this->image_paths[i].c_str());
+                }
+            }
+            if (!shared_array && layers[0].pixels &&
+                runtime.textures().uploadArray(this->array_name.c_str(), layers.data(), n_images,
+                                               layers[0].width, layers[0].height)) {
+                // over a texture budget the array can be evicted, the images are still on disk
+                runtime.textures().setLoader(this->array_name.c_str(), reloadImages, this);
+            }
+            for (const textureArrayLayer& layer : layers) {
+                stbi_image_free(const_cast<unsigned char*>(layer.pixels));
+            }
+            if (!shaders_built) {
+                return false;
+            }
+
+            /* Misc. setup for render loop */
+            this->theta = 1;
+            this->rotational_velocity = 1;
+            this->mode = 0;
+            this->mode_held = false;
+            this->paused = false;
+            this->pause_held = false;
+
+            for (int i = 0; i < N_CUBE_SHADER_MODES; i++) {
+                GLuint program = this->shaders.get(runtime, CUBE_SHADER_MODES[i]);
+                this->transform_locations[i] = glGetUniformLocation(program, "transform");
+            }
+            return true;
+        }
 
-    /* Window hints */
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_SAMPLES, 4);
-
-    /* Video mode, window, display */
-    std::unique_ptr<displayObjects> display_objects = glhelpers::getDisplayObjects();
-    GLFWwindow* window = glhelpers::glfwCreatePrimaryWindow(
-        display_objects->vidmode->width/2, display_objects->vidmode->height/2,
-        "OpenGL program that hasn't rendered anything yet",
-        NULL, NULL
-    );
-    if (!window) {
-        GL_LOG_ERROR() << "ERROR: could not open window with GLFW3";
-        glfwTerminate();
-        return 1;
-    }
-    glfwMakeContextCurrent(window);
+        void update(Runtime& runtime, double dt) override {
+            (void)dt;
+            this->readModeKey(runtime);
+            // P stops the cubes, and with them every frame until the next key press
+            bool pause = runtime.keyPressed(GLFW_KEY_P);
+            if (pause && !this->pause_held) {
+                this->paused = !this->paused;
+            }
+            this->pause_held = pause;
+            if (this->paused) {
+                return;
+            }
+            this->theta = (this->theta < 360) ? this->theta + this->rotational_velocity :
+                                                this->theta + this->rotational_velocity - 360;
+        }
 
-    /* Initialize extension wrangler library */
-    if (gl3wInit()) {
-       GL_LOG_ERROR()  << "OH NO INDEPENDENCE DAY (gl3wInit failed)";
-    }
+        bool animating() const override {
+            return !this->paused;
+        }
 
-    /* Debugging */
-    glEnable(GL_DEBUG_OUTPUT);
-    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-    glDebugMessageCallback(gldebug::glDebugCallback, nullptr);
-    glfwSetErrorCallback(gldebug::glfwErrorCallback);
-    //gldebug::logGLParams(); // uncomment to log graphics hardware limits
-
-    /* Initialize a new log and populate with version info */
-    GL_LOG_RESET();
-    GL_LOG_INFO() << "Renderer: " << glGetString(GL_RENDERER);
-    GL_LOG_INFO() << "OpenGL version supported: " << glGetString(GL_VERSION);
-
-    /* Callbacks for non-debugging functions */
-    glfwSetWindowSizeCallback(window, glhelpers::glfw_primary_window_size_callback);
-    glfwSetFramebufferSizeCallback(window, glhelpers::glfw_default_framebuffer_size_callback);
-
-    /* Misc. setup calls to OpenGL's API */
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-
-    /* Matrices and 3d object initialization */
-    float scale = 0.3f;
-    float wcorr = glhelpers::WIDESCREEN_SCALING_DIVISOR; // correction factor for widescreen
-    glm::mat4 model{
-         scale,         0.0f,   0.0f, 0.0f,
-          0.0f,  scale/wcorr,   0.0f, 0.0f,
-          0.0f,         0.0f,  scale, 0.0f,
-          0.0f,         0.0f,   0.0f, 1.0f
-    };
-    float* obj_x = &model[3][0];
-    float* obj_y = &model[3][1];
-
-    float color_vectors[] = {
-        0.22f, 0.00f, 0.23f,
-        0.00f, 0.44f, 0.00f,
-        0.01f, 0.00f, 0.58f,
-        1.00f, 0.11f, 0.00f,
-        0.26f, 1.00f, 0.59f,
-        0.00f, 0.00f, 1.00f,
-        0.55f, 0.00f, 0.56f,
-        0.00f, 0.64f, 0.00f,
-    };
-
-    // Load container image into a texture
-    int width, height, nrChannels;
-    unsigned char *container_img_data = stbi_load("res/img/container.jpg", &width, &height, 
-            &nrChannels, 0);
-    unsigned int texture;
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    if (container_img_data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-                GL_UNSIGNED_BYTE, container_img_data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-    } else {
-        printf("Failed to load image\n");
-    }
-    stbi_image_free(container_img_data);
-
-    //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    //glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    /* Binding for our 3d objects */
-    unsigned int vertex_arr;
-    unsigned int vertex_buffer, color_buffer, element_buffer;
-
-    glGenVertexArrays(1, &vertex_arr);
-    glBindVertexArray(vertex_arr);
-
-    glGenBuffers(1, &color_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, color_buffer);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(color_vectors)*3, 
-        color_vectors, GL_STATIC_DRAW
-    );
-
-    glGenBuffers(1, &vertex_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-    glBufferData(GL_ARRAY_BUFFER, glshapes::SIZE_IMAGE_CUBE_VERTICES*5,
-        glshapes::IMAGE_CUBE_VERTICES, GL_STATIC_DRAW
-    );
-
-    glGenBuffers(1, &element_buffer);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, glshapes::SIZE_IMAGE_CUBE_INDICES,
-        glshapes::IMAGE_CUBE_INDICES, GL_STATIC_DRAW);
-
-
-    glBindBuffer(GL_ARRAY_BUFFER, color_buffer);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float)*5, nullptr);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(float)*5, 
-            (void*)(3*sizeof(float)));
-
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-
-    /* Shader program initialization logic */
-    std::unique_ptr<shaderSrc> vertex_src, fragment_src;
-    vertex_src = glhelpers::load_shader_file(
-        GL_VERTEX_SHADER, "res/shaders/fifth.vert"
-    );
-    fragment_src = glhelpers::load_shader_file(
-        GL_FRAGMENT_SHADER, "res/shaders/fifth.frag"
-    );
-    GLuint vs = glhelpers::compile_shaderSrc(vertex_src.get());
-    GLuint fs = glhelpers::compile_shaderSrc(fragment_src.get());
-
-    /* Link the shader program and use it*/
-    GLuint shader_prog = glCreateProgram();
-    glAttachShader(shader_prog, vs);
-    glAttachShader(shader_prog, fs);
-    glhelpers::gl_link_program(shader_prog);
-
-    /* Misc. setup for render loop */
-    size_t n_elements = glshapes::SIZE_IMAGE_CUBE_INDICES/sizeof(unsigned);
-
-    int theta = 1;
-    int rotational_velocity = 1;
-
-    glm::mat4 rotation_matrix = (
-        glhelpers::rot3d_matrix(theta, 'x') * glhelpers::rot3d_matrix(theta, 'y')
-    );
-    glUseProgram(shader_prog);
-    int model_location = glGetUniformLocation(shader_prog, "model");
-    int rot_location = glGetUniformLocation(shader_prog, "rotation");
-    glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(rot_location, 1, GL_FALSE, glm::value_ptr(rotation_matrix));
-    // glBindBuffer(GL_ARRAY_BUFFER, vposition_buffer);
-    // glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, element_buffer);
-    // glBindBuffer(GL_ARRAY_BUFFER, cube_data_buffer);
-    // glBindVertexArray(vertex_arr);
-
-    glhelpers::SimpleTimer timer = glhelpers::SimpleTimer();
-
-    /* Render loop */
-    while (!glfwWindowShouldClose(window)) {
-        glhelpers::update_fps_counter(window);
-        timer.update();
-        
-        glUniformMatrix4fv(model_location, 1, GL_FALSE, glm::value_ptr(model));
-        glm::mat4 rotation_matrix = (
-            glhelpers::rot3d_matrix(theta, 'x') * glhelpers::rot3d_matrix(theta, 'y')
-        );
-        glUniformMatrix4fv(rot_location, 1, GL_FALSE, 
-            glm::value_ptr(rotation_matrix)
-        );
-        glBindTexture(GL_TEXTURE_2D, texture);
-
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glViewport(0, 0, 
-                glhelpers::get_glfw_primary_window_width(), 
-                glhelpers::get_glfw_primary_window_height());
-
-        /* Draw objects here */
-        glDrawElements(GL_TRIANGLES, n_elements, GL_UNSIGNED_INT, nullptr);
-
-        glfwPollEvents();
-        glfwSwapBuffers(window);
-
-        if (GLFW_PRESS == glfwGetKey(window, GLFW_KEY_ESCAPE)) {
-            glfwSetWindowShouldClose(window, 1);
+        // the mode is only a program switch, so a late press still makes this frame
+        void lateLatch(Runtime& runtime) override {
+            this->readModeKey(runtime);
         }
 
-        theta = (theta < 360) ? theta + rotational_velocity : 
-                                theta + rotational_velocity - 360;
-    }
+        void render(Runtime& runtime) override {
+            runtime.beginRenderPass(soupcans::depthTestedPass());
+            glBindVertexArray(this->cube.vertex_array);
+            soupcans::mat4f transform = soupcans::quatToMat4(soupcans::quatMultiply(
+                soupcans::quatDegrees(soupcans::AXIS_X, this->theta),
+                soupcans::quatDegrees(soupcans::AXIS_Y, this->theta)
+            ));
+            soupcans::multiplyMat4(glm::value_ptr(this->model), transform.m, transform.m);
+
+            /* With the prepass, the far faces of each cube never get to
+               sample the texture array; only the nearest surface is shaded */
+            if (this->depth_prepass) {
+                glUseProgram(this->shaders.get(runtime, DEPTH_ONLY));
+                glUniformMatrix4fv(this->depth_transform_location, 1, GL_FALSE, transform.m);
+                soupcans::beginDepthPrepass();
+                glDrawElementsInstanced(GL_TRIANGLES, this->cube.n_indices,
+                    this->cube.index_type, nullptr, this->n_cubes
+                );
+                soupcans::endDepthPrepass();
+            }
+
+            glUseProgram(this->shaders.get(runtime, CUBE_SHADER_MODES[this->mode]));
+            glUniformMatrix4fv(this->transform_locations[this->mode], 1, GL_FALSE, transform.m);
+            // the faces turn away from the camera, anisotropic filtering keeps them sharp
+            runtime.textures().bindArray(0, runtime.textures().useArray(this->array_name.c_str()),
+                                         SAMPLER_ANISOTROPIC);
+
+            /* Draw objects here */
+            glDrawElementsInstanced(GL_TRIANGLES, this->cube.n_indices, this->cube.index_type,
+                nullptr, this->n_cubes
+            );
+            runtime.endRenderPass();
+        }
+
+        void shutdown(Runtime& runtime) override {
+            if (this->owns_array) {
+                // video wall panels can still be drawing it, but this scene is going
+                runtime.textures().setLoader(this->array_name.c_str(), nullptr, nullptr);
+            }
+            this->shaders.clear();
+            soupcans::deleteMesh(&this->cube);
+            glDeleteBuffers(1, &this->instance_buffer);
+        }
 
-    glfwTerminate();
+    private:
+        int n_cubes;
+        std::vector<std::string> extra_images;
+        bool depth_prepass;
+        glm::mat4 model;
+        int theta;
+        int rotational_velocity;
+        int mode;
+        bool mode_held;
+        bool paused;
+        bool pause_held;
+
+        soupcans::gpuMesh cube;
+        GLuint instance_buffer;
+        std::vector<std::string> image_paths;
+        std::string array_name;
+        bool owns_array;
+        ShaderPermutations shaders;
+        int transform_locations[N_CUBE_SHADER_MODES];
+        int depth_transform_location;
+
+        // the same decode init() does, on the thread that found the array evicted
+        static bool reloadImages(TextureRegistry& textures, const char* name, void* user_data) {
+            ImageCubeScene* scene = static_cast<ImageCubeScene*>(user_data);
+            std::vector<textureArrayLayer> layers(scene->image_paths.size(), textureArrayLayer{});
+            for (size_t i = 0; i < layers.size(); i++) {
+                layers[i].pixels = soupcans::decodeImageFile(
+                    scene->image_paths[i].c_str(), &layers[i].width, &layers[i].height,
+                    &layers[i].n_channels
+                );
+            }
+            bool reloaded = layers[0].pixels && textures.uploadArray(
+                name, layers.data(), static_cast<int>(layers.size()),
+                layers[0].width, layers[0].height
+            );
+            for (const textureArrayLayer& layer : layers) {
+                stbi_image_free(const_cast<unsigned char*>(layer.pixels));
+            }
+            return reloaded;
+        }
 
-    return 0;
+        void readModeKey(Runtime& runtime) {
+            bool next_mode = runtime.keyPressed(GLFW_KEY_M);
+            if (next_mode && !this->mode_held) {
+                this->mode = (this->mode + 1) % N_CUBE_SHADER_MODES;
+            }
+            this->mode_held = next_mode;
+        }
+};
+
+/* Cube count, then any extra images for the cubes to cycle through.
+   --depth-prepass lays down depth first, see beginDepthPrepass().
+*/
+std::unique_ptr<Scene> soupcans::createImageCubeScene(int argc, char** argv) {
+    const char* count = nullptr;
+    bool depth_prepass = false;
+    std::vector<std::string> extra_images;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--depth-prepass") == 0) {
+            depth_prepass = true;
+        } else if (!count) {
+            count = argv[i];
+        } else {
+            extra_images.push_back(argv[i]);
+        }
+    }
+    int n_cubes = count ? atoi(count) : 1;
+    if (n_cubes < 1) {
+        n_cubes = 1;
+    }
+    return std::unique_ptr<Scene>(new ImageCubeScene(n_cubes, extra_images, depth_prepass));
 }
@@ -0,0 +1,6 @@
+#include "../runtime/runtime.hpp"
+#include "../runtime/sceneList.hpp"
+
+int main(int argc, char** argv) {
+    return soupcans::runSceneMain(argc, argv, soupcans::createImageCubeScene);
+}
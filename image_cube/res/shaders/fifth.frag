@@ -2,12 +2,22 @@
 
 in vec3 color;
 in vec2 tex_coord;
+flat in float layer;
 out vec4 frag_color;
 
-uniform sampler2D cubeTexture; 
+// TEXTURED, VERTEX_COLOR and DEPTH_ONLY are #defined per variant by the scene
+#ifdef TEXTURED
+uniform sampler2DArray cubeTexture;
+#endif
 
 void main() {
-    // frag_color = vec4(color, 1.0); 
-    frag_color = texture(cubeTexture, tex_coord); 
-    // frag_color = texture(inaTexture, tex_coord) * vec4(color, 1.0); 
+#if defined(DEPTH_ONLY)
+    // the depth prepass only wants depth, color writes are masked off anyway
+#elif defined(TEXTURED) && defined(VERTEX_COLOR)
+    frag_color = texture(cubeTexture, vec3(tex_coord, layer)) * vec4(color, 1.0);
+#elif defined(TEXTURED)
+    frag_color = texture(cubeTexture, vec3(tex_coord, layer));
+#else
+    frag_color = vec4(color, 1.0);
+#endif
 }
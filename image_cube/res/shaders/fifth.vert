@@ -3,15 +3,22 @@
 layout(location = 0) in vec3 vertex_position;
 layout(location = 1) in vec3 vertex_color;
 layout(location = 2) in vec2 texture_coord;
+// per cube: xy offset, scale, texture array layer
+layout(location = 3) in vec4 instance;
 
-uniform mat4 model;
-uniform mat4 rotation;
+// model * rotation
+uniform mat4 transform;
 
 out vec3 color;
 out vec2 tex_coord;
+flat out float layer;
+// the depth prepass and the shading pass must land on exactly the same depths
+invariant gl_Position;
 
 void main() {
     color = vertex_color;
     tex_coord = texture_coord;
-    gl_Position = model * rotation * vec4(vertex_position, 1.0); 
+    layer = instance.w;
+    gl_Position = transform * vec4(vertex_position * instance.z, 1.0)
+                + vec4(instance.xy, 0.0, 0.0);
 }
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <math.h>
+
+#include <memory>
+
+#include <GL/gl3w.h>
+#include <GLFW/glfw3.h>
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../runtime/runtime.hpp"
+#include "../runtime/sceneList.hpp"
+
+using soupcans::ArenaScope;
+using soupcans::Runtime;
+using soupcans::Scene;
+using soupcans::sceneSettings;
+
+// the quad covers the whole window, so there is nothing to clear and no depth
+static const soupcans::renderPassDesc QUAD_PASS = soupcans::flatPass(soupcans::LOAD_DONT_CARE);
+
+class RotatingColorsScene : public Scene {
+	public:
+		const char* name() const override {
+			return "rotating_colors";
+		}
+
+		sceneSettings settings() const override {
+			sceneSettings settings;
+			settings.window.title = "rotating_colors";
+			settings.window.width = 800;
+			settings.window.height = 800;
+			settings.window.depth_buffer = false;
+			return settings;
+		}
+
+		bool init(Runtime& runtime) override {
+			glm::vec3 triangle_vectors[] = {
+				glm::vec3(-1.0f,  1.0f, 0.0f),
+				glm::vec3(-1.0f, -1.0f, 0.0f),
+				glm::vec3( 1.0f, -1.0f, 0.0f),
+
+				glm::vec3(-1.0f,  1.0f, 0.0f),
+				glm::vec3( 1.0f,  1.0f, 0.0f),
+				glm::vec3( 1.0f, -1.0f, 0.0f)
+			};
+			ArenaScope scratch(soupcans::scratchArena());
+			float* points = soupcans::flattenInto(soupcans::scratchArena(), triangle_vectors,
+												  sizeof(triangle_vectors));
+
+			glGenBuffers(1, &this->vbo);
+			glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(triangle_vectors),
+						 points, GL_STATIC_DRAW);
+
+			glGenVertexArrays(1, &this->vao);
+			glBindVertexArray(this->vao);
+			glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+			glEnableVertexAttribArray(0);
+
+			this->shader_prog = runtime.loadShaderProgram(VERTEX_SHADER, FRAGMENT_SHADER);
+
+			if (!this->shader_prog) {
+				return false;
+			}
+
+			float scale = 1.0f;
+			this->widescreen_matrix = glm::mat4{
+				scale,         0.0f,  0.0f, 0.0f,
+				 0.0f,        scale,  0.0f, 0.0f,
+				 0.0f,         0.0f, scale, 0.0f,
+				 0.0f,         0.0f,  0.0f, 1.0f,
+			};
+			this->i_op = INC;
+			this->intensity = 0.0f;
+			this->lookUpUniforms();
+			return true;
+		}
+
+		void update(Runtime& runtime, double dt) override {
+			(void)dt;
+			if (this->intensity < 0.0f || this->intensity > 1.0f) {
+				this->i_op = (this->i_op == INC) ? DEC : INC;
+			}
+			this->intensity = (this->i_op == INC) ?
+				this->intensity + DELTA : this->intensity - DELTA;
+
+			if (runtime.keyPressed(GLFW_KEY_R)) {
+				runtime.reloadShaderProgram(&this->shader_prog, VERTEX_SHADER, FRAGMENT_SHADER);
+				this->lookUpUniforms();
+			}
+		}
+
+		void render(Runtime& runtime) override {
+			runtime.beginRenderPass(QUAD_PASS);
+			glUseProgram(this->shader_prog);
+			glUniform1f(this->intensity_location, this->intensity);
+			glBindVertexArray(this->vao);
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+			runtime.endRenderPass();
+		}
+
+		void shutdown(Runtime& runtime) override {
+			(void)runtime;
+			glDeleteProgram(this->shader_prog);
+			glDeleteVertexArrays(1, &this->vao);
+			glDeleteBuffers(1, &this->vbo);
+		}
+
+	private:
+		const char* VERTEX_SHADER = "shaders/vertex.glsl";
+		const char* FRAGMENT_SHADER = "shaders/fragment.glsl";
+		static constexpr int N_COLOR_SHIFT_FRAMES = 7500;
+		static constexpr float DELTA = 1.0f / static_cast<float>(N_COLOR_SHIFT_FRAMES);
+
+		enum FRAME_OPERATION {INC, DEC};
+		FRAME_OPERATION i_op;
+		float intensity;
+		glm::mat4 widescreen_matrix;
+
+		GLuint vbo, vao;
+		GLuint shader_prog;
+		int matrix_location, intensity_location;
+
+		// after every (re)load, the program starts without our uniforms
+		void lookUpUniforms() {
+			glUseProgram(this->shader_prog);
+			this->matrix_location = glGetUniformLocation(this->shader_prog, "matrix");
+			this->intensity_location = glGetUniformLocation(this->shader_prog, "intensity");
+			glUniformMatrix4fv(this->matrix_location, 1, GL_FALSE,
+							   glm::value_ptr(this->widescreen_matrix));
+			glUniform1f(this->intensity_location, this->intensity);
+		}
+};
+
+std::unique_ptr<Scene> soupcans::createRotatingColorsScene(int argc, char** argv) {
+	(void)argc;
+	(void)argv;
+	return std::unique_ptr<Scene>(new RotatingColorsScene());
+}
@@ -0,0 +1,409 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../common/log.hpp"
+#include "antiAliasing.hpp"
+
+namespace soupcans {
+
+static const char* const ANTI_ALIAS_MODE_NAMES[] = { "off", "msaa2", "msaa4", "msaa8", "fxaa" };
+
+bool parseAntiAliasMode(const char* text, antiAliasMode* mode) {
+    for (int i = 0; i < 5; i++) {
+        if (!strcmp(text, ANTI_ALIAS_MODE_NAMES[i])) {
+            *mode = static_cast<antiAliasMode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* antiAliasModeName(antiAliasMode mode) {
+    return ANTI_ALIAS_MODE_NAMES[mode];
+}
+
+antiAliasMode defaultAntiAliasMode() {
+    const char* env = getenv("SOUP_ANTI_ALIAS");
+    antiAliasMode mode = ANTI_ALIAS_MSAA4;
+    if (env && !parseAntiAliasMode(env, &mode)) {
+        SOUP_LOG_WARNING("unknown SOUP_ANTI_ALIAS %s, using msaa4", env);
+        mode = ANTI_ALIAS_MSAA4;
+    }
+    return mode;
+}
+
+int antiAliasSamples(antiAliasMode mode) {
+    switch (mode) {
+        case ANTI_ALIAS_MSAA2:
+            return 2;
+        case ANTI_ALIAS_MSAA4:
+            return 4;
+        case ANTI_ALIAS_MSAA8:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+// one triangle over the whole viewport, made from gl_VertexID
+static const char* const FXAA_VERTEX_SHADER =
+    "#version 330 core\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "    uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+    "    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);\n"
+    "}\n";
+
+/* FXAA in one pass, after Lottes' FXAA 3.11 "console" variant: pixels with
+   little local contrast are passed through, on the rest the luma gradient
+   of the 2x2 neighbourhood gives the edge direction and two pairs of
+   bilinear taps along it are blended. The wider pair is only taken when
+   it doesn't reach past the local luma range, which keeps thin lines.
+*/
+static const char* const FXAA_FRAGMENT_SHADER =
+    "#version 330 core\n"
+    "uniform sampler2D frame;\n"
+    "uniform vec2 texel;\n"
+    "in vec2 uv;\n"
+    "out vec4 color;\n"
+    "const float EDGE_THRESHOLD = 1.0 / 8.0;\n"
+    "const float EDGE_THRESHOLD_MIN = 1.0 / 24.0;\n"
+    "const float REDUCE_MUL = 1.0 / 8.0;\n"
+    "const float REDUCE_MIN = 1.0 / 128.0;\n"
+    "const float SPAN_MAX = 8.0;\n"
+    "float luma(vec3 rgb) {\n"
+    "    return dot(rgb, vec3(0.299, 0.587, 0.114));\n"
+    "}\n"
+    "void main() {\n"
+    "    vec3 rgb_m = texture(frame, uv).rgb;\n"
+    "    float luma_m = luma(rgb_m);\n"
+    "    float luma_nw = luma(textureOffset(frame, uv, ivec2(-1, 1)).rgb);\n"
+    "    float luma_ne = luma(textureOffset(frame, uv, ivec2(1, 1)).rgb);\n"
+    "    float luma_sw = luma(textureOffset(frame, uv, ivec2(-1, -1)).rgb);\n"
+    "    float luma_se = luma(textureOffset(frame, uv, ivec2(1, -1)).rgb);\n"
+    "    float luma_min = min(luma_m, min(min(luma_nw, luma_ne), min(luma_sw, luma_se)));\n"
+    "    float luma_max = max(luma_m, max(max(luma_nw, luma_ne), max(luma_sw, luma_se)));\n"
+    "    if (luma_max - luma_min < max(EDGE_THRESHOLD_MIN, luma_max * EDGE_THRESHOLD)) {\n"
+    "        color = vec4(rgb_m, 1.0);\n"
+    "        return;\n"
+    "    }\n"
+    "    vec2 dir = vec2(-((luma_nw + luma_ne) - (luma_sw + luma_se)),\n"
+    "                    (luma_nw + luma_sw) - (luma_ne + luma_se));\n"
+    "    float reduce = max((luma_nw + luma_ne + luma_sw + luma_se) * 0.25 * REDUCE_MUL,\n"
+    "                       REDUCE_MIN);\n"
+    "    float scale = 1.0 / (min(abs(dir.x), abs(dir.y)) + reduce);\n"
+    "    dir = clamp(dir * scale, -SPAN_MAX, SPAN_MAX) * texel;\n"
+    "    vec3 rgb_a = 0.5 * (texture(frame, uv + dir * (1.0 / 3.0 - 0.5)).rgb +\n"
+    "                        texture(frame, uv + dir * (2.0 / 3.0 - 0.5)).rgb);\n"
+    "    vec3 rgb_b = rgb_a * 0.5 + 0.25 * (texture(frame, uv - dir * 0.5).rgb +\n"
+    "                                       texture(frame, uv + dir * 0.5).rgb);\n"
+    "    float luma_b = luma(rgb_b);\n"
+    "    color = vec4((luma_b < luma_min || luma_b > luma_max) ? rgb_a : rgb_b, 1.0);\n"
+    "}\n";
+
+// clamped so the taps along an edge never wrap around to the far side of the frame
+static const samplerDesc FXAA_SAMPLER = { FILTER_BILINEAR, WRAP_CLAMP, 1 };
+
+static GLuint compileShaderSource(GLenum shader_type, const char* source) {
+    GLuint shader = glCreateShader(shader_type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE) {
+        char info_log[1024];
+        glGetShaderInfoLog(shader, sizeof(info_log), NULL, info_log);
+        SOUP_LOG_ERROR("FXAA shader failed to compile:\n%s", info_log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+static GLuint linkFxaaProgram() {
+    GLuint vertex = compileShaderSource(GL_VERTEX_SHADER, FXAA_VERTEX_SHADER);
+    GLuint fragment = compileShaderSource(GL_FRAGMENT_SHADER, FXAA_FRAGMENT_SHADER);
+    GLuint program = (vertex && fragment) ? glCreateProgram() : 0;
+    if (program) {
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        glLinkProgram(program);
+    }
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    if (!program) {
+        return 0;
+    }
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        char info_log[1024];
+        glGetProgramInfoLog(program, sizeof(info_log), NULL, info_log);
+        SOUP_LOG_ERROR("FXAA program failed to link:\n%s", info_log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+AntiAliasPass::AntiAliasPass() {
+    this->mode = ANTI_ALIAS_OFF;
+    this->width = 0;
+    this->height = 0;
+    this->depth = false;
+    this->default_output = true;
+    this->output = 0;
+    this->msaa_fbo = 0;
+    this->msaa_color = 0;
+    this->msaa_depth = 0;
+    this->fxaa_target = scaledRenderTarget{};
+    this->fxaa_program = 0;
+    this->fxaa_vertex_array = 0;
+    this->fxaa_texel_location = -1;
+    memset(this->queries, 0, sizeof(this->queries));
+    this->first_timed = 0;
+    this->n_pending = 0;
+    this->timing = false;
+    this->n_timed = 0;
+    this->last_render_seconds = -1.0;
+    this->last_resolve_seconds = -1.0;
+    this->total_render_seconds = 0.0;
+    this->total_resolve_seconds = 0.0;
+}
+
+AntiAliasPass::~AntiAliasPass() {
+    if (this->msaa_fbo || this->fxaa_target.fbo || this->fxaa_program || this->queries[0][0]) {
+        SOUP_LOG_WARNING("anti-aliasing pass destroyed with its targets still allocated");
+    }
+}
+
+void AntiAliasPass::deleteTargets() {
+    if (this->msaa_fbo) {
+        glDeleteFramebuffers(1, &this->msaa_fbo);
+        glDeleteRenderbuffers(1, &this->msaa_color);
+        glDeleteRenderbuffers(1, &this->msaa_depth);
+        this->msaa_fbo = 0;
+        this->msaa_color = 0;
+        this->msaa_depth = 0;
+    }
+    deleteScaledRenderTarget(&this->fxaa_target);
+}
+
+bool AntiAliasPass::allocate(antiAliasMode mode, int width, int height, bool depth,
+                             bool default_output) {
+    this->deleteTargets();
+    this->mode = mode;
+    this->width = width;
+    this->height = height;
+    this->depth = depth;
+    this->default_output = default_output;
+
+    if (mode == ANTI_ALIAS_FXAA) {
+        // the program outlives resizes, it doesn't depend on the size
+        if (!this->fxaa_program) {
+            this->fxaa_program = linkFxaaProgram();
+            if (!this->fxaa_program) {
+                return false;
+            }
+            glUseProgram(this->fxaa_program);
+            glUniform1i(glGetUniformLocation(this->fxaa_program, "frame"), 0);
+            this->fxaa_texel_location = glGetUniformLocation(this->fxaa_program, "texel");
+            glUseProgram(0);
+            // core profiles draw nothing without a vertex array, even an empty one
+            glGenVertexArrays(1, &this->fxaa_vertex_array);
+        }
+        return resizeScaledRenderTarget(&this->fxaa_target, width, height, depth);
+    }
+
+    int samples = antiAliasSamples(mode);
+    if (samples == 0) {
+        return true;
+    }
+    GLint max_samples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+    if (samples > max_samples) {
+        SOUP_LOG_WARNING("%s asks for %d samples, the driver only does %d",
+                         antiAliasModeName(mode), samples, max_samples);
+        samples = max_samples;
+    }
+    /* A resolve blit needs the same color format on both ends, so match a
+       window without alpha; the mailbox ring's targets are all RGBA8.
+    */
+    GLenum color_format = GL_RGBA8;
+    if (default_output) {
+        GLint alpha_bits = 8;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_BACK_LEFT,
+                                              GL_FRAMEBUFFER_ATTACHMENT_ALPHA_SIZE, &alpha_bits);
+        color_format = (alpha_bits > 0) ? GL_RGBA8 : GL_RGB8;
+    }
+    glGenRenderbuffers(1, &this->msaa_color);
+    glBindRenderbuffer(GL_RENDERBUFFER, this->msaa_color);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, color_format, width, height);
+    if (depth) {
+        glGenRenderbuffers(1, &this->msaa_depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, this->msaa_depth);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24,
+                                         width, height);
+    }
+    glGenFramebuffers(1, &this->msaa_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, this->msaa_fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                              GL_RENDERBUFFER, this->msaa_color);
+    if (depth) {
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                  GL_RENDERBUFFER, this->msaa_depth);
+    }
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+void AntiAliasPass::collectTimes(bool wait) {
+    // queries finish in order, so stop at the first frame that hasn't
+    while (this->n_pending > 0) {
+        GLuint* stamps = this->queries[this->first_timed];
+        GLint available = GL_FALSE;
+        if (!wait) {
+            glGetQueryObjectiv(stamps[N_STAMPS - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                return;
+            }
+        }
+        GLuint64 begin = 0, resolve = 0, end = 0;
+        glGetQueryObjectui64v(stamps[0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(stamps[1], GL_QUERY_RESULT, &resolve);
+        glGetQueryObjectui64v(stamps[2], GL_QUERY_RESULT, &end);
+        this->last_render_seconds = (end - begin) * 1e-9;
+        this->last_resolve_seconds = (end - resolve) * 1e-9;
+        this->total_render_seconds += this->last_render_seconds;
+        this->total_resolve_seconds += this->last_resolve_seconds;
+        this->n_timed++;
+        this->first_timed = (this->first_timed + 1) % N_TIMED_FRAMES;
+        this->n_pending--;
+    }
+}
+
+GLuint AntiAliasPass::beginFrame(antiAliasMode mode, int width, int height, bool depth,
+                                 GLuint output) {
+    if (!this->queries[0][0]) {
+        glGenQueries(N_TIMED_FRAMES * N_STAMPS, &this->queries[0][0]);
+    }
+    this->collectTimes(false);
+    // the GPU is a whole ring behind, leave this frame out rather than wait for it
+    this->timing = this->n_pending < N_TIMED_FRAMES;
+    if (this->timing) {
+        int slot = (this->first_timed + this->n_pending) % N_TIMED_FRAMES;
+        /* A deferred rasterizer (tilers, llvmpipe) only draws what it has
+           queued at a flush, so without one the scene lands in whichever
+           bracket flushes next. Every stamp flushes what came before it.
+        */
+        glFlush();
+        glQueryCounter(this->queries[slot][0], GL_TIMESTAMP);
+    }
+
+    // a target that failed stays gone until the mode or size changes
+    bool default_output = output == 0;
+    if (mode != this->mode || width != this->width || height != this->height ||
+        depth != this->depth || default_output != this->default_output) {
+        if (!this->allocate(mode, width, height, depth, default_output)) {
+            SOUP_LOG_ERROR("%s target %dx%d is incomplete, drawing without anti-aliasing",
+                           antiAliasModeName(mode), width, height);
+            this->deleteTargets();
+        }
+    }
+
+    this->output = output;
+    GLuint target = output;
+    if (this->msaa_fbo) {
+        target = this->msaa_fbo;
+    } else if (this->fxaa_target.fbo) {
+        target = this->fxaa_target.fbo;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    return target;
+}
+
+void AntiAliasPass::endFrame(TextureRegistry& textures) {
+    int slot = (this->first_timed + this->n_pending) % N_TIMED_FRAMES;
+    if (this->timing) {
+        glFlush();
+        glQueryCounter(this->queries[slot][1], GL_TIMESTAMP);
+    }
+
+    if (this->msaa_fbo) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, this->msaa_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->output);
+        glBlitFramebuffer(0, 0, this->width, this->height, 0, 0, this->width, this->height,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    } else if (this->fxaa_target.fbo) {
+        glBindFramebuffer(GL_FRAMEBUFFER, this->output);
+        glViewport(0, 0, this->width, this->height);
+        // scenes keep whatever state they like between frames, put it back afterwards
+        GLint program = 0, vertex_array = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertex_array);
+        const GLenum CAPABILITIES[] = { GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE, GL_SCISSOR_TEST };
+        bool enabled[4];
+        for (int i = 0; i < 4; i++) {
+            enabled[i] = glIsEnabled(CAPABILITIES[i]) == GL_TRUE;
+            glDisable(CAPABILITIES[i]);
+        }
+
+        glUseProgram(this->fxaa_program);
+        glUniform2f(this->fxaa_texel_location, 1.0f / this->width, 1.0f / this->height);
+        textures.bind(0, this->fxaa_target.color_texture, FXAA_SAMPLER);
+        glBindVertexArray(this->fxaa_vertex_array);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+
+        for (int i = 0; i < 4; i++) {
+            if (enabled[i]) {
+                glEnable(CAPABILITIES[i]);
+            }
+        }
+        glBindVertexArray(vertex_array);
+        glUseProgram(program);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, this->output);
+
+    if (this->timing) {
+        glFlush();
+        glQueryCounter(this->queries[slot][2], GL_TIMESTAMP);
+        this->n_pending++;
+        this->timing = false;
+    }
+}
+
+void AntiAliasPass::finish() {
+    this->collectTimes(true);
+}
+
+void AntiAliasPass::clear() {
+    this->deleteTargets();
+    if (this->fxaa_program) {
+        glDeleteProgram(this->fxaa_program);
+        glDeleteVertexArrays(1, &this->fxaa_vertex_array);
+        this->fxaa_program = 0;
+        this->fxaa_vertex_array = 0;
+    }
+    if (this->queries[0][0]) {
+        glDeleteQueries(N_TIMED_FRAMES * N_STAMPS, &this->queries[0][0]);
+    }
+    memset(this->queries, 0, sizeof(this->queries));
+    this->mode = ANTI_ALIAS_OFF;
+    this->width = 0;
+    this->height = 0;
+    this->depth = false;
+    this->default_output = true;
+    this->output = 0;
+    this->first_timed = 0;
+    this->n_pending = 0;
+    this->timing = false;
+    this->n_timed = 0;
+    this->last_render_seconds = -1.0;
+    this->last_resolve_seconds = -1.0;
+    this->total_render_seconds = 0.0;
+    this->total_resolve_seconds = 0.0;
+}
+
+}
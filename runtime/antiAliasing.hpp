@@ -0,0 +1,125 @@
+#ifndef SOUPCANS_ANTI_ALIASING_HPP
+#define SOUPCANS_ANTI_ALIASING_HPP
+
+#include <stdint.h>
+
+#include <GL/gl3w.h>
+
+#include "renderTarget.hpp"
+#include "textures.hpp"
+
+namespace soupcans {
+
+/* How edges are smoothed, picked per deployment. The window itself is
+   never multisampled, scenes draw into an offscreen target instead:
+   ANTI_ALIAS_OFF      straight into the window, nothing to pay for
+   ANTI_ALIAS_MSAA*    a multisampled framebuffer, resolved into the window
+                       with one glBlitFramebuffer. Every fragment is shaded
+                       once but depth, coverage and the resolve scale with
+                       the samples, which a software rasterizer feels
+   ANTI_ALIAS_FXAA     a plain target, then one full screen FXAA pass that
+                       blurs along the edges it finds. A fixed cost per
+                       pixel whatever the scene draws, softens text a little
+*/
+enum antiAliasMode {
+    ANTI_ALIAS_OFF,
+    ANTI_ALIAS_MSAA2,
+    ANTI_ALIAS_MSAA4,
+    ANTI_ALIAS_MSAA8,
+    ANTI_ALIAS_FXAA
+};
+
+// "off", "msaa2", "msaa4", "msaa8" or "fxaa"
+bool parseAntiAliasMode(const char* text, antiAliasMode* mode);
+const char* antiAliasModeName(antiAliasMode mode);
+// SOUP_ANTI_ALIAS if it is set, otherwise msaa4, what every demo used to ask the window for
+antiAliasMode defaultAntiAliasMode();
+// samples per pixel of the multisampled modes, 0 for the others
+int antiAliasSamples(antiAliasMode mode);
+
+/* The offscreen half of anti-aliasing. beginFrame() binds what the scene
+   draws into, endFrame() resolves it into the output framebuffer. Both
+   put GL_TIMESTAMP queries around the frame, read back a few frames later
+   without waiting, so every mode reports what the scene and the resolve
+   cost on the GPU; that is how a deployment tells what a mode is worth.
+*/
+class AntiAliasPass {
+    public:
+        AntiAliasPass();
+        ~AntiAliasPass();
+
+        AntiAliasPass(const AntiAliasPass&) = delete;
+        AntiAliasPass& operator=(const AntiAliasPass&) = delete;
+
+        /* Binds the target for `mode` and returns its framebuffer, which is
+           `output` itself when there is nothing to resolve. A target that
+           can't be made is logged once and the frame goes to `output`. It
+           only gets a depth buffer with `depth`.
+        */
+        GLuint beginFrame(antiAliasMode mode, int width, int height, bool depth, GLuint output);
+        // resolves into the output framebuffer and leaves it bound
+        void endFrame(TextureRegistry& textures);
+
+        /* GPU seconds of the newest frame that came back, from beginFrame()
+           to endFrame() and of the resolve alone. Negative until one has.
+        */
+        double lastRenderSeconds() const {
+            return this->last_render_seconds;
+        }
+        double lastResolveSeconds() const {
+            return this->last_resolve_seconds;
+        }
+        // totals over every frame that came back since the last clear()
+        uint64_t timedFrames() const {
+            return this->n_timed;
+        }
+        double totalRenderSeconds() const {
+            return this->total_render_seconds;
+        }
+        double totalResolveSeconds() const {
+            return this->total_resolve_seconds;
+        }
+        // waits for the frames still on the GPU, for the end of a run
+        void finish();
+
+        // deletes the targets and drops the totals, call while the context is current
+        void clear();
+
+    private:
+        // frames in flight before timing skips one rather than wait
+        static const int N_TIMED_FRAMES = 4;
+        // begin, resolve, end
+        static const int N_STAMPS = 3;
+
+        antiAliasMode mode;
+        int width, height;
+        bool depth;
+        bool default_output;
+        GLuint output;
+
+        // ANTI_ALIAS_MSAA*
+        GLuint msaa_fbo;
+        GLuint msaa_color;
+        GLuint msaa_depth;
+        // ANTI_ALIAS_FXAA
+        scaledRenderTarget fxaa_target;
+        GLuint fxaa_program;
+        GLuint fxaa_vertex_array;
+        GLint fxaa_texel_location;
+
+        GLuint queries[N_TIMED_FRAMES][N_STAMPS];
+        int first_timed, n_pending;
+        bool timing;
+        uint64_t n_timed;
+        double last_render_seconds, last_resolve_seconds;
+        double total_render_seconds, total_resolve_seconds;
+
+        bool allocate(antiAliasMode mode, int width, int height, bool depth,
+                      bool default_output);
+        void deleteTargets();
+        void collectTimes(bool wait);
+};
+
+}
+
+#endif
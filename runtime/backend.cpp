@@ -0,0 +1,301 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../common/log.hpp"
+#include "backend.hpp"
+
+namespace soupcans {
+
+static const char* const PRESENT_MODE_NAMES[] = { "vsync", "adaptive", "uncapped", "mailbox" };
+
+bool parsePresentMode(const char* text, presentMode* mode) {
+    for (int i = 0; i < 4; i++) {
+        if (!strcmp(text, PRESENT_MODE_NAMES[i])) {
+            *mode = static_cast<presentMode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* presentModeName(presentMode mode) {
+    return PRESENT_MODE_NAMES[mode];
+}
+
+presentMode defaultPresentMode() {
+    const char* env = getenv("SOUP_PRESENT_MODE");
+    presentMode mode = PRESENT_VSYNC;
+    if (env && !parsePresentMode(env, &mode)) {
+        SOUP_LOG_WARNING("unknown SOUP_PRESENT_MODE %s, using vsync", env);
+        mode = PRESENT_VSYNC;
+    }
+    return mode;
+}
+
+int swapIntervalFor(presentMode mode) {
+    switch (mode) {
+        case PRESENT_ADAPTIVE:
+            if (glfwExtensionSupported("GLX_EXT_swap_control_tear") ||
+                glfwExtensionSupported("WGL_EXT_swap_control_tear")) {
+                return -1;
+            }
+            SOUP_LOG_WARNING("no EXT_swap_control_tear, adaptive vsync falls back to vsync");
+            return 1;
+        case PRESENT_UNCAPPED:
+        // the runtime decides when a mailbox frame is shown, swaps must not block
+        case PRESENT_MAILBOX:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+// the first user initializes GLFW and the last terminates it, all on the main thread
+static int g_glfw_users = 0;
+
+static void glfwErrorCallback(int error, const char* description) {
+    SOUP_LOG_ERROR("GLFW error %d: %s", error, description);
+}
+
+bool acquireGlfw() {
+    if (g_glfw_users == 0) {
+        glfwSetErrorCallback(glfwErrorCallback);
+        if (!glfwInit()) {
+            SOUP_LOG_ERROR("could not start GLFW3");
+            return false;
+        }
+    }
+    g_glfw_users++;
+    return true;
+}
+
+void releaseGlfw() {
+    if (--g_glfw_users == 0) {
+        glfwTerminate();
+    }
+}
+
+// every kind of input only needs to mark that some arrived
+static void inputArrived(GLFWwindow* window) {
+    static_cast<GlfwWindowBackend*>(glfwGetWindowUserPointer(window))->markInput();
+}
+
+static void keyCallback(GLFWwindow* window, int, int, int, int) {
+    inputArrived(window);
+}
+
+static void mouseButtonCallback(GLFWwindow* window, int, int, int) {
+    inputArrived(window);
+}
+
+static void cursorPosCallback(GLFWwindow* window, double, double) {
+    inputArrived(window);
+}
+
+static GlfwWindowBackend* backendOf(GLFWwindow* window) {
+    return static_cast<GlfwWindowBackend*>(glfwGetWindowUserPointer(window));
+}
+
+static void iconifyCallback(GLFWwindow* window, int iconified) {
+    backendOf(window)->markIconified(iconified != 0);
+}
+
+static void focusCallback(GLFWwindow* window, int focused) {
+    backendOf(window)->markFocused(focused != 0);
+}
+
+static void refreshCallback(GLFWwindow* window) {
+    backendOf(window)->markRefresh();
+}
+
+GlfwWindowBackend::GlfwWindowBackend() {
+    this->window = nullptr;
+    this->visible = true;
+    this->input_arrived = false;
+    this->input_time = -1.0;
+    this->last_poll = 0.0;
+    this->iconified = false;
+    this->has_focus = true;
+    this->refresh_requested = false;
+}
+
+GlfwWindowBackend::~GlfwWindowBackend() {
+    this->close();
+}
+
+bool GlfwWindowBackend::open(const windowSettings& settings) {
+    if (!acquireGlfw()) {
+        return false;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, settings.gl_major);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, settings.gl_minor);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, settings.debug_context ? GL_TRUE : GL_FALSE);
+    // anti-aliasing happens offscreen, see antiAliasing.hpp
+    glfwWindowHint(GLFW_SAMPLES, 0);
+    glfwWindowHint(GLFW_DEPTH_BITS, settings.depth_buffer ? 24 : 0);
+    glfwWindowHint(GLFW_VISIBLE, this->visible ? GL_TRUE : GL_FALSE);
+
+    int width = settings.width, height = settings.height;
+    const GLFWvidmode* vidmode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    if (width <= 0) {
+        width = vidmode ? vidmode->width / 2 : 1280;
+    }
+    if (height <= 0) {
+        height = vidmode ? vidmode->height / 2 : 720;
+    }
+
+    this->window = glfwCreateWindow(width, height, settings.title, NULL, NULL);
+    if (!this->window) {
+        SOUP_LOG_ERROR("could not open window with GLFW3");
+        releaseGlfw();
+        return false;
+    }
+    glfwMakeContextCurrent(this->window);
+    glfwSwapInterval(swapIntervalFor(settings.present_mode));
+
+    this->iconified = false;
+    this->has_focus = glfwGetWindowAttrib(this->window, GLFW_FOCUSED) != 0;
+    this->refresh_requested = false;
+    this->input_arrived = false;
+    this->input_time = -1.0;
+    this->last_poll = glfwGetTime();
+    glfwSetWindowUserPointer(this->window, this);
+    glfwSetKeyCallback(this->window, keyCallback);
+    glfwSetMouseButtonCallback(this->window, mouseButtonCallback);
+    glfwSetCursorPosCallback(this->window, cursorPosCallback);
+    glfwSetWindowIconifyCallback(this->window, iconifyCallback);
+    glfwSetWindowFocusCallback(this->window, focusCallback);
+    glfwSetWindowRefreshCallback(this->window, refreshCallback);
+    return true;
+}
+
+void GlfwWindowBackend::close() {
+    if (this->window) {
+        glfwDestroyWindow(this->window);
+        this->window = nullptr;
+        releaseGlfw();
+    }
+}
+
+bool GlfwWindowBackend::shouldClose() {
+    return glfwWindowShouldClose(this->window);
+}
+
+void GlfwWindowBackend::requestClose() {
+    glfwSetWindowShouldClose(this->window, 1);
+}
+
+void GlfwWindowBackend::eventsHandled(double input_time) {
+    if (this->input_arrived && this->input_time < 0.0) {
+        this->input_time = input_time;
+    }
+    this->input_arrived = false;
+    this->last_poll = glfwGetTime();
+}
+
+void GlfwWindowBackend::pollEvents() {
+    glfwPollEvents();
+    this->eventsHandled(this->last_poll);
+}
+
+void GlfwWindowBackend::waitEvents(double timeout) {
+    glfwWaitEventsTimeout(timeout);
+    // the wait ends as soon as an event comes in, so now is when it did
+    this->eventsHandled(glfwGetTime());
+}
+
+bool GlfwWindowBackend::inputPending() {
+    return this->input_time >= 0.0;
+}
+
+bool GlfwWindowBackend::hidden() {
+    return this->iconified;
+}
+
+bool GlfwWindowBackend::focused() {
+    return this->has_focus;
+}
+
+bool GlfwWindowBackend::takeRefreshRequest() {
+    bool requested = this->refresh_requested;
+    this->refresh_requested = false;
+    return requested;
+}
+
+double GlfwWindowBackend::takeInputTime() {
+    double input_time = this->input_time;
+    this->input_time = -1.0;
+    return input_time;
+}
+
+void GlfwWindowBackend::present() {
+    glfwSwapBuffers(this->window);
+}
+
+void GlfwWindowBackend::framebufferSize(int* width, int* height) {
+    glfwGetFramebufferSize(this->window, width, height);
+}
+
+bool GlfwWindowBackend::keyPressed(int key) {
+    return glfwGetKey(this->window, key) == GLFW_PRESS;
+}
+
+void GlfwWindowBackend::setTitle(const char* title) {
+    glfwSetWindowTitle(this->window, title);
+}
+
+double GlfwWindowBackend::refreshRate() {
+    GLFWmonitor* monitor = glfwGetWindowMonitor(this->window);
+    const GLFWvidmode* vidmode = glfwGetVideoMode(monitor ? monitor : glfwGetPrimaryMonitor());
+    return vidmode ? vidmode->refreshRate : 0.0;
+}
+
+double GlfwWindowBackend::time() {
+    return glfwGetTime();
+}
+
+HeadlessBackend::HeadlessBackend() {
+    this->visible = false;
+    this->finish_on_present = true;
+}
+
+bool HeadlessBackend::open(const windowSettings& settings) {
+    this->finish_on_present = settings.finish_on_present;
+    return GlfwWindowBackend::open(settings);
+}
+
+void HeadlessBackend::present() {
+    if (this->finish_on_present) {
+        glFinish();
+    } else {
+        glFlush();
+    }
+}
+
+bool HeadlessBackend::keyPressed(int) {
+    return false;
+}
+
+double HeadlessBackend::refreshRate() {
+    return 0.0;
+}
+
+bool HeadlessBackend::hidden() {
+    return false;
+}
+
+bool HeadlessBackend::focused() {
+    return true;
+}
+
+std::unique_ptr<Backend> createBackend(backendKind kind) {
+    if (kind == BACKEND_HEADLESS) {
+        return std::unique_ptr<Backend>(new HeadlessBackend());
+    }
+    return std::unique_ptr<Backend>(new GlfwWindowBackend());
+}
+
+}
@@ -0,0 +1,187 @@
+#ifndef SOUPCANS_BACKEND_HPP
+#define SOUPCANS_BACKEND_HPP
+
+#include <memory>
+
+#include <GL/gl3w.h>
+#include <GLFW/glfw3.h>
+
+namespace soupcans {
+
+/* How finished frames reach the display, picked per deployment:
+   PRESENT_VSYNC        swap interval 1, smooth, up to a frame of extra latency
+   PRESENT_ADAPTIVE     interval -1 (EXT_swap_control_tear), a late frame tears
+                        instead of waiting a whole refresh, falls back to vsync
+   PRESENT_UNCAPPED     interval 0, the throughput ceiling, tears
+   PRESENT_MAILBOX      renders uncapped into a ring of offscreen frames and
+                        shows the newest finished one once per refresh
+*/
+enum presentMode {
+    PRESENT_VSYNC,
+    PRESENT_ADAPTIVE,
+    PRESENT_UNCAPPED,
+    PRESENT_MAILBOX
+};
+
+// "vsync", "adaptive", "uncapped" or "mailbox"
+bool parsePresentMode(const char* text, presentMode* mode);
+const char* presentModeName(presentMode mode);
+// SOUP_PRESENT_MODE if it is set, otherwise vsync
+presentMode defaultPresentMode();
+// for glfwSwapInterval(), needs a current context to look for EXT_swap_control_tear
+int swapIntervalFor(presentMode mode);
+
+// GLFW is process wide, everything that opens windows holds a reference while it does
+bool acquireGlfw();
+void releaseGlfw();
+
+struct windowSettings {
+    const char* title = "SOUPCANS";
+    // 0 means half the primary monitor in that direction
+    int width = 0;
+    int height = 0;
+    int gl_major = 4;
+    int gl_minor = 3;
+    // off for scenes whose render passes never use depth, see renderPass.hpp
+    bool depth_buffer = true;
+    // set by the runtime, like the debug context
+    presentMode present_mode = PRESENT_VSYNC;
+    // set by the runtime from its debug level
+    bool debug_context = false;
+    /* Headless only: present() waits for the GPU so frame times include
+       its work. The runtime turns it off when frames are read back, the
+       readback rings only overlap the GPU with later frames if nothing
+       drains it in between.
+    */
+    bool finish_on_present = true;
+};
+
+/* Where frames go. A backend owns the GL context and everything the
+   platform layer does for us: events, input, presenting and the clock.
+*/
+class Backend {
+    public:
+        virtual ~Backend() {}
+
+        // creates the window and makes its context current
+        virtual bool open(const windowSettings& settings) = 0;
+        virtual void close() = 0;
+
+        virtual bool shouldClose() = 0;
+        virtual void requestClose() = 0;
+        virtual void pollEvents() = 0;
+        virtual void present() = 0;
+
+        /* The oldest time the input from the polls since the last call
+           can have arrived, -1 if there was none. Events only come out of
+           pollEvents(), so that is the start of the poll before them.
+        */
+        virtual double takeInputTime() = 0;
+        // input has come in that takeInputTime() hasn't handed out yet
+        virtual bool inputPending() = 0;
+
+        /* Like pollEvents(), but sleeps until an event comes in or
+           `timeout` seconds pass, for when there is nothing to draw
+        */
+        virtual void waitEvents(double timeout) = 0;
+        // minimized; GLFW has no way to tell that the window is covered
+        virtual bool hidden() = 0;
+        virtual bool focused() = 0;
+        // the window system wants the contents drawn again, clears the request
+        virtual bool takeRefreshRequest() = 0;
+
+        virtual void framebufferSize(int* width, int* height) = 0;
+        virtual bool keyPressed(int key) = 0;
+        virtual void setTitle(const char* title) = 0;
+
+        // of the display frames go to, 0 if there is none or it is unknown
+        virtual double refreshRate() = 0;
+
+        // seconds on a monotonic clock
+        virtual double time() = 0;
+};
+
+class GlfwWindowBackend : public Backend {
+    public:
+        GlfwWindowBackend();
+        ~GlfwWindowBackend() override;
+
+        bool open(const windowSettings& settings) override;
+        void close() override;
+
+        bool shouldClose() override;
+        void requestClose() override;
+        void pollEvents() override;
+        void present() override;
+        double takeInputTime() override;
+        bool inputPending() override;
+        void waitEvents(double timeout) override;
+        bool hidden() override;
+        bool focused() override;
+        bool takeRefreshRequest() override;
+
+        void framebufferSize(int* width, int* height) override;
+        bool keyPressed(int key) override;
+        void setTitle(const char* title) override;
+        double refreshRate() override;
+        double time() override;
+
+        // for the GLFW callbacks
+        void markInput() {
+            this->input_arrived = true;
+        }
+        void markIconified(bool iconified) {
+            this->iconified = iconified;
+        }
+        void markFocused(bool focused) {
+            this->has_focus = focused;
+        }
+        void markRefresh() {
+            this->refresh_requested = true;
+        }
+
+    protected:
+        GLFWwindow* window;
+        bool visible;
+        // set by the input callbacks during a poll
+        bool input_arrived;
+        double input_time;
+        double last_poll;
+        bool iconified;
+        bool has_focus;
+        bool refresh_requested;
+
+        // after every poll or wait, stamps what the callbacks saw with `input_time`
+        void eventsHandled(double input_time);
+};
+
+/* Same GL context in a hidden window, for benchmarks and CI. Nothing is
+   shown, so present() only waits for the GPU (or just flushes, see
+   windowSettings::finish_on_present) and input never fires.
+*/
+class HeadlessBackend : public GlfwWindowBackend {
+    public:
+        HeadlessBackend();
+
+        bool open(const windowSettings& settings) override;
+        void present() override;
+        bool keyPressed(int key) override;
+        double refreshRate() override;
+        // nobody looks at a hidden window, so it is always fair game
+        bool hidden() override;
+        bool focused() override;
+
+    private:
+        bool finish_on_present;
+};
+
+enum backendKind {
+    BACKEND_WINDOW,
+    BACKEND_HEADLESS
+};
+
+std::unique_ptr<Backend> createBackend(backendKind kind);
+
+}
+
+#endif
@@ -0,0 +1,424 @@
+#include <string.h>
+
+#include <chrono>
+
+#include "../common/log.hpp"
+#include "frameCapture.hpp"
+
+namespace soupcans {
+
+captureFormat captureFormatFor(const char* path) {
+    size_t length = strlen(path);
+    if (strchr(path, '%')) {
+        return CAPTURE_PNG;
+    }
+    if (strcmp(path, "-") == 0 || (length >= 4 && strcmp(path + length - 4, ".y4m") == 0)) {
+        return CAPTURE_Y4M;
+    }
+    return CAPTURE_FFMPEG;
+}
+
+/* PNG, written by hand so capturing needs no image library. The pixels go
+   into stored (uncompressed) deflate blocks, which costs disk space but
+   keeps the encoder thread far ahead of the renderer.
+*/
+static uint32_t g_crc_table[256];
+
+static void initCrcTable() {
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        g_crc_table[n] = c;
+    }
+}
+
+struct pngChunkWriter {
+    FILE* file;
+    uint32_t crc;
+
+    void begin(const char* type, uint32_t length) {
+        unsigned char header[4] = { (unsigned char)(length >> 24), (unsigned char)(length >> 16),
+                                    (unsigned char)(length >> 8), (unsigned char)length };
+        fwrite(header, 1, 4, this->file);
+        this->crc = 0xffffffffu;
+        this->write(type, 4);
+    }
+
+    void write(const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            this->crc = g_crc_table[(this->crc ^ bytes[i]) & 0xff] ^ (this->crc >> 8);
+        }
+        fwrite(data, 1, size, this->file);
+    }
+
+    void writeU32(uint32_t value) {
+        unsigned char bytes[4] = { (unsigned char)(value >> 24), (unsigned char)(value >> 16),
+                                   (unsigned char)(value >> 8), (unsigned char)value };
+        this->write(bytes, 4);
+    }
+
+    void end() {
+        uint32_t crc = this->crc ^ 0xffffffffu;
+        unsigned char bytes[4] = { (unsigned char)(crc >> 24), (unsigned char)(crc >> 16),
+                                   (unsigned char)(crc >> 8), (unsigned char)crc };
+        fwrite(bytes, 1, 4, this->file);
+    }
+};
+
+// rows are RGB with the filter byte in front, already top to bottom
+static bool writePng(const char* path, const unsigned char* rows, int width, int height) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    static const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    fwrite(SIGNATURE, 1, sizeof(SIGNATURE), file);
+
+    pngChunkWriter chunk = { file, 0 };
+    chunk.begin("IHDR", 13);
+    chunk.writeU32(width);
+    chunk.writeU32(height);
+    // 8 bit RGB, deflate, no filtering beyond per row, not interlaced
+    static const unsigned char IHDR_TAIL[5] = { 8, 2, 0, 0, 0 };
+    chunk.write(IHDR_TAIL, sizeof(IHDR_TAIL));
+    chunk.end();
+
+    static const uint32_t MAX_STORED_BLOCK = 65535;
+    uint32_t raw_size = (uint32_t)height * (1 + (uint32_t)width * 3);
+    uint32_t n_blocks = (raw_size + MAX_STORED_BLOCK - 1) / MAX_STORED_BLOCK;
+    chunk.begin("IDAT", 2 + raw_size + 5 * n_blocks + 4);
+    static const unsigned char ZLIB_HEADER[2] = { 0x78, 0x01 };
+    chunk.write(ZLIB_HEADER, 2);
+    uint32_t adler_a = 1, adler_b = 0;
+    for (uint32_t offset = 0; offset < raw_size; offset += MAX_STORED_BLOCK) {
+        uint32_t size = (raw_size - offset < MAX_STORED_BLOCK) ? raw_size - offset :
+            MAX_STORED_BLOCK;
+        unsigned char block_header[5] = {
+            (unsigned char)(offset + size == raw_size ? 1 : 0),
+            (unsigned char)size, (unsigned char)(size >> 8),
+            (unsigned char)~size, (unsigned char)(~size >> 8)
+        };
+        chunk.write(block_header, 5);
+        chunk.write(rows + offset, size);
+        // 5552 bytes is as far as the sums go before they could overflow
+        for (uint32_t i = 0; i < size; i += 5552) {
+            uint32_t end = (size - i < 5552) ? size : i + 5552;
+            for (uint32_t j = i; j < end; j++) {
+                adler_a += rows[offset + j];
+                adler_b += adler_a;
+            }
+            adler_a %= 65521;
+            adler_b %= 65521;
+        }
+    }
+    chunk.writeU32((adler_b << 16) | adler_a);
+    chunk.end();
+
+    chunk.begin("IEND", 0);
+    chunk.end();
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+FrameCapture::FrameCapture() {
+    this->path = nullptr;
+    this->format = CAPTURE_Y4M;
+    this->width = 0;
+    this->height = 0;
+    this->fps = 0.0;
+    this->stream = nullptr;
+    for (int i = 0; i < N_PBOS; i++) {
+        this->ring[i].pbo = 0;
+        this->ring[i].fence = 0;
+    }
+    this->oldest = 0;
+    this->n_in_flight = 0;
+    this->n_read = 0;
+    this->encoding = false;
+    this->capture_stats = captureStats{};
+}
+
+FrameCapture::~FrameCapture() {
+    if (this->isOpen()) {
+        SOUP_LOG_WARNING("capture to %s never closed, frames in flight are lost", this->path);
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->encoding = false;
+        lock.unlock();
+        this->wake_up.notify_all();
+        this->encoder.join();
+    }
+}
+
+bool FrameCapture::open(const char* path, int width, int height, double fps) {
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    this->path = path;
+    this->format = captureFormatFor(path);
+    this->fps = (fps > 0.0) ? fps : 60.0;
+
+    if (this->format == CAPTURE_Y4M) {
+        this->stream = (strcmp(path, "-") == 0) ? stdout : fopen(path, "wb");
+    } else if (this->format == CAPTURE_FFMPEG) {
+        char command[1024];
+        snprintf(command, sizeof(command),
+                 "ffmpeg -loglevel error -y -f yuv4mpegpipe -i - -pix_fmt yuv420p \"%s\"", path);
+        this->stream = popen(command, "w");
+    }
+    if (this->format != CAPTURE_PNG && !this->stream) {
+        SOUP_LOG_ERROR("could not open capture output %s", path);
+        return false;
+    }
+    if (this->stream) {
+        // the frame rate only goes into the header, frames are never dropped or repeated
+        fprintf(this->stream, "YUV4MPEG2 W%d H%d F%d:1000 Ip A1:1 C420jpeg\n",
+                width, height, (int)(this->fps * 1000.0 + 0.5));
+    }
+    if (this->format == CAPTURE_PNG) {
+        initCrcTable();
+        this->converted.resize((size_t)height * (1 + (size_t)width * 3));
+    } else {
+        size_t chroma = (size_t)((width + 1) / 2) * ((height + 1) / 2);
+        this->converted.resize((size_t)width * height + 2 * chroma);
+    }
+
+    this->width = width;
+    this->height = height;
+    size_t frame_size = (size_t)width * height * 4;
+    for (int i = 0; i < N_PBOS; i++) {
+        glGenBuffers(1, &this->ring[i].pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, this->ring[i].pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frame_size, nullptr, GL_STREAM_READ);
+        this->ring[i].fence = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    this->oldest = 0;
+    this->n_in_flight = 0;
+    this->n_read = 0;
+
+    this->free_frames.clear();
+    this->queued_frames.clear();
+    this->queued_frames.reserve(N_ENCODER_FRAMES);
+    for (int i = 0; i < N_ENCODER_FRAMES; i++) {
+        this->frames[i].resize(frame_size);
+        this->free_frames.push_back(i);
+    }
+    this->capture_stats = captureStats{};
+    this->encoding = true;
+    this->encoder = std::thread(&FrameCapture::encoderLoop, this);
+    SOUP_LOG_INFO("capturing %dx%d at %.2f fps to %s", width, height, this->fps, path);
+    return true;
+}
+
+void FrameCapture::capture() {
+    if (!this->isOpen()) {
+        return;
+    }
+    if (this->n_in_flight == N_PBOS) {
+        // the GPU is more than a ring behind, only now does the CPU wait for it
+        this->capture_stats.n_readback_stalls++;
+        this->retire(true);
+    }
+
+    int next = (this->oldest + this->n_in_flight) % N_PBOS;
+    readback& slot = this->ring[next];
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    // with a pack buffer bound this returns at once, the copy happens on the GPU
+    glReadPixels(0, 0, this->width, this->height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    this->n_in_flight++;
+
+    // pass on whatever has already landed, oldest first so frames stay in order
+    while (this->n_in_flight > 1) {
+        GLenum status = glClientWaitSync(this->ring[this->oldest].fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        this->retire(false);
+    }
+}
+
+// maps the oldest readback and queues a copy of it for the encoder
+void FrameCapture::retire(bool wait) {
+    readback& slot = this->ring[this->oldest];
+    if (wait) {
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    int frame;
+    {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        if (this->free_frames.empty()) {
+            this->capture_stats.n_encoder_stalls++;
+            this->wake_up.wait(lock, [this]() { return !this->free_frames.empty(); });
+        }
+        frame = this->free_frames.back();
+        this->free_frames.pop_back();
+    }
+
+    size_t frame_size = (size_t)this->width * this->height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frame_size, GL_MAP_READ_BIT);
+    if (pixels) {
+        memcpy(this->frames[frame].data(), pixels, frame_size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        SOUP_LOG_ERROR("could not map capture buffer, frame %llu is black",
+                       (unsigned long long)this->n_read);
+        memset(this->frames[frame].data(), 0, frame_size);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->queued_frames.push_back(frame);
+    }
+    this->wake_up.notify_all();
+    this->oldest = (this->oldest + 1) % N_PBOS;
+    this->n_in_flight--;
+    this->n_read++;
+}
+
+void FrameCapture::encoderLoop() {
+    uint64_t frame_index = 0;
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->wake_up.wait(lock, [this]() {
+            return !this->encoding || !this->queued_frames.empty();
+        });
+        if (this->queued_frames.empty()) {
+            break;
+        }
+        int frame = this->queued_frames.front();
+        this->queued_frames.erase(this->queued_frames.begin());
+        lock.unlock();
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        this->encodeFrame(this->frames[frame].data(), frame_index++);
+        this->capture_stats.encode_seconds += std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        this->free_frames.push_back(frame);
+        this->capture_stats.n_frames++;
+        this->wake_up.notify_all();
+    }
+}
+
+static inline unsigned char clampByte(int value) {
+    return (unsigned char)((value < 0) ? 0 : (value > 255 ? 255 : value));
+}
+
+// GL rows start at the bottom, both outputs start at the top
+void FrameCapture::encodeFrame(const unsigned char* rgba, uint64_t frame) {
+    int w = this->width, h = this->height;
+    unsigned char* out = this->converted.data();
+    if (this->format == CAPTURE_PNG) {
+        for (int y = 0; y < h; y++) {
+            const unsigned char* src = rgba + (size_t)(h - 1 - y) * w * 4;
+            unsigned char* dst = out + (size_t)y * (1 + w * 3);
+            *dst++ = 0;
+            for (int x = 0; x < w; x++) {
+                dst[x * 3 + 0] = src[x * 4 + 0];
+                dst[x * 3 + 1] = src[x * 4 + 1];
+                dst[x * 3 + 2] = src[x * 4 + 2];
+            }
+        }
+        char file_name[1024];
+        snprintf(file_name, sizeof(file_name), this->path, (int)frame);
+        if (!writePng(file_name, out, w, h)) {
+            SOUP_LOG_ERROR("could not write %s", file_name);
+        }
+        return;
+    }
+
+    // BT.601 in fixed point, chroma averaged over each 2x2 block
+    int chroma_w = (w + 1) / 2, chroma_h = (h + 1) / 2;
+    unsigned char* y_plane = out;
+    unsigned char* u_plane = y_plane + (size_t)w * h;
+    unsigned char* v_plane = u_plane + (size_t)chroma_w * chroma_h;
+    for (int y = 0; y < h; y++) {
+        const unsigned char* src = rgba + (size_t)(h - 1 - y) * w * 4;
+        unsigned char* dst = y_plane + (size_t)y * w;
+        for (int x = 0; x < w; x++) {
+            int r = src[x * 4 + 0], g = src[x * 4 + 1], b = src[x * 4 + 2];
+            dst[x] = clampByte(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+    }
+    for (int cy = 0; cy < chroma_h; cy++) {
+        int y0 = h - 1 - 2 * cy;
+        int y1 = (y0 > 0) ? y0 - 1 : y0;
+        const unsigned char* row0 = rgba + (size_t)y0 * w * 4;
+        const unsigned char* row1 = rgba + (size_t)y1 * w * 4;
+        for (int cx = 0; cx < chroma_w; cx++) {
+            int x0 = 2 * cx;
+            int x1 = (x0 + 1 < w) ? x0 + 1 : x0;
+            int r = (row0[x0 * 4] + row0[x1 * 4] + row1[x0 * 4] + row1[x1 * 4] + 2) >> 2;
+            int g = (row0[x0 * 4 + 1] + row0[x1 * 4 + 1] +
+                     row1[x0 * 4 + 1] + row1[x1 * 4 + 1] + 2) >> 2;
+            int b = (row0[x0 * 4 + 2] + row0[x1 * 4 + 2] +
+                     row1[x0 * 4 + 2] + row1[x1 * 4 + 2] + 2) >> 2;
+            size_t i = (size_t)cy * chroma_w + cx;
+            u_plane[i] = clampByte(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v_plane[i] = clampByte(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+    fputs("FRAME\n", this->stream);
+    fwrite(out, 1, this->converted.size(), this->stream);
+}
+
+void FrameCapture::close() {
+    if (!this->isOpen()) {
+        return;
+    }
+    while (this->n_in_flight > 0) {
+        this->retire(true);
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->encoding = false;
+    }
+    this->wake_up.notify_all();
+    this->encoder.join();
+
+    for (int i = 0; i < N_PBOS; i++) {
+        glDeleteBuffers(1, &this->ring[i].pbo);
+        this->ring[i].pbo = 0;
+    }
+    if (this->format == CAPTURE_FFMPEG) {
+        if (pclose(this->stream) != 0) {
+            SOUP_LOG_ERROR("ffmpeg failed to encode %s", this->path);
+        }
+    } else if (this->stream && this->stream != stdout) {
+        fclose(this->stream);
+    } else if (this->stream) {
+        fflush(this->stream);
+    }
+    this->stream = nullptr;
+
+    const captureStats& stats = this->capture_stats;
+    double encode_ms = stats.n_frames ? stats.encode_seconds * 1000.0 / stats.n_frames : 0.0;
+    // part of the run report, which release builds print too
+    fprintf(stderr, "capture: %llu frames to %s, %.2f ms encode per frame, "
+                    "%llu readback stalls, %llu encoder stalls\n",
+            (unsigned long long)stats.n_frames, this->path, encode_ms,
+            (unsigned long long)stats.n_readback_stalls,
+            (unsigned long long)stats.n_encoder_stalls);
+    for (int i = 0; i < N_ENCODER_FRAMES; i++) {
+        std::vector<unsigned char>().swap(this->frames[i]);
+    }
+    this->width = 0;
+    this->height = 0;
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef SOUPCANS_FRAME_CAPTURE_HPP
+#define SOUPCANS_FRAME_CAPTURE_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <GL/gl3w.h>
+
+namespace soupcans {
+
+enum captureFormat {
+    // one YUV4MPEG2 stream, 4:2:0
+    CAPTURE_Y4M,
+    // numbered files from a printf pattern such as frames/%05d.png
+    CAPTURE_PNG,
+    // the Y4M stream piped into a local ffmpeg, which picks the codec from the file name
+    CAPTURE_FFMPEG
+};
+
+// .y4m and "-" (stdout) are Y4M, a pattern with % is PNG, anything else goes through ffmpeg
+captureFormat captureFormatFor(const char* path);
+
+struct captureStats {
+    uint64_t n_frames;
+    // readbacks still in flight when their PBO came round again
+    uint64_t n_readback_stalls;
+    // frames that had to wait for the encoder to free a buffer
+    uint64_t n_encoder_stalls;
+    double encode_seconds;
+};
+
+/* Writes every rendered frame to a video or image sequence without
+   stalling the render loop. capture() only queues an asynchronous
+   glReadPixels into the next PBO of a ring and fences it; the frame is
+   mapped a few frames later, once its fence has signaled, and handed to
+   an encoder thread that converts and writes it. Readback and encoding
+   overlap the rendering of the frames after it.
+*/
+class FrameCapture {
+    public:
+        FrameCapture();
+        ~FrameCapture();
+
+        FrameCapture(const FrameCapture&) = delete;
+        FrameCapture& operator=(const FrameCapture&) = delete;
+
+        // captures the current framebuffer at this size, call with the context current
+        bool open(const char* path, int width, int height, double fps);
+
+        // after rendering a frame and before presenting it
+        void capture();
+
+        // drains the ring and the encoder, call while the context is still current
+        void close();
+
+        bool isOpen() const {
+            return this->width > 0;
+        }
+        const captureStats& stats() const {
+            return this->capture_stats;
+        }
+
+    private:
+        static const int N_PBOS = 3;
+        static const int N_ENCODER_FRAMES = 4;
+
+        struct readback {
+            GLuint pbo;
+            GLsync fence;
+        };
+
+        const char* path;
+        captureFormat format;
+        int width;
+        int height;
+        double fps;
+        FILE* stream;
+
+        readback ring[N_PBOS];
+        // ring[oldest] is the oldest readback in flight, n_in_flight of them
+        int oldest;
+        int n_in_flight;
+        uint64_t n_read;
+
+        // RGBA frames going to the encoder; free_frames and queued_frames hold indices
+        std::vector<unsigned char> frames[N_ENCODER_FRAMES];
+        std::vector<int> free_frames;
+        std::vector<int> queued_frames;
+        std::mutex mutex;
+        std::condition_variable wake_up;
+        std::thread encoder;
+        bool encoding;
+        // encoder thread scratch, sized once at open()
+        std::vector<unsigned char> converted;
+
+        captureStats capture_stats;
+
+        void retire(bool wait);
+        void encoderLoop();
+        void encodeFrame(const unsigned char* rgba, uint64_t frame);
+};
+
+}
+
+#endif
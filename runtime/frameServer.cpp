@@ -0,0 +1,141 @@
+#include <stdio.h>
+
+#include "../common/log.hpp"
+#include "frameServer.hpp"
+
+namespace soupcans {
+
+FrameServer::FrameServer() {
+    this->width = 0;
+    this->height = 0;
+    for (int i = 0; i < N_PBOS; i++) {
+        this->ring[i] = readback{ 0, 0, 0, 0 };
+    }
+    this->oldest = 0;
+    this->n_in_flight = 0;
+    this->n_served = 0;
+    this->server_stats = frameServerStats{};
+}
+
+FrameServer::~FrameServer() {
+    if (this->isOpen()) {
+        SOUP_LOG_WARNING("frame server never closed, frames in flight are lost");
+    }
+}
+
+bool FrameServer::open(const char* socket_path, int width, int height) {
+    if (width <= 0 || height <= 0 || !this->share.open(socket_path, width, height)) {
+        return false;
+    }
+    this->width = width;
+    this->height = height;
+    size_t frame_size = this->share.frameSize();
+    for (int i = 0; i < N_PBOS; i++) {
+        glGenBuffers(1, &this->ring[i].pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, this->ring[i].pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frame_size, nullptr, GL_STREAM_READ);
+        this->ring[i].fence = 0;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    this->oldest = 0;
+    this->n_in_flight = 0;
+    this->n_served = 0;
+    this->server_stats = frameServerStats{};
+    return true;
+}
+
+void FrameServer::serve() {
+    if (!this->isOpen()) {
+        return;
+    }
+    this->share.serviceConnections();
+    uint64_t frame = this->n_served++;
+    if (this->share.consumerCount() == 0) {
+        // nobody left to hand them to
+        while (this->n_in_flight > 0) {
+            glDeleteSync(this->ring[this->oldest].fence);
+            this->ring[this->oldest].fence = 0;
+            this->oldest = (this->oldest + 1) % N_PBOS;
+            this->n_in_flight--;
+        }
+        this->server_stats.n_unwatched++;
+        return;
+    }
+    if (this->n_in_flight == N_PBOS) {
+        // the GPU is more than a ring behind, only now does the CPU wait for it
+        this->server_stats.n_readback_stalls++;
+        this->retire(true);
+    }
+
+    int next = (this->oldest + this->n_in_flight) % N_PBOS;
+    readback& slot = this->ring[next];
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    // with a pack buffer bound this returns at once, the copy happens on the GPU
+    glReadPixels(0, 0, this->width, this->height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.frame = frame;
+    slot.capture_ns = frameShareClockNs();
+    this->n_in_flight++;
+
+    // publish whatever has landed, oldest first so frame numbers only go up
+    while (this->n_in_flight > 0) {
+        GLenum status = glClientWaitSync(this->ring[this->oldest].fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        this->retire(false);
+    }
+}
+
+// copies the oldest readback into a shared slot and publishes it
+void FrameServer::retire(bool wait) {
+    readback& slot = this->ring[this->oldest];
+    if (wait) {
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    }
+    glDeleteSync(slot.fence);
+    slot.fence = 0;
+
+    // no slot free means every consumer is still on an older frame, this one is dropped
+    unsigned char* pixels = this->share.beginFrame();
+    if (pixels) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, this->share.frameSize(), pixels);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        this->share.publish(slot.frame, slot.capture_ns);
+        this->server_stats.n_frames++;
+    }
+    this->oldest = (this->oldest + 1) % N_PBOS;
+    this->n_in_flight--;
+}
+
+void FrameServer::close() {
+    if (!this->isOpen()) {
+        return;
+    }
+    while (this->n_in_flight > 0) {
+        this->retire(true);
+    }
+    for (int i = 0; i < N_PBOS; i++) {
+        glDeleteBuffers(1, &this->ring[i].pbo);
+        this->ring[i].pbo = 0;
+    }
+    const frameServerStats& stats = this->server_stats;
+    const frameShareStats& shared = this->share.stats();
+    // part of the run report, which release builds print too
+    fprintf(stderr, "frame server: %llu frames published, %llu dropped with every slot taken, "
+                    "%llu unwatched, %llu readback stalls, %llu consumers over the run\n",
+            (unsigned long long)stats.n_frames, (unsigned long long)shared.n_dropped,
+            (unsigned long long)stats.n_unwatched,
+            (unsigned long long)stats.n_readback_stalls,
+            (unsigned long long)shared.n_connections);
+    this->share.close();
+    this->width = 0;
+    this->height = 0;
+}
+
+}
@@ -0,0 +1,79 @@
+#ifndef SOUPCANS_FRAME_SERVER_HPP
+#define SOUPCANS_FRAME_SERVER_HPP
+
+#include <stdint.h>
+
+#include <GL/gl3w.h>
+
+#include "../common/frameShare.hpp"
+
+namespace soupcans {
+
+struct frameServerStats {
+    uint64_t n_frames;
+    // frames rendered while no consumer was connected, never read back
+    uint64_t n_unwatched;
+    // readbacks still in flight when their PBO came round again
+    uint64_t n_readback_stalls;
+};
+
+/* Publishes every rendered frame to local consumers through a
+   FrameShareServer, see frameShare.hpp. Like FrameCapture, serve() only
+   queues an asynchronous glReadPixels into a ring of PBOs and fences it;
+   once the fence has signaled the pixels go straight from the PBO into a
+   free shared slot and the consumers are woken. Consumers read that slot
+   in place, so the one copy on the CPU is out of the PBO. While nobody is
+   connected nothing is read back at all.
+*/
+class FrameServer {
+    public:
+        FrameServer();
+        ~FrameServer();
+
+        FrameServer(const FrameServer&) = delete;
+        FrameServer& operator=(const FrameServer&) = delete;
+
+        // serves the current framebuffer at this size, call with the context current
+        bool open(const char* socket_path, int width, int height);
+
+        // after rendering a frame and before presenting it
+        void serve();
+
+        // publishes what is still in flight, call while the context is still current
+        void close();
+
+        bool isOpen() const {
+            return this->width > 0;
+        }
+        const frameServerStats& stats() const {
+            return this->server_stats;
+        }
+
+    private:
+        static const int N_PBOS = 3;
+
+        struct readback {
+            GLuint pbo;
+            GLsync fence;
+            uint64_t frame;
+            uint64_t capture_ns;
+        };
+
+        FrameShareServer share;
+        int width;
+        int height;
+
+        readback ring[N_PBOS];
+        // ring[oldest] is the oldest readback in flight, n_in_flight of them
+        int oldest;
+        int n_in_flight;
+        uint64_t n_served;
+
+        frameServerStats server_stats;
+
+        void retire(bool wait);
+};
+
+}
+
+#endif
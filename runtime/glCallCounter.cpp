@@ -0,0 +1,227 @@
+#include "glCallCounter.hpp"
+
+namespace soupcans {
+
+static glCallCounts g_gl_calls;
+
+static PFNGLDRAWARRAYSPROC real_draw_arrays;
+static PFNGLDRAWELEMENTSPROC real_draw_elements;
+static PFNGLDRAWARRAYSINSTANCEDPROC real_draw_arrays_instanced;
+static PFNGLDRAWELEMENTSINSTANCEDPROC real_draw_elements_instanced;
+static PFNGLUSEPROGRAMPROC real_use_program;
+static PFNGLBINDVERTEXARRAYPROC real_bind_vertex_array;
+static PFNGLBINDBUFFERPROC real_bind_buffer;
+static PFNGLBINDTEXTUREPROC real_bind_texture;
+static PFNGLBINDSAMPLERPROC real_bind_sampler;
+static PFNGLBINDFRAMEBUFFERPROC real_bind_framebuffer;
+static PFNGLUNIFORM1FPROC real_uniform1f;
+static PFNGLUNIFORM1IPROC real_uniform1i;
+static PFNGLUNIFORM2FPROC real_uniform2f;
+static PFNGLUNIFORMMATRIX3FVPROC real_uniform_matrix3fv;
+static PFNGLUNIFORMMATRIX4FVPROC real_uniform_matrix4fv;
+static PFNGLBUFFERDATAPROC real_buffer_data;
+static PFNGLBUFFERSUBDATAPROC real_buffer_sub_data;
+static PFNGLTEXIMAGE2DPROC real_tex_image_2d;
+static PFNGLTEXSUBIMAGE2DPROC real_tex_sub_image_2d;
+static PFNGLTEXSUBIMAGE3DPROC real_tex_sub_image_3d;
+static PFNGLCLEARPROC real_clear;
+
+// close enough for the 8 bit formats the demos upload
+static uint64_t textureBytes(GLsizei width, GLsizei height, GLenum format) {
+    uint64_t channels = 4;
+    if (format == GL_RED) {
+        channels = 1;
+    } else if (format == GL_RG) {
+        channels = 2;
+    } else if (format == GL_RGB || format == GL_BGR) {
+        channels = 3;
+    }
+    return (uint64_t)width * height * channels;
+}
+
+static void APIENTRY countedDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    g_gl_calls.draw_calls++;
+    real_draw_arrays(mode, first, count);
+}
+
+static void APIENTRY countedDrawElements(GLenum mode, GLsizei count, GLenum type,
+                                         const void* indices) {
+    g_gl_calls.draw_calls++;
+    real_draw_elements(mode, count, type, indices);
+}
+
+static void APIENTRY countedDrawArraysInstanced(GLenum mode, GLint first, GLsizei count,
+                                                GLsizei instance_count) {
+    g_gl_calls.draw_calls++;
+    real_draw_arrays_instanced(mode, first, count, instance_count);
+}
+
+static void APIENTRY countedDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                                                  const void* indices,
+                                                  GLsizei instance_count) {
+    g_gl_calls.draw_calls++;
+    real_draw_elements_instanced(mode, count, type, indices, instance_count);
+}
+
+static void APIENTRY countedUseProgram(GLuint program) {
+    g_gl_calls.binds++;
+    real_use_program(program);
+}
+
+static void APIENTRY countedBindVertexArray(GLuint array) {
+    g_gl_calls.binds++;
+    real_bind_vertex_array(array);
+}
+
+static void APIENTRY countedBindBuffer(GLenum target, GLuint buffer) {
+    g_gl_calls.binds++;
+    real_bind_buffer(target, buffer);
+}
+
+static void APIENTRY countedBindTexture(GLenum target, GLuint texture) {
+    g_gl_calls.binds++;
+    real_bind_texture(target, texture);
+}
+
+static void APIENTRY countedBindSampler(GLuint unit, GLuint sampler) {
+    g_gl_calls.binds++;
+    real_bind_sampler(unit, sampler);
+}
+
+static void APIENTRY countedBindFramebuffer(GLenum target, GLuint framebuffer) {
+    g_gl_calls.binds++;
+    real_bind_framebuffer(target, framebuffer);
+}
+
+static void APIENTRY countedUniform1f(GLint location, GLfloat v0) {
+    g_gl_calls.uniform_updates++;
+    real_uniform1f(location, v0);
+}
+
+static void APIENTRY countedUniform1i(GLint location, GLint v0) {
+    g_gl_calls.uniform_updates++;
+    real_uniform1i(location, v0);
+}
+
+static void APIENTRY countedUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+    g_gl_calls.uniform_updates++;
+    real_uniform2f(location, v0, v1);
+}
+
+static void APIENTRY countedUniformMatrix3fv(GLint location, GLsizei count,
+                                             GLboolean transpose, const GLfloat* value) {
+    g_gl_calls.uniform_updates++;
+    real_uniform_matrix3fv(location, count, transpose, value);
+}
+
+static void APIENTRY countedUniformMatrix4fv(GLint location, GLsizei count,
+                                             GLboolean transpose, const GLfloat* value) {
+    g_gl_calls.uniform_updates++;
+    real_uniform_matrix4fv(location, count, transpose, value);
+}
+
+static void APIENTRY countedBufferData(GLenum target, GLsizeiptr size, const void* data,
+                                       GLenum usage) {
+    g_gl_calls.uploads++;
+    g_gl_calls.upload_bytes += data ? size : 0;
+    real_buffer_data(target, size, data, usage);
+}
+
+static void APIENTRY countedBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
+                                          const void* data) {
+    g_gl_calls.uploads++;
+    g_gl_calls.upload_bytes += size;
+    real_buffer_sub_data(target, offset, size, data);
+}
+
+static void APIENTRY countedTexImage2D(GLenum target, GLint level, GLint internal_format,
+                                       GLsizei width, GLsizei height, GLint border,
+                                       GLenum format, GLenum type, const void* pixels) {
+    g_gl_calls.uploads++;
+    g_gl_calls.upload_bytes += pixels ? textureBytes(width, height, format) : 0;
+    real_tex_image_2d(target, level, internal_format, width, height, border,
+                      format, type, pixels);
+}
+
+static void APIENTRY countedTexSubImage2D(GLenum target, GLint level, GLint x_offset,
+                                          GLint y_offset, GLsizei width, GLsizei height,
+                                          GLenum format, GLenum type, const void* pixels) {
+    g_gl_calls.uploads++;
+    g_gl_calls.upload_bytes += textureBytes(width, height, format);
+    real_tex_sub_image_2d(target, level, x_offset, y_offset, width, height,
+                          format, type, pixels);
+}
+
+static void APIENTRY countedTexSubImage3D(GLenum target, GLint level, GLint x_offset,
+                                          GLint y_offset, GLint z_offset, GLsizei width,
+                                          GLsizei height, GLsizei depth, GLenum format,
+                                          GLenum type, const void* pixels) {
+    g_gl_calls.uploads++;
+    g_gl_calls.upload_bytes += textureBytes(width, height, format) * depth;
+    real_tex_sub_image_3d(target, level, x_offset, y_offset, z_offset, width, height, depth,
+                          format, type, pixels);
+}
+
+static void APIENTRY countedClear(GLbitfield mask) {
+    g_gl_calls.clears++;
+    real_clear(mask);
+}
+
+void installGlCallCounters() {
+    // gl3w exposes every entry point as an assignable function pointer
+    if (glDrawArrays == countedDrawArrays) {
+        return;
+    }
+    real_draw_arrays = glDrawArrays;
+    glDrawArrays = countedDrawArrays;
+    real_draw_elements = glDrawElements;
+    glDrawElements = countedDrawElements;
+    real_draw_arrays_instanced = glDrawArraysInstanced;
+    glDrawArraysInstanced = countedDrawArraysInstanced;
+    real_draw_elements_instanced = glDrawElementsInstanced;
+    glDrawElementsInstanced = countedDrawElementsInstanced;
+
+    real_use_program = glUseProgram;
+    glUseProgram = countedUseProgram;
+    real_bind_vertex_array = glBindVertexArray;
+    glBindVertexArray = countedBindVertexArray;
+    real_bind_buffer = glBindBuffer;
+    glBindBuffer = countedBindBuffer;
+    real_bind_texture = glBindTexture;
+    glBindTexture = countedBindTexture;
+    real_bind_sampler = glBindSampler;
+    glBindSampler = countedBindSampler;
+    real_bind_framebuffer = glBindFramebuffer;
+    glBindFramebuffer = countedBindFramebuffer;
+
+    real_uniform1f = glUniform1f;
+    glUniform1f = countedUniform1f;
+    real_uniform1i = glUniform1i;
+    glUniform1i = countedUniform1i;
+    real_uniform2f = glUniform2f;
+    glUniform2f = countedUniform2f;
+    real_uniform_matrix3fv = glUniformMatrix3fv;
+    glUniformMatrix3fv = countedUniformMatrix3fv;
+    real_uniform_matrix4fv = glUniformMatrix4fv;
+    glUniformMatrix4fv = countedUniformMatrix4fv;
+
+    real_buffer_data = glBufferData;
+    glBufferData = countedBufferData;
+    real_buffer_sub_data = glBufferSubData;
+    glBufferSubData = countedBufferSubData;
+    real_tex_image_2d = glTexImage2D;
+    glTexImage2D = countedTexImage2D;
+    real_tex_sub_image_2d = glTexSubImage2D;
+    glTexSubImage2D = countedTexSubImage2D;
+    real_tex_sub_image_3d = glTexSubImage3D;
+    glTexSubImage3D = countedTexSubImage3D;
+
+    real_clear = glClear;
+    glClear = countedClear;
+}
+
+const glCallCounts& glCallTotals() {
+    return g_gl_calls;
+}
+
+}
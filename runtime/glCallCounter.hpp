@@ -0,0 +1,45 @@
+#ifndef SOUPCANS_GL_CALL_COUNTER_HPP
+#define SOUPCANS_GL_CALL_COUNTER_HPP
+
+#include <stdint.h>
+
+#include <GL/gl3w.h>
+
+namespace soupcans {
+
+// running totals of the GL calls that matter for frame cost
+struct glCallCounts {
+    uint64_t draw_calls;
+    // program, vertex array, buffer, texture, sampler and framebuffer binds
+    uint64_t binds;
+    uint64_t uniform_updates;
+    // buffer and texture uploads, and how many bytes they moved
+    uint64_t uploads;
+    uint64_t upload_bytes;
+    uint64_t clears;
+};
+
+/* Swaps the gl3w entry points for the calls above with counting wrappers
+   that forward to the driver, on top of the resource tracking wrappers;
+   install after loadGlEntryPoints(). Meant for benchmarks, counting
+   is not free and only works from the thread owning the context.
+*/
+void installGlCallCounters();
+
+const glCallCounts& glCallTotals();
+
+inline glCallCounts glCallCountsSince(const glCallCounts& start) {
+    const glCallCounts& now = glCallTotals();
+    glCallCounts diff;
+    diff.draw_calls = now.draw_calls - start.draw_calls;
+    diff.binds = now.binds - start.binds;
+    diff.uniform_updates = now.uniform_updates - start.uniform_updates;
+    diff.uploads = now.uploads - start.uploads;
+    diff.upload_bytes = now.upload_bytes - start.upload_bytes;
+    diff.clears = now.clears - start.clears;
+    return diff;
+}
+
+}
+
+#endif
@@ -0,0 +1,510 @@
+#include <string.h>
+
+#include <vector>
+
+#include "../common/log.hpp"
+#include "glResources.hpp"
+
+namespace soupcans {
+
+static thread_local GlResourceRegistry* t_registry = nullptr;
+static thread_local const char* t_owner = "runtime";
+
+const char* glResourceKindName(glResourceKind kind) {
+    static const char* NAMES[N_GL_RESOURCE_KINDS] = {
+        "buffers", "textures", "renderbuffers", "programs", "shaders",
+        "vertex arrays", "framebuffers", "samplers", "queries"
+    };
+    return (kind >= 0 && kind < N_GL_RESOURCE_KINDS) ? NAMES[kind] : "objects";
+}
+
+// GL names are only unique per kind
+static uint64_t objectKey(glResourceKind kind, GLuint name) {
+    return ((uint64_t)kind << 32) | name;
+}
+
+GlResourceRegistry::GlResourceRegistry() {
+    this->current = glResourceTotals{};
+    this->peak_bytes = 0;
+}
+
+GlResourceRegistry::~GlResourceRegistry() {
+    this->detach();
+}
+
+void GlResourceRegistry::makeCurrent() {
+    t_registry = this;
+}
+
+void GlResourceRegistry::detach() {
+    if (t_registry == this) {
+        t_registry = nullptr;
+    }
+}
+
+void GlResourceRegistry::created(glResourceKind kind, GLuint name) {
+    if (name == 0) {
+        return;
+    }
+    record& object = this->objects[objectKey(kind, name)];
+    if (object.owner) {
+        // the driver handed out a name the registry thought was still alive
+        this->current.bytes[kind] -= object.bytes;
+        this->current.count[kind]--;
+    }
+    object = record{ t_owner, 0 };
+    this->current.count[kind]++;
+}
+
+void GlResourceRegistry::deleted(glResourceKind kind, GLuint name) {
+    std::unordered_map<uint64_t, record>::iterator found =
+        this->objects.find(objectKey(kind, name));
+    if (found == this->objects.end()) {
+        // made before tracking started, or by another thread's context
+        return;
+    }
+    this->current.bytes[kind] -= found->second.bytes;
+    this->current.count[kind]--;
+    this->objects.erase(found);
+}
+
+void GlResourceRegistry::resized(glResourceKind kind, GLuint name, uint64_t bytes,
+                                 bool add_to_existing) {
+    std::unordered_map<uint64_t, record>::iterator found =
+        this->objects.find(objectKey(kind, name));
+    if (found == this->objects.end()) {
+        return;
+    }
+    this->current.bytes[kind] -= found->second.bytes;
+    found->second.bytes = add_to_existing ? found->second.bytes + bytes : bytes;
+    this->current.bytes[kind] += found->second.bytes;
+    uint64_t total = this->current.totalBytes();
+    if (total > this->peak_bytes) {
+        this->peak_bytes = total;
+    }
+}
+
+uint64_t GlResourceRegistry::reportLeaks() {
+    struct leak {
+        const char* owner;
+        int kind;
+        uint64_t count;
+        uint64_t bytes;
+    };
+    std::vector<leak> leaks;
+    for (const std::pair<const uint64_t, record>& entry : this->objects) {
+        int kind = (int)(entry.first >> 32);
+        leak* match = nullptr;
+        for (leak& l : leaks) {
+            if (l.kind == kind && !strcmp(l.owner, entry.second.owner)) {
+                match = &l;
+                break;
+            }
+        }
+        if (!match) {
+            leaks.push_back(leak{ entry.second.owner, kind, 0, 0 });
+            match = &leaks.back();
+        }
+        match->count++;
+        match->bytes += entry.second.bytes;
+    }
+    for (const leak& l : leaks) {
+        SOUP_LOG_WARNING("%s leaked %llu %s (~%.1f KB)", l.owner, (unsigned long long)l.count,
+                         glResourceKindName((glResourceKind)l.kind), l.bytes / 1024.0);
+    }
+    uint64_t n_leaked = this->objects.size();
+    this->clear();
+    return n_leaked;
+}
+
+void GlResourceRegistry::clear() {
+    this->objects.clear();
+    this->current = glResourceTotals{};
+    this->peak_bytes = 0;
+}
+
+glResourceOwner::glResourceOwner(const char* owner) {
+    this->previous = t_owner;
+    t_owner = owner;
+}
+
+glResourceOwner::~glResourceOwner() {
+    t_owner = this->previous;
+}
+
+// an owner of nullptr keeps objects out of the registry, see TextureRegistry
+static GlResourceRegistry* recording() {
+    return t_owner ? t_registry : nullptr;
+}
+
+// close enough per texel or sample, RGB formats are padded to 4 bytes by every driver
+static uint64_t bytesPerTexel(GLenum internal_format) {
+    switch (internal_format) {
+        case GL_R8:
+        case GL_RED:
+            return 1;
+        case GL_RG8:
+        case GL_RG:
+        case GL_R16F:
+        case GL_DEPTH_COMPONENT16:
+            return 2;
+        case GL_RGB16F:
+        case GL_RGBA16F:
+        case GL_RG32F:
+        case GL_DEPTH32F_STENCIL8:
+            return 8;
+        case GL_RGB32F:
+        case GL_RGBA32F:
+            return 16;
+        default:
+            // RGB8, RGBA8, sRGB, R32F, R11G11B10F, RGB10_A2 and the 24 and 32 bit depths
+            return 4;
+    }
+}
+
+static GLenum textureBinding(GLenum target) {
+    switch (target) {
+        case GL_TEXTURE_2D: return GL_TEXTURE_BINDING_2D;
+        case GL_TEXTURE_2D_ARRAY: return GL_TEXTURE_BINDING_2D_ARRAY;
+        case GL_TEXTURE_3D: return GL_TEXTURE_BINDING_3D;
+        case GL_TEXTURE_2D_MULTISAMPLE: return GL_TEXTURE_BINDING_2D_MULTISAMPLE;
+        case GL_TEXTURE_CUBE_MAP: return GL_TEXTURE_BINDING_CUBE_MAP;
+        default: break;
+    }
+    if (target >= GL_TEXTURE_CUBE_MAP_POSITIVE_X && target <= GL_TEXTURE_CUBE_MAP_NEGATIVE_Z) {
+        return GL_TEXTURE_BINDING_CUBE_MAP;
+    }
+    return 0;
+}
+
+static GLenum bufferBinding(GLenum target) {
+    switch (target) {
+        case GL_ARRAY_BUFFER: return GL_ARRAY_BUFFER_BINDING;
+        case GL_ELEMENT_ARRAY_BUFFER: return GL_ELEMENT_ARRAY_BUFFER_BINDING;
+        case GL_UNIFORM_BUFFER: return GL_UNIFORM_BUFFER_BINDING;
+        case GL_SHADER_STORAGE_BUFFER: return GL_SHADER_STORAGE_BUFFER_BINDING;
+        case GL_PIXEL_PACK_BUFFER: return GL_PIXEL_PACK_BUFFER_BINDING;
+        case GL_PIXEL_UNPACK_BUFFER: return GL_PIXEL_UNPACK_BUFFER_BINDING;
+        case GL_COPY_READ_BUFFER: return GL_COPY_READ_BUFFER_BINDING;
+        case GL_COPY_WRITE_BUFFER: return GL_COPY_WRITE_BUFFER_BINDING;
+        case GL_DRAW_INDIRECT_BUFFER: return GL_DRAW_INDIRECT_BUFFER_BINDING;
+        case GL_DISPATCH_INDIRECT_BUFFER: return GL_DISPATCH_INDIRECT_BUFFER_BINDING;
+        case GL_ATOMIC_COUNTER_BUFFER: return GL_ATOMIC_COUNTER_BUFFER_BINDING;
+        case GL_TRANSFORM_FEEDBACK_BUFFER: return GL_TRANSFORM_FEEDBACK_BUFFER_BINDING;
+        default: return 0;
+    }
+}
+
+// what the storage call is about to size, 0 for a target the registry doesn't follow
+static GLuint boundObject(GLenum binding) {
+    if (binding == 0) {
+        return 0;
+    }
+    GLint name = 0;
+    glGetIntegerv(binding, &name);
+    return (GLuint)name;
+}
+
+static uint64_t mipChainBytes(GLsizei levels, GLsizei width, GLsizei height, GLsizei depth,
+                              bool depth_is_layers, GLenum internal_format) {
+    uint64_t bytes = 0;
+    for (GLsizei level = 0; level < levels; level++) {
+        bytes += (uint64_t)width * height * depth;
+        width = (width > 1) ? width / 2 : 1;
+        height = (height > 1) ? height / 2 : 1;
+        if (!depth_is_layers) {
+            depth = (depth > 1) ? depth / 2 : 1;
+        }
+    }
+    return bytes * bytesPerTexel(internal_format);
+}
+
+static PFNGLGENBUFFERSPROC real_gen_buffers;
+static PFNGLDELETEBUFFERSPROC real_delete_buffers;
+static PFNGLBUFFERDATAPROC real_buffer_data;
+static PFNGLBUFFERSTORAGEPROC real_buffer_storage;
+static PFNGLGENTEXTURESPROC real_gen_textures;
+static PFNGLDELETETEXTURESPROC real_delete_textures;
+static PFNGLTEXSTORAGE2DPROC real_tex_storage_2d;
+static PFNGLTEXSTORAGE3DPROC real_tex_storage_3d;
+static PFNGLTEXSTORAGE2DMULTISAMPLEPROC real_tex_storage_2d_multisample;
+static PFNGLTEXIMAGE2DPROC real_tex_image_2d;
+static PFNGLGENRENDERBUFFERSPROC real_gen_renderbuffers;
+static PFNGLDELETERENDERBUFFERSPROC real_delete_renderbuffers;
+static PFNGLRENDERBUFFERSTORAGEPROC real_renderbuffer_storage;
+static PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC real_renderbuffer_storage_multisample;
+static PFNGLCREATEPROGRAMPROC real_create_program;
+static PFNGLDELETEPROGRAMPROC real_delete_program;
+static PFNGLCREATESHADERPROC real_create_shader;
+static PFNGLDELETESHADERPROC real_delete_shader;
+static PFNGLGENVERTEXARRAYSPROC real_gen_vertex_arrays;
+static PFNGLDELETEVERTEXARRAYSPROC real_delete_vertex_arrays;
+static PFNGLGENFRAMEBUFFERSPROC real_gen_framebuffers;
+static PFNGLDELETEFRAMEBUFFERSPROC real_delete_framebuffers;
+static PFNGLGENSAMPLERSPROC real_gen_samplers;
+static PFNGLDELETESAMPLERSPROC real_delete_samplers;
+static PFNGLGENQUERIESPROC real_gen_queries;
+static PFNGLDELETEQUERIESPROC real_delete_queries;
+
+static void recordCreated(glResourceKind kind, GLsizei n, const GLuint* names) {
+    GlResourceRegistry* registry = recording();
+    for (GLsizei i = 0; registry && i < n; i++) {
+        registry->created(kind, names[i]);
+    }
+}
+
+// deletes are recorded whoever owns them, an object belongs to whoever made it
+static void recordDeleted(glResourceKind kind, GLsizei n, const GLuint* names) {
+    for (GLsizei i = 0; t_registry && i < n; i++) {
+        t_registry->deleted(kind, names[i]);
+    }
+}
+
+static void recordResized(glResourceKind kind, GLuint name, uint64_t bytes,
+                          bool add_to_existing) {
+    if (t_registry && name != 0) {
+        t_registry->resized(kind, name, bytes, add_to_existing);
+    }
+}
+
+static void APIENTRY trackedGenBuffers(GLsizei n, GLuint* buffers) {
+    real_gen_buffers(n, buffers);
+    recordCreated(GL_RESOURCE_BUFFER, n, buffers);
+}
+
+static void APIENTRY trackedDeleteBuffers(GLsizei n, const GLuint* buffers) {
+    recordDeleted(GL_RESOURCE_BUFFER, n, buffers);
+    real_delete_buffers(n, buffers);
+}
+
+static void APIENTRY trackedBufferData(GLenum target, GLsizeiptr size, const void* data,
+                                       GLenum usage) {
+    if (t_registry) {
+        recordResized(GL_RESOURCE_BUFFER, boundObject(bufferBinding(target)), size, false);
+    }
+    real_buffer_data(target, size, data, usage);
+}
+
+static void APIENTRY trackedBufferStorage(GLenum target, GLsizeiptr size, const void* data,
+                                          GLbitfield flags) {
+    if (t_registry) {
+        recordResized(GL_RESOURCE_BUFFER, boundObject(bufferBinding(target)), size, false);
+    }
+    real_buffer_storage(target, size, data, flags);
+}
+
+static void APIENTRY trackedGenTextures(GLsizei n, GLuint* textures) {
+    real_gen_textures(n, textures);
+    recordCreated(GL_RESOURCE_TEXTURE, n, textures);
+}
+
+static void APIENTRY trackedDeleteTextures(GLsizei n, const GLuint* textures) {
+    recordDeleted(GL_RESOURCE_TEXTURE, n, textures);
+    real_delete_textures(n, textures);
+}
+
+static void APIENTRY trackedTexStorage2D(GLenum target, GLsizei levels, GLenum internal_format,
+                                         GLsizei width, GLsizei height) {
+    if (t_registry) {
+        uint64_t bytes = mipChainBytes(levels, width, height, 1, true, internal_format);
+        if (target == GL_TEXTURE_CUBE_MAP) {
+            bytes *= 6;
+        }
+        recordResized(GL_RESOURCE_TEXTURE, boundObject(textureBinding(target)), bytes, false);
+    }
+    real_tex_storage_2d(target, levels, internal_format, width, height);
+}
+
+static void APIENTRY trackedTexStorage3D(GLenum target, GLsizei levels, GLenum internal_format,
+                                         GLsizei width, GLsizei height, GLsizei depth) {
+    if (t_registry) {
+        uint64_t bytes = mipChainBytes(levels, width, height, depth, target != GL_TEXTURE_3D,
+                                       internal_format);
+        recordResized(GL_RESOURCE_TEXTURE, boundObject(textureBinding(target)), bytes, false);
+    }
+    real_tex_storage_3d(target, levels, internal_format, width, height, depth);
+}
+
+static void APIENTRY trackedTexStorage2DMultisample(GLenum target, GLsizei samples,
+                                                    GLenum internal_format, GLsizei width,
+                                                    GLsizei height,
+                                                    GLboolean fixed_sample_locations) {
+    if (t_registry) {
+        uint64_t bytes = mipChainBytes(1, width, height, 1, true, internal_format) *
+                         (samples > 1 ? samples : 1);
+        recordResized(GL_RESOURCE_TEXTURE, boundObject(textureBinding(target)), bytes, false);
+    }
+    real_tex_storage_2d_multisample(target, samples, internal_format, width, height,
+                                    fixed_sample_locations);
+}
+
+static void APIENTRY trackedTexImage2D(GLenum target, GLint level, GLint internal_format,
+                                       GLsizei width, GLsizei height, GLint border,
+                                       GLenum format, GLenum type, const void* pixels) {
+    if (t_registry) {
+        // level 0 of the first face starts the texture over, the rest add to it
+        bool first = level == 0 &&
+            (target == GL_TEXTURE_2D || target == GL_TEXTURE_CUBE_MAP_POSITIVE_X);
+        uint64_t bytes = mipChainBytes(1, width, height, 1, true, (GLenum)internal_format);
+        recordResized(GL_RESOURCE_TEXTURE, boundObject(textureBinding(target)), bytes, !first);
+    }
+    real_tex_image_2d(target, level, internal_format, width, height, border,
+                      format, type, pixels);
+}
+
+static void APIENTRY trackedGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+    real_gen_renderbuffers(n, renderbuffers);
+    recordCreated(GL_RESOURCE_RENDERBUFFER, n, renderbuffers);
+}
+
+static void APIENTRY trackedDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+    recordDeleted(GL_RESOURCE_RENDERBUFFER, n, renderbuffers);
+    real_delete_renderbuffers(n, renderbuffers);
+}
+
+static void APIENTRY trackedRenderbufferStorage(GLenum target, GLenum internal_format,
+                                                GLsizei width, GLsizei height) {
+    if (t_registry) {
+        recordResized(GL_RESOURCE_RENDERBUFFER, boundObject(GL_RENDERBUFFER_BINDING),
+                      mipChainBytes(1, width, height, 1, true, internal_format), false);
+    }
+    real_renderbuffer_storage(target, internal_format, width, height);
+}
+
+static void APIENTRY trackedRenderbufferStorageMultisample(GLenum target, GLsizei samples,
+                                                           GLenum internal_format,
+                                                           GLsizei width, GLsizei height) {
+    if (t_registry) {
+        uint64_t bytes = mipChainBytes(1, width, height, 1, true, internal_format) *
+                         (samples > 1 ? samples : 1);
+        recordResized(GL_RESOURCE_RENDERBUFFER, boundObject(GL_RENDERBUFFER_BINDING),
+                      bytes, false);
+    }
+    real_renderbuffer_storage_multisample(target, samples, internal_format, width, height);
+}
+
+static GLuint APIENTRY trackedCreateProgram() {
+    GLuint program = real_create_program();
+    recordCreated(GL_RESOURCE_PROGRAM, 1, &program);
+    return program;
+}
+
+static void APIENTRY trackedDeleteProgram(GLuint program) {
+    recordDeleted(GL_RESOURCE_PROGRAM, 1, &program);
+    real_delete_program(program);
+}
+
+static GLuint APIENTRY trackedCreateShader(GLenum type) {
+    GLuint shader = real_create_shader(type);
+    recordCreated(GL_RESOURCE_SHADER, 1, &shader);
+    return shader;
+}
+
+static void APIENTRY trackedDeleteShader(GLuint shader) {
+    recordDeleted(GL_RESOURCE_SHADER, 1, &shader);
+    real_delete_shader(shader);
+}
+
+static void APIENTRY trackedGenVertexArrays(GLsizei n, GLuint* arrays) {
+    real_gen_vertex_arrays(n, arrays);
+    recordCreated(GL_RESOURCE_VERTEX_ARRAY, n, arrays);
+}
+
+static void APIENTRY trackedDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+    recordDeleted(GL_RESOURCE_VERTEX_ARRAY, n, arrays);
+    real_delete_vertex_arrays(n, arrays);
+}
+
+static void APIENTRY trackedGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+    real_gen_framebuffers(n, framebuffers);
+    recordCreated(GL_RESOURCE_FRAMEBUFFER, n, framebuffers);
+}
+
+static void APIENTRY trackedDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+    recordDeleted(GL_RESOURCE_FRAMEBUFFER, n, framebuffers);
+    real_delete_framebuffers(n, framebuffers);
+}
+
+static void APIENTRY trackedGenSamplers(GLsizei n, GLuint* samplers) {
+    real_gen_samplers(n, samplers);
+    recordCreated(GL_RESOURCE_SAMPLER, n, samplers);
+}
+
+static void APIENTRY trackedDeleteSamplers(GLsizei n, const GLuint* samplers) {
+    recordDeleted(GL_RESOURCE_SAMPLER, n, samplers);
+    real_delete_samplers(n, samplers);
+}
+
+static void APIENTRY trackedGenQueries(GLsizei n, GLuint* queries) {
+    real_gen_queries(n, queries);
+    recordCreated(GL_RESOURCE_QUERY, n, queries);
+}
+
+static void APIENTRY trackedDeleteQueries(GLsizei n, const GLuint* queries) {
+    recordDeleted(GL_RESOURCE_QUERY, n, queries);
+    real_delete_queries(n, queries);
+}
+
+void installGlResourceTracking() {
+    if (glGenBuffers == trackedGenBuffers) {
+        return;
+    }
+    real_gen_buffers = glGenBuffers;
+    glGenBuffers = trackedGenBuffers;
+    real_delete_buffers = glDeleteBuffers;
+    glDeleteBuffers = trackedDeleteBuffers;
+    real_buffer_data = glBufferData;
+    glBufferData = trackedBufferData;
+    real_buffer_storage = glBufferStorage;
+    glBufferStorage = trackedBufferStorage;
+
+    real_gen_textures = glGenTextures;
+    glGenTextures = trackedGenTextures;
+    real_delete_textures = glDeleteTextures;
+    glDeleteTextures = trackedDeleteTextures;
+    real_tex_storage_2d = glTexStorage2D;
+    glTexStorage2D = trackedTexStorage2D;
+    real_tex_storage_3d = glTexStorage3D;
+    glTexStorage3D = trackedTexStorage3D;
+    real_tex_storage_2d_multisample = glTexStorage2DMultisample;
+    glTexStorage2DMultisample = trackedTexStorage2DMultisample;
+    real_tex_image_2d = glTexImage2D;
+    glTexImage2D = trackedTexImage2D;
+
+    real_gen_renderbuffers = glGenRenderbuffers;
+    glGenRenderbuffers = trackedGenRenderbuffers;
+    real_delete_renderbuffers = glDeleteRenderbuffers;
+    glDeleteRenderbuffers = trackedDeleteRenderbuffers;
+    real_renderbuffer_storage = glRenderbufferStorage;
+    glRenderbufferStorage = trackedRenderbufferStorage;
+    real_renderbuffer_storage_multisample = glRenderbufferStorageMultisample;
+    glRenderbufferStorageMultisample = trackedRenderbufferStorageMultisample;
+
+    real_create_program = glCreateProgram;
+    glCreateProgram = trackedCreateProgram;
+    real_delete_program = glDeleteProgram;
+    glDeleteProgram = trackedDeleteProgram;
+    real_create_shader = glCreateShader;
+    glCreateShader = trackedCreateShader;
+    real_delete_shader = glDeleteShader;
+    glDeleteShader = trackedDeleteShader;
+
+    real_gen_vertex_arrays = glGenVertexArrays;
+    glGenVertexArrays = trackedGenVertexArrays;
+    real_delete_vertex_arrays = glDeleteVertexArrays;
+    glDeleteVertexArrays = trackedDeleteVertexArrays;
+    real_gen_framebuffers = glGenFramebuffers;
+    glGenFramebuffers = trackedGenFramebuffers;
+    real_delete_framebuffers = glDeleteFramebuffers;
+    glDeleteFramebuffers = trackedDeleteFramebuffers;
+    real_gen_samplers = glGenSamplers;
+    glGenSamplers = trackedGenSamplers;
+    real_delete_samplers = glDeleteSamplers;
+    glDeleteSamplers = trackedDeleteSamplers;
+    real_gen_queries = glGenQueries;
+    glGenQueries = trackedGenQueries;
+    real_delete_queries = glDeleteQueries;
+    glDeleteQueries = trackedDeleteQueries;
+}
+
+}
@@ -0,0 +1,119 @@
+#ifndef SOUPCANS_GL_RESOURCES_HPP
+#define SOUPCANS_GL_RESOURCES_HPP
+
+#include <stdint.h>
+
+#include <unordered_map>
+
+#include <GL/gl3w.h>
+
+namespace soupcans {
+
+enum glResourceKind {
+    GL_RESOURCE_BUFFER,
+    GL_RESOURCE_TEXTURE,
+    GL_RESOURCE_RENDERBUFFER,
+    GL_RESOURCE_PROGRAM,
+    GL_RESOURCE_SHADER,
+    GL_RESOURCE_VERTEX_ARRAY,
+    GL_RESOURCE_FRAMEBUFFER,
+    GL_RESOURCE_SAMPLER,
+    GL_RESOURCE_QUERY,
+    N_GL_RESOURCE_KINDS
+};
+
+// plural, "buffers", "textures" ...
+const char* glResourceKindName(glResourceKind kind);
+
+struct glResourceTotals {
+    uint64_t count[N_GL_RESOURCE_KINDS];
+    /* What the storage calls asked for: buffer sizes, every texture level
+       and sample, with RGB padded to RGBA the way drivers store it. Only
+       buffers, textures and renderbuffers have any.
+    */
+    uint64_t bytes[N_GL_RESOURCE_KINDS];
+
+    uint64_t totalBytes() const {
+        uint64_t total = 0;
+        for (int i = 0; i < N_GL_RESOURCE_KINDS; i++) {
+            total += this->bytes[i];
+        }
+        return total;
+    }
+};
+
+/* Every GL object made on one thread's context, with its estimated size
+   and the owner that was current when it was made (see glResourceOwner).
+   Nothing has to register anything: installGlResourceTracking() puts
+   wrappers on the gl3w entry points that make, size and delete objects,
+   and they report to the registry current on the calling thread. Whatever
+   is still alive when the context goes is a leak.
+*/
+class GlResourceRegistry {
+    public:
+        GlResourceRegistry();
+        ~GlResourceRegistry();
+
+        GlResourceRegistry(const GlResourceRegistry&) = delete;
+        GlResourceRegistry& operator=(const GlResourceRegistry&) = delete;
+
+        // objects this thread makes and deletes from now on are recorded here
+        void makeCurrent();
+        // stops recording on this thread, if this was the current registry
+        void detach();
+
+        const glResourceTotals& totals() const {
+            return this->current;
+        }
+        // the most bytes alive at once since the last clear()
+        uint64_t peakBytes() const {
+            return this->peak_bytes;
+        }
+
+        /* Logs every object still alive, a line per owner and kind, and
+           forgets them. The number of objects, 0 when nothing leaked.
+        */
+        uint64_t reportLeaks();
+        void clear();
+
+        // for the wrappers
+        void created(glResourceKind kind, GLuint name);
+        void deleted(glResourceKind kind, GLuint name);
+        void resized(glResourceKind kind, GLuint name, uint64_t bytes, bool add_to_existing);
+
+    private:
+        struct record {
+            const char* owner;
+            uint64_t bytes;
+        };
+
+        std::unordered_map<uint64_t, record> objects;
+        glResourceTotals current;
+        uint64_t peak_bytes;
+};
+
+/* While in scope, GL objects made on this thread are put down to `owner`,
+   which has to outlive the registry; scene names and string literals do.
+   "runtime" when no scope is open.
+*/
+class glResourceOwner {
+    public:
+        explicit glResourceOwner(const char* owner);
+        ~glResourceOwner();
+
+        glResourceOwner(const glResourceOwner&) = delete;
+        glResourceOwner& operator=(const glResourceOwner&) = delete;
+
+    private:
+        const char* previous;
+};
+
+/* Swaps the gl3w entry points that make, size and delete objects for
+   recording wrappers. gl3wInit() undoes this, loadGlEntryPoints() runs
+   both once per process.
+*/
+void installGlResourceTracking();
+
+}
+
+#endif
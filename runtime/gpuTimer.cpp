@@ -0,0 +1,47 @@
+#include "gpuTimer.hpp"
+
+namespace soupcans {
+
+void initGpuFrameTimer(gpuFrameTimer* timer) {
+    glGenQueries(N_GPU_TIMER_QUERIES, timer->queries);
+    timer->next = 0;
+    timer->n_pending = 0;
+}
+
+void deleteGpuFrameTimer(gpuFrameTimer* timer) {
+    glDeleteQueries(N_GPU_TIMER_QUERIES, timer->queries);
+    timer->n_pending = 0;
+}
+
+void beginGpuFrame(gpuFrameTimer* timer) {
+    if (timer->n_pending == N_GPU_TIMER_QUERIES) {
+        // ring is full, the oldest result gets dropped
+        timer->n_pending--;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, timer->queries[timer->next]);
+}
+
+void endGpuFrame(gpuFrameTimer* timer) {
+    glEndQuery(GL_TIME_ELAPSED);
+    timer->next = (timer->next + 1) % N_GPU_TIMER_QUERIES;
+    timer->n_pending++;
+}
+
+bool readGpuFrameTime(gpuFrameTimer* timer, double* gpu_ms) {
+    if (timer->n_pending == 0) {
+        return false;
+    }
+    int oldest = (timer->next - timer->n_pending + N_GPU_TIMER_QUERIES) % N_GPU_TIMER_QUERIES;
+    GLint available = 0;
+    glGetQueryObjectiv(timer->queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return false;
+    }
+    GLuint64 elapsed_ns = 0;
+    glGetQueryObjectui64v(timer->queries[oldest], GL_QUERY_RESULT, &elapsed_ns);
+    timer->n_pending--;
+    *gpu_ms = elapsed_ns * 1e-6;
+    return true;
+}
+
+}
@@ -0,0 +1,31 @@
+#ifndef SOUPCANS_GPU_TIMER_HPP
+#define SOUPCANS_GPU_TIMER_HPP
+
+#include <GL/gl3w.h>
+
+namespace soupcans {
+
+/* GL_TIME_ELAPSED queries in a small ring. Results are only read once the
+   GPU says they are available, so measuring never stalls the pipeline;
+   they just show up a frame or two late.
+*/
+const int N_GPU_TIMER_QUERIES = 4;
+struct gpuFrameTimer {
+    GLuint queries[N_GPU_TIMER_QUERIES];
+    int next;
+    int n_pending;
+};
+
+void initGpuFrameTimer(gpuFrameTimer* timer);
+void deleteGpuFrameTimer(gpuFrameTimer* timer);
+
+// brackets the GPU work to be measured, only one timer can be open at a time
+void beginGpuFrame(gpuFrameTimer* timer);
+void endGpuFrame(gpuFrameTimer* timer);
+
+// true if the oldest frame's GPU time was ready, in milliseconds
+bool readGpuFrameTime(gpuFrameTimer* timer, double* gpu_ms);
+
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include "../common/log.hpp"
+#include "latency.hpp"
+
+namespace soupcans {
+
+const double LatencyTracker::BIN_SECONDS = 0.0001;
+
+LatencyTracker::LatencyTracker() {
+    histogram* histograms[] = { &this->to_update, &this->to_submit, &this->to_present };
+    for (histogram* h : histograms) {
+        // the last bin catches everything slower than the range
+        h->bins.assign(N_BINS + 1, 0);
+        h->n_samples = 0;
+        h->max_seconds = 0.0;
+    }
+    this->queries[0] = 0;
+    this->first = 0;
+    this->n_pending = 0;
+    this->submitted_input = -1.0;
+}
+
+LatencyTracker::~LatencyTracker() {
+    if (this->queries[0]) {
+        SOUP_LOG_WARNING("latency tracker destroyed with its queries still allocated");
+    }
+}
+
+void LatencyTracker::record(histogram* h, double seconds) {
+    seconds = (seconds > 0.0) ? seconds : 0.0;
+    int bin = static_cast<int>(seconds / BIN_SECONDS);
+    h->bins[(bin < N_BINS) ? bin : N_BINS]++;
+    h->n_samples++;
+    h->max_seconds = (seconds > h->max_seconds) ? seconds : h->max_seconds;
+}
+
+latencySummary LatencyTracker::summarize(const histogram& h) {
+    latencySummary summary = latencySummary{};
+    summary.n_samples = h.n_samples;
+    if (h.n_samples == 0) {
+        return summary;
+    }
+    summary.max = h.max_seconds * 1000.0;
+    const double FRACTIONS[] = { 0.50, 0.95, 0.99 };
+    double* outputs[] = { &summary.p50, &summary.p95, &summary.p99 };
+    uint64_t seen = 0;
+    int f = 0;
+    for (int bin = 0; bin <= N_BINS && f < 3; bin++) {
+        seen += h.bins[bin];
+        while (f < 3 && seen >= FRACTIONS[f] * h.n_samples) {
+            // the middle of the bin, or the real maximum past the end of the range
+            double ms = (bin < N_BINS) ? (bin + 0.5) * BIN_SECONDS * 1000.0 : summary.max;
+            *outputs[f++] = (ms < summary.max) ? ms : summary.max;
+        }
+    }
+    return summary;
+}
+
+void LatencyTracker::reset(histogram* h) {
+    for (uint32_t& count : h->bins) {
+        count = 0;
+    }
+    h->n_samples = 0;
+    h->max_seconds = 0.0;
+}
+
+void LatencyTracker::frameSubmitted(double input_time, double update_start,
+                                    double submit_time) {
+    if (input_time < 0.0) {
+        return;
+    }
+    // a mailbox frame that is never shown hands its input on to the one that is
+    if (this->submitted_input < 0.0) {
+        this->submitted_input = input_time;
+    }
+    record(&this->to_update, update_start - input_time);
+    record(&this->to_submit, submit_time - input_time);
+}
+
+void LatencyTracker::framePresented() {
+    if (this->submitted_input < 0.0) {
+        return;
+    }
+    if (!this->queries[0]) {
+        glGenQueries(MAX_PENDING, this->queries);
+    }
+    if (this->n_pending == MAX_PENDING) {
+        // the GPU has not caught up in a whole ring of input frames, give up on the oldest
+        this->first = (this->first + 1) % MAX_PENDING;
+        this->n_pending--;
+    }
+    int last = (this->first + this->n_pending) % MAX_PENDING;
+    glQueryCounter(this->queries[last], GL_TIMESTAMP);
+    // or it sits in the command buffer, and is stamped, until next frame's flush
+    glFlush();
+    this->pending_input[last] = this->submitted_input;
+    this->n_pending++;
+    this->submitted_input = -1.0;
+}
+
+void LatencyTracker::poll(double now) {
+    if (this->n_pending == 0) {
+        return;
+    }
+    // GL_TIMESTAMP is the GPU clock, line it up with ours once per poll
+    GLint64 gpu_now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+    double gpu_to_cpu = now - gpu_now * 1e-9;
+    // queries finish in order, so stop at the first one that hasn't
+    while (this->n_pending > 0) {
+        GLuint query = this->queries[this->first];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        GLuint64 swapped_ns = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &swapped_ns);
+        double swapped = swapped_ns * 1e-9 + gpu_to_cpu;
+        record(&this->to_present, swapped - this->pending_input[this->first]);
+        this->first = (this->first + 1) % MAX_PENDING;
+        this->n_pending--;
+    }
+}
+
+latencySummary LatencyTracker::inputToUpdate() const {
+    return summarize(this->to_update);
+}
+
+latencySummary LatencyTracker::inputToSubmit() const {
+    return summarize(this->to_submit);
+}
+
+latencySummary LatencyTracker::inputToPresent() const {
+    return summarize(this->to_present);
+}
+
+void LatencyTracker::clear() {
+    if (this->queries[0]) {
+        glDeleteQueries(MAX_PENDING, this->queries);
+        this->queries[0] = 0;
+    }
+    this->n_pending = 0;
+    this->first = 0;
+    this->submitted_input = -1.0;
+    reset(&this->to_update);
+    reset(&this->to_submit);
+    reset(&this->to_present);
+}
+
+}
@@ -0,0 +1,79 @@
+#ifndef SOUPCANS_LATENCY_HPP
+#define SOUPCANS_LATENCY_HPP
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <GL/gl3w.h>
+
+namespace soupcans {
+
+// milliseconds, from the tracker's histograms
+struct latencySummary {
+    uint64_t n_samples;
+    double p50, p95, p99, max;
+};
+
+/* Input to photon for every frame that acted on input. A frame is stamped
+   when its input was polled, when update() started and when it was
+   submitted. A timestamp query behind its present gives the time the GPU
+   was done with the swap, the closest GL gets to the photons; it is read
+   back a frame or so later without waiting and moved onto the CPU clock,
+   so how often poll() runs doesn't show up in the numbers.
+
+   GLFW only hands out events inside pollEvents(), so an event's own time
+   is unknown. It is taken as the poll before the one that delivered it,
+   the oldest it can be, which makes every number here an upper bound and
+   counts the wait for the next poll, the part late latching takes out.
+
+   Samples go into fixed 0.1 ms histograms, recording never allocates.
+*/
+class LatencyTracker {
+    public:
+        LatencyTracker();
+        ~LatencyTracker();
+
+        LatencyTracker(const LatencyTracker&) = delete;
+        LatencyTracker& operator=(const LatencyTracker&) = delete;
+
+        // input_time < 0 means the frame had no input, and nothing is tracked
+        void frameSubmitted(double input_time, double update_start, double submit_time);
+        // right after present(), puts a timestamp behind the frame submitted last
+        void framePresented();
+        // finishes every frame whose timestamp is back, `now` is the current time
+        void poll(double now);
+
+        latencySummary inputToUpdate() const;
+        latencySummary inputToSubmit() const;
+        latencySummary inputToPresent() const;
+
+        // drops pending frames and all samples, call while the context is current
+        void clear();
+
+    private:
+        static const int MAX_PENDING = 8;
+        static const int N_BINS = 2500;
+        static const double BIN_SECONDS;
+
+        struct histogram {
+            std::vector<uint32_t> bins;
+            uint64_t n_samples;
+            double max_seconds;
+        };
+
+        histogram to_update, to_submit, to_present;
+        // made on first use, the tracker exists before the context does
+        GLuint queries[MAX_PENDING];
+        double pending_input[MAX_PENDING];
+        int first, n_pending;
+        double submitted_input;
+
+        static void record(histogram* h, double seconds);
+        static latencySummary summarize(const histogram& h);
+        static void reset(histogram* h);
+};
+
+}
+
+#endif
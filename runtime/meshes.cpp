@@ -0,0 +1,111 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../common/log.hpp"
+#include "meshes.hpp"
+
+namespace soupcans {
+
+static void attributeFormat(meshComponentType type, GLenum* gl_type, GLboolean* normalized) {
+    switch (type) {
+        case MESH_FLOAT32:
+            *gl_type = GL_FLOAT;
+            break;
+        case MESH_FLOAT16:
+            *gl_type = GL_HALF_FLOAT;
+            break;
+        case MESH_UNORM8:
+            *gl_type = GL_UNSIGNED_BYTE;
+            break;
+        case MESH_SNORM8:
+            *gl_type = GL_BYTE;
+            break;
+        case MESH_UNORM16:
+            *gl_type = GL_UNSIGNED_SHORT;
+            break;
+        default:
+            *gl_type = GL_SHORT;
+            break;
+    }
+    *normalized = (type == MESH_FLOAT32 || type == MESH_FLOAT16) ? GL_FALSE : GL_TRUE;
+}
+
+bool loadMesh(const char* path, const meshAttributeLocations& locations, gpuMesh* mesh) {
+    *mesh = gpuMesh{};
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        SOUP_LOG_ERROR("could not open mesh %s", path);
+        return false;
+    }
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // the mapping keeps the file, the descriptor isn't needed anymore
+    close(fd);
+    if (data == MAP_FAILED) {
+        SOUP_LOG_ERROR("could not map mesh %s", path);
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    // the driver's copy reads all of it, start the readahead now
+    madvise(data, size, MADV_WILLNEED);
+
+    const char* problem = validateMesh(data, size);
+    if (problem) {
+        SOUP_LOG_ERROR("mesh %s: %s", path, problem);
+        munmap(data, size);
+        return false;
+    }
+    meshFileHeader header;
+    memcpy(&header, data, sizeof(header));
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+    glGenVertexArrays(1, &mesh->vertex_array);
+    glBindVertexArray(mesh->vertex_array);
+    glGenBuffers(1, &mesh->vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER,
+                 static_cast<GLsizeiptr>(header.n_vertices) * header.vertex_stride,
+                 bytes + header.vertex_offset, GL_STATIC_DRAW);
+    glGenBuffers(1, &mesh->index_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 static_cast<GLsizeiptr>(header.n_indices) * header.index_size,
+                 bytes + header.index_offset, GL_STATIC_DRAW);
+    munmap(data, size);
+
+    for (uint32_t i = 0; i < header.n_attributes; i++) {
+        const meshAttribute& attribute = header.attributes[i];
+        int location = locations.locations[attribute.semantic];
+        if (location < 0) {
+            continue;
+        }
+        GLenum gl_type;
+        GLboolean normalized;
+        attributeFormat(attribute.type, &gl_type, &normalized);
+        glVertexAttribPointer(location, attribute.components, gl_type, normalized,
+                              header.vertex_stride,
+                              reinterpret_cast<const void*>(static_cast<uintptr_t>(attribute.offset)));
+        glEnableVertexAttribArray(location);
+    }
+
+    mesh->n_indices = static_cast<GLsizei>(header.n_indices);
+    mesh->index_type = (header.index_size == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    memcpy(mesh->bounds_min, header.bounds_min, sizeof(mesh->bounds_min));
+    memcpy(mesh->bounds_max, header.bounds_max, sizeof(mesh->bounds_max));
+    return true;
+}
+
+void deleteMesh(gpuMesh* mesh) {
+    glDeleteVertexArrays(1, &mesh->vertex_array);
+    glDeleteBuffers(1, &mesh->vertex_buffer);
+    glDeleteBuffers(1, &mesh->index_buffer);
+    *mesh = gpuMesh{};
+}
+
+}
@@ -0,0 +1,35 @@
+#ifndef SOUPCANS_MESHES_HPP
+#define SOUPCANS_MESHES_HPP
+
+#include <GL/gl3w.h>
+
+#include "../common/meshFormat.hpp"
+
+namespace soupcans {
+
+// vertex shader input each kind of attribute goes to, -1 leaves it out
+struct meshAttributeLocations {
+    int locations[N_MESH_SEMANTICS] = { 0, -1, 2, 1 };
+};
+
+struct gpuMesh {
+    GLuint vertex_array;
+    GLuint vertex_buffer;
+    GLuint index_buffer;
+    GLsizei n_indices;
+    // for glDrawElements(), GL_UNSIGNED_SHORT unless the mesh is large
+    GLenum index_type;
+    float bounds_min[3];
+    float bounds_max[3];
+};
+
+/* Maps a .smsh file and hands its vertex and index blocks to the GL as
+   they are, nothing is decoded on the CPU. The mesh's vertex array is
+   left bound, so per-instance attributes can go straight onto it.
+*/
+bool loadMesh(const char* path, const meshAttributeLocations& locations, gpuMesh* mesh);
+void deleteMesh(gpuMesh* mesh);
+
+}
+
+#endif
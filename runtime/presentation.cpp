@@ -0,0 +1,201 @@
+#include "../common/log.hpp"
+#include "presentation.hpp"
+
+namespace soupcans {
+
+// non-blocking, GL_SYNC_FLUSH_COMMANDS_BIT makes sure the fence gets to the GPU at all
+static bool fenceSignaled(GLsync fence) {
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+MailboxRing::MailboxRing() {
+    for (slot& s : this->slots) {
+        s = slot{};
+    }
+    this->width = 0;
+    this->height = 0;
+    this->depth = false;
+    this->rendering = -1;
+    this->n_begun = 0;
+    this->shown_serial = 0;
+}
+
+MailboxRing::~MailboxRing() {
+    if (this->slots[0].target.fbo) {
+        SOUP_LOG_WARNING("mailbox ring destroyed with its targets still allocated");
+    }
+}
+
+void MailboxRing::collectFinished() {
+    for (slot& s : this->slots) {
+        if (s.fence && fenceSignaled(s.fence)) {
+            glDeleteSync(s.fence);
+            s.fence = 0;
+        }
+    }
+}
+
+GLuint MailboxRing::beginFrame(int width, int height, bool depth) {
+    if (width != this->width || height != this->height || depth != this->depth ||
+        !this->slots[0].target.fbo) {
+        this->clear();
+        for (slot& s : this->slots) {
+            if (!resizeScaledRenderTarget(&s.target, width, height, depth)) {
+                SOUP_LOG_ERROR("mailbox target %dx%d is incomplete", width, height);
+                this->clear();
+                return 0;
+            }
+        }
+        this->width = width;
+        this->height = height;
+        this->depth = depth;
+    }
+
+    // keep the newest finished frame for present(), reuse the oldest of the others
+    this->collectFinished();
+    int newest = -1, oldest = -1;
+    for (int i = 0; i < N_TARGETS; i++) {
+        const slot& s = this->slots[i];
+        if (!s.fence && s.serial > this->shown_serial &&
+            (newest < 0 || s.serial > this->slots[newest].serial)) {
+            newest = i;
+        }
+    }
+    for (int i = 0; i < N_TARGETS; i++) {
+        if (i != newest && (oldest < 0 || this->slots[i].serial < this->slots[oldest].serial)) {
+            oldest = i;
+        }
+    }
+
+    slot& s = this->slots[oldest];
+    if (s.fence) {
+        // the GPU is a whole ring behind, this is the only place the CPU waits for it
+        glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(s.fence);
+        s.fence = 0;
+    }
+    s.serial = ++this->n_begun;
+    this->rendering = oldest;
+    glBindFramebuffer(GL_FRAMEBUFFER, s.target.fbo);
+    return s.target.fbo;
+}
+
+void MailboxRing::endFrame() {
+    if (this->rendering < 0) {
+        return;
+    }
+    this->slots[this->rendering].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    this->rendering = -1;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+bool MailboxRing::present(int window_width, int window_height) {
+    this->collectFinished();
+    int newest = -1;
+    for (int i = 0; i < N_TARGETS; i++) {
+        const slot& s = this->slots[i];
+        if (!s.fence && s.serial > this->shown_serial &&
+            (newest < 0 || s.serial > this->slots[newest].serial)) {
+            newest = i;
+        }
+    }
+    if (newest < 0) {
+        return false;
+    }
+    const slot& s = this->slots[newest];
+    blitScaledRenderTarget(&s.target, this->width, this->height,
+                           window_width, window_height);
+    this->shown_serial = s.serial;
+    return true;
+}
+
+void MailboxRing::clear() {
+    for (slot& s : this->slots) {
+        if (s.fence) {
+            glDeleteSync(s.fence);
+        }
+        deleteScaledRenderTarget(&s.target);
+        s = slot{};
+    }
+    this->width = 0;
+    this->height = 0;
+    this->depth = false;
+    this->rendering = -1;
+    this->n_begun = 0;
+    this->shown_serial = 0;
+}
+
+SwapLatencyProbe::SwapLatencyProbe() {
+    this->queries[0] = 0;
+    this->first = 0;
+    this->n_pending = 0;
+    this->n_samples = 0;
+    this->total_seconds = 0.0;
+    this->max_seconds = 0.0;
+}
+
+SwapLatencyProbe::~SwapLatencyProbe() {
+    if (this->queries[0]) {
+        SOUP_LOG_WARNING("swap latency probe destroyed with its queries still allocated");
+    }
+}
+
+void SwapLatencyProbe::presented(double present_start) {
+    if (!this->queries[0]) {
+        glGenQueries(MAX_PENDING, this->queries);
+    }
+    if (this->n_pending == MAX_PENDING) {
+        // nothing came back for a whole ring of frames, stop waiting on the oldest
+        this->first = (this->first + 1) % MAX_PENDING;
+        this->n_pending--;
+    }
+    int last = (this->first + this->n_pending) % MAX_PENDING;
+    glQueryCounter(this->queries[last], GL_TIMESTAMP);
+    // or it is only stamped at next frame's flush
+    glFlush();
+    this->starts[last] = present_start;
+    this->n_pending++;
+}
+
+void SwapLatencyProbe::poll(double now) {
+    if (this->n_pending == 0) {
+        return;
+    }
+    // GL_TIMESTAMP is the GPU clock, line it up with ours once per poll
+    GLint64 gpu_now = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu_now);
+    double gpu_to_cpu = now - gpu_now * 1e-9;
+    // queries finish in order, so stop at the first one that hasn't
+    while (this->n_pending > 0) {
+        GLuint query = this->queries[this->first];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        GLuint64 swapped_ns = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &swapped_ns);
+        double latency = swapped_ns * 1e-9 + gpu_to_cpu - this->starts[this->first];
+        latency = (latency > 0.0) ? latency : 0.0;
+        this->n_samples++;
+        this->total_seconds += latency;
+        this->max_seconds = (latency > this->max_seconds) ? latency : this->max_seconds;
+        this->first = (this->first + 1) % MAX_PENDING;
+        this->n_pending--;
+    }
+}
+
+void SwapLatencyProbe::clear() {
+    if (this->queries[0]) {
+        glDeleteQueries(MAX_PENDING, this->queries);
+        this->queries[0] = 0;
+    }
+    this->n_pending = 0;
+    this->first = 0;
+    this->n_samples = 0;
+    this->total_seconds = 0.0;
+    this->max_seconds = 0.0;
+}
+
+}
@@ -0,0 +1,106 @@
+#ifndef SOUPCANS_PRESENTATION_HPP
+#define SOUPCANS_PRESENTATION_HPP
+
+#include <stdint.h>
+
+#include <GL/gl3w.h>
+
+#include "renderTarget.hpp"
+
+namespace soupcans {
+
+/* The offscreen half of PRESENT_MAILBOX. Frames are rendered into a ring
+   of window sized targets as fast as the scene goes; present() blits the
+   newest one the GPU has finished to the window and the rest are dropped.
+   Finishing is checked with fences without waiting, so showing a frame
+   never stalls on one still being drawn. With three targets there is
+   always one free to render into while one waits to be shown and one is
+   on the GPU; only when the GPU is that far behind does beginFrame() wait.
+*/
+class MailboxRing {
+    public:
+        static const int N_TARGETS = 3;
+
+        MailboxRing();
+        ~MailboxRing();
+
+        MailboxRing(const MailboxRing&) = delete;
+        MailboxRing& operator=(const MailboxRing&) = delete;
+
+        /* Binds the target for the next frame and returns its framebuffer, 0
+           if it can't. `depth` is for scenes drawing straight into it.
+        */
+        GLuint beginFrame(int width, int height, bool depth);
+        void endFrame();
+
+        // blits the newest finished frame to the default framebuffer, false if none is new
+        bool present(int window_width, int window_height);
+
+        // call while the context is still current
+        void clear();
+
+    private:
+        struct slot {
+            scaledRenderTarget target;
+            GLsync fence;
+            // which frame it holds, 0 for none
+            uint64_t serial;
+        };
+
+        slot slots[N_TARGETS];
+        int width, height;
+        bool depth;
+        int rendering;
+        uint64_t n_begun;
+        uint64_t shown_serial;
+
+        void collectFinished();
+};
+
+/* Swap latency: a timestamp query goes in right behind every present and
+   is read back a frame or so later without waiting, so the time from
+   calling present() to the GPU getting through the swap is measured at no
+   cost to the frame. The GPU stamps it when it gets there, so how often
+   poll() runs doesn't show up in the numbers.
+*/
+class SwapLatencyProbe {
+    public:
+        SwapLatencyProbe();
+        ~SwapLatencyProbe();
+
+        SwapLatencyProbe(const SwapLatencyProbe&) = delete;
+        SwapLatencyProbe& operator=(const SwapLatencyProbe&) = delete;
+
+        // right after present(), `present_start` is when it was called
+        void presented(double present_start);
+        // records every swap whose timestamp is back, `now` is the current time
+        void poll(double now);
+
+        uint64_t sampleCount() const {
+            return this->n_samples;
+        }
+        double totalSeconds() const {
+            return this->total_seconds;
+        }
+        double maxSeconds() const {
+            return this->max_seconds;
+        }
+
+        // drops the pending queries and the totals, call while the context is current
+        void clear();
+
+    private:
+        static const int MAX_PENDING = 8;
+
+        // made on first use, the probe exists before the context does
+        GLuint queries[MAX_PENDING];
+        double starts[MAX_PENDING];
+        int first, n_pending;
+        uint64_t n_samples;
+        double total_seconds;
+        double max_seconds;
+};
+
+}
+
+#endif
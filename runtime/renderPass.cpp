@@ -0,0 +1,102 @@
+#include "renderPass.hpp"
+#include "textures.hpp"
+
+namespace soupcans {
+
+renderPassDesc flatPass(loadAction color_load) {
+    renderPassDesc pass;
+    pass.color_load = color_load;
+    return pass;
+}
+
+renderPassDesc depthTestedPass(loadAction color_load) {
+    renderPassDesc pass;
+    pass.color_load = color_load;
+    pass.depth = true;
+    return pass;
+}
+
+bool supportsInvalidation() {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    bool core = major > 4 || (major == 4 && minor >= 3);
+    return core || hasGlExtension("GL_ARB_invalidate_subdata");
+}
+
+// the default framebuffer names its buffers differently from an FBO
+static GLenum colorAttachment(GLuint framebuffer) {
+    return framebuffer ? GL_COLOR_ATTACHMENT0 : GL_COLOR;
+}
+
+static GLenum depthAttachment(GLuint framebuffer) {
+    return framebuffer ? GL_DEPTH_ATTACHMENT : GL_DEPTH;
+}
+
+void beginRenderPass(const renderPassDesc& pass, GLuint framebuffer, bool can_invalidate) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    GLenum dont_care[2];
+    int n_dont_care = 0;
+    GLbitfield clear = 0;
+    if (pass.color_load == LOAD_CLEAR) {
+        glClearColor(pass.clear_color[0], pass.clear_color[1], pass.clear_color[2],
+                     pass.clear_color[3]);
+        clear |= GL_COLOR_BUFFER_BIT;
+    } else if (pass.color_load == LOAD_DONT_CARE) {
+        dont_care[n_dont_care++] = colorAttachment(framebuffer);
+    }
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    if (pass.depth) {
+        // glClear skips depth while writes to it are masked off
+        glDepthMask(GL_TRUE);
+        if (pass.depth_load == LOAD_CLEAR) {
+            glClearDepth(pass.clear_depth);
+            clear |= GL_DEPTH_BUFFER_BIT;
+        } else if (pass.depth_load == LOAD_DONT_CARE) {
+            dont_care[n_dont_care++] = depthAttachment(framebuffer);
+        }
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(pass.depth_func);
+    } else {
+        glDisable(GL_DEPTH_TEST);
+    }
+    if (n_dont_care > 0 && can_invalidate) {
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, n_dont_care, dont_care);
+    }
+    if (clear) {
+        glClear(clear);
+    }
+}
+
+void endRenderPass(const renderPassDesc& pass, GLuint framebuffer, bool can_invalidate) {
+    if (pass.depth) {
+        // a depth prepass leaves writes off, the next clear needs them
+        glDepthMask(GL_TRUE);
+    }
+    GLenum invalidate[2];
+    int n_invalidate = 0;
+    if (pass.color_store == STORE_INVALIDATE) {
+        invalidate[n_invalidate++] = colorAttachment(framebuffer);
+    }
+    if (pass.depth && pass.depth_store == STORE_INVALIDATE) {
+        invalidate[n_invalidate++] = depthAttachment(framebuffer);
+    }
+    if (n_invalidate > 0 && can_invalidate) {
+        // the pass may have drawn through other framebuffers in between
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, n_invalidate, invalidate);
+    }
+}
+
+void beginDepthPrepass() {
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_TRUE);
+}
+
+void endDepthPrepass() {
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_FALSE);
+    glDepthFunc(GL_LEQUAL);
+}
+
+}
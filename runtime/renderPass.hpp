@@ -0,0 +1,69 @@
+#ifndef SOUPCANS_RENDER_PASS_HPP
+#define SOUPCANS_RENDER_PASS_HPP
+
+#include <GL/gl3w.h>
+
+namespace soupcans {
+
+// what an attachment holds when a pass starts
+enum loadAction {
+    // whatever the last pass left
+    LOAD_KEEP,
+    LOAD_CLEAR,
+    // the pass covers every pixel, the old contents are thrown away unread
+    LOAD_DONT_CARE
+};
+
+// what happens to an attachment when a pass ends
+enum storeAction {
+    STORE_KEEP,
+    // nothing reads it again, the driver may drop it instead of writing it out
+    STORE_INVALIDATE
+};
+
+/* One pass over a framebuffer: which attachments it uses and what happens
+   to them at either end. A pass without depth runs with the depth test
+   off and never touches a depth buffer, so scenes made only of such
+   passes can go without one (windowSettings::depth_buffer). Depth is
+   thrown away at the end by default; nothing reads it after the frame.
+*/
+struct renderPassDesc {
+    loadAction color_load = LOAD_CLEAR;
+    storeAction color_store = STORE_KEEP;
+    float clear_color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    bool depth = false;
+    loadAction depth_load = LOAD_CLEAR;
+    storeAction depth_store = STORE_INVALIDATE;
+    float clear_depth = 1.0f;
+    GLenum depth_func = GL_LESS;
+};
+
+// color only, depth test off
+renderPassDesc flatPass(loadAction color_load = LOAD_CLEAR);
+// color and a cleared depth buffer with GL_LESS
+renderPassDesc depthTestedPass(loadAction color_load = LOAD_CLEAR);
+
+// true if the current context has glInvalidateFramebuffer, GL 4.3 or ARB_invalidate_subdata
+bool supportsInvalidation();
+
+/* Binds `framebuffer` and carries out the load actions, then sets the
+   depth state the pass asks for. Without `can_invalidate` LOAD_DONT_CARE
+   does nothing and STORE_INVALIDATE keeps the contents.
+*/
+void beginRenderPass(const renderPassDesc& pass, GLuint framebuffer, bool can_invalidate);
+void endRenderPass(const renderPassDesc& pass, GLuint framebuffer, bool can_invalidate);
+
+/* A depth prepass inside a pass with depth. Draw the opaque geometry once
+   between these two with a cheap fragment shader, then draw it again to
+   shade it: the second time depth is read-only with GL_LEQUAL, so early-Z
+   runs the expensive fragment shader once per pixel however much overlaps.
+   Only worth it when fragments cost more than the second geometry pass;
+   both draws need the same vertex transform to land on the same depths.
+*/
+void beginDepthPrepass();
+void endDepthPrepass();
+
+}
+
+#endif
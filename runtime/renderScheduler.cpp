@@ -0,0 +1,47 @@
+#include <sys/resource.h>
+
+#include "renderScheduler.hpp"
+
+namespace soupcans {
+
+RenderScheduler::RenderScheduler(const schedulerSettings& settings) {
+    this->settings = settings;
+    // the first frame always draws
+    this->redraw_requested = true;
+}
+
+double RenderScheduler::waitForFrame(Backend& backend, bool animating) {
+    double waited = 0.0;
+    while (!backend.shouldClose()) {
+        // a refresh only counts once the window can be seen again
+        bool visible = !backend.hidden();
+        if (visible) {
+            bool damaged = backend.takeRefreshRequest() || this->redraw_requested;
+            if (animating || damaged || backend.inputPending()) {
+                break;
+            }
+        }
+        double wait_start = backend.time();
+        backend.waitEvents(this->settings.idle_timeout);
+        waited += backend.time() - wait_start;
+    }
+    this->redraw_requested = false;
+    return waited;
+}
+
+double RenderScheduler::frameRateCap(Backend& backend, double max_fps) const {
+    double background = this->settings.background_fps;
+    if (background <= 0.0 || backend.focused()) {
+        return max_fps;
+    }
+    return (max_fps > 0.0 && max_fps < background) ? max_fps : background;
+}
+
+double processCpuSeconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+}
+
+}
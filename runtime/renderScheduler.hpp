@@ -0,0 +1,48 @@
+#ifndef SOUPCANS_RENDER_SCHEDULER_HPP
+#define SOUPCANS_RENDER_SCHEDULER_HPP
+
+#include "backend.hpp"
+
+namespace soupcans {
+
+struct schedulerSettings {
+    // frame rate cap while the window doesn't have focus, 0 leaves it alone
+    double background_fps = 10.0;
+    // how long one wait for events lasts while nothing needs drawing
+    double idle_timeout = 0.5;
+};
+
+/* Decides when the runtime draws at all. A minimized window draws
+   nothing and sleeps in the backend's event wait; an unfocused one is
+   capped to the background rate; a scene that isn't animating only draws
+   when input, a refresh from the window system or requestRedraw() gives
+   it a reason. Anything else draws every frame as before.
+*/
+class RenderScheduler {
+    public:
+        explicit RenderScheduler(const schedulerSettings& settings = schedulerSettings());
+
+        // draws the next frame even if nothing else would
+        void requestRedraw() {
+            this->redraw_requested = true;
+        }
+
+        /* Returns once a frame should be drawn or the window should close,
+           with the seconds spent waiting for events
+        */
+        double waitForFrame(Backend& backend, bool animating);
+
+        // the frame rate cap for this frame, `max_fps` is the one it would have had
+        double frameRateCap(Backend& backend, double max_fps) const;
+
+    private:
+        schedulerSettings settings;
+        bool redraw_requested;
+};
+
+// user + system time this process has used so far, in seconds
+double processCpuSeconds();
+
+}
+
+#endif
@@ -0,0 +1,64 @@
+#include <stddef.h>
+
+#include "renderTarget.hpp"
+
+namespace soupcans {
+
+void deleteScaledRenderTarget(scaledRenderTarget* target) {
+    if (target->fbo) {
+        glDeleteFramebuffers(1, &target->fbo);
+        glDeleteTextures(1, &target->color_texture);
+        glDeleteRenderbuffers(1, &target->depth_buffer);
+        target->fbo = 0;
+        target->depth_buffer = 0;
+    }
+}
+
+bool resizeScaledRenderTarget(scaledRenderTarget* target, int width, int height,
+                              bool depth) {
+    deleteScaledRenderTarget(target);
+    target->width = width;
+    target->height = height;
+
+    glGenTextures(1, &target->color_texture);
+    glBindTexture(GL_TEXTURE_2D, target->color_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // one level, so it is still complete sampled through SamplerCache's mipmapped samplers
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+    target->depth_buffer = 0;
+    if (depth) {
+        glGenRenderbuffers(1, &target->depth_buffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, target->depth_buffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    }
+
+    glGenFramebuffers(1, &target->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, target->color_texture, 0);
+    if (depth) {
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                  GL_RENDERBUFFER, target->depth_buffer);
+    }
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+void blitScaledRenderTarget(const scaledRenderTarget* target,
+                            int scaled_width, int scaled_height,
+                            int window_width, int window_height,
+                            GLuint window_framebuffer) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target->fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, window_framebuffer);
+    glBlitFramebuffer(0, 0, scaled_width, scaled_height,
+                      0, 0, window_width, window_height,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, window_framebuffer);
+}
+
+}
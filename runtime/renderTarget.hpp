@@ -0,0 +1,37 @@
+#ifndef SOUPCANS_RENDER_TARGET_HPP
+#define SOUPCANS_RENDER_TARGET_HPP
+
+#include <GL/gl3w.h>
+
+namespace soupcans {
+
+/* Offscreen target a scene is drawn into. It is allocated at window size
+   and a scaled frame only uses its lower left corner, so changing the
+   render scale never reallocates anything.
+*/
+struct scaledRenderTarget {
+    GLuint fbo;
+    GLuint color_texture;
+    // 0 for a target made without depth
+    GLuint depth_buffer;
+    int width, height;
+};
+
+/* (re)allocates the attachments, false if the framebuffer is incomplete.
+   Only passes with depth need `depth`, see renderPass.hpp.
+*/
+bool resizeScaledRenderTarget(scaledRenderTarget* target, int width, int height,
+                              bool depth = true);
+void deleteScaledRenderTarget(scaledRenderTarget* target);
+
+/* Bilinear upscale of the scaled corner onto the window, which is
+   Runtime::sceneFramebuffer() rather than always the default framebuffer
+*/
+void blitScaledRenderTarget(const scaledRenderTarget* target,
+                            int scaled_width, int scaled_height,
+                            int window_width, int window_height,
+                            GLuint window_framebuffer = 0);
+
+}
+
+#endif
@@ -0,0 +1,928 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "runtime.hpp"
+
+namespace soupcans {
+
+#if SOUP_DEBUG_LEVEL > SOUP_DEBUG_RELEASE
+static void APIENTRY glDebugCallback(GLenum source, GLenum type, GLuint id,
+                                     GLenum severity, GLsizei length,
+                                     const GLchar* message, const void* user_data) {
+    (void)source;
+    (void)length;
+    (void)user_data;
+    logLevel level = LOG_DEBUG;
+    if (severity == GL_DEBUG_SEVERITY_HIGH) {
+        level = LOG_ERROR;
+    } else if (severity == GL_DEBUG_SEVERITY_MEDIUM) {
+        level = LOG_WARNING;
+    } else if (severity == GL_DEBUG_SEVERITY_LOW) {
+        level = LOG_INFO;
+    }
+    logMessage(level, "GL debug (type 0x%x, id %u): %s", type, id, message);
+}
+#endif
+
+Runtime::Runtime(const runtimeSettings& settings)
+    : frame_arena(256 * 1024) {
+    this->settings = settings;
+    this->settings.debug_level = clampDebugLevel(settings.debug_level);
+    if (this->settings.capture_path) {
+        // frames are read back, nobody needs to see them or wait for the display
+        this->settings.backend = BACKEND_HEADLESS;
+        this->settings.uncapped = true;
+    }
+    if (this->settings.serve_path) {
+        // read back like a capture, but paced, and a hidden window has nothing to sync to
+        this->settings.backend = BACKEND_HEADLESS;
+        this->settings.present_mode = PRESENT_UNCAPPED;
+    }
+    if (this->settings.replay_path) {
+        // the trace sets the pace, and a replay is there to be profiled
+        this->settings.backend = BACKEND_HEADLESS;
+        this->settings.uncapped = true;
+        this->settings.count_gl_calls = true;
+    }
+    if (this->settings.debug_level >= DEBUG_ASYNC) {
+        // asked for diagnostics, so show all of them
+        setLogLevel(LOG_DEBUG);
+        startLogThread();
+    }
+    this->texture_registry.setBudget(this->settings.texture_budget);
+    this->job_system.reset(new JobSystem(
+        (settings.n_threads > 0) ? settings.n_threads : JobSystem::defaultThreadCount()
+    ));
+    this->scene_framebuffer = 0;
+    this->active_scene = nullptr;
+    this->can_invalidate = false;
+    this->open_pass_framebuffer = 0;
+    this->pass_open = false;
+    this->trace_frame = traceFrame{};
+    this->input_poll = 0;
+    this->random_seed = 0;
+    this->frame_index = 0;
+    this->frame_time = 0.0;
+    this->title_time = 0.0;
+    this->title_frames = 0;
+    this->last_run = runStats{};
+    this->profile_hook = nullptr;
+    this->profile_user_data = nullptr;
+}
+
+Runtime::~Runtime() {
+    this->closeBackend();
+    stopLogThread();
+}
+
+bool loadGlEntryPoints() {
+    static std::once_flag loaded_once;
+    static bool loaded = false;
+    std::call_once(loaded_once, []() {
+        if (gl3wInit()) {
+            SOUP_LOG_ERROR("OH NO INDEPENDENCE DAY (gl3wInit failed)");
+            return;
+        }
+        installGlResourceTracking();
+        loaded = true;
+    });
+    return loaded;
+}
+
+void Runtime::setProfileHook(profileHook hook, void* user_data) {
+    this->profile_hook = hook;
+    this->profile_user_data = user_data;
+}
+
+bool Runtime::openBackend(const sceneSettings& scene_settings) {
+    this->active_backend = this->provided_backend ?
+        std::move(this->provided_backend) : createBackend(this->settings.backend);
+    if (!this->active_backend->open(scene_settings.window)) {
+        this->active_backend.reset();
+        return false;
+    }
+    if (!loadGlEntryPoints()) {
+        this->closeBackend();
+        return false;
+    }
+    if (this->settings.count_gl_calls) {
+        // wraps the tracking wrappers, benchmarks don't share the process with panels
+        static std::mutex counters_mutex;
+        std::lock_guard<std::mutex> guard(counters_mutex);
+        installGlCallCounters();
+    }
+    this->gl_resources.makeCurrent();
+
+#if SOUP_DEBUG_LEVEL > SOUP_DEBUG_RELEASE
+    if (this->settings.debug_level >= DEBUG_ASYNC) {
+        glEnable(GL_DEBUG_OUTPUT);
+        // synchronous output serializes the driver, only when asked for
+        if (this->settings.debug_level == DEBUG_SYNC) {
+            glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        }
+        glDebugMessageCallback(glDebugCallback, nullptr);
+    }
+#endif
+    SOUP_LOG_INFO("Renderer: %s", glGetString(GL_RENDERER));
+    SOUP_LOG_INFO("OpenGL version supported: %s", glGetString(GL_VERSION));
+
+    // depth testing is up to each render pass
+    this->can_invalidate = supportsInvalidation();
+    return true;
+}
+
+void Runtime::closeBackend() {
+    this->closeTrace();
+    if (this->active_backend) {
+        this->texture_registry.clear();
+        // the scene and the runtime have deleted everything they meant to by now
+        this->gl_resources.reportLeaks();
+        this->gl_resources.detach();
+        this->active_backend->close();
+        this->active_backend.reset();
+    }
+}
+
+void Runtime::framebufferSize(int* width, int* height) {
+    this->active_backend->framebufferSize(width, height);
+}
+
+void Runtime::beginRenderPass(const renderPassDesc& pass, GLuint framebuffer) {
+    if (this->pass_open) {
+        SOUP_LOG_WARNING("render pass begun inside another, ending that one first");
+        this->endRenderPass();
+    }
+    soupcans::beginRenderPass(pass, framebuffer, this->can_invalidate);
+    this->open_pass = pass;
+    this->open_pass_framebuffer = framebuffer;
+    this->pass_open = true;
+}
+
+void Runtime::endRenderPass() {
+    if (!this->pass_open) {
+        SOUP_LOG_WARNING("render pass ended without being begun");
+        return;
+    }
+    soupcans::endRenderPass(this->open_pass, this->open_pass_framebuffer,
+                            this->can_invalidate);
+    this->pass_open = false;
+}
+
+bool Runtime::keyPressed(int key) {
+    if (this->trace_reader.isOpen()) {
+        return this->trace_frame.pressed(key, this->input_poll);
+    }
+    bool pressed = this->active_backend->keyPressed(key);
+    if (pressed && this->trace_writer.isOpen() &&
+        !this->trace_frame.press(key, this->input_poll)) {
+        SOUP_LOG_WARNING("more than %d keys pressed at once, key %d isn't recorded",
+                         MAX_TRACE_KEYS, key);
+    }
+    return pressed;
+}
+
+void Runtime::requestClose() {
+    this->active_backend->requestClose();
+}
+
+void Runtime::updateTitle(const char* scene_title) {
+    // same as the old fps counters, refresh the title a few times a second
+    static const double TITLE_INTERVAL = 0.25;
+    this->title_frames++;
+    double elapsed = this->frame_time - this->title_time;
+    if (elapsed < TITLE_INTERVAL) {
+        return;
+    }
+    double fps = this->title_frames / elapsed;
+    this->title_time = this->frame_time;
+    this->title_frames = 0;
+
+    char title[256];
+    snprintf(title, sizeof(title), "%s @ fps: %.2f", scene_title, fps);
+    this->active_backend->setTitle(title);
+}
+
+void Runtime::pace(double frame_start, double max_fps) {
+    if (max_fps <= 0.0) {
+        return;
+    }
+    // sleep off whatever is left of this frame's slot, unlike a fixed delay
+    // this leaves the frame time alone when the work itself is slow
+    double remaining = frame_start + 1.0 / max_fps - this->active_backend->time();
+    if (remaining > 0.0) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(remaining));
+    }
+}
+
+// before the backend opens: the seed, and for a replay the trace and its framebuffer size
+bool Runtime::openTrace(Scene& scene, sceneSettings* scene_settings) {
+    this->trace_frame = traceFrame{};
+    this->input_poll = 0;
+    if (!this->settings.replay_path) {
+        this->random_seed = this->settings.random_seed;
+        if (this->random_seed == 0) {
+            this->random_seed = (uint64_t)
+                std::chrono::system_clock::now().time_since_epoch().count();
+        }
+        return true;
+    }
+    if (!this->trace_reader.open(this->settings.replay_path)) {
+        return false;
+    }
+    const traceFileHeader& header = this->trace_reader.header();
+    if (strncmp(header.scene, scene.name(), sizeof(header.scene) - 1) != 0) {
+        SOUP_LOG_ERROR("%s was recorded from %s, not %s", this->settings.replay_path,
+                       header.scene, scene.name());
+        this->trace_reader.close();
+        return false;
+    }
+    scene_settings->window.width = header.width;
+    scene_settings->window.height = header.height;
+    this->random_seed = header.random_seed;
+    this->replay_frame_seconds.clear();
+    this->replay_frame_seconds.reserve((size_t)header.n_frames);
+    SOUP_LOG_INFO("replaying %llu frames of %s at %dx%d, seed %llu",
+                  (unsigned long long)header.n_frames, header.scene, header.width,
+                  header.height, (unsigned long long)header.random_seed);
+    return true;
+}
+
+void Runtime::closeTrace() {
+    this->trace_writer.close();
+    this->trace_reader.close();
+}
+
+// sorted samples
+static double percentile(const std::vector<double>& samples, double p) {
+    return samples[(size_t)(p * (samples.size() - 1) + 0.5)];
+}
+
+int Runtime::run(Scene& scene, std::unique_ptr<Backend> backend) {
+    this->provided_backend = std::move(backend);
+    int status = this->run(scene);
+    this->provided_backend.reset();
+    return status;
+}
+
+int Runtime::run(Scene& scene) {
+    sceneSettings scene_settings = scene.settings();
+    if (this->settings.width > 0 && this->settings.height > 0) {
+        scene_settings.window.width = this->settings.width;
+        scene_settings.window.height = this->settings.height;
+    }
+    presentMode present_mode = this->settings.uncapped ?
+        PRESENT_UNCAPPED : this->settings.present_mode;
+    scene_settings.window.present_mode = present_mode;
+    scene_settings.window.debug_context = this->settings.debug_level >= DEBUG_ASYNC;
+    // capture's and serve's fences say when their readbacks are done, nothing else has to wait
+    scene_settings.window.finish_on_present = !this->settings.capture_path &&
+                                              !this->settings.serve_path;
+    antiAliasMode anti_alias = this->settings.anti_alias;
+    if (!scene_settings.multisample && antiAliasSamples(anti_alias) > 0) {
+        SOUP_LOG_INFO("%s blits into its framebuffer, running it without %s",
+                      scene.name(), antiAliasModeName(anti_alias));
+        anti_alias = ANTI_ALIAS_OFF;
+    }
+    // the window only needs depth when the scene draws straight into it
+    bool scene_depth = scene_settings.window.depth_buffer;
+    scene_settings.window.depth_buffer = scene_depth && anti_alias == ANTI_ALIAS_OFF &&
+                                         present_mode != PRESENT_MAILBOX;
+    if (!this->openTrace(scene, &scene_settings)) {
+        return 1;
+    }
+    if (!this->openBackend(scene_settings)) {
+        this->closeTrace();
+        return 1;
+    }
+    if (this->settings.record_path) {
+        traceFileHeader header = traceFileHeader{};
+        header.random_seed = this->random_seed;
+        this->active_backend->framebufferSize(&header.width, &header.height);
+        snprintf(header.scene, sizeof(header.scene), "%s", scene.name());
+        if (!this->trace_writer.open(this->settings.record_path, header)) {
+            this->closeBackend();
+            return 1;
+        }
+        SOUP_LOG_INFO("recording %s to %s, seed %llu", scene.name(),
+                      this->settings.record_path, (unsigned long long)this->random_seed);
+    }
+    double max_fps = (this->settings.max_fps > 0.0) ?
+        this->settings.max_fps : scene_settings.max_fps;
+    if (this->settings.uncapped) {
+        max_fps = 0.0;
+    }
+
+    this->active_scene = &scene;
+    this->frame_index = 0;
+    this->frame_time = this->active_backend->time();
+    this->frame_arena.reset();
+    bool initialized;
+    {
+        glResourceOwner owner(scene.name());
+        initialized = scene.init(*this);
+    }
+    if (!initialized) {
+        SOUP_LOG_ERROR("scene %s failed to initialize", scene.name());
+        this->active_scene = nullptr;
+        this->closeBackend();
+        return 1;
+    }
+    if (this->settings.capture_path) {
+        int width, height;
+        this->active_backend->framebufferSize(&width, &height);
+        if (!this->frame_capture.open(this->settings.capture_path, width, height,
+                                      this->settings.capture_fps)) {
+            glResourceOwner owner(scene.name());
+            scene.shutdown(*this);
+            this->active_scene = nullptr;
+            this->closeBackend();
+            return 1;
+        }
+    }
+    if (this->settings.serve_path) {
+        int width, height;
+        this->active_backend->framebufferSize(&width, &height);
+        if (!this->frame_server.open(this->settings.serve_path, width, height)) {
+            this->frame_capture.close();
+            glResourceOwner owner(scene.name());
+            scene.shutdown(*this);
+            this->active_scene = nullptr;
+            this->closeBackend();
+            return 1;
+        }
+    }
+    double capture_dt = 1.0 / ((this->settings.capture_fps > 0.0) ?
+        this->settings.capture_fps : 60.0);
+    // a mailbox frame is shown once per refresh, whatever rate the scene renders at
+    bool mailbox = present_mode == PRESENT_MAILBOX;
+    double refresh_rate = this->active_backend->refreshRate();
+    double present_interval = 1.0 / ((refresh_rate > 0.0) ? refresh_rate : 60.0);
+
+    // benchmarks and captures want every frame, however idle the scene is
+    bool scheduled = this->settings.backend == BACKEND_WINDOW && !this->settings.uncapped;
+    this->scheduler = RenderScheduler(this->settings.scheduler);
+
+    FrameAllocationTracker frame_tracker;
+    this->job_system->resetStats();
+    this->last_run = runStats{};
+    double run_cpu_start = processCpuSeconds();
+    double run_worker_cpu_start = this->job_system->workerCpuSeconds();
+    uint64_t run_heap_start = heapAllocationCount();
+    glCallCounts run_gl_start = glCallTotals();
+    double run_start = this->active_backend->time();
+    double last_frame = run_start;
+    double next_present = run_start;
+    bool replaying = this->trace_reader.isOpen();
+    // backend time minus trace time, for replaying at the recorded pace
+    double replay_offset = 0.0;
+    this->title_time = run_start;
+    this->title_frames = 0;
+
+    while (!this->active_backend->shouldClose()) {
+        if (this->settings.max_frames > 0 && this->frame_index >= this->settings.max_frames) {
+            break;
+        }
+        if (scheduled) {
+            double waited = this->scheduler.waitForFrame(*this->active_backend,
+                                                         scene.animating());
+            this->last_run.idle_seconds += waited;
+            last_frame += waited;
+            if (this->active_backend->shouldClose()) {
+                break;
+            }
+        }
+        if (replaying) {
+            if (!this->trace_reader.read(&this->trace_frame)) {
+                break;
+            }
+            if (this->frame_index == 0) {
+                replay_offset = this->active_backend->time() - this->trace_frame.time;
+            }
+            double due = this->trace_frame.time + replay_offset;
+            double early = due - this->active_backend->time();
+            if (this->settings.replay_original_timing && early > 0.0) {
+                std::this_thread::sleep_for(std::chrono::duration<double>(early));
+            }
+        } else {
+            this->trace_frame.flags = 0;
+            this->trace_frame.n_keys = 0;
+        }
+        this->input_poll = 0;
+        frame_tracker.beginFrame();
+        this->frame_arena.reset();
+        this->texture_registry.beginFrame();
+
+        double frame_start = this->active_backend->time();
+        double dt = this->frame_capture.isOpen() ? capture_dt : frame_start - last_frame;
+        last_frame = frame_start;
+        this->frame_time = frame_start;
+        if (replaying) {
+            dt = this->trace_frame.dt;
+            this->frame_time = this->trace_frame.time;
+        }
+        this->trace_frame.dt = dt;
+        this->trace_frame.time = this->frame_time;
+        this->updateTitle(scene_settings.window.title);
+
+        this->active_backend->pollEvents();
+        // a replay's input is all in the trace
+        double input_time = -1.0;
+        if (!replaying) {
+            input_time = this->active_backend->takeInputTime();
+            if (this->active_backend->keyPressed(GLFW_KEY_ESCAPE)) {
+                this->active_backend->requestClose();
+            }
+        }
+
+        frameTimings timings;
+        double update_start = this->active_backend->time();
+        {
+            glResourceOwner owner(scene.name());
+            scene.update(*this, dt);
+        }
+        bool late_latched = replaying && (this->trace_frame.flags & TRACE_LATE_LATCHED);
+        if (this->settings.late_latch && !replaying) {
+            // whatever came in during update() still makes this frame
+            this->active_backend->pollEvents();
+            double late_input = this->active_backend->takeInputTime();
+            if (late_input >= 0.0) {
+                late_latched = true;
+                input_time = (input_time >= 0.0) ? input_time : late_input;
+            }
+        }
+        if (late_latched) {
+            this->input_poll = 1;
+            this->trace_frame.flags |= TRACE_LATE_LATCHED;
+            glResourceOwner owner(scene.name());
+            scene.lateLatch(*this);
+        }
+        double update_end = this->active_backend->time();
+        timings.update_seconds = update_end - frame_start;
+
+        int width, height;
+        this->active_backend->framebufferSize(&width, &height);
+        bool output_depth = scene_depth && anti_alias == ANTI_ALIAS_OFF;
+        GLuint output = mailbox ? this->mailbox.beginFrame(width, height, output_depth) : 0;
+        this->scene_framebuffer = this->anti_alias_pass.beginFrame(anti_alias, width, height,
+                                                                   scene_depth, output);
+        glViewport(0, 0, width, height);
+        {
+            glResourceOwner owner(scene.name());
+            scene.render(*this);
+        }
+        if (this->pass_open) {
+            SOUP_LOG_WARNING("%s left a render pass open", scene.name());
+            this->endRenderPass();
+        }
+        this->anti_alias_pass.endFrame(this->texture_registry);
+        if (output) {
+            this->mailbox.endFrame();
+        }
+        double render_end = this->active_backend->time();
+        timings.render_seconds = render_end - update_end;
+        this->input_latency.frameSubmitted(input_time, update_start, render_end);
+
+        // queuing the readback counts as presenting, the frame is leaving the GPU
+        this->frame_capture.capture();
+        this->frame_server.serve();
+        // the readbacks above can take a while, the GPU clock is lined up with the time now
+        double poll_time = this->active_backend->time();
+        this->swap_latency.poll(poll_time);
+        this->input_latency.poll(poll_time);
+        bool show = true;
+        if (output) {
+            // too early, or nothing new has finished: this frame is dropped
+            show = render_end >= next_present && this->mailbox.present(width, height);
+            while (show && next_present <= render_end) {
+                next_present += present_interval;
+            }
+        }
+        if (show) {
+            double present_start = this->active_backend->time();
+            this->active_backend->present();
+            this->swap_latency.presented(present_start);
+            this->input_latency.framePresented();
+            this->last_run.n_presented++;
+        }
+        double present_end = this->active_backend->time();
+        timings.present_seconds = present_end - render_end;
+
+        this->pace(frame_start, scheduled ?
+            this->scheduler.frameRateCap(*this->active_backend, max_fps) : max_fps);
+        timings.frame_seconds = this->active_backend->time() - frame_start;
+        timings.gpu_render_seconds = this->anti_alias_pass.lastRenderSeconds();
+        timings.gpu_anti_alias_seconds = this->anti_alias_pass.lastResolveSeconds();
+        if (replaying) {
+            this->replay_frame_seconds.push_back(timings.frame_seconds);
+        }
+        this->trace_writer.write(this->trace_frame);
+
+        this->last_run.n_frames++;
+        this->last_run.update_seconds += timings.update_seconds;
+        this->last_run.render_seconds += timings.render_seconds;
+        this->last_run.present_seconds += timings.present_seconds;
+        if (this->profile_hook) {
+            this->profile_hook(scene, this->frame_index, timings, this->profile_user_data);
+        }
+        this->frame_index++;
+        frame_tracker.endFrame();
+    }
+    this->last_run.wall_seconds = this->active_backend->time() - run_start;
+    this->last_run.cpu_seconds = processCpuSeconds() - run_cpu_start;
+    this->last_run.worker_cpu_seconds = this->job_system->workerCpuSeconds() -
+                                        run_worker_cpu_start;
+    this->last_run.n_allocating_frames = frame_tracker.allocatingFrames();
+    this->last_run.n_heap_allocations = heapAllocationCount() - run_heap_start;
+    this->last_run.gl_calls = glCallCountsSince(run_gl_start);
+    this->last_run.gl_resources = this->gl_resources.totals();
+    this->last_run.gl_peak_bytes = this->gl_resources.peakBytes();
+    this->last_run.heap_bytes = heapBytesInUse();
+    this->last_run.heap_peak_bytes = heapPeakBytes();
+    this->last_run.texture_bytes = this->texture_registry.residentBytes();
+    this->last_run.texture_budget = this->texture_registry.budgetStats();
+    std::vector<double>& replay_seconds = this->replay_frame_seconds;
+    if (!replay_seconds.empty()) {
+        std::vector<double>::iterator slowest =
+            std::max_element(replay_seconds.begin(), replay_seconds.end());
+        this->last_run.replay_slowest_frame = (uint64_t)(slowest - replay_seconds.begin());
+        this->last_run.replay_max_seconds = *slowest;
+        std::sort(replay_seconds.begin(), replay_seconds.end());
+        this->last_run.replay_p50_seconds = percentile(replay_seconds, 0.5);
+        this->last_run.replay_p95_seconds = percentile(replay_seconds, 0.95);
+        this->last_run.replay_p99_seconds = percentile(replay_seconds, 0.99);
+        replay_seconds.clear();
+    }
+    glFinish();
+    this->swap_latency.poll(this->active_backend->time());
+    this->input_latency.poll(this->active_backend->time());
+    this->last_run.n_swap_latency_samples = this->swap_latency.sampleCount();
+    this->last_run.swap_latency_seconds = this->swap_latency.totalSeconds();
+    this->last_run.max_swap_latency_seconds = this->swap_latency.maxSeconds();
+    this->last_run.input_to_update = this->input_latency.inputToUpdate();
+    this->last_run.input_to_submit = this->input_latency.inputToSubmit();
+    this->last_run.input_to_present = this->input_latency.inputToPresent();
+    this->anti_alias_pass.finish();
+    this->last_run.anti_alias = anti_alias;
+    this->last_run.n_gpu_frames = this->anti_alias_pass.timedFrames();
+    this->last_run.gpu_render_seconds = this->anti_alias_pass.totalRenderSeconds();
+    this->last_run.gpu_anti_alias_seconds = this->anti_alias_pass.totalResolveSeconds();
+    this->swap_latency.clear();
+    this->input_latency.clear();
+    this->mailbox.clear();
+    this->anti_alias_pass.clear();
+    this->scene_framebuffer = 0;
+
+    this->frame_capture.close();
+    this->frame_server.close();
+    this->closeTrace();
+    {
+        glResourceOwner owner(scene.name());
+        scene.shutdown(*this);
+    }
+    this->reportRun(scene);
+    frame_tracker.report(stderr);
+    this->active_scene = nullptr;
+    this->closeBackend();
+    return 0;
+}
+
+void Runtime::reportRun(const Scene& scene) {
+    const runStats& stats = this->last_run;
+    if (stats.n_frames == 0) {
+        return;
+    }
+    double ms_per_frame = 1000.0 / stats.n_frames;
+    fprintf(stderr, "%s: %llu frames in %.2f s, per frame %.3f ms update, "
+                    "%.3f ms render, %.3f ms present\n",
+            scene.name(), (unsigned long long)stats.n_frames, stats.wall_seconds,
+            stats.update_seconds * ms_per_frame, stats.render_seconds * ms_per_frame,
+            stats.present_seconds * ms_per_frame);
+    // what a host running many instances cares about
+    fprintf(stderr, "%s: %.3f s CPU per wall second (%.3f s of it in %d job workers), "
+                    "%.2f of %.2f s idle waiting for events\n",
+            scene.name(), stats.cpu_seconds / stats.wall_seconds,
+            stats.worker_cpu_seconds / stats.wall_seconds,
+            this->job_system->threadCount() - 1, stats.idle_seconds, stats.wall_seconds);
+    if (stats.n_swap_latency_samples > 0) {
+        presentMode mode = this->settings.uncapped ? PRESENT_UNCAPPED : this->settings.present_mode;
+        fprintf(stderr, "present %s: %llu of %llu frames shown, swap latency %.3f ms average, "
+                        "%.3f ms max\n",
+                presentModeName(mode), (unsigned long long)stats.n_presented,
+                (unsigned long long)stats.n_frames,
+                stats.swap_latency_seconds * 1000.0 / stats.n_swap_latency_samples,
+                stats.max_swap_latency_seconds * 1000.0);
+    }
+    if (stats.n_gpu_frames > 0) {
+        double gpu_ms = 1000.0 / stats.n_gpu_frames;
+        // wall time beside the split, a driver can still move work between the brackets
+        fprintf(stderr, "anti-alias %s: per frame %.3f ms wall, %.3f ms on the GPU, "
+                        "%.3f ms of it resolving\n",
+                antiAliasModeName(stats.anti_alias), stats.wall_seconds * ms_per_frame,
+                stats.gpu_render_seconds * gpu_ms, stats.gpu_anti_alias_seconds * gpu_ms);
+    }
+    const latencySummary& to_present = stats.input_to_present;
+    if (to_present.n_samples > 0) {
+        fprintf(stderr, "input to present%s over %llu inputs: p50 %.2f ms, p95 %.2f ms, "
+                        "p99 %.2f ms, max %.2f ms (p50 %.2f ms to update, %.2f ms to submit)\n",
+                this->settings.late_latch ? " (late latched)" : "",
+                (unsigned long long)to_present.n_samples, to_present.p50, to_present.p95,
+                to_present.p99, to_present.max, stats.input_to_update.p50,
+                stats.input_to_submit.p50);
+    }
+    if (this->settings.replay_path) {
+        const glCallCounts& calls = stats.gl_calls;
+        fprintf(stderr, "replay%s: frame time p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, "
+                        "max %.3f ms (frame %llu); per frame %.1f draws, %.1f binds, "
+                        "%.1f uniform updates, %.1f uploads\n",
+                this->settings.replay_original_timing ? " at the recorded pace" : "",
+                stats.replay_p50_seconds * 1000.0, stats.replay_p95_seconds * 1000.0,
+                stats.replay_p99_seconds * 1000.0, stats.replay_max_seconds * 1000.0,
+                (unsigned long long)stats.replay_slowest_frame,
+                (double)calls.draw_calls / stats.n_frames,
+                (double)calls.binds / stats.n_frames,
+                (double)calls.uniform_updates / stats.n_frames,
+                (double)calls.uploads / stats.n_frames);
+    }
+    const glResourceTotals& gl = stats.gl_resources;
+    const double MB = 1024.0 * 1024.0;
+    fprintf(stderr, "memory: GL ~%.1f MB (%.1f MB peak; %.1f MB in %llu textures, %.1f MB in "
+                    "%llu buffers, %.1f MB in %llu renderbuffers, %llu programs), heap %.1f MB "
+                    "(%.1f MB peak)\n",
+            gl.totalBytes() / MB, stats.gl_peak_bytes / MB,
+            gl.bytes[GL_RESOURCE_TEXTURE] / MB,
+            (unsigned long long)gl.count[GL_RESOURCE_TEXTURE],
+            gl.bytes[GL_RESOURCE_BUFFER] / MB,
+            (unsigned long long)gl.count[GL_RESOURCE_BUFFER],
+            gl.bytes[GL_RESOURCE_RENDERBUFFER] / MB,
+            (unsigned long long)gl.count[GL_RESOURCE_RENDERBUFFER],
+            (unsigned long long)gl.count[GL_RESOURCE_PROGRAM],
+            stats.heap_bytes / MB, stats.heap_peak_bytes / MB);
+    uint64_t budget = this->texture_registry.budget();
+    if (budget > 0) {
+        const textureBudgetStats& textures = stats.texture_budget;
+        fprintf(stderr, "texture budget %.1f MB: %.1f MB resident, %.1f MB peak, %llu evicted, "
+                        "%llu reloaded, %llu refused\n",
+                budget / MB, stats.texture_bytes / MB, textures.peak_bytes / MB,
+                (unsigned long long)textures.n_evictions,
+                (unsigned long long)textures.n_reloads,
+                (unsigned long long)textures.n_refused);
+    }
+    this->job_system->printStats(stderr);
+}
+
+const char* Runtime::resourcePath(const char* relative_path) {
+    const char* root = this->settings.resource_root;
+    const char* scene_name = this->active_scene ? this->active_scene->name() : "";
+    size_t length = strlen(relative_path) + 8;
+    if (root) {
+        length += strlen(root) + strlen(scene_name) + 2;
+    }
+    char* path = static_cast<char*>(this->frame_arena.allocate(length, 1));
+    if (root) {
+        snprintf(path, length, "%s/%s/res/%s", root, scene_name, relative_path);
+    } else {
+        snprintf(path, length, "res/%s", relative_path);
+    }
+    return path;
+}
+
+// reads the source through the scratch arena, so reloading never touches the heap
+static GLuint compileShaderFile(GLenum shader_type, const char* path, const char* defines) {
+    ArenaScope scratch(scratchArena());
+    const GLchar* src = readFileInto(scratchArena(), path);
+    if (!src) {
+        SOUP_LOG_ERROR("could not read shader file %s", path);
+        return 0;
+    }
+
+    // #version has to stay first, the defines go after it and #line keeps
+    // the compiler's line numbers matching the file
+    const GLchar* parts[4] = { "", "", "", src };
+    if (defines && defines[0]) {
+        const char* body = src;
+        if (strncmp(src, "#version", 8) == 0) {
+            const char* newline = strchr(src, '\n');
+            body = newline ? newline + 1 : src + strlen(src);
+        }
+        size_t version_length = body - src;
+        char* version = static_cast<char*>(scratchArena().allocate(version_length + 2, 1));
+        memcpy(version, src, version_length);
+        // a #version line without a newline at the end of the file
+        if (version_length > 0 && version[version_length - 1] != '\n') {
+            version[version_length++] = '\n';
+        }
+        version[version_length] = '\0';
+        char* line = static_cast<char*>(scratchArena().allocate(32, 1));
+        snprintf(line, 32, "#line %d\n", version_length > 0 ? 2 : 1);
+        parts[0] = version;
+        parts[1] = defines;
+        parts[2] = line;
+        parts[3] = body;
+    }
+
+    GLuint shader = glCreateShader(shader_type);
+    glShaderSource(shader, 4, parts, NULL);
+    glCompileShader(shader);
+
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE) {
+        char info_log[1024];
+        glGetShaderInfoLog(shader, sizeof(info_log), NULL, info_log);
+        SOUP_LOG_ERROR("%s failed to compile:\n%s", path, info_log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool Runtime::loadMesh(const char* mesh_path, gpuMesh* mesh,
+                       const meshAttributeLocations& locations) {
+    return soupcans::loadMesh(this->resourcePath(mesh_path), locations, mesh);
+}
+
+// compiles every stage from res/ and links them, 0 if any of that fails
+GLuint Runtime::linkShaderFiles(const GLenum* types, const char* const* paths, int n_stages,
+                                const char* defines) {
+    GLuint shaders[5] = { 0, 0, 0, 0, 0 };
+    bool compiled = true;
+    for (int i = 0; i < n_stages; i++) {
+        shaders[i] = compileShaderFile(types[i], this->resourcePath(paths[i]), defines);
+        compiled = compiled && shaders[i];
+    }
+    GLuint program = compiled ? glCreateProgram() : 0;
+    for (int i = 0; i < n_stages; i++) {
+        if (program) {
+            glAttachShader(program, shaders[i]);
+        }
+    }
+    if (program) {
+        glLinkProgram(program);
+    }
+    // the program keeps what it needs, the shader objects can go
+    for (int i = 0; i < n_stages; i++) {
+        glDeleteShader(shaders[i]);
+    }
+    if (!program) {
+        return 0;
+    }
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        char info_log[1024];
+        glGetProgramInfoLog(program, sizeof(info_log), NULL, info_log);
+        SOUP_LOG_ERROR("%s + %s failed to link:\n%s", paths[0], paths[n_stages - 1], info_log);
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+GLuint Runtime::loadShaderProgram(const char* vertex_path, const char* fragment_path,
+                                  const char* defines) {
+    const GLenum types[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    const char* paths[] = { vertex_path, fragment_path };
+    return this->linkShaderFiles(types, paths, 2, defines);
+}
+
+GLuint Runtime::loadTessellatedProgram(const char* vertex_path, const char* control_path,
+                                       const char* evaluation_path, const char* fragment_path,
+                                       const char* defines) {
+    const GLenum types[] = {
+        GL_VERTEX_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER, GL_FRAGMENT_SHADER
+    };
+    const char* paths[] = { vertex_path, control_path, evaluation_path, fragment_path };
+    return this->linkShaderFiles(types, paths, 4, defines);
+}
+
+bool Runtime::reloadShaderProgram(GLuint* program, const char* vertex_path,
+                                  const char* fragment_path, const char* defines) {
+    GLuint new_program = this->loadShaderProgram(vertex_path, fragment_path, defines);
+    if (!new_program) {
+        return false;
+    }
+    glDeleteProgram(*program);
+    *program = new_program;
+    return true;
+}
+
+void printRuntimeFlags(FILE* out) {
+    fprintf(out,
+            "[--headless] [--frames N] [--fps N] [--threads N] "
+            "[--resources DIR] [--debug release|async|sync] "
+            "[--present vsync|adaptive|uncapped|mailbox] [--late-latch] "
+            "[--anti-alias off|msaa2|msaa4|msaa8|fxaa] "
+            "[--background-fps N] [--capture FILE] [--capture-fps N] [--serve SOCKET] "
+            "[--texture-budget MB] [--seed N] [--record FILE] [--replay FILE] "
+            "[--replay-timing fast|original]");
+}
+
+static void printUsage(const char* program_name) {
+    fprintf(stderr, "usage: %s ", program_name);
+    printRuntimeFlags(stderr);
+    fprintf(stderr, " [scene options]\n");
+}
+
+int parseRuntimeFlag(int argc, char** argv, int* i, runtimeSettings* settings) {
+    const char* flag = argv[*i];
+    bool has_value = *i + 1 < argc;
+    if (strcmp(flag, "--headless") == 0) {
+        settings->backend = BACKEND_HEADLESS;
+    } else if (strcmp(flag, "--late-latch") == 0) {
+        settings->late_latch = true;
+    } else if (!has_value) {
+        return 0;
+    } else if (strcmp(flag, "--frames") == 0) {
+        settings->max_frames = strtoull(argv[++*i], nullptr, 10);
+    } else if (strcmp(flag, "--fps") == 0) {
+        settings->max_fps = atof(argv[++*i]);
+    } else if (strcmp(flag, "--threads") == 0) {
+        settings->n_threads = atoi(argv[++*i]);
+    } else if (strcmp(flag, "--resources") == 0) {
+        settings->resource_root = argv[++*i];
+    } else if (strcmp(flag, "--debug") == 0) {
+        if (!parseDebugLevel(argv[++*i], &settings->debug_level)) {
+            return -1;
+        }
+        if (clampDebugLevel(settings->debug_level) != settings->debug_level) {
+            SOUP_LOG_WARNING("this build only goes up to debug level %d",
+                             SOUP_DEBUG_LEVEL);
+        }
+    } else if (strcmp(flag, "--background-fps") == 0) {
+        settings->scheduler.background_fps = atof(argv[++*i]);
+    } else if (strcmp(flag, "--present") == 0) {
+        if (!parsePresentMode(argv[++*i], &settings->present_mode)) {
+            return -1;
+        }
+    } else if (strcmp(flag, "--anti-alias") == 0) {
+        if (!parseAntiAliasMode(argv[++*i], &settings->anti_alias)) {
+            return -1;
+        }
+    } else if (strcmp(flag, "--capture") == 0) {
+        settings->capture_path = argv[++*i];
+    } else if (strcmp(flag, "--capture-fps") == 0) {
+        settings->capture_fps = atof(argv[++*i]);
+    } else if (strcmp(flag, "--serve") == 0) {
+        settings->serve_path = argv[++*i];
+    } else if (strcmp(flag, "--texture-budget") == 0) {
+        settings->texture_budget = (uint64_t)(atof(argv[++*i]) * 1024.0 * 1024.0);
+    } else if (strcmp(flag, "--seed") == 0) {
+        settings->random_seed = strtoull(argv[++*i], nullptr, 10);
+    } else if (strcmp(flag, "--record") == 0) {
+        settings->record_path = argv[++*i];
+    } else if (strcmp(flag, "--replay") == 0) {
+        settings->replay_path = argv[++*i];
+    } else if (strcmp(flag, "--replay-timing") == 0) {
+        const char* timing = argv[++*i];
+        if (strcmp(timing, "original") == 0) {
+            settings->replay_original_timing = true;
+        } else if (strcmp(timing, "fast") == 0) {
+            settings->replay_original_timing = false;
+        } else {
+            return -1;
+        }
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+int runSceneMain(int argc, char** argv, sceneFactory create_scene) {
+    // runtime flags are taken out, everything else goes to the scene
+    runtimeSettings settings;
+    std::vector<char*> scene_argv;
+    scene_argv.push_back(argv[0]);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            printUsage(argv[0]);
+            return 0;
+        }
+        int parsed = parseRuntimeFlag(argc, argv, &i, &settings);
+        if (parsed < 0) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (parsed == 0) {
+            scene_argv.push_back(argv[i]);
+        }
+    }
+    scene_argv.push_back(nullptr);
+
+    Runtime runtime(settings);
+    std::unique_ptr<Scene> scene = create_scene(
+        static_cast<int>(scene_argv.size()) - 1, scene_argv.data()
+    );
+    if (!scene) {
+        return 1;
+    }
+    return runtime.run(*scene);
+}
+
+}
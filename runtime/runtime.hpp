@@ -0,0 +1,324 @@
+#ifndef SOUPCANS_RUNTIME_HPP
+#define SOUPCANS_RUNTIME_HPP
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <memory>
+#include <vector>
+
+#include "../common/frameArena.hpp"
+#include "../common/inputTrace.hpp"
+#include "../common/jobSystem.hpp"
+#include "../common/log.hpp"
+#include "antiAliasing.hpp"
+#include "backend.hpp"
+#include "frameCapture.hpp"
+#include "frameServer.hpp"
+#include "glCallCounter.hpp"
+#include "glResources.hpp"
+#include "latency.hpp"
+#include "meshes.hpp"
+#include "presentation.hpp"
+#include "renderPass.hpp"
+#include "renderScheduler.hpp"
+#include "scene.hpp"
+#include "textures.hpp"
+
+namespace soupcans {
+
+struct runtimeSettings {
+    backendKind backend = BACKEND_WINDOW;
+    // stop after this many frames, 0 runs until the window closes
+    uint64_t max_frames = 0;
+    // overrides the scene's frame rate cap when set
+    double max_fps = 0.0;
+    // ignore every frame rate cap, for benchmarks; implies PRESENT_UNCAPPED
+    bool uncapped = false;
+    presentMode present_mode = defaultPresentMode();
+    antiAliasMode anti_alias = defaultAntiAliasMode();
+    // poll input again just before render(), see Scene::lateLatch()
+    bool late_latch = false;
+    // idling and background throttling, windowed runs that aren't uncapped only
+    schedulerSettings scheduler;
+    // override the scene's window size when set
+    int width = 0;
+    int height = 0;
+    // wrap the GL entry points to count calls into runStats, costs a little
+    bool count_gl_calls = false;
+    int n_threads = 0;
+    // where scenes find res/, nullptr means the working directory
+    const char* resource_root = nullptr;
+    // GL debug context and diagnostics, capped by SOUP_DEBUG_LEVEL at build time
+    debugLevel debug_level = defaultDebugLevel();
+    /* Records every frame to a file, see captureFormatFor(). Runs headless
+       and uncapped, with update() getting a fixed 1 / capture_fps step so
+       the video plays at the right speed however long a frame took.
+    */
+    const char* capture_path = nullptr;
+    double capture_fps = 60.0;
+    /* Publishes every frame to local processes through shared memory,
+       listening on this Unix socket, see FrameServer. Runs headless at the
+       scene's own frame rate; consumers composite the frames themselves.
+    */
+    const char* serve_path = nullptr;
+    /* Bytes the scene's textures may take, 0 for no limit. Textures with
+       a loader are evicted and reloaded to stay under it, one that can't
+       fit is refused; see TextureRegistry::setBudget().
+    */
+    uint64_t texture_budget = defaultTextureBudget();
+    /* Records what the scene's frames depended on, see inputTrace.hpp: the
+       random seed, each frame's dt and clock and the keys it saw pressed.
+    */
+    const char* record_path = nullptr;
+    /* Runs the frames of a recorded trace instead of live ones: headless
+       at the recorded size, with GL calls counted and every frame timed.
+       As fast as it goes, or with replay_original_timing at the pace it
+       was recorded at. Runs the scene with the same flags it was
+       recorded with, the trace doesn't hold them.
+    */
+    const char* replay_path = nullptr;
+    bool replay_original_timing = false;
+    // what Runtime::randomSeed() hands the scene, 0 picks one from the clock
+    uint64_t random_seed = 0;
+};
+
+struct frameTimings {
+    double update_seconds;
+    double render_seconds;
+    double present_seconds;
+    double frame_seconds;
+    /* GPU time of the scene's drawing plus the anti-aliasing resolve, and
+       of the resolve alone. These are for the newest frame the GPU has
+       finished, a few frames behind this one, and negative until one has.
+    */
+    double gpu_render_seconds;
+    double gpu_anti_alias_seconds;
+};
+
+// totals for one run(), what the batch benchmarks report
+struct runStats {
+    uint64_t n_frames;
+    double update_seconds;
+    double render_seconds;
+    double present_seconds;
+    double wall_seconds;
+    // CPU time the whole process used, and how long it slept waiting for events
+    double cpu_seconds;
+    double idle_seconds;
+    // the part of cpu_seconds this runtime's job workers used, idle or not
+    double worker_cpu_seconds;
+    uint64_t n_allocating_frames;
+    uint64_t n_heap_allocations;
+    // frames that reached the display, fewer than n_frames with PRESENT_MAILBOX
+    uint64_t n_presented;
+    // present() until the GPU is done with the swap, measured with fences
+    uint64_t n_swap_latency_samples;
+    double swap_latency_seconds;
+    double max_swap_latency_seconds;
+    // frames that acted on input, see LatencyTracker
+    latencySummary input_to_update;
+    latencySummary input_to_submit;
+    latencySummary input_to_present;
+    // what the scene ran with and, over the frames timed on the GPU, what it cost
+    antiAliasMode anti_alias;
+    uint64_t n_gpu_frames;
+    double gpu_render_seconds;
+    double gpu_anti_alias_seconds;
+    // only filled in with runtimeSettings::count_gl_calls
+    glCallCounts gl_calls;
+    // GL objects alive after the last frame, estimated bytes, see GlResourceRegistry
+    glResourceTotals gl_resources;
+    uint64_t gl_peak_bytes;
+    // global operator new, process wide
+    uint64_t heap_bytes;
+    uint64_t heap_peak_bytes;
+    uint64_t texture_bytes;
+    textureBudgetStats texture_budget;
+    // with runtimeSettings::replay_path, CPU frame time percentiles and the slowest frame
+    double replay_p50_seconds;
+    double replay_p95_seconds;
+    double replay_p99_seconds;
+    double replay_max_seconds;
+    uint64_t replay_slowest_frame;
+};
+
+// called after every frame, for profilers and benchmark harnesses
+typedef void (*profileHook)(const Scene& scene, uint64_t frame,
+                            const frameTimings& timings, void* user_data);
+
+/* Owns everything the demos used to set up by hand: the backend and GL
+   context, the job system, the per-frame arena, frame pacing, logging of
+   GL debug output and loading of resources. One runtime can run any
+   number of scenes one after the other.
+*/
+class Runtime {
+    public:
+        explicit Runtime(const runtimeSettings& settings = runtimeSettings());
+        ~Runtime();
+
+        Runtime(const Runtime&) = delete;
+        Runtime& operator=(const Runtime&) = delete;
+
+        // runs the scene until it closes or max_frames is reached, 0 on success
+        int run(Scene& scene);
+        /* Same on a backend made elsewhere instead of one of settings.backend,
+           a video wall panel's window. The runtime keeps it until the run ends.
+        */
+        int run(Scene& scene, std::unique_ptr<Backend> backend);
+
+        const runStats& lastRunStats() const {
+            return this->last_run;
+        }
+
+        void setProfileHook(profileHook hook, void* user_data);
+        // from the next run() on, for benchmarks that compare modes
+        void setAntiAliasMode(antiAliasMode mode) {
+            this->settings.anti_alias = mode;
+        }
+
+        /* For scenes */
+        JobSystem& jobs() {
+            return *this->job_system;
+        }
+        // reset at the start of every frame
+        LinearArena& frameArena() {
+            return this->frame_arena;
+        }
+        Backend& backend() {
+            return *this->active_backend;
+        }
+        // emptied when the scene's context goes away
+        TextureRegistry& textures() {
+            return this->texture_registry;
+        }
+        // every GL object made in the scene's context, by owner
+        const GlResourceRegistry& glResources() const {
+            return this->gl_resources;
+        }
+        /* What render() starts out drawing to, and what a scene that draws
+           offscreen should bind again for the window: the anti-aliasing
+           target, or with that off 0 or the ring target of PRESENT_MAILBOX.
+        */
+        GLuint sceneFramebuffer() const {
+            return this->scene_framebuffer;
+        }
+        uint64_t frameIndex() const {
+            return this->frame_index;
+        }
+        double time() const {
+            return this->frame_time;
+        }
+        /* Seed whatever randomness the scene has with this, a replay gets
+           the seed the recording had. Set before init().
+        */
+        uint64_t randomSeed() const {
+            return this->random_seed;
+        }
+        void framebufferSize(int* width, int* height);
+        /* Render passes, see renderPass.hpp. A pass goes to sceneFramebuffer()
+           unless it is given one of the scene's own, one pass at a time.
+        */
+        void beginRenderPass(const renderPassDesc& pass) {
+            this->beginRenderPass(pass, this->scene_framebuffer);
+        }
+        void beginRenderPass(const renderPassDesc& pass, GLuint framebuffer);
+        void endRenderPass();
+        // recorded and replayed, see runtimeSettings::record_path; input in init() isn't
+        bool keyPressed(int key);
+        void requestClose();
+        // draw another frame even though the scene isn't animating
+        void requestRedraw() {
+            this->scheduler.requestRedraw();
+        }
+
+        /* Resources */
+        // path of a file under the scene's res/ directory, valid for this frame
+        const char* resourcePath(const char* relative_path);
+        /* Compiles and links a vertex + fragment shader pair from res/, 0 on
+           failure. `defines` ("#define NAME 1\n" lines) goes in right after
+           each file's #version line.
+        */
+        GLuint loadShaderProgram(const char* vertex_path, const char* fragment_path,
+                                 const char* defines = nullptr);
+        // same with tessellation control and evaluation stages, GL 4.0 and up
+        GLuint loadTessellatedProgram(const char* vertex_path, const char* control_path,
+                                      const char* evaluation_path, const char* fragment_path,
+                                      const char* defines = nullptr);
+        // swaps in a fresh build of the program, keeps the old one if it fails
+        bool reloadShaderProgram(GLuint* program, const char* vertex_path,
+                                 const char* fragment_path, const char* defines = nullptr);
+        // a packed mesh from res/, see loadMesh() in meshes.hpp
+        bool loadMesh(const char* mesh_path, gpuMesh* mesh,
+                      const meshAttributeLocations& locations = meshAttributeLocations());
+
+    private:
+        runtimeSettings settings;
+        std::unique_ptr<JobSystem> job_system;
+        std::unique_ptr<Backend> active_backend;
+        std::unique_ptr<Backend> provided_backend;
+        LinearArena frame_arena;
+        GlResourceRegistry gl_resources;
+        TextureRegistry texture_registry;
+        FrameCapture frame_capture;
+        FrameServer frame_server;
+        InputTraceWriter trace_writer;
+        InputTraceReader trace_reader;
+        // what this frame has seen pressed, or replays
+        traceFrame trace_frame;
+        // 0 until the late latch poll, then 1
+        int input_poll;
+        uint64_t random_seed;
+        std::vector<double> replay_frame_seconds;
+        MailboxRing mailbox;
+        AntiAliasPass anti_alias_pass;
+        SwapLatencyProbe swap_latency;
+        LatencyTracker input_latency;
+        RenderScheduler scheduler;
+        GLuint scene_framebuffer;
+        const Scene* active_scene;
+        // glInvalidateFramebuffer works in this context
+        bool can_invalidate;
+        renderPassDesc open_pass;
+        GLuint open_pass_framebuffer;
+        bool pass_open;
+
+        uint64_t frame_index;
+        double frame_time;
+        double title_time;
+        uint64_t title_frames;
+        runStats last_run;
+        profileHook profile_hook;
+        void* profile_user_data;
+
+        bool openBackend(const sceneSettings& scene_settings);
+        void closeBackend();
+        void updateTitle(const char* scene_title);
+        void pace(double frame_start, double max_fps);
+        void reportRun(const Scene& scene);
+        bool openTrace(Scene& scene, sceneSettings* scene_settings);
+        void closeTrace();
+        GLuint linkShaderFiles(const GLenum* types, const char* const* paths, int n_stages,
+                               const char* defines);
+};
+
+/* Loads the gl3w entry points and puts the resource tracking wrappers on
+   them, once per process; the first call needs a current context. The
+   entry points are process wide, so the video wall does this before its
+   panel threads start rather than have one panel swap them under another.
+*/
+bool loadGlEntryPoints();
+
+/* Takes the runtime flag at argv[*i] and its value into settings, leaving
+   *i on the last argument it used. 1 if it took one, 0 if argv[*i] isn't a
+   runtime flag, -1 if the value is bad.
+*/
+int parseRuntimeFlag(int argc, char** argv, int* i, runtimeSettings* settings);
+void printRuntimeFlags(FILE* out);
+
+// a demo's whole main(): parses the runtime flags and runs one scene
+int runSceneMain(int argc, char** argv, sceneFactory create_scene);
+
+}
+
+#endif
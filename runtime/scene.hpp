@@ -0,0 +1,75 @@
+#ifndef SOUPCANS_SCENE_HPP
+#define SOUPCANS_SCENE_HPP
+
+#include <memory>
+
+#include "backend.hpp"
+
+namespace soupcans {
+
+class Runtime;
+
+struct sceneSettings {
+    windowSettings window;
+    // frame rate cap on top of vsync, 0 leaves the frame rate alone
+    double max_fps = 0.0;
+    /* False for scenes that draw offscreen and blit the result to
+       Runtime::sceneFramebuffer(). A blit can't write a multisampled
+       framebuffer, so the MSAA modes are off for them; FXAA still works.
+    */
+    bool multisample = true;
+};
+
+/* A demo, minus all the setup. The runtime opens the backend, calls init()
+   once the GL context exists, then update() and render() every frame and
+   shutdown() before the context goes away. GL objects made in init() must
+   be released in shutdown(), scenes can run back to back in one process.
+*/
+class Scene {
+    public:
+        virtual ~Scene() {}
+
+        virtual const char* name() const = 0;
+
+        // what the scene wants from the backend and the frame pacing
+        virtual sceneSettings settings() const {
+            return sceneSettings();
+        }
+
+        // false stops the run before the first frame
+        virtual bool init(Runtime& runtime) = 0;
+
+        /* False while nothing changes without input. The runtime then
+           stops drawing and waits for events, until input, the window
+           system or Runtime::requestRedraw() wants a frame.
+        */
+        virtual bool animating() const {
+            return true;
+        }
+
+        // dt is the time since the previous update in seconds, idle waits left out
+        virtual void update(Runtime& runtime, double dt) = 0;
+
+        /* With late latching on, input is polled again right before
+           render() and this is called if any came in since update(). Only
+           re-read what render() shows straight from input here, the frame
+           is about to be submitted.
+        */
+        virtual void lateLatch(Runtime& runtime) {
+            (void)runtime;
+        }
+
+        // the viewport already covers the framebuffer
+        virtual void render(Runtime& runtime) = 0;
+
+        virtual void shutdown(Runtime& runtime) {
+            (void)runtime;
+        }
+};
+
+// every demo exposes one of these, argv[1..] are the demo's own options
+typedef std::unique_ptr<Scene> (*sceneFactory)(int argc, char** argv);
+
+}
+
+#endif
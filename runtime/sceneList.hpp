@@ -0,0 +1,19 @@
+#ifndef SOUPCANS_SCENE_LIST_HPP
+#define SOUPCANS_SCENE_LIST_HPP
+
+#include "scene.hpp"
+
+namespace soupcans {
+
+/* Every demo scene. Each one is defined next to its demo, link in the
+   demo's scene source to use it.
+*/
+std::unique_ptr<Scene> createBouncingCandyScene(int argc, char** argv);
+std::unique_ptr<Scene> createDvdTriangleScene(int argc, char** argv);
+std::unique_ptr<Scene> createImageCubeScene(int argc, char** argv);
+std::unique_ptr<Scene> createRotatingColorsScene(int argc, char** argv);
+std::unique_ptr<Scene> createShaderTriangleScene(int argc, char** argv);
+
+}
+
+#endif
@@ -0,0 +1,91 @@
+#include <stdio.h>
+
+#include "../common/log.hpp"
+#include "runtime.hpp"
+#include "shaderPermutations.hpp"
+
+namespace soupcans {
+
+ShaderPermutations::ShaderPermutations(const char* vertex_path, const char* fragment_path,
+                                       const char* const* feature_names, int n_features) {
+    this->vertex_path = vertex_path;
+    this->fragment_path = fragment_path;
+    this->feature_names = feature_names;
+    this->n_features = (n_features < MAX_FEATURES) ? n_features : MAX_FEATURES;
+}
+
+ShaderPermutations::~ShaderPermutations() {
+    if (!this->variants.empty()) {
+        SOUP_LOG_WARNING("%zu variants of %s leaked, clear() them before the context goes",
+                         this->variants.size(), this->fragment_path);
+    }
+}
+
+GLuint ShaderPermutations::build(Runtime& runtime, uint32_t mask) {
+    char defines[2048];
+    size_t length = 0;
+    defines[0] = '\0';
+    for (int i = 0; i < this->n_features; i++) {
+        if (mask & (1u << i)) {
+            int written = snprintf(defines + length, sizeof(defines) - length,
+                                   "#define %s 1\n", this->feature_names[i]);
+            if (written < 0 || (size_t)written >= sizeof(defines) - length) {
+                SOUP_LOG_ERROR("too many features for %s", this->fragment_path);
+                return 0;
+            }
+            length += written;
+        }
+    }
+    if (this->n_features < MAX_FEATURES && (mask >> this->n_features)) {
+        SOUP_LOG_WARNING("%s has no feature for mask bits 0x%x", this->fragment_path,
+                         mask >> this->n_features << this->n_features);
+    }
+    GLuint program = runtime.loadShaderProgram(this->vertex_path, this->fragment_path, defines);
+    if (!program) {
+        SOUP_LOG_ERROR("variant 0x%x of %s failed", mask, this->fragment_path);
+    }
+    return program;
+}
+
+GLuint ShaderPermutations::get(Runtime& runtime, uint32_t mask) {
+    // a handful of variants per shader, a linear search beats hashing
+    for (const variant& v : this->variants) {
+        if (v.mask == mask) {
+            return v.program;
+        }
+    }
+    GLuint program = this->build(runtime, mask);
+    this->variants.push_back(variant{ mask, program });
+    return program;
+}
+
+bool ShaderPermutations::warm(Runtime& runtime, const uint32_t* masks, int n_masks) {
+    bool ok = true;
+    for (int i = 0; i < n_masks; i++) {
+        ok = this->get(runtime, masks[i]) && ok;
+    }
+    return ok;
+}
+
+bool ShaderPermutations::reload(Runtime& runtime) {
+    bool ok = true;
+    for (variant& v : this->variants) {
+        GLuint program = this->build(runtime, v.mask);
+        if (!program) {
+            ok = false;
+            continue;
+        }
+        glDeleteProgram(v.program);
+        v.program = program;
+    }
+    return ok;
+}
+
+void ShaderPermutations::clear() {
+    for (const variant& v : this->variants) {
+        glDeleteProgram(v.program);
+    }
+    this->variants.clear();
+}
+
+}
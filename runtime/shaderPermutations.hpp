@@ -0,0 +1,71 @@
+#ifndef SOUPCANS_SHADER_PERMUTATIONS_HPP
+#define SOUPCANS_SHADER_PERMUTATIONS_HPP
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <GL/gl3w.h>
+
+namespace soupcans {
+
+class Runtime;
+
+/* Every variant of one vertex + fragment shader pair. Bit i of a feature
+   mask #defines feature_names[i] to 1 for that build, so the shader picks
+   its code paths with #ifdef instead of branching on uniforms. Each mask
+   is compiled once on first use and cached; switching modes at runtime
+   is then a glUseProgram, not a branch on every pixel.
+*/
+class ShaderPermutations {
+    public:
+        static const int MAX_FEATURES = 32;
+
+        // the names are not copied and have to outlive the permutations
+        ShaderPermutations(const char* vertex_path, const char* fragment_path,
+                           const char* const* feature_names, int n_features);
+        ~ShaderPermutations();
+
+        ShaderPermutations(const ShaderPermutations&) = delete;
+        ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+        /* The program for exactly these features. 0 if it doesn't compile,
+           which is remembered too, so a broken variant isn't rebuilt every
+           frame until the next reload().
+        */
+        GLuint get(Runtime& runtime, uint32_t mask);
+
+        // builds the variants up front so the first mode switch doesn't hitch
+        bool warm(Runtime& runtime, const uint32_t* masks, int n_masks);
+
+        /* Rebuilds every cached variant from the files. A variant that no
+           longer compiles keeps its old program; program names change, so
+           look uniforms up again afterwards.
+        */
+        bool reload(Runtime& runtime);
+
+        int variantCount() const {
+            return static_cast<int>(this->variants.size());
+        }
+
+        // deletes every program, call while the context is still current
+        void clear();
+
+    private:
+        struct variant {
+            uint32_t mask;
+            GLuint program;
+        };
+
+        const char* vertex_path;
+        const char* fragment_path;
+        const char* const* feature_names;
+        int n_features;
+        std::vector<variant> variants;
+
+        GLuint build(Runtime& runtime, uint32_t mask);
+};
+
+}
+
+#endif
@@ -0,0 +1,650 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../common/log.hpp"
+#include "glResources.hpp"
+#include "textures.hpp"
+
+// from the 4.6 headers, the anisotropic extensions use the same values
+#ifndef GL_TEXTURE_MAX_ANISOTROPY
+#define GL_TEXTURE_MAX_ANISOTROPY 0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY 0x84FF
+#endif
+
+namespace soupcans {
+
+static uint32_t samplerKey(const samplerDesc& desc, int anisotropy) {
+    return (uint32_t)desc.filter | ((uint32_t)desc.wrap << 4) | ((uint32_t)anisotropy << 8);
+}
+
+static GLenum wrapMode(samplerWrap wrap) {
+    if (wrap == WRAP_CLAMP) {
+        return GL_CLAMP_TO_EDGE;
+    } else if (wrap == WRAP_MIRROR) {
+        return GL_MIRRORED_REPEAT;
+    }
+    return GL_REPEAT;
+}
+
+bool hasGlExtension(const char* name) {
+    GLint n_extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &n_extensions);
+    for (GLint i = 0; i < n_extensions; i++) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (extension && !strcmp(extension, name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint64_t defaultTextureBudget() {
+    const char* megabytes = getenv("SOUP_TEXTURE_BUDGET");
+    return megabytes ? (uint64_t)(atof(megabytes) * 1024.0 * 1024.0) : 0;
+}
+
+SamplerCache::SamplerCache() {
+    this->max_supported_anisotropy = 0;
+}
+
+SamplerCache::~SamplerCache() {
+    if (!this->samplers.empty()) {
+        SOUP_LOG_WARNING("%zu samplers leaked, clear() the cache before the context goes",
+                         this->samplers.size());
+    }
+}
+
+GLuint SamplerCache::get(const samplerDesc& desc) {
+    int anisotropy = (desc.max_anisotropy > 1) ? desc.max_anisotropy : 1;
+    if (anisotropy > 1) {
+        if (this->max_supported_anisotropy == 0) {
+            // core in 4.6, an extension with the same enums before that
+            GLint max_anisotropy = 1;
+            if (hasGlExtension("GL_ARB_texture_filter_anisotropic") ||
+                hasGlExtension("GL_EXT_texture_filter_anisotropic")) {
+                glGetIntegerv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &max_anisotropy);
+            }
+            this->max_supported_anisotropy = (max_anisotropy > 1) ? max_anisotropy : 1;
+        }
+        if (anisotropy > this->max_supported_anisotropy) {
+            anisotropy = this->max_supported_anisotropy;
+        }
+    }
+
+    uint32_t key = samplerKey(desc, anisotropy);
+    for (const entry& e : this->samplers) {
+        if (e.key == key) {
+            return e.sampler;
+        }
+    }
+
+    GLuint sampler;
+    glGenSamplers(1, &sampler);
+    GLenum wrap = wrapMode(desc.wrap);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, wrap);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, wrap);
+    if (desc.filter == FILTER_NEAREST) {
+        glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    } else if (desc.filter == FILTER_BILINEAR) {
+        glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+        glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    } else {
+        glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    }
+    if (anisotropy > 1) {
+        glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY, (float)anisotropy);
+    }
+    this->samplers.push_back(entry{ key, sampler });
+    return sampler;
+}
+
+void SamplerCache::clear() {
+    for (const entry& e : this->samplers) {
+        glDeleteSamplers(1, &e.sampler);
+    }
+    this->samplers.clear();
+    this->max_supported_anisotropy = 0;
+}
+
+static int mipLevelsFor(int width, int height) {
+    int largest = (width > height) ? width : height;
+    int n_levels = 1;
+    while (largest > 1) {
+        largest >>= 1;
+        n_levels++;
+    }
+    return n_levels;
+}
+
+static uint64_t mipChainBytes(int width, int height, int n_levels, uint64_t texel_bytes) {
+    uint64_t bytes = 0;
+    for (int level = 0; level < n_levels; level++) {
+        bytes += (uint64_t)width * height;
+        width = (width > 1) ? width / 2 : 1;
+        height = (height > 1) ? height / 2 : 1;
+    }
+    return bytes * texel_bytes;
+}
+
+static double megabytes(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+TextureRegistry::TextureRegistry()
+    : store(std::make_shared<textureStore>()), owns_store(true) {
+    this->store->budget = 0;
+    this->store->resident_bytes = 0;
+    // last_used 0 is never, so frames count from 1
+    this->store->frame = 1;
+    this->store->generation.store(0);
+    this->store->stats = textureBudgetStats{};
+    {
+        std::lock_guard<std::mutex> guard(this->store->lock);
+        this->joinStore();
+    }
+    this->invalidateBindings();
+}
+
+TextureRegistry::~TextureRegistry() {
+    if (this->owns_store && (!this->store->textures.empty() || !this->store->arrays.empty())) {
+        SOUP_LOG_WARNING("%zu textures leaked, clear() the registry before the context goes",
+                         this->store->textures.size() + this->store->arrays.size());
+    }
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    this->leaveStore();
+}
+
+void TextureRegistry::shareTexturesWith(TextureRegistry& owner) {
+    this->clear();
+    {
+        std::lock_guard<std::mutex> guard(this->store->lock);
+        this->leaveStore();
+    }
+    this->store = owner.store;
+    this->owns_store = false;
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    this->joinStore();
+}
+
+void TextureRegistry::joinStore() {
+    std::vector<uint64_t>& frame_starts = this->store->frame_starts;
+    this->sharer = 0;
+    while (this->sharer < (int)frame_starts.size() && frame_starts[this->sharer] != 0) {
+        this->sharer++;
+    }
+    if (this->sharer == (int)frame_starts.size()) {
+        frame_starts.push_back(0);
+    }
+    // the owner of a wall's textures never draws, it mustn't hold back everyone's evictions
+    frame_starts[this->sharer] = NOT_DRAWING;
+    this->bound_generation = this->store->generation.load();
+}
+
+void TextureRegistry::leaveStore() {
+    this->store->frame_starts[this->sharer] = 0;
+}
+
+/* Makes room for `bytes` more, evicting what it has to. Replacing a
+   texture frees the old one, so that one's bytes are already room.
+*/
+bool TextureRegistry::reserve(const char* name, bool array, uint64_t bytes) {
+    textureStore& s = *this->store;
+    uint64_t replaced = 0;
+    if (array) {
+        std::unordered_map<std::string, resident<textureArrayInfo>>::iterator old =
+            s.arrays.find(name);
+        replaced = (old != s.arrays.end() && old->second.info.texture) ?
+            old->second.info.bytes : 0;
+    } else {
+        std::unordered_map<std::string, resident<textureInfo>>::iterator old =
+            s.textures.find(name);
+        replaced = (old != s.textures.end() && old->second.info.texture) ?
+            old->second.info.bytes : 0;
+    }
+    if (s.budget > 0) {
+        while (s.resident_bytes - replaced + bytes > s.budget && this->evictOne(name, array)) {
+        }
+        if (s.resident_bytes - replaced + bytes > s.budget) {
+            s.stats.n_refused++;
+            SOUP_LOG_ERROR("texture %s needs %.1f MB, %.1f MB of the %.1f MB budget can't be "
+                           "evicted", name, megabytes(bytes), megabytes(s.resident_bytes - replaced),
+                           megabytes(s.budget));
+            return false;
+        }
+    }
+    s.resident_bytes += bytes;
+    if (s.resident_bytes - replaced > s.stats.peak_bytes) {
+        s.stats.peak_bytes = s.resident_bytes - replaced;
+    }
+    return true;
+}
+
+// the least recently used texture with a loader that no sharer used in its current frame
+bool TextureRegistry::evictOne(const char* keep_name, bool keep_array) {
+    textureStore& s = *this->store;
+    resident<textureInfo>* oldest_texture = nullptr;
+    resident<textureArrayInfo>* oldest_array = nullptr;
+    // every sharer's beginFrame() moves s.frame, so go by the frame begun longest ago
+    uint64_t oldest = s.frame;
+    for (uint64_t frame_start : s.frame_starts) {
+        if (frame_start != 0 && frame_start < oldest) {
+            oldest = frame_start;
+        }
+    }
+    for (std::pair<const std::string, resident<textureInfo>>& entry : s.textures) {
+        resident<textureInfo>& r = entry.second;
+        if (r.info.texture && r.loader && r.last_used < oldest &&
+            (keep_array || entry.first != keep_name)) {
+            oldest_texture = &r;
+            oldest = r.last_used;
+        }
+    }
+    for (std::pair<const std::string, resident<textureArrayInfo>>& entry : s.arrays) {
+        resident<textureArrayInfo>& r = entry.second;
+        if (r.info.texture && r.loader && r.last_used < oldest &&
+            (!keep_array || entry.first != keep_name)) {
+            oldest_array = &r;
+            oldest_texture = nullptr;
+            oldest = r.last_used;
+        }
+    }
+
+    if (oldest_texture) {
+        glDeleteTextures(1, &oldest_texture->info.texture);
+        oldest_texture->info.texture = 0;
+        s.resident_bytes -= oldest_texture->info.bytes;
+    } else if (oldest_array) {
+        glDeleteTextures(1, &oldest_array->info.texture);
+        oldest_array->info.texture = 0;
+        s.resident_bytes -= oldest_array->info.bytes;
+    } else {
+        return false;
+    }
+    s.stats.n_evictions++;
+    // the freed name can come back for another texture, every sharer's cached binds would skip it
+    s.generation.fetch_add(1);
+    return true;
+}
+
+static const GLenum PIXEL_FORMATS[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+
+GLuint TextureRegistry::upload(const char* name, const unsigned char* pixels,
+                               int width, int height, int n_channels) {
+    if (!pixels) {
+        SOUP_LOG_ERROR("texture %s has no usable pixels", name);
+        return 0;
+    }
+    GLuint texture = this->allocate(name, width, height, n_channels);
+    if (!texture) {
+        return 0;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    // rows of RGB images are not always 4 byte aligned
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, PIXEL_FORMATS[n_channels - 1],
+                    GL_UNSIGNED_BYTE, pixels);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    this->invalidateBindings();
+    return texture;
+}
+
+GLuint TextureRegistry::allocate(const char* name, int width, int height, int n_channels) {
+    static const GLenum INTERNAL_FORMATS[] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+    if (width <= 0 || height <= 0 || n_channels < 1 || n_channels > 4) {
+        SOUP_LOG_ERROR("texture %s has no usable size", name);
+        return 0;
+    }
+
+    textureInfo info;
+    info.width = width;
+    info.height = height;
+    info.n_levels = mipLevelsFor(width, height);
+    // drivers pad RGB to 4 bytes
+    info.bytes = mipChainBytes(width, height, info.n_levels, (n_channels == 3) ? 4 : n_channels);
+    {
+        std::lock_guard<std::mutex> guard(this->store->lock);
+        if (!this->reserve(name, false, info.bytes)) {
+            return 0;
+        }
+    }
+
+    {
+        // a shared store's textures outlive this context, the owner deletes them
+        glResourceOwner owner(this->owns_store ? "textures" : nullptr);
+        glGenTextures(1, &info.texture);
+    }
+    glBindTexture(GL_TEXTURE_2D, info.texture);
+    // immutable storage, every level exists from the start
+    glTexStorage2D(GL_TEXTURE_2D, info.n_levels, INTERNAL_FORMATS[n_channels - 1],
+                   width, height);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    this->invalidateBindings();
+
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    std::unordered_map<std::string, resident<textureInfo>>::iterator old =
+        this->store->textures.find(name);
+    if (old != this->store->textures.end()) {
+        if (old->second.info.texture) {
+            glDeleteTextures(1, &old->second.info.texture);
+            this->store->resident_bytes -= old->second.info.bytes;
+            this->store->generation.fetch_add(1);
+        }
+        // a reload keeps the loader, and counts as used so the next one can't evict it
+        old->second.info = info;
+        old->second.last_used = this->store->frame;
+    } else {
+        // not used until the first use(), everything made in init() can still be evicted
+        this->store->textures.emplace(
+            name, resident<textureInfo>{ info, 0, nullptr, nullptr, false }
+        );
+    }
+    return info.texture;
+}
+
+GLuint TextureRegistry::find(const char* name) const {
+    const textureInfo* found = this->info(name);
+    return found ? found->texture : 0;
+}
+
+// entries never move in the maps, so the pointers stay good after the lock
+const textureInfo* TextureRegistry::info(const char* name) const {
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    std::unordered_map<std::string, resident<textureInfo>>::const_iterator found =
+        this->store->textures.find(name);
+    return (found != this->store->textures.end()) ? &found->second.info : nullptr;
+}
+
+/* Scales one image into a layer with a framebuffer blit. Blits only read
+   one level, so shrinking starts from the smallest mip still at least the
+   layer's size instead of skipping most of the full size image's texels.
+*/
+static void blitIntoLayer(GLuint array_texture, int layer, int width, int height,
+                          const textureArrayLayer& image) {
+    GLuint source;
+    glGenTextures(1, &source);
+    glBindTexture(GL_TEXTURE_2D, source);
+    glTexStorage2D(GL_TEXTURE_2D, mipLevelsFor(image.width, image.height), GL_RGBA8,
+                   image.width, image.height);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height,
+                    PIXEL_FORMATS[image.n_channels - 1], GL_UNSIGNED_BYTE, image.pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    int level = 0;
+    while ((image.width >> (level + 1)) >= width && (image.height >> (level + 1)) >= height) {
+        level++;
+    }
+
+    // a reload from use() lands in the middle of a render pass, which has to carry on after
+    GLint read_framebuffer = 0;
+    GLint draw_framebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer);
+    // blits are scissored too
+    GLboolean scissored = glIsEnabled(GL_SCISSOR_TEST);
+    glDisable(GL_SCISSOR_TEST);
+    GLuint framebuffers[2];
+    glGenFramebuffers(2, framebuffers);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           source, level);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array_texture, 0, layer);
+    glBlitFramebuffer(0, 0, image.width >> level, image.height >> level, 0, 0, width, height,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)read_framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)draw_framebuffer);
+    if (scissored) {
+        glEnable(GL_SCISSOR_TEST);
+    }
+    glDeleteFramebuffers(2, framebuffers);
+    glDeleteTextures(1, &source);
+}
+
+const textureArrayInfo* TextureRegistry::uploadArray(const char* name,
+                                                     const textureArrayLayer* layers,
+                                                     int n_layers, int width, int height) {
+    if (n_layers <= 0 || width <= 0 || height <= 0) {
+        SOUP_LOG_ERROR("texture array %s has no layers", name);
+        return nullptr;
+    }
+
+    textureArrayInfo info;
+    info.width = width;
+    info.height = height;
+    info.n_layers = n_layers;
+    info.n_levels = mipLevelsFor(width, height);
+    info.bytes = mipChainBytes(width, height, info.n_levels, 4) * n_layers;
+    {
+        std::lock_guard<std::mutex> guard(this->store->lock);
+        if (!this->reserve(name, true, info.bytes)) {
+            return nullptr;
+        }
+    }
+
+    glResourceOwner owner(this->owns_store ? "textures" : nullptr);
+    glGenTextures(1, &info.texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, info.texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, info.n_levels, GL_RGBA8, width, height, n_layers);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < n_layers; i++) {
+        const textureArrayLayer& image = layers[i];
+        if (!image.pixels || image.n_channels < 1 || image.n_channels > 4) {
+            SOUP_LOG_WARNING("layer %d of %s has no usable pixels, left black", i, name);
+            continue;
+        }
+        if (image.width == width && image.height == height) {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1,
+                            PIXEL_FORMATS[image.n_channels - 1], GL_UNSIGNED_BYTE, image.pixels);
+        } else {
+            blitIntoLayer(info.texture, i, width, height, image);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, info.texture);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    this->invalidateBindings();
+
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    std::unordered_map<std::string, resident<textureArrayInfo>>::iterator old =
+        this->store->arrays.find(name);
+    if (old != this->store->arrays.end()) {
+        if (old->second.info.texture) {
+            glDeleteTextures(1, &old->second.info.texture);
+            this->store->resident_bytes -= old->second.info.bytes;
+            this->store->generation.fetch_add(1);
+        }
+        old->second.info = info;
+        old->second.last_used = this->store->frame;
+        return &old->second.info;
+    }
+    return &this->store->arrays.emplace(
+        name, resident<textureArrayInfo>{ info, 0, nullptr, nullptr, false }
+    ).first->second.info;
+}
+
+const textureArrayInfo* TextureRegistry::findArray(const char* name) const {
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    std::unordered_map<std::string, resident<textureArrayInfo>>::const_iterator found =
+        this->store->arrays.find(name);
+    return (found != this->store->arrays.end()) ? &found->second.info : nullptr;
+}
+
+void TextureRegistry::bindTarget(GLenum target, GLuint unit, GLuint texture,
+                                 GLuint* bound_targets, const samplerDesc& desc) {
+    GLuint sampler = this->sampler_cache.get(desc);
+    // a sharer freed a name since, it may be bound here and belong to another texture now
+    uint64_t generation = this->store->generation.load(std::memory_order_acquire);
+    if (generation != this->bound_generation) {
+        this->invalidateBindings();
+        this->bound_generation = generation;
+    }
+    if (unit >= (GLuint)N_TRACKED_UNITS) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        glBindSampler(unit, sampler);
+        return;
+    }
+    if (bound_targets[unit] != texture) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        bound_targets[unit] = texture;
+    }
+    if (this->bound_samplers[unit] != sampler) {
+        glBindSampler(unit, sampler);
+        this->bound_samplers[unit] = sampler;
+    }
+}
+
+void TextureRegistry::bind(GLuint unit, GLuint texture, const samplerDesc& desc) {
+    this->bindTarget(GL_TEXTURE_2D, unit, texture, this->bound_textures, desc);
+}
+
+void TextureRegistry::bindArray(GLuint unit, GLuint texture, const samplerDesc& desc) {
+    this->bindTarget(GL_TEXTURE_2D_ARRAY, unit, texture, this->bound_arrays, desc);
+}
+
+template <typename Info>
+GLuint TextureRegistry::useEntry(
+    std::unordered_map<std::string, resident<Info>> textureStore::* map, const char* name) {
+    textureLoader loader;
+    void* loader_data;
+    {
+        std::lock_guard<std::mutex> guard(this->store->lock);
+        typename std::unordered_map<std::string, resident<Info>>::iterator found =
+            ((*this->store).*map).find(name);
+        if (found == ((*this->store).*map).end()) {
+            return 0;
+        }
+        resident<Info>& r = found->second;
+        r.last_used = this->store->frame;
+        if (r.info.texture || !r.loader || r.reload_failed) {
+            return r.info.texture;
+        }
+        loader = r.loader;
+        loader_data = r.loader_data;
+    }
+
+    // outside the lock, the loader uploads through this registry
+    bool reloaded = loader(*this, name, loader_data);
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    typename std::unordered_map<std::string, resident<Info>>::iterator found =
+        ((*this->store).*map).find(name);
+    if (found == ((*this->store).*map).end()) {
+        return 0;
+    }
+    if (reloaded && found->second.info.texture) {
+        this->store->stats.n_reloads++;
+    } else {
+        SOUP_LOG_WARNING("evicted texture %s could not be reloaded", name);
+        found->second.reload_failed = true;
+    }
+    return found->second.info.texture;
+}
+
+GLuint TextureRegistry::use(const char* name) {
+    return this->useEntry(&textureStore::textures, name);
+}
+
+GLuint TextureRegistry::useArray(const char* name) {
+    return this->useEntry(&textureStore::arrays, name);
+}
+
+void TextureRegistry::setLoader(const char* name, textureLoader loader, void* user_data) {
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    std::unordered_map<std::string, resident<textureInfo>>::iterator texture =
+        this->store->textures.find(name);
+    if (texture != this->store->textures.end()) {
+        texture->second.loader = loader;
+        texture->second.loader_data = user_data;
+    }
+    std::unordered_map<std::string, resident<textureArrayInfo>>::iterator array =
+        this->store->arrays.find(name);
+    if (array != this->store->arrays.end()) {
+        array->second.loader = loader;
+        array->second.loader_data = user_data;
+    }
+}
+
+void TextureRegistry::setBudget(uint64_t bytes) {
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    this->store->budget = bytes;
+    for (std::pair<const std::string, resident<textureInfo>>& entry : this->store->textures) {
+        entry.second.reload_failed = false;
+    }
+    for (std::pair<const std::string, resident<textureArrayInfo>>& entry : this->store->arrays) {
+        entry.second.reload_failed = false;
+    }
+}
+
+uint64_t TextureRegistry::budget() const {
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    return this->store->budget;
+}
+
+uint64_t TextureRegistry::residentBytes() const {
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    return this->store->resident_bytes;
+}
+
+textureBudgetStats TextureRegistry::budgetStats() const {
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    return this->store->stats;
+}
+
+void TextureRegistry::beginFrame() {
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    this->store->frame++;
+    this->store->frame_starts[this->sharer] = this->store->frame;
+}
+
+void TextureRegistry::invalidateBindings() {
+    // 0 is a valid binding, so use a name no texture ever gets
+    for (int i = 0; i < N_TRACKED_UNITS; i++) {
+        this->bound_textures[i] = ~0u;
+        this->bound_arrays[i] = ~0u;
+        this->bound_samplers[i] = ~0u;
+    }
+}
+
+void TextureRegistry::clear() {
+    if (!this->owns_store) {
+        // the owner deletes the textures, this one goes back to its own
+        uint64_t budget;
+        {
+            std::lock_guard<std::mutex> guard(this->store->lock);
+            budget = this->store->budget;
+            this->leaveStore();
+        }
+        this->store = std::make_shared<textureStore>();
+        this->store->budget = budget;
+        this->store->frame = 1;
+        this->store->generation.store(0);
+        this->store->stats = textureBudgetStats{};
+        this->owns_store = true;
+        std::lock_guard<std::mutex> guard(this->store->lock);
+        this->joinStore();
+    }
+    std::lock_guard<std::mutex> guard(this->store->lock);
+    for (const std::pair<const std::string, resident<textureInfo>>& entry :
+         this->store->textures) {
+        // glDeleteTextures() skips the 0 of an evicted one
+        glDeleteTextures(1, &entry.second.info.texture);
+    }
+    this->store->textures.clear();
+    for (const std::pair<const std::string, resident<textureArrayInfo>>& entry :
+         this->store->arrays) {
+        glDeleteTextures(1, &entry.second.info.texture);
+    }
+    this->store->arrays.clear();
+    this->store->resident_bytes = 0;
+    this->store->generation.fetch_add(1);
+    this->sampler_cache.clear();
+    this->invalidateBindings();
+}
+
+}
@@ -0,0 +1,266 @@
+#ifndef SOUPCANS_TEXTURES_HPP
+#define SOUPCANS_TEXTURES_HPP
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/gl3w.h>
+
+namespace soupcans {
+
+enum samplerFilter {
+    FILTER_NEAREST,
+    FILTER_BILINEAR,
+    // linear within and between mip levels
+    FILTER_TRILINEAR
+};
+
+enum samplerWrap {
+    WRAP_REPEAT,
+    WRAP_CLAMP,
+    WRAP_MIRROR
+};
+
+struct samplerDesc {
+    samplerFilter filter;
+    samplerWrap wrap;
+    // 1 is off, clamped to what the driver supports
+    int max_anisotropy;
+};
+
+const samplerDesc SAMPLER_TRILINEAR = { FILTER_TRILINEAR, WRAP_REPEAT, 1 };
+const samplerDesc SAMPLER_ANISOTROPIC = { FILTER_TRILINEAR, WRAP_REPEAT, 16 };
+const samplerDesc SAMPLER_CLAMPED = { FILTER_TRILINEAR, WRAP_CLAMP, 1 };
+
+/* Sampler objects, one per distinct filter/wrap/anisotropy combination.
+   Keeping filtering in samplers instead of texture parameters means a
+   texture never carries stale state from whoever used it last.
+*/
+class SamplerCache {
+    public:
+        SamplerCache();
+        ~SamplerCache();
+
+        SamplerCache(const SamplerCache&) = delete;
+        SamplerCache& operator=(const SamplerCache&) = delete;
+
+        GLuint get(const samplerDesc& desc);
+
+        // deletes every sampler, call while the context is still current
+        void clear();
+
+    private:
+        struct entry {
+            uint32_t key;
+            GLuint sampler;
+        };
+        std::vector<entry> samplers;
+        // 0 until the first anisotropic sampler asks the driver
+        int max_supported_anisotropy;
+};
+
+struct textureInfo {
+    // 0 while evicted, see TextureRegistry::setBudget()
+    GLuint texture;
+    int width;
+    int height;
+    int n_levels;
+    // every level, what the texture counts against the budget
+    uint64_t bytes;
+};
+
+// one decoded image going into a texture array
+struct textureArrayLayer {
+    const unsigned char* pixels;
+    int width;
+    int height;
+    int n_channels;
+};
+
+struct textureArrayInfo {
+    GLuint texture;
+    int width;
+    int height;
+    int n_layers;
+    int n_levels;
+    uint64_t bytes;
+};
+
+class TextureRegistry;
+
+/* Makes an evicted texture again under the same name, with upload(),
+   allocate() or uploadArray() on `textures`. False if it couldn't.
+*/
+typedef bool (*textureLoader)(TextureRegistry& textures, const char* name, void* user_data);
+
+struct textureBudgetStats {
+    uint64_t n_evictions;
+    uint64_t n_reloads;
+    // textures refused because they didn't fit even with everything evictable gone
+    uint64_t n_refused;
+    uint64_t peak_bytes;
+};
+
+// true if the current context lists the extension
+bool hasGlExtension(const char* name);
+
+// bytes from SOUP_TEXTURE_BUDGET (in MB), 0 for no budget when unset
+uint64_t defaultTextureBudget();
+
+/* Owns the scene's 2D textures by name. Every upload gets immutable
+   storage and a full mip chain, so a texture is always mip complete and
+   minification never reads the full size level for a far away surface.
+   bind() skips texture and sampler binds that are already in place.
+
+   With a budget set, the textures held here never add up to more than it.
+   A texture that doesn't fit first evicts the least recently used ones
+   that have a loader and weren't used this frame, by this registry or any
+   that shares its textures; if that still isn't enough it is refused.
+   Textures without a loader are never evicted.
+*/
+class TextureRegistry {
+    public:
+        TextureRegistry();
+        ~TextureRegistry();
+
+        TextureRegistry(const TextureRegistry&) = delete;
+        TextureRegistry& operator=(const TextureRegistry&) = delete;
+
+        // 8 bit pixels with 1-4 channels, tightly packed; replaces an old one of the same name
+        GLuint upload(const char* name, const unsigned char* pixels, int width, int height,
+                      int n_channels);
+
+        /* Mip complete storage with undefined contents, for textures drawn
+           on the GPU. Regenerate the mips with glGenerateMipmap() after
+           rendering into level 0.
+        */
+        GLuint allocate(const char* name, int width, int height, int n_channels);
+
+        // 0 if nothing was uploaded under that name
+        GLuint find(const char* name) const;
+        const textureInfo* info(const char* name) const;
+
+        /* Packs the images into the layers of one RGBA8 GL_TEXTURE_2D_ARRAY
+           of the given size, so objects with different images can share a
+           draw call and pick their image by layer. Images of another size
+           are scaled into their layer on the GPU. Mip complete like upload().
+        */
+        const textureArrayInfo* uploadArray(const char* name, const textureArrayLayer* layers,
+                                            int n_layers, int width, int height);
+        const textureArrayInfo* findArray(const char* name) const;
+
+        void bind(GLuint unit, GLuint texture, const samplerDesc& desc);
+        void bindArray(GLuint unit, GLuint texture, const samplerDesc& desc);
+
+        /* The texture under `name` for drawing this frame: marks it used,
+           and reloads it first if it was evicted. 0 if there is none or
+           it couldn't come back. A texture with a loader can change GL
+           name, so look it up here every frame instead of keeping it.
+        */
+        GLuint use(const char* name);
+        GLuint useArray(const char* name);
+
+        /* How to make `name` again after eviction, for the texture and
+           the array of that name. Without one (nullptr) they stay put.
+        */
+        void setLoader(const char* name, textureLoader loader, void* user_data);
+
+        // bytes, 0 for none; shared with whoever shares the textures
+        void setBudget(uint64_t bytes);
+        uint64_t budget() const;
+        uint64_t residentBytes() const;
+        textureBudgetStats budgetStats() const;
+
+        /* Once per frame, before any use(). Nothing used in the current
+           frame is evicted, nor anything a sharer used in its current one.
+        */
+        void beginFrame();
+
+        // after anything binds textures or samplers behind the registry's back
+        void invalidateBindings();
+
+        /* Looks up and uploads into `owner`'s textures from now on, for a
+           context that shares objects with owner's. Samplers and binding
+           state stay per registry, they belong to each context. Textures
+           uploaded through either are deleted by owner's clear() only.
+        */
+        void shareTexturesWith(TextureRegistry& owner);
+
+        SamplerCache& samplers() {
+            return this->sampler_cache;
+        }
+
+        // deletes everything, call while the context is still current
+        void clear();
+
+    private:
+        static const int N_TRACKED_UNITS = 16;
+
+        template <typename Info>
+        struct resident {
+            Info info;
+            // the store's frame at the last use()
+            uint64_t last_used;
+            textureLoader loader;
+            void* loader_data;
+            // the loader failed, not tried again until the budget changes
+            bool reload_failed;
+        };
+
+        // the textures themselves, what shareTexturesWith() shares
+        struct textureStore {
+            std::mutex lock;
+            std::unordered_map<std::string, resident<textureInfo>> textures;
+            std::unordered_map<std::string, resident<textureArrayInfo>> arrays;
+            uint64_t budget;
+            uint64_t resident_bytes;
+            // counts every sharer's beginFrame()
+            uint64_t frame;
+            /* The frame each sharer's current frame began at, indexed by
+               sharer. 0 for a free entry, NOT_DRAWING before the first
+               beginFrame().
+            */
+            std::vector<uint64_t> frame_starts;
+            // bumped whenever a GL name is freed, every sharer's cached binds are stale then
+            std::atomic<uint64_t> generation;
+            textureBudgetStats stats;
+        };
+
+        static const uint64_t NOT_DRAWING = ~(uint64_t)0;
+
+        std::shared_ptr<textureStore> store;
+        bool owns_store;
+        // this registry's entry in store->frame_starts
+        int sharer;
+        SamplerCache sampler_cache;
+        GLuint bound_textures[N_TRACKED_UNITS];
+        GLuint bound_arrays[N_TRACKED_UNITS];
+        GLuint bound_samplers[N_TRACKED_UNITS];
+        // store->generation when the bound_ arrays were last right
+        uint64_t bound_generation;
+
+        // with the store locked
+        void joinStore();
+        void leaveStore();
+
+        void bindTarget(GLenum target, GLuint unit, GLuint texture, GLuint* bound_targets,
+                        const samplerDesc& desc);
+
+        // with the store locked
+        bool reserve(const char* name, bool array, uint64_t bytes);
+        bool evictOne(const char* keep_name, bool keep_array);
+
+        template <typename Info>
+        GLuint useEntry(std::unordered_map<std::string, resident<Info>> textureStore::* map,
+                        const char* name);
+};
+
+}
+
+#endif
@@ -0,0 +1,503 @@
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "windowWall.hpp"
+
+namespace soupcans {
+
+/* A panel's window and what its callbacks last saw. The callbacks run on
+   the main thread and the panel reads from its render thread, so it is
+   all atomics, plus a counter under `wake_lock` for waitEvents().
+*/
+struct panelWindow {
+    GLFWwindow* window;
+    bool visible;
+    double refresh_rate;
+    std::atomic<bool> keys[GLFW_KEY_LAST + 1];
+    std::atomic<int> width, height;
+    std::atomic<double> input_time;
+    std::atomic<bool> iconified, refresh_requested;
+    std::mutex wake_lock;
+    std::condition_variable woken;
+    uint64_t n_events;
+};
+
+static void wakePanel(panelWindow* panel) {
+    {
+        std::lock_guard<std::mutex> guard(panel->wake_lock);
+        panel->n_events++;
+    }
+    panel->woken.notify_all();
+}
+
+static panelWindow* panelOf(GLFWwindow* window) {
+    return static_cast<panelWindow*>(glfwGetWindowUserPointer(window));
+}
+
+static void panelInput(panelWindow* panel) {
+    // the first event the panel hasn't taken yet sets the time
+    double none = -1.0;
+    panel->input_time.compare_exchange_strong(none, glfwGetTime());
+    wakePanel(panel);
+}
+
+static void panelKeyCallback(GLFWwindow* window, int key, int, int action, int) {
+    panelWindow* panel = panelOf(window);
+    if (key >= 0 && key <= GLFW_KEY_LAST) {
+        panel->keys[key] = action != GLFW_RELEASE;
+    }
+    panelInput(panel);
+}
+
+static void panelMouseButtonCallback(GLFWwindow* window, int, int, int) {
+    panelInput(panelOf(window));
+}
+
+static void panelCursorPosCallback(GLFWwindow* window, double, double) {
+    panelInput(panelOf(window));
+}
+
+static void panelSizeCallback(GLFWwindow* window, int width, int height) {
+    panelWindow* panel = panelOf(window);
+    panel->width = width;
+    panel->height = height;
+    wakePanel(panel);
+}
+
+static void panelIconifyCallback(GLFWwindow* window, int iconified) {
+    panelWindow* panel = panelOf(window);
+    panel->iconified = iconified != 0;
+    wakePanel(panel);
+}
+
+static void panelRefreshCallback(GLFWwindow* window) {
+    panelWindow* panel = panelOf(window);
+    panel->refresh_requested = true;
+    wakePanel(panel);
+}
+
+/* What a panel's Runtime sees. The window belongs to the wall and
+   outlives the runtime; this only makes its context current on the
+   render thread and reads what the main thread's callbacks left.
+*/
+class WallPanelBackend : public Backend {
+    public:
+        explicit WallPanelBackend(panelWindow* panel) {
+            this->panel = panel;
+            this->events_handled = 0;
+        }
+
+        bool open(const windowSettings& settings) override {
+            glfwMakeContextCurrent(this->panel->window);
+            glfwSwapInterval(swapIntervalFor(settings.present_mode));
+            std::lock_guard<std::mutex> guard(this->panel->wake_lock);
+            this->events_handled = this->panel->n_events;
+            return true;
+        }
+
+        void close() override {
+            glfwMakeContextCurrent(nullptr);
+        }
+
+        bool shouldClose() override {
+            return glfwWindowShouldClose(this->panel->window);
+        }
+
+        void requestClose() override {
+            // the main thread takes the rest of the wall down with it
+            glfwSetWindowShouldClose(this->panel->window, 1);
+            glfwPostEmptyEvent();
+        }
+
+        // events are handled on the main thread as they come in
+        void pollEvents() override {}
+
+        void present() override {
+            if (this->panel->visible) {
+                glfwSwapBuffers(this->panel->window);
+            } else {
+                glFinish();
+            }
+        }
+
+        double takeInputTime() override {
+            return this->panel->input_time.exchange(-1.0);
+        }
+
+        bool inputPending() override {
+            return this->panel->input_time.load() >= 0.0;
+        }
+
+        void waitEvents(double timeout) override {
+            std::unique_lock<std::mutex> lock(this->panel->wake_lock);
+            this->panel->woken.wait_for(lock, std::chrono::duration<double>(timeout), [this] {
+                return this->panel->n_events != this->events_handled;
+            });
+            this->events_handled = this->panel->n_events;
+        }
+
+        bool hidden() override {
+            return this->panel->iconified;
+        }
+
+        // at most one panel has focus, but the whole wall is being watched
+        bool focused() override {
+            return true;
+        }
+
+        bool takeRefreshRequest() override {
+            return this->panel->refresh_requested.exchange(false);
+        }
+
+        void framebufferSize(int* width, int* height) override {
+            *width = this->panel->width;
+            *height = this->panel->height;
+        }
+
+        bool keyPressed(int key) override {
+            return key >= 0 && key <= GLFW_KEY_LAST && this->panel->keys[key];
+        }
+
+        // panels have no title bar, and GLFW only sets titles on the main thread
+        void setTitle(const char*) override {}
+
+        double refreshRate() override {
+            return this->panel->refresh_rate;
+        }
+
+        double time() override {
+            return glfwGetTime();
+        }
+
+    private:
+        panelWindow* panel;
+        // panel->n_events as of the last wait
+        uint64_t events_handled;
+};
+
+// panels start one at a time, in order
+struct wallStartup {
+    std::mutex lock;
+    std::condition_variable turn;
+    int next;
+};
+
+struct panelRun {
+    int index;
+    panelWindow* window;
+    Scene* scene;
+    const runtimeSettings* settings;
+    TextureRegistry* shared_textures;
+    wallStartup* startup;
+    std::atomic<int>* n_running;
+    bool passed_turn;
+    int status;
+};
+
+static void passStartupTurn(panelRun* run) {
+    if (run->passed_turn) {
+        return;
+    }
+    run->passed_turn = true;
+    {
+        std::lock_guard<std::mutex> guard(run->startup->lock);
+        run->startup->next = run->index + 1;
+    }
+    run->startup->turn.notify_all();
+}
+
+static void panelFrameDone(const Scene&, uint64_t frame, const frameTimings&, void* user_data) {
+    if (frame == 0) {
+        // whatever init() uploaded has to be there before the next context looks for it
+        glFinish();
+        passStartupTurn(static_cast<panelRun*>(user_data));
+    }
+}
+
+static void runPanel(panelRun* run) {
+    {
+        std::unique_lock<std::mutex> lock(run->startup->lock);
+        run->startup->turn.wait(lock, [run] {
+            return run->startup->next >= run->index;
+        });
+    }
+    // made here, the thread that makes a runtime is worker 0 of its job system
+    Runtime runtime(*run->settings);
+    runtime.textures().shareTexturesWith(*run->shared_textures);
+    runtime.setProfileHook(panelFrameDone, run);
+    run->status = runtime.run(*run->scene,
+        std::unique_ptr<Backend>(new WallPanelBackend(run->window)));
+    // a panel that never drew a frame still lets the next one start
+    passStartupTurn(run);
+    if (run->status != 0) {
+        glfwSetWindowShouldClose(run->window->window, 1);
+    }
+    (*run->n_running)--;
+    glfwPostEmptyEvent();
+}
+
+static void contextHints(int gl_major, int gl_minor, bool debug_context) {
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, gl_major);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, gl_minor);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, debug_context ? GL_TRUE : GL_FALSE);
+    // anti-aliasing happens offscreen, see antiAliasing.hpp
+    glfwWindowHint(GLFW_SAMPLES, 0);
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+}
+
+static panelWindow* openPanelWindow(const wallPanel& panel, const windowSettings& scene_window,
+                                    GLFWwindow* root, bool visible) {
+    int n_monitors = 0;
+    GLFWmonitor** monitors = glfwGetMonitors(&n_monitors);
+    if (panel.monitor < 0 || panel.monitor >= n_monitors) {
+        SOUP_LOG_ERROR("there is no monitor %d, only %d", panel.monitor, n_monitors);
+        return nullptr;
+    }
+    if (panel.columns <= 0 || panel.rows <= 0 || panel.cell < 0 ||
+        panel.cell >= panel.columns * panel.rows) {
+        SOUP_LOG_ERROR("cell %d is not in a %dx%d grid", panel.cell, panel.columns, panel.rows);
+        return nullptr;
+    }
+    GLFWmonitor* monitor = monitors[panel.monitor];
+    const GLFWvidmode* vidmode = glfwGetVideoMode(monitor);
+    int monitor_x = 0, monitor_y = 0;
+    glfwGetMonitorPos(monitor, &monitor_x, &monitor_y);
+    int cell_width = (vidmode ? vidmode->width : 1280) / panel.columns;
+    int cell_height = (vidmode ? vidmode->height : 720) / panel.rows;
+
+    glfwWindowHint(GLFW_DEPTH_BITS, scene_window.depth_buffer ? 24 : 0);
+    glfwWindowHint(GLFW_DECORATED, GL_FALSE);
+    GLFWwindow* window = glfwCreateWindow(cell_width, cell_height, scene_window.title,
+                                          nullptr, root);
+    if (!window) {
+        SOUP_LOG_ERROR("could not open a panel window on monitor %d", panel.monitor);
+        return nullptr;
+    }
+    glfwSetWindowPos(window, monitor_x + (panel.cell % panel.columns) * cell_width,
+                     monitor_y + (panel.cell / panel.columns) * cell_height);
+
+    panelWindow* p = new panelWindow();
+    p->window = window;
+    p->visible = visible;
+    p->refresh_rate = (visible && vidmode) ? vidmode->refreshRate : 0.0;
+    for (std::atomic<bool>& key : p->keys) {
+        key = false;
+    }
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(window, &width, &height);
+    p->width = width;
+    p->height = height;
+    p->input_time = -1.0;
+    p->iconified = false;
+    p->refresh_requested = false;
+    p->n_events = 0;
+
+    glfwSetWindowUserPointer(window, p);
+    glfwSetKeyCallback(window, panelKeyCallback);
+    glfwSetMouseButtonCallback(window, panelMouseButtonCallback);
+    glfwSetCursorPosCallback(window, panelCursorPosCallback);
+    glfwSetFramebufferSizeCallback(window, panelSizeCallback);
+    glfwSetWindowIconifyCallback(window, panelIconifyCallback);
+    glfwSetWindowRefreshCallback(window, panelRefreshCallback);
+    if (visible) {
+        glfwShowWindow(window);
+    }
+    return p;
+}
+
+int runWall(const wallSettings& settings, const std::vector<wallPanel>& panels) {
+    if (panels.empty()) {
+        SOUP_LOG_ERROR("a wall needs at least one panel");
+        return 1;
+    }
+    // scenes only parse their options until init(), make them all before any window
+    std::vector<std::unique_ptr<Scene>> scenes;
+    for (const wallPanel& panel : panels) {
+        std::vector<char*> argv = panel.args;
+        argv.push_back(nullptr);
+        scenes.push_back(panel.create_scene(static_cast<int>(argv.size()) - 1, argv.data()));
+        if (!scenes.back()) {
+            return 1;
+        }
+    }
+
+    if (!acquireGlfw()) {
+        return 1;
+    }
+    // objects are only shared between alike contexts, so every one gets the newest GL asked for
+    int gl_major = 0, gl_minor = 0;
+    for (const std::unique_ptr<Scene>& scene : scenes) {
+        windowSettings window = scene->settings().window;
+        if (window.gl_major > gl_major || (window.gl_major == gl_major && window.gl_minor > gl_minor)) {
+            gl_major = window.gl_major;
+            gl_minor = window.gl_minor;
+        }
+    }
+    bool visible = settings.runtime.backend == BACKEND_WINDOW;
+    contextHints(gl_major, gl_minor,
+                 clampDebugLevel(settings.runtime.debug_level) >= DEBUG_ASYNC);
+    GLFWwindow* root = glfwCreateWindow(16, 16, "SOUPCANS wall", nullptr, nullptr);
+    if (!root) {
+        SOUP_LOG_ERROR("could not create the wall's root context");
+        releaseGlfw();
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<panelWindow>> windows;
+    for (size_t i = 0; i < panels.size(); i++) {
+        panelWindow* window = openPanelWindow(panels[i], scenes[i]->settings().window,
+                                              root, visible);
+        if (!window) {
+            break;
+        }
+        windows.emplace_back(window);
+    }
+
+    // before any panel thread, so none of them loads the entry points under another
+    glfwMakeContextCurrent(root);
+    bool loaded = loadGlEntryPoints();
+    glfwMakeContextCurrent(nullptr);
+
+    int status = 0;
+    if (loaded && windows.size() == panels.size()) {
+        runtimeSettings panel_settings = settings.runtime;
+        panel_settings.n_threads = settings.threads_per_panel;
+        panel_settings.count_gl_calls = false;
+        panel_settings.capture_path = nullptr;
+        panel_settings.serve_path = nullptr;
+        // one trace is one scene's frames
+        panel_settings.record_path = nullptr;
+        panel_settings.replay_path = nullptr;
+
+        TextureRegistry shared_textures;
+        // the panels' textures all live here, so the one budget covers the wall
+        shared_textures.setBudget(panel_settings.texture_budget);
+        wallStartup startup;
+        startup.next = 0;
+        std::atomic<int> n_running(static_cast<int>(panels.size()));
+        std::vector<panelRun> runs(panels.size());
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < panels.size(); i++) {
+            runs[i] = panelRun{ static_cast<int>(i), windows[i].get(), scenes[i].get(),
+                                &panel_settings, &shared_textures, &startup, &n_running,
+                                false, 0 };
+        }
+        for (panelRun& run : runs) {
+            threads.emplace_back(runPanel, &run);
+        }
+
+        while (n_running > 0) {
+            glfwWaitEventsTimeout(0.25);
+            bool closing = false;
+            for (const std::unique_ptr<panelWindow>& window : windows) {
+                closing = closing || glfwWindowShouldClose(window->window);
+            }
+            if (closing) {
+                for (const std::unique_ptr<panelWindow>& window : windows) {
+                    glfwSetWindowShouldClose(window->window, 1);
+                    wakePanel(window.get());
+                }
+            }
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        for (const panelRun& run : runs) {
+            status = (run.status != 0) ? 1 : status;
+        }
+
+        // the panels' contexts are gone, the textures go with the root's
+        glfwMakeContextCurrent(root);
+        shared_textures.clear();
+        glfwMakeContextCurrent(nullptr);
+    } else {
+        status = 1;
+    }
+
+    for (const std::unique_ptr<panelWindow>& window : windows) {
+        glfwDestroyWindow(window->window);
+    }
+    glfwDestroyWindow(root);
+    releaseGlfw();
+    return status;
+}
+
+static void printWallUsage(const char* program_name, const namedScene* scenes, int n_scenes) {
+    fprintf(stderr, "usage: %s ", program_name);
+    printRuntimeFlags(stderr);
+    fprintf(stderr, " --panel MONITOR[/COLUMNSxROWS/CELL] SCENE [scene options] "
+                    "[--panel ...]\nscenes:");
+    for (int i = 0; i < n_scenes; i++) {
+        fprintf(stderr, " %s", scenes[i].name);
+    }
+    fprintf(stderr, "\n");
+}
+
+static bool parsePanelSpec(const char* spec, wallPanel* panel) {
+    char end = 0;
+    if (sscanf(spec, "%d%c", &panel->monitor, &end) == 1) {
+        return true;
+    }
+    return sscanf(spec, "%d/%dx%d/%d%c", &panel->monitor, &panel->columns,
+                  &panel->rows, &panel->cell, &end) == 4;
+}
+
+int runWallMain(int argc, char** argv, const namedScene* scenes, int n_scenes) {
+    wallSettings settings;
+    std::vector<wallPanel> panels;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--help") == 0) {
+            printWallUsage(argv[0], scenes, n_scenes);
+            return 0;
+        }
+        if (strcmp(argv[i], "--panel") == 0) {
+            wallPanel panel;
+            if (i + 2 >= argc || !parsePanelSpec(argv[i + 1], &panel)) {
+                printWallUsage(argv[0], scenes, n_scenes);
+                return 1;
+            }
+            const char* scene_name = argv[i + 2];
+            for (int s = 0; s < n_scenes; s++) {
+                if (strcmp(scenes[s].name, scene_name) == 0) {
+                    panel.create_scene = scenes[s].create;
+                }
+            }
+            if (!panel.create_scene) {
+                SOUP_LOG_ERROR("unknown scene %s", scene_name);
+                printWallUsage(argv[0], scenes, n_scenes);
+                return 1;
+            }
+            panel.args.push_back(argv[0]);
+            panels.push_back(panel);
+            i += 2;
+        } else if (!panels.empty()) {
+            // everything after a panel's scene is that scene's
+            panels.back().args.push_back(argv[i]);
+        } else if (parseRuntimeFlag(argc, argv, &i, &settings.runtime) <= 0) {
+            printWallUsage(argv[0], scenes, n_scenes);
+            return 1;
+        }
+    }
+    if (panels.empty()) {
+        printWallUsage(argv[0], scenes, n_scenes);
+        return 1;
+    }
+    if (settings.runtime.n_threads > 0) {
+        settings.threads_per_panel = settings.runtime.n_threads;
+    }
+    // the scenes come from every demo, each finds res/ in its own directory
+    if (!settings.runtime.resource_root) {
+        settings.runtime.resource_root = "..";
+    }
+    return runWall(settings, panels);
+}
+
+}
@@ -0,0 +1,63 @@
+#ifndef SOUPCANS_WINDOW_WALL_HPP
+#define SOUPCANS_WINDOW_WALL_HPP
+
+#include <vector>
+
+#include "runtime.hpp"
+
+namespace soupcans {
+
+/* One scene on one part of a monitor. The monitor is split into a grid
+   of columns x rows and the panel gets cell `cell`, counted row by row.
+*/
+struct wallPanel {
+    // index into glfwGetMonitors(), the primary monitor is usually 0
+    int monitor = 0;
+    int columns = 1;
+    int rows = 1;
+    int cell = 0;
+    sceneFactory create_scene = nullptr;
+    // the scene's argv, args[0] is the program name
+    std::vector<char*> args;
+};
+
+struct wallSettings {
+    // every panel's runtime starts from these, see runWall() for what changes
+    runtimeSettings runtime;
+    // job threads for each panel, the panels already run side by side
+    int threads_per_panel = 1;
+};
+
+/* Runs every panel at once, each in a borderless window of its own with
+   its own render thread, Runtime and GL context. The contexts share
+   objects with a hidden root context, and the panels share their textures
+   through its registry, so a wall showing one image many times uploads
+   it once. Programs, buffers and everything else a scene makes stay per
+   panel; scenes delete those in shutdown() and vertex arrays and
+   framebuffers can't be shared anyway.
+
+   GLFW only handles events on the main thread, so that is all the main
+   thread does: it pumps events into the panels and waits. Panels
+   initialize one at a time, a scene looking for a texture finds the one
+   the panel before it uploaded. Closing any panel closes the wall, and
+   no panel is throttled for not having focus.
+
+   GL call counting and frame capture are per process and turned off.
+   Returns 0 if every panel ran.
+*/
+int runWall(const wallSettings& settings, const std::vector<wallPanel>& panels);
+
+struct namedScene {
+    const char* name;
+    sceneFactory create;
+};
+
+/* A wall's whole main(), the runtime flags followed by one or more of
+       --panel MONITOR[/COLUMNSxROWS/CELL] SCENE [scene options]
+   with SCENE one of `scenes`.
+*/
+int runWallMain(int argc, char** argv, const namedScene* scenes, int n_scenes);
+
+}
+
+#endif
@@ -0,0 +1,73 @@
+#version 330 core
+
+// GPU twin of generateCloudTexture() in common/cloudNoise.cpp, keep the two in step
+out vec4 frag_color;
+
+uniform vec2 tile_size;
+uniform int period;
+uniform int n_octaves;
+uniform float persistence;
+uniform float coverage;
+uniform int seed;
+
+#define TWO_PI 6.28318530718f
+#define NOISE_NORMALIZE 1.41421356f
+
+uint hash32(uint x) {
+	x ^= x >> 16u;
+	x *= 0x7feb352du;
+	x ^= x >> 15u;
+	x *= 0x846ca68bu;
+	x ^= x >> 16u;
+	return x;
+}
+
+vec2 lattice_gradient(int ix, int iy, uint octave_seed) {
+	uint h = hash32(uint(ix) ^ hash32(uint(iy) ^ hash32(octave_seed)));
+	float angle = float(h >> 8u) * (TWO_PI / 16777216.0f);
+	return vec2(cos(angle), sin(angle));
+}
+
+vec2 fade(vec2 t) {
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+// the lattice wraps every octave_period cells, so the tile repeats seamlessly
+float tileable_noise(vec2 p, int octave_period, uint octave_seed) {
+	vec2 cell = floor(p);
+	vec2 t = p - cell;
+	int ix0 = int(cell.x) % octave_period;
+	int iy0 = int(cell.y) % octave_period;
+	int ix1 = (ix0 + 1 == octave_period) ? 0 : ix0 + 1;
+	int iy1 = (iy0 + 1 == octave_period) ? 0 : iy0 + 1;
+
+	float n00 = dot(lattice_gradient(ix0, iy0, octave_seed), t);
+	float n10 = dot(lattice_gradient(ix1, iy0, octave_seed), t - vec2(1.0f, 0.0f));
+	float n01 = dot(lattice_gradient(ix0, iy1, octave_seed), t - vec2(0.0f, 1.0f));
+	float n11 = dot(lattice_gradient(ix1, iy1, octave_seed), t - vec2(1.0f, 1.0f));
+	vec2 u = fade(t);
+	return mix(mix(n00, n10, u.x), mix(n01, n11, u.x), u.y);
+}
+
+void main() {
+	// gl_FragCoord sits on pixel centers, same sample points as the CPU rows
+	vec2 uv = gl_FragCoord.xy / tile_size;
+	float sum = 0.0f;
+	float total = 0.0f;
+	float amplitude = 1.0f;
+	for (int octave = 0; octave < n_octaves; octave++) {
+		int octave_period = period << octave;
+		sum += amplitude * tileable_noise(uv * float(octave_period), octave_period,
+										  uint(seed) + uint(octave));
+		total += amplitude;
+		amplitude *= persistence;
+	}
+	float density = (total > 0.0f) ? sum / total * NOISE_NORMALIZE : 0.0f;
+
+	float clamped_coverage = clamp(coverage, 0.0f, 0.99f);
+	float c = clamp((0.5f + 0.5f * density - clamped_coverage) / (1.0f - clamped_coverage),
+					0.0f, 1.0f);
+	c = c * (2.0f - c);
+	vec3 cloud = mix(vec3(0.80f, 0.82f, 0.88f), vec3(1.0f), c);
+	frag_color = vec4(mix(vec3(0.40f, 0.62f, 0.90f), cloud, c), 1.0f);
+}
@@ -0,0 +1,7 @@
+#version 330 core
+
+// one triangle covering the whole target, no vertex buffer needed
+void main() {
+	vec2 corner = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+	gl_Position = vec4(corner * 2.0f - 1.0f, 0.0f, 1.0f);
+}
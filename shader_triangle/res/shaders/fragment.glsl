@@ -1,14 +1,10 @@
 #version 330 core
 
-in float theta;
-in float hshift;
-in vec2 vertex_position;
-in vec2 tex_coord;
 out vec4 frag_color;
 
-uniform sampler2D sky_texture;
-
-#define TRIANGLE_MAGNITUDE 0.5f
+#ifdef DRAW_TRIANGLE
+in float theta;
+in vec2 vertex_position;
 
 mat2 rot_2d_mat(float degs) {
 	return mat2(cos(degs), -sin(degs), sin(degs), cos(degs));
@@ -33,22 +29,20 @@ vec3 compute_position_rgb(vec2 vposition) {
 
 	return vec3(r, g, b);
 }
+#endif
 
-bool position_in_triangle(vec2 vposition) {
-	if (vposition.y < -TRIANGLE_MAGNITUDE) {
-		return false;
-	} else if (vposition.x > 0) {
-		return vposition.y <= TRIANGLE_MAGNITUDE - (2 * vposition.x);
-	} else {
-		return vposition.y <= TRIANGLE_MAGNITUDE + (2 * vposition.x);
-	}
-}
+#ifdef DRAW_SKY
+in vec2 tex_coord;
 
+uniform sampler2D sky_texture;
+#endif
 
 void main() {
-	if (position_in_triangle(vertex_position)) {
-		frag_color = vec4(compute_position_rgb(vertex_position), 1.0f); 
-	} else {
-		frag_color = texture(sky_texture, vec2(tex_coord.x + hshift, tex_coord.y));
-	}
+#ifdef DRAW_TRIANGLE
+	// the triangle is real geometry now, no test for which side of its edges we're on
+	frag_color = vec4(compute_position_rgb(vertex_position), 1.0f);
+#endif
+#ifdef DRAW_SKY
+	frag_color = texture(sky_texture, tex_coord);
+#endif
 }
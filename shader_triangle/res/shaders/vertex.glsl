@@ -1,24 +1,35 @@
 #version 330 core
 
+// built once per variant with DRAW_TRIANGLE or DRAW_SKY defined, see shader_triangle.cpp
+
+#ifdef DRAW_TRIANGLE
 // "vp" = vertex position
 layout(location = 0) in vec2 triangle_vp;
+
+uniform float intensity;
+
+out vec2 vertex_position;
+out float theta;
+#endif
+
+#ifdef DRAW_SKY
 layout(location = 1) in vec2 skybox_vp;
 layout(location = 2) in vec2 skybox_tex_coord;
 
-uniform mat4 matrix;
-uniform float intensity;
 uniform float horizontal_shift;
-uniform int render_target;
 
 out vec2 tex_coord;
-out vec2 vertex_position;
-out float theta;
-out float hshift;
+#endif
 
 void main() {
+#ifdef DRAW_TRIANGLE
 	theta = intensity * 360.0f;
-	vertex_position = skybox_vp;
-	tex_coord = skybox_tex_coord;
-	hshift = horizontal_shift;
+	vertex_position = triangle_vp;
+	gl_Position = vec4(triangle_vp, 0.0f, 1.0f);
+#endif
+#ifdef DRAW_SKY
+	// the sampler repeats, so the shift can run past the edge of the tile
+	tex_coord = vec2(skybox_tex_coord.x + horizontal_shift, skybox_tex_coord.y);
 	gl_Position = vec4(skybox_vp, 0.0f, 1.0f);
+#endif
 }
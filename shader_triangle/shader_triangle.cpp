@@ -0,0 +1,400 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <memory>
+#include <vector>
+
+#include <GL/gl3w.h>
+#include <GLFW/glfw3.h>
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../common/cloudNoise.hpp"
+#include "../common/renderScale.hpp"
+#include "../runtime/runtime.hpp"
+#include "../runtime/gpuTimer.hpp"
+#include "../runtime/renderTarget.hpp"
+#include "../runtime/sceneList.hpp"
+#include "../runtime/shaderPermutations.hpp"
+
+using soupcans::ArenaScope;
+using soupcans::RenderScaleController;
+using soupcans::gpuFrameTimer;
+using soupcans::scaledRenderTarget;
+using soupcans::Runtime;
+using soupcans::Scene;
+using soupcans::sceneSettings;
+using soupcans::SAMPLER_TRILINEAR;
+using soupcans::ShaderPermutations;
+using soupcans::TextureRegistry;
+
+/* The sky covers the whole scaled target, so its color is never loaded;
+   depth only lets the triangle, drawn first, keep the sky from shading
+   under it. The window gets nothing but the blit over all of it.
+*/
+static const soupcans::renderPassDesc SCENE_PASS =
+	soupcans::depthTestedPass(soupcans::LOAD_DONT_CARE);
+static const soupcans::renderPassDesc BLIT_PASS = soupcans::flatPass(soupcans::LOAD_DONT_CARE);
+
+// one #define each in vertex.glsl and fragment.glsl, a variant is built per mask
+enum triangleShaderFeature : uint32_t {
+	DRAW_TRIANGLE = 1u << 0,
+	DRAW_SKY = 1u << 1
+};
+static const char* const TRIANGLE_SHADER_FEATURES[] = { "DRAW_TRIANGLE", "DRAW_SKY" };
+
+template <class T>
+inline GLuint vboFromFlattenedVectorArray(T* vector_arr, size_t size_arr) {
+	GLsizeiptr size_arr_cast = static_cast<GLsizeiptr>(size_arr);
+
+	GLint current_array_buffer;
+	glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &current_array_buffer);
+
+	ArenaScope scratch(soupcans::scratchArena());
+	float* arr_flatten = soupcans::flattenInto(soupcans::scratchArena(), vector_arr, size_arr);
+
+	GLuint new_vbo;
+	glGenBuffers(1, &new_vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, new_vbo);
+	glBufferData(GL_ARRAY_BUFFER, size_arr_cast, arr_flatten, GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, static_cast<GLuint>(current_array_buffer));
+	return new_vbo;
+}
+
+class ShaderTriangleScene : public Scene {
+	public:
+		ShaderTriangleScene(int sky_size, bool gpu_clouds)
+			: shaders("shaders/vertex.glsl", "shaders/fragment.glsl",
+					  TRIANGLE_SHADER_FEATURES, 2),
+			  render_scale(RenderScaleController::defaultBudgetMs(), 0.25f) {
+			this->sky_size = sky_size;
+			// panels of a wall share one sky per size, never one of another size
+			snprintf(this->sky_name, sizeof(this->sky_name), "%s_%d", SKY_TEXTURE, sky_size);
+			this->gpu_clouds = gpu_clouds;
+			this->owns_sky = false;
+			this->cloud_jobs = nullptr;
+		}
+
+		const char* name() const override {
+			return "shader_triangle";
+		}
+
+		sceneSettings settings() const override {
+			sceneSettings settings;
+			settings.window.title = "shader_triangle";
+			settings.window.width = 1600;
+			settings.window.height = 1200;
+			// drawn offscreen at its own scale and blitted over the window
+			settings.multisample = false;
+			settings.window.depth_buffer = false;
+			return settings;
+		}
+
+		bool init(Runtime& runtime) override {
+			// the sky tile repeats, so the quad can show any span of it
+			glm::vec4 skybox_vertices[] = {
+				glm::vec4( 1.0f,  1.0f, SKY_SPAN_X, SKY_SPAN_Y),  // top right
+				glm::vec4( 1.0f, -1.0f, SKY_SPAN_X,       0.0f),  // bottom right
+				glm::vec4(-1.0f, -1.0f,       0.0f,       0.0f),  // bottom left
+				glm::vec4(-1.0f,  1.0f,       0.0f, SKY_SPAN_Y)   // top left
+			};
+			this->skybox_vbo = vboFromFlattenedVectorArray<glm::vec4>(
+				skybox_vertices, sizeof(skybox_vertices)
+				);
+			GLuint skybox_indices[] = {
+				0, 1, 3,
+				1, 2, 3
+			};
+
+			glm::vec2 triangle_positions[] = {
+				glm::vec2( 0.0f,  0.5f),
+				glm::vec2( 0.5f, -0.5f),
+				glm::vec2(-0.5f, -0.5f)
+			};
+			this->triangle_vbo = vboFromFlattenedVectorArray<glm::vec2>(
+				triangle_positions, sizeof(triangle_positions)
+				);
+
+			// triangle @ location = 0, drawn on its own instead of tested for in every sky pixel
+			glGenVertexArrays(1, &this->triangle_vao);
+			glBindVertexArray(this->triangle_vao);
+			glBindBuffer(GL_ARRAY_BUFFER, this->triangle_vbo);
+			glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+			glEnableVertexAttribArray(0);
+
+			glGenVertexArrays(1, &this->sky_vao);
+			glBindVertexArray(this->sky_vao);
+
+			// the element buffer binding is part of the VAO
+			glGenBuffers(1, &this->skybox_element_ebo);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->skybox_element_ebo);
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(skybox_indices),
+						 skybox_indices, GL_STATIC_DRAW);
+
+			// skybox vposition @ location = 1, texture sample coord @ location = 2
+			glBindBuffer(GL_ARRAY_BUFFER, this->skybox_vbo);
+			glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float),
+								  (void*)(2 * sizeof(float)));
+			glEnableVertexAttribArray(2);
+
+			static const uint32_t VARIANTS[] = { DRAW_TRIANGLE, DRAW_SKY };
+			if (!this->shaders.warm(runtime, VARIANTS, 2)) {
+				return false;
+			}
+			// another panel of a video wall may already have made this sky
+			this->owns_sky = !runtime.textures().info(this->sky_name);
+			if (this->owns_sky) {
+				double sky_start = glfwGetTime();
+				GLuint sky_texture = this->gpu_clouds ?
+					this->drawCloudTexture(runtime) : this->generateCloudTexture(runtime);
+				if (!sky_texture) {
+					return false;
+				}
+				SOUP_LOG_INFO("%dx%d sky generated on the %s in %.1f ms", this->sky_size,
+							  this->sky_size, this->gpu_clouds ? "GPU" : "CPU",
+							  (glfwGetTime() - sky_start) * 1000.0);
+				// evicted over a texture budget, the same clouds come back from the CPU
+				this->cloud_jobs = &runtime.jobs();
+				runtime.textures().setLoader(this->sky_name, reloadClouds, this);
+			}
+
+			this->i_op = INC;
+			this->intensity = 0.0f;
+			this->horizontal_shift = 0.0f;
+			this->show_triangle = true;
+			this->toggle_held = false;
+			this->lookUpUniforms(runtime);
+
+			/* The scene is drawn offscreen at a fraction of the window size that
+			   follows the measured GPU time, then stretched over the window.
+			   SOUP_GPU_BUDGET_MS sets the frame time to hold.
+			*/
+			int fb_width, fb_height;
+			runtime.framebufferSize(&fb_width, &fb_height);
+			this->scene_target = scaledRenderTarget();
+			if (!soupcans::resizeScaledRenderTarget(&this->scene_target, fb_width, fb_height)) {
+				SOUP_LOG_ERROR("offscreen framebuffer is incomplete");
+				return false;
+			}
+			soupcans::initGpuFrameTimer(&this->gpu_timer);
+			return true;
+		}
+
+		void update(Runtime& runtime, double dt) override {
+			(void)dt;
+			if (this->intensity < 0.0f || this->intensity > 1.0f) {
+				this->i_op = (this->i_op == INC) ? DEC : INC;
+			}
+			this->intensity = (this->i_op == INC) ?
+				this->intensity + COLOR_DELTA : this->intensity - COLOR_DELTA;
+			// GL_REPEAT does the wrapping, this only keeps the float small and precise
+			this->horizontal_shift += HORIZONTAL_SHIFT_DELTA;
+			if (this->horizontal_shift >= 1.0f) {
+				this->horizontal_shift -= 1.0f;
+			}
+
+			if (runtime.keyPressed(GLFW_KEY_R)) {
+				this->shaders.reload(runtime);
+				this->lookUpUniforms(runtime);
+			}
+			this->readToggleKey(runtime);
+
+			double gpu_ms;
+			while (soupcans::readGpuFrameTime(&this->gpu_timer, &gpu_ms)) {
+				this->render_scale.update(gpu_ms);
+			}
+		}
+
+		void lateLatch(Runtime& runtime) override {
+			this->readToggleKey(runtime);
+		}
+
+		void render(Runtime& runtime) override {
+			int fb_width, fb_height;
+			runtime.framebufferSize(&fb_width, &fb_height);
+			if (fb_width != this->scene_target.width || fb_height != this->scene_target.height) {
+				soupcans::resizeScaledRenderTarget(&this->scene_target, fb_width, fb_height);
+			}
+			int scaled_width = static_cast<int>(fb_width * this->render_scale.scale());
+			int scaled_height = static_cast<int>(fb_height * this->render_scale.scale());
+			scaled_width = (scaled_width > 0) ? scaled_width : 1;
+			scaled_height = (scaled_height > 0) ? scaled_height : 1;
+
+			soupcans::beginGpuFrame(&this->gpu_timer);
+			runtime.beginRenderPass(SCENE_PASS, this->scene_target.fbo);
+			glViewport(0, 0, scaled_width, scaled_height);
+
+			// triangle first, the depth test then keeps the sky from shading under it
+			if (this->show_triangle) {
+				glUseProgram(this->shaders.get(runtime, DRAW_TRIANGLE));
+				glBindVertexArray(this->triangle_vao);
+				glUniform1f(this->intensity_location, this->intensity);
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+			}
+
+			// draw skybox
+			glUseProgram(this->shaders.get(runtime, DRAW_SKY));
+			glBindVertexArray(this->sky_vao);
+			// the sky scrolls sideways, so it has to repeat
+			runtime.textures().bind(0, runtime.textures().use(this->sky_name), SAMPLER_TRILINEAR);
+			glUniform1f(this->horizontal_shift_location, this->horizontal_shift);
+			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+			runtime.endRenderPass();
+			// only the scaled work, the full size blit costs the same at every scale
+			soupcans::endGpuFrame(&this->gpu_timer);
+
+			runtime.beginRenderPass(BLIT_PASS);
+			soupcans::blitScaledRenderTarget(&this->scene_target, scaled_width, scaled_height,
+											 fb_width, fb_height, runtime.sceneFramebuffer());
+			runtime.endRenderPass();
+		}
+
+		void shutdown(Runtime& runtime) override {
+			if (this->owns_sky) {
+				runtime.textures().setLoader(this->sky_name, nullptr, nullptr);
+			}
+			this->render_scale.report(stderr);
+			soupcans::deleteGpuFrameTimer(&this->gpu_timer);
+			soupcans::deleteScaledRenderTarget(&this->scene_target);
+			this->shaders.clear();
+			glDeleteVertexArrays(1, &this->sky_vao);
+			glDeleteVertexArrays(1, &this->triangle_vao);
+			glDeleteBuffers(1, &this->skybox_vbo);
+			glDeleteBuffers(1, &this->triangle_vbo);
+			glDeleteBuffers(1, &this->skybox_element_ebo);
+		}
+
+	private:
+		const char* CLOUDS_VERTEX_SHADER = "shaders/clouds_vertex.glsl";
+		const char* CLOUDS_FRAGMENT_SHADER = "shaders/clouds_fragment.glsl";
+		// the texture name is this with the size after it
+		static constexpr const char* SKY_TEXTURE = "sky_clouds";
+		// tiles across and up the window, 4:3 so the clouds aren't stretched
+		static constexpr float SKY_SPAN_X = 1.0f;
+		static constexpr float SKY_SPAN_Y = 0.75f;
+		static constexpr int N_COLOR_SHIFT_FRAMES = 7500;
+		static constexpr int N_SCROLL_SKY_FRAMES = 1000;
+		static constexpr float COLOR_DELTA = 1.0f / static_cast<float>(N_COLOR_SHIFT_FRAMES);
+		static constexpr float HORIZONTAL_SHIFT_DELTA = 1.0f / static_cast<float>(N_SCROLL_SKY_FRAMES);
+
+		enum FRAME_OPERATION {INC, DEC};
+		FRAME_OPERATION i_op;
+		float intensity;
+		float horizontal_shift;
+		bool show_triangle;
+		bool toggle_held;
+
+		GLuint skybox_vbo, triangle_vbo, skybox_element_ebo, sky_vao, triangle_vao;
+		bool owns_sky;
+		char sky_name[48];
+		soupcans::JobSystem* cloud_jobs;
+		int sky_size;
+		bool gpu_clouds;
+		ShaderPermutations shaders;
+		int intensity_location, horizontal_shift_location;
+
+		RenderScaleController render_scale;
+		scaledRenderTarget scene_target;
+		gpuFrameTimer gpu_timer;
+
+		static GLuint uploadCpuClouds(TextureRegistry& textures, const char* name,
+									  soupcans::JobSystem* jobs, int size) {
+			std::vector<unsigned char> pixels((size_t)size * size * 4);
+			soupcans::generateCloudTexture(soupcans::DEFAULT_CLOUDS, size, size,
+										   pixels.data(), jobs);
+			return textures.upload(name, pixels.data(), size, size, 4);
+		}
+
+		GLuint generateCloudTexture(Runtime& runtime) {
+			return uploadCpuClouds(runtime.textures(), this->sky_name, &runtime.jobs(),
+								   this->sky_size);
+		}
+
+		static bool reloadClouds(TextureRegistry& textures, const char* name, void* user_data) {
+			ShaderTriangleScene* scene = static_cast<ShaderTriangleScene*>(user_data);
+			return uploadCpuClouds(textures, name, scene->cloud_jobs, scene->sky_size) != 0;
+		}
+
+		// the same clouds drawn straight into the texture, nothing crosses the bus
+		GLuint drawCloudTexture(Runtime& runtime) {
+			GLuint program = runtime.loadShaderProgram(CLOUDS_VERTEX_SHADER,
+													   CLOUDS_FRAGMENT_SHADER);
+			if (!program) {
+				return 0;
+			}
+			GLuint texture = runtime.textures().allocate(this->sky_name, this->sky_size,
+														 this->sky_size, 4);
+			GLuint fbo, empty_vao;
+			glGenFramebuffers(1, &fbo);
+			glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+								   texture, 0);
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE) {
+				const soupcans::cloudSettings& clouds = soupcans::DEFAULT_CLOUDS;
+				glUseProgram(program);
+				glUniform2f(glGetUniformLocation(program, "tile_size"),
+							(float)this->sky_size, (float)this->sky_size);
+				glUniform1i(glGetUniformLocation(program, "period"), clouds.period);
+				glUniform1i(glGetUniformLocation(program, "n_octaves"), clouds.n_octaves);
+				glUniform1f(glGetUniformLocation(program, "persistence"), clouds.persistence);
+				glUniform1f(glGetUniformLocation(program, "coverage"), clouds.coverage);
+				glUniform1i(glGetUniformLocation(program, "seed"), (GLint)clouds.seed);
+				glGenVertexArrays(1, &empty_vao);
+				glBindVertexArray(empty_vao);
+				glViewport(0, 0, this->sky_size, this->sky_size);
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+				glBindVertexArray(0);
+				glDeleteVertexArrays(1, &empty_vao);
+
+				glBindTexture(GL_TEXTURE_2D, texture);
+				glGenerateMipmap(GL_TEXTURE_2D);
+				glBindTexture(GL_TEXTURE_2D, 0);
+				runtime.textures().invalidateBindings();
+			} else {
+				SOUP_LOG_ERROR("sky framebuffer is incomplete");
+				texture = 0;
+			}
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glDeleteFramebuffers(1, &fbo);
+			glDeleteProgram(program);
+			return texture;
+		}
+
+		// T hides the triangle, which only means one program fewer per frame
+		void readToggleKey(Runtime& runtime) {
+			bool toggle = runtime.keyPressed(GLFW_KEY_T);
+			if (toggle && !this->toggle_held) {
+				this->show_triangle = !this->show_triangle;
+			}
+			this->toggle_held = toggle;
+		}
+
+		// after every (re)load, the programs start without our uniforms
+		void lookUpUniforms(Runtime& runtime) {
+			GLuint triangle_prog = this->shaders.get(runtime, DRAW_TRIANGLE);
+			GLuint sky_prog = this->shaders.get(runtime, DRAW_SKY);
+			this->intensity_location = glGetUniformLocation(triangle_prog, "intensity");
+			this->horizontal_shift_location = glGetUniformLocation(sky_prog, "horizontal_shift");
+		}
+};
+
+// [sky_size] [--gpu-clouds]
+std::unique_ptr<Scene> soupcans::createShaderTriangleScene(int argc, char** argv) {
+	int sky_size = 1024;
+	bool gpu_clouds = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--gpu-clouds") == 0) {
+			gpu_clouds = true;
+		} else if (atoi(argv[i]) > 0) {
+			sky_size = atoi(argv[i]);
+		}
+	}
+	return std::unique_ptr<Scene>(new ShaderTriangleScene(sky_size, gpu_clouds));
+}
@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "../common/frameShare.hpp"
+
+using namespace soupcans;
+
+/* The smallest useful consumer of a demo run with --serve SOCKET: reads
+   every frame it is woken for in place, straight out of the shared
+   mapping, and reports how late frames reach it. What a compositor
+   would do with the pixels (upload them, blend them) goes where the
+   average is taken here.
+*/
+
+// P6 rows go top to bottom, the shared ones bottom to top
+static bool writePpm(const char* path, const sharedFrame& frame) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", frame.width, frame.height);
+    std::vector<unsigned char> row((size_t)frame.width * 3);
+    for (int y = frame.height - 1; y >= 0; y--) {
+        const unsigned char* src = frame.pixels + (size_t)y * frame.stride;
+        for (int x = 0; x < frame.width; x++) {
+            row[x * 3 + 0] = src[x * 4 + 0];
+            row[x * 3 + 1] = src[x * 4 + 1];
+            row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        fwrite(row.data(), 1, row.size(), file);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+// milliseconds, sorts the samples
+static double percentile(std::vector<double>& samples, double p) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t i = (size_t)(p * (samples.size() - 1) + 0.5);
+    return samples[i];
+}
+
+int main(int argc, char** argv) {
+    uint64_t max_frames = 0;
+    const char* snapshot_path = nullptr;
+    const char* socket_path = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            max_frames = strtoull(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--snapshot") && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else if (argv[i][0] != '-' && !socket_path) {
+            socket_path = argv[i];
+        } else {
+            socket_path = nullptr;
+            break;
+        }
+    }
+    if (!socket_path) {
+        fprintf(stderr, "usage: %s [--frames N] [--snapshot FILE.ppm] SOCKET\n", argv[0]);
+        return 1;
+    }
+
+    FrameShareClient client;
+    if (!client.connect(socket_path)) {
+        return 1;
+    }
+    std::vector<double> capture_latency, publish_latency;
+    uint64_t n_frames = 0, n_skipped = 0, n_notified = 0;
+    uint64_t last_frame = 0;
+    uint64_t report_start = frameShareClockNs();
+    uint64_t report_frames = 0;
+    while (client.connected() && (max_frames == 0 || n_frames < max_frames)) {
+        uint64_t published = client.waitFrames(1000);
+        sharedFrame frame;
+        if (published == 0 || !client.acquire(&frame)) {
+            continue;
+        }
+        n_notified += published;
+        if (n_frames > 0 && frame.frame == last_frame) {
+            // the wake before this one already found it, the server was a step ahead
+            client.release();
+            continue;
+        }
+        uint64_t acquired_ns = frameShareClockNs();
+        if (n_frames > 0 && frame.frame > last_frame + 1) {
+            n_skipped += frame.frame - last_frame - 1;
+        }
+        last_frame = frame.frame;
+
+        // touch every pixel where it lies, as uploading it would
+        uint64_t sums[3] = { 0, 0, 0 };
+        for (int y = 0; y < frame.height; y++) {
+            const unsigned char* row = frame.pixels + (size_t)y * frame.stride;
+            for (int x = 0; x < frame.width; x++) {
+                sums[0] += row[x * 4 + 0];
+                sums[1] += row[x * 4 + 1];
+                sums[2] += row[x * 4 + 2];
+            }
+        }
+        if (snapshot_path && n_frames == 0 && !writePpm(snapshot_path, frame)) {
+            fprintf(stderr, "could not write %s\n", snapshot_path);
+        }
+        capture_latency.push_back((acquired_ns - frame.capture_ns) / 1e6);
+        publish_latency.push_back((acquired_ns - frame.publish_ns) / 1e6);
+        client.release();
+        n_frames++;
+        report_frames++;
+
+        uint64_t now = frameShareClockNs();
+        if (now - report_start >= 1000000000ull) {
+            double pixels = (double)frame.width * frame.height;
+            printf("frame %llu: %.1f fps, %.2f ms after readback, average rgb %.0f %.0f %.0f\n",
+                   (unsigned long long)frame.frame, report_frames * 1e9 / (now - report_start),
+                   capture_latency.back(), sums[0] / pixels, sums[1] / pixels, sums[2] / pixels);
+            report_start = now;
+            report_frames = 0;
+        }
+    }
+    client.close();
+
+    printf("%llu frames read, %llu published, %llu skipped\n", (unsigned long long)n_frames,
+           (unsigned long long)n_notified, (unsigned long long)n_skipped);
+    std::vector<double>* latencies[2] = { &capture_latency, &publish_latency };
+    const char* labels[2] = { "readback to read", "publish to read" };
+    for (int i = 0; i < 2 && n_frames > 0; i++) {
+        double p50 = percentile(*latencies[i], 0.5);
+        double p95 = percentile(*latencies[i], 0.95);
+        printf("%-17s p50 %.3f ms, p95 %.3f ms, max %.3f ms\n", labels[i], p50, p95,
+               latencies[i]->back());
+    }
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "../common/meshFormat.hpp"
+
+using namespace soupcans;
+
+struct objOptions {
+    bool flip_v = false;
+    bool normals = true;
+    bool colors = true;
+};
+
+// one corner of a face, indices into the v, vt and vn lists, -1 when absent
+typedef std::tuple<int, int, int> objCorner;
+
+// OBJ indices start at 1, negative ones count back from the end of the list
+static bool resolveIndex(const char* text, size_t count, int* index) {
+    if (!*text) {
+        *index = -1;
+        return true;
+    }
+    long i = strtol(text, nullptr, 10);
+    long resolved = (i < 0) ? static_cast<long>(count) + i : i - 1;
+    if (i == 0 || resolved < 0 || resolved >= static_cast<long>(count)) {
+        return false;
+    }
+    *index = static_cast<int>(resolved);
+    return true;
+}
+
+/* Triangles from the v, vt, vn and f lines of an OBJ file; polygons are
+   fanned, everything else (groups, materials, smoothing) is skipped. A
+   vertex is each distinct v/vt/vn corner. Colors come from the common
+   "v x y z r g b" extension.
+*/
+static bool readObj(const char* path, const objOptions& options, meshSource* mesh) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "could not open %s\n", path);
+        return false;
+    }
+    std::vector<float> positions, colors, texcoords, normals;
+    std::vector<objCorner> corners;
+    bool has_colors = false;
+    char line[1024];
+    int line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), file)) {
+        line_number++;
+        float x = 0.0f, y = 0.0f, z = 0.0f, r = 1.0f, g = 1.0f, b = 1.0f;
+        if (!strncmp(line, "v ", 2)) {
+            int n = sscanf(line + 2, "%f %f %f %f %f %f", &x, &y, &z, &r, &g, &b);
+            ok = n >= 3;
+            has_colors = has_colors || n == 6;
+            positions.insert(positions.end(), { x, y, z });
+            colors.insert(colors.end(), { r, g, b, 1.0f });
+        } else if (!strncmp(line, "vt ", 3)) {
+            ok = sscanf(line + 3, "%f %f", &x, &y) >= 1;
+            texcoords.insert(texcoords.end(), { x, options.flip_v ? 1.0f - y : y });
+        } else if (!strncmp(line, "vn ", 3)) {
+            ok = sscanf(line + 3, "%f %f %f", &x, &y, &z) == 3;
+            normals.insert(normals.end(), { x, y, z });
+        } else if (!strncmp(line, "f ", 2)) {
+            std::vector<objCorner> face;
+            for (char* token = strtok(line + 2, " \t\r\n"); token && ok;
+                 token = strtok(nullptr, " \t\r\n")) {
+                // v, v/vt, v//vn or v/vt/vn
+                char* parts[3] = { token, nullptr, nullptr };
+                for (int p = 1; p < 3; p++) {
+                    char* slash = parts[p - 1] ? strchr(parts[p - 1], '/') : nullptr;
+                    if (slash) {
+                        *slash = '\0';
+                        parts[p] = slash + 1;
+                    }
+                }
+                int v, vt = -1, vn = -1;
+                ok = *parts[0] && resolveIndex(parts[0], positions.size() / 3, &v) &&
+                     (!parts[1] || resolveIndex(parts[1], texcoords.size() / 2, &vt)) &&
+                     (!parts[2] || resolveIndex(parts[2], normals.size() / 3, &vn));
+                face.push_back(objCorner(v, vt, vn));
+            }
+            ok = ok && face.size() >= 3;
+            for (size_t i = 2; ok && i < face.size(); i++) {
+                corners.insert(corners.end(), { face[0], face[i - 1], face[i] });
+            }
+        }
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "%s:%d: can't read this line\n", path, line_number);
+        return false;
+    }
+
+    bool use_texcoords = false, use_normals = false;
+    for (const objCorner& corner : corners) {
+        use_texcoords = use_texcoords || std::get<1>(corner) >= 0;
+        use_normals = use_normals || (options.normals && std::get<2>(corner) >= 0);
+    }
+    bool use_colors = options.colors && has_colors;
+
+    std::map<objCorner, uint32_t> vertices;
+    for (const objCorner& corner : corners) {
+        std::map<objCorner, uint32_t>::iterator found = vertices.find(corner);
+        if (found != vertices.end()) {
+            mesh->indices.push_back(found->second);
+            continue;
+        }
+        uint32_t index = static_cast<uint32_t>(vertices.size());
+        vertices[corner] = index;
+        mesh->indices.push_back(index);
+        int v = std::get<0>(corner), vt = std::get<1>(corner), vn = std::get<2>(corner);
+        mesh->positions.insert(mesh->positions.end(), &positions[v * 3], &positions[v * 3 + 3]);
+        if (use_colors) {
+            mesh->colors.insert(mesh->colors.end(), &colors[v * 4], &colors[v * 4 + 4]);
+        }
+        if (use_texcoords) {
+            if (vt >= 0) {
+                mesh->texcoords.insert(mesh->texcoords.end(),
+                                       &texcoords[vt * 2], &texcoords[vt * 2 + 2]);
+            } else {
+                mesh->texcoords.insert(mesh->texcoords.end(), { 0.0f, 0.0f });
+            }
+        }
+        if (use_normals) {
+            if (vn >= 0) {
+                mesh->normals.insert(mesh->normals.end(), &normals[vn * 3], &normals[vn * 3 + 3]);
+            } else {
+                mesh->normals.insert(mesh->normals.end(), { 0.0f, 0.0f, 1.0f });
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    objOptions obj_options;
+    meshPackOptions pack_options;
+    const char* paths[2] = { nullptr, nullptr };
+    int n_paths = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--full-positions")) {
+            pack_options.full_positions = true;
+        } else if (!strcmp(argv[i], "--flip-v")) {
+            obj_options.flip_v = true;
+        } else if (!strcmp(argv[i], "--no-normals")) {
+            obj_options.normals = false;
+        } else if (!strcmp(argv[i], "--no-colors")) {
+            obj_options.colors = false;
+        } else if (argv[i][0] != '-' && n_paths < 2) {
+            paths[n_paths++] = argv[i];
+        } else {
+            n_paths = 0;
+            break;
+        }
+    }
+    if (n_paths != 2) {
+        fprintf(stderr, "usage: %s [--full-positions] [--flip-v] [--no-normals] [--no-colors] "
+                        "input.obj output.smsh\n", argv[0]);
+        return 1;
+    }
+
+    meshSource mesh;
+    std::vector<uint8_t> packed;
+    if (!readObj(paths[0], obj_options, &mesh) || !packMesh(mesh, pack_options, &packed)) {
+        return 1;
+    }
+    FILE* out = fopen(paths[1], "wb");
+    if (!out || fwrite(packed.data(), 1, packed.size(), out) != packed.size()) {
+        fprintf(stderr, "could not write %s\n", paths[1]);
+        if (out) {
+            fclose(out);
+        }
+        return 1;
+    }
+    fclose(out);
+
+    // against the same mesh as float attributes and 32 bit indices
+    size_t n_vertices = mesh.positions.size() / 3;
+    size_t unpacked = (mesh.positions.size() + mesh.normals.size() + mesh.texcoords.size() +
+                       mesh.colors.size()) * sizeof(float) + mesh.indices.size() * 4;
+    printf("%s: %zu vertices, %zu triangles, %zu bytes (%.0f%% of unpacked)\n",
+           paths[1], n_vertices, mesh.indices.size() / 3, packed.size(),
+           100.0 * packed.size() / unpacked);
+    return 0;
+}
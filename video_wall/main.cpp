@@ -0,0 +1,16 @@
+#include "../runtime/sceneList.hpp"
+#include "../runtime/windowWall.hpp"
+
+using namespace soupcans;
+
+const namedScene SCENES[] = {
+    { "bouncing_candy", createBouncingCandyScene },
+    { "dvd_triangle", createDvdTriangleScene },
+    { "image_cube", createImageCubeScene },
+    { "rotating_colors", createRotatingColorsScene },
+    { "shader_triangle", createShaderTriangleScene },
+};
+
+int main(int argc, char** argv) {
+    return runWallMain(argc, argv, SCENES, sizeof(SCENES) / sizeof(SCENES[0]));
+}